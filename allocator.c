@@ -0,0 +1,597 @@
+//
+// allocator.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "allocator.h"
+
+#include <stdbit.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Block headers : every allocation is preceded by a 16 byte header, so
+//                   frees and reallocations know the block's origin
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t hostPoolNoClass     = UINT16_MAX;
+constexpr size_t   hostHeaderSize      = 16;
+constexpr size_t   hostMinBlockSizeLog = 5;         // 32 bytes
+
+typedef struct HostBlockHeader
+{
+    uint64_t size;              // requested size
+    uint16_t scope;
+    uint16_t sizeClass;         // hostPoolNoClass when not pooled
+    uint32_t offset;            // from the start of the block
+}
+HostBlockHeader;
+
+static_assert(sizeof(HostBlockHeader) == hostHeaderSize);
+
+// * getHeader
+//
+HostBlockHeader* getHeader(void* pMemory)
+{
+    return (HostBlockHeader*)( (uint8_t*)pMemory - hostHeaderSize );
+}
+
+// * getSizeClass : hostPoolNoClass for blocks too large to pool
+//
+uint32_t getSizeClass(size_t size) [[unsequenced]]
+{
+    auto const blockSizeLog = stdc_bit_width(size + hostHeaderSize - 1);
+    auto const sizeClass    = (blockSizeLog < hostMinBlockSizeLog)
+                            ? 0 : blockSizeLog - hostMinBlockSizeLog;
+
+    return (sizeClass < hostPoolClassCount) ? (uint32_t)sizeClass : hostPoolNoClass;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Thread caches : each thread keeps up to threadCacheCapacity free blocks
+//                   per scope and class, exchanging half of them with the
+//                   shared list when it runs empty or full
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t threadCacheCapacity = 64;
+
+typedef struct ThreadCache
+{
+    HostAllocator* pOwner;
+    void*          heads[hostAllocationScopeCount][hostPoolClassCount];
+    uint32_t       counts[hostAllocationScopeCount][hostPoolClassCount];
+}
+ThreadCache;
+
+thread_local ThreadCache* pThreadCache;
+
+tss_t     threadCacheKey;
+once_flag threadCacheKeyOnce = ONCE_FLAG_INIT;
+
+// * lockList / unlockList
+//
+void lockList(HostPoolList* pList)
+{
+    while (atomic_flag_test_and_set_explicit(&pList->lock, memory_order_acquire)) {
+        thrd_yield();
+    }
+}
+
+void unlockList(HostPoolList* pList)
+{
+    atomic_flag_clear_explicit(&pList->lock, memory_order_release);
+}
+
+// * moveBlocks : up to count blocks between free lists
+//
+uint32_t moveBlocks(void** pFromHead, void** pToHead, uint32_t count)
+{
+    uint32_t moved = 0;
+
+    while (moved < count && nullptr != *pFromHead)
+    {
+        auto const block = *pFromHead;
+
+        memcpy(pFromHead, block, sizeof(void*));
+        memcpy(block, pToHead, sizeof(void*));
+
+        *pToHead = block;
+        ++moved;
+    }
+
+    return moved;
+}
+
+// * flushThreadCache : return every cached block to its shared list
+//
+void flushThreadCache(ThreadCache* pCache)
+{
+    if (nullptr == pCache->pOwner) {
+        return;
+    }
+
+    for (uint32_t ss = 0; ss < hostAllocationScopeCount; ++ss)
+    {
+        for (uint32_t cc = 0; cc < hostPoolClassCount; ++cc)
+        {
+            auto const pList = &pCache->pOwner->pools[ss][cc];
+
+            lockList(pList);
+
+            pList->count += moveBlocks( &pCache->heads[ss][cc], &pList->head,
+                                        pCache->counts[ss][cc] );
+            unlockList(pList);
+
+            pCache->counts[ss][cc] = 0;
+        }
+    }
+
+    pCache->pOwner = nullptr;
+}
+
+// * destroyThreadCache : runs as each thread exits
+//
+void destroyThreadCache(void* pCache)
+{
+    flushThreadCache(pCache);
+    free(pCache);
+}
+
+// * createThreadCacheKey
+//
+void createThreadCacheKey(void)
+{
+    tss_create(&threadCacheKey, destroyThreadCache);
+}
+
+// * getThreadCache : bound to pAllocator, or null when out of memory
+//
+ThreadCache* getThreadCache(HostAllocator* pAllocator)
+{
+    if (nullptr == pThreadCache)
+    {
+        call_once(&threadCacheKeyOnce, createThreadCacheKey);
+
+        pThreadCache = calloc(1, sizeof(ThreadCache));
+
+        if (nullptr == pThreadCache) {
+            return nullptr;
+        }
+
+        tss_set(threadCacheKey, pThreadCache);
+    }
+
+    //  - a thread moving to another allocator gives its blocks back first
+    if (pAllocator != pThreadCache->pOwner)
+    {
+        flushThreadCache(pThreadCache);
+        pThreadCache->pOwner = pAllocator;
+    }
+
+    return pThreadCache;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Accounting
+//
+//====----------------------------------------------------------------------====
+
+// * countAllocation
+//
+void countAllocation(HostAllocationCounters* pCounters, size_t size)
+{
+    auto const bytes = size + atomic_fetch_add(&pCounters->bytes, size);
+
+    atomic_fetch_add(&pCounters->allocations, 1);
+    atomic_fetch_add(&pCounters->totalBytes, size);
+
+    auto peak = atomic_load(&pCounters->peakBytes);
+
+    while (peak < bytes && !atomic_compare_exchange_weak(&pCounters->peakBytes, &peak, bytes)) {
+    }
+}
+
+// * countFree
+//
+void countFree(HostAllocationCounters* pCounters, size_t size)
+{
+    atomic_fetch_add(&pCounters->frees, 1);
+    atomic_fetch_sub(&pCounters->bytes, size);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Allocation
+//
+//====----------------------------------------------------------------------====
+
+// * allocateBlock
+//
+void* allocateBlock( HostAllocator*          pAllocator,
+                     size_t                  size,
+                     size_t                  alignment,
+                     VkSystemAllocationScope scope )
+{
+    auto const scopeIndex = (uint32_t)scope % hostAllocationScopeCount;
+    auto const pCounters  = &pAllocator->scopes[scopeIndex];
+
+    auto sizeClass = getSizeClass(size);
+
+    if (HOST_ALLOCATOR_MODE_POOLED != pAllocator->mode || hostHeaderSize < alignment) {
+        sizeClass = hostPoolNoClass;
+    }
+
+    uint8_t* pBlock = nullptr;
+    size_t   offset = hostHeaderSize;
+
+    if (hostPoolNoClass == sizeClass)
+    {
+        //  - malloc, aligning the memory after the header
+        if (alignment < hostHeaderSize) {
+            alignment = hostHeaderSize;
+        }
+
+        pBlock = malloc(size + hostHeaderSize + alignment - 1);
+
+        if (nullptr == pBlock) {
+            return nullptr;
+        }
+
+        auto const address = (uintptr_t)pBlock + hostHeaderSize;
+
+        offset = hostHeaderSize + ( (alignment - address % alignment) % alignment );
+    }
+    else
+    {
+        //  - pooled : thread cache, then the shared list, then malloc
+        auto const pCache = getThreadCache(pAllocator);
+
+        if (nullptr != pCache)
+        {
+            auto const pHead  = &pCache->heads[scopeIndex][sizeClass];
+            auto const pCount = &pCache->counts[scopeIndex][sizeClass];
+
+            if (0 == *pCount)
+            {
+                auto const pList = &pAllocator->pools[scopeIndex][sizeClass];
+
+                lockList(pList);
+
+                auto const moved = moveBlocks( &pList->head, pHead,
+                                               threadCacheCapacity / 2 );
+                pList->count -= moved;
+
+                unlockList(pList);
+
+                *pCount += moved;
+            }
+
+            if (0 < *pCount)
+            {
+                pBlock = *pHead;
+
+                memcpy(pHead, pBlock, sizeof(void*));
+                --*pCount;
+
+                atomic_fetch_add(&pCounters->poolHits, 1);
+            }
+        }
+
+        if (nullptr == pBlock)
+        {
+            pBlock = malloc((size_t)1 << (sizeClass + hostMinBlockSizeLog));
+
+            if (nullptr == pBlock) {
+                return nullptr;
+            }
+        }
+    }
+
+    auto const pMemory = pBlock + offset;
+
+    *getHeader(pMemory) = (HostBlockHeader){
+        .size      = size,
+        .scope     = (uint16_t)scopeIndex,
+        .sizeClass = (uint16_t)sizeClass,
+        .offset    = (uint32_t)offset
+    };
+
+    countAllocation(pCounters, size);
+
+    return pMemory;
+}
+
+// * freeBlock
+//
+void freeBlock(HostAllocator* pAllocator, void* pMemory)
+{
+    auto const header = *getHeader(pMemory);
+    auto const pBlock = (uint8_t*)pMemory - header.offset;
+
+    countFree(&pAllocator->scopes[header.scope], header.size);
+
+    if (hostPoolNoClass == header.sizeClass)
+    {
+        free(pBlock);
+        return;
+    }
+
+    //  - pooled : back to the thread cache, spilling half when full
+    auto const pCache = getThreadCache(pAllocator);
+
+    if (nullptr == pCache)
+    {
+        free(pBlock);
+        return;
+    }
+
+    auto const pHead  = &pCache->heads[header.scope][header.sizeClass];
+    auto const pCount = &pCache->counts[header.scope][header.sizeClass];
+
+    if (threadCacheCapacity <= *pCount)
+    {
+        auto const pList = &pAllocator->pools[header.scope][header.sizeClass];
+
+        lockList(pList);
+
+        pList->count += moveBlocks(pHead, &pList->head, threadCacheCapacity / 2);
+
+        unlockList(pList);
+
+        *pCount -= threadCacheCapacity / 2;
+    }
+
+    memcpy(pBlock, pHead, sizeof(void*));
+
+    *pHead = pBlock;
+    ++*pCount;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Callbacks
+//
+//====----------------------------------------------------------------------====
+
+// * hostAllocation
+//
+VKAPI_ATTR void* VKAPI_CALL hostAllocation( void*                   pUserData,
+                                            size_t                  size,
+                                            size_t                  alignment,
+                                            VkSystemAllocationScope scope )
+{
+    if (0 == size) {
+        return nullptr;
+    }
+
+    return allocateBlock(pUserData, size, alignment, scope);
+}
+
+// * hostReallocation
+//
+VKAPI_ATTR void* VKAPI_CALL hostReallocation( void*                   pUserData,
+                                              void*                   pOriginal,
+                                              size_t                  size,
+                                              size_t                  alignment,
+                                              VkSystemAllocationScope scope )
+{
+    HostAllocator* pAllocator = pUserData;
+
+    if (nullptr == pOriginal) {
+        return hostAllocation(pUserData, size, alignment, scope);
+    }
+
+    if (0 == size)
+    {
+        freeBlock(pAllocator, pOriginal);
+        return nullptr;
+    }
+
+    auto const originalSize = getHeader(pOriginal)->size;
+
+    //  - on failure the original allocation is left untouched
+    auto const pMemory = allocateBlock(pAllocator, size, alignment, scope);
+
+    if (nullptr != pMemory)
+    {
+        memcpy(pMemory, pOriginal, (originalSize < size) ? originalSize : size);
+        freeBlock(pAllocator, pOriginal);
+
+        atomic_fetch_add(&pAllocator->scopes[getHeader(pMemory)->scope].reallocations, 1);
+    }
+
+    return pMemory;
+}
+
+// * hostFree
+//
+VKAPI_ATTR void VKAPI_CALL hostFree(void* pUserData, void* pMemory)
+{
+    if (nullptr != pMemory) {
+        freeBlock(pUserData, pMemory);
+    }
+}
+
+// * hostInternalAllocation
+//
+VKAPI_ATTR void VKAPI_CALL hostInternalAllocation
+(
+    void*                                   pUserData,
+    size_t                                  size,
+    [[maybe_unused]] VkInternalAllocationType allocationType,
+    VkSystemAllocationScope                 scope
+)
+{
+    HostAllocator* pAllocator = pUserData;
+
+    auto const pCounters = &pAllocator->scopes[(uint32_t)scope % hostAllocationScopeCount];
+
+    atomic_fetch_add(&pCounters->internalAllocations, 1);
+    atomic_fetch_add(&pCounters->internalBytes, size);
+}
+
+// * hostInternalFree
+//
+VKAPI_ATTR void VKAPI_CALL hostInternalFree
+(
+    void*                                   pUserData,
+    size_t                                  size,
+    [[maybe_unused]] VkInternalAllocationType allocationType,
+    VkSystemAllocationScope                 scope
+)
+{
+    HostAllocator* pAllocator = pUserData;
+
+    auto const pCounters = &pAllocator->scopes[(uint32_t)scope % hostAllocationScopeCount];
+
+    atomic_fetch_sub(&pCounters->internalBytes, size);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * HostAllocator
+//
+//====----------------------------------------------------------------------====
+
+// * createHostAllocator
+//
+VkResult createHostAllocator(HostAllocatorMode mode, HostAllocator* pAllocator)
+{
+    memset( pAllocator, 0, sizeof(*pAllocator) );
+
+    pAllocator->mode      = mode;
+    pAllocator->callbacks = (VkAllocationCallbacks){
+        .pUserData             = pAllocator,
+        .pfnAllocation         = hostAllocation,
+        .pfnReallocation       = hostReallocation,
+        .pfnFree               = hostFree,
+        .pfnInternalAllocation = hostInternalAllocation,
+        .pfnInternalFree       = hostInternalFree
+    };
+
+    for (uint32_t ss = 0; ss < hostAllocationScopeCount; ++ss)
+    {
+        for (uint32_t cc = 0; cc < hostPoolClassCount; ++cc) {
+            atomic_flag_clear(&pAllocator->pools[ss][cc].lock);
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+// * destroyHostAllocator
+//
+void destroyHostAllocator(HostAllocator* pAllocator)
+{
+    if (nullptr != pThreadCache && pAllocator == pThreadCache->pOwner) {
+        flushThreadCache(pThreadCache);
+    }
+
+    for (uint32_t ss = 0; ss < hostAllocationScopeCount; ++ss)
+    {
+        for (uint32_t cc = 0; cc < hostPoolClassCount; ++cc)
+        {
+            auto const pList = &pAllocator->pools[ss][cc];
+
+            while (nullptr != pList->head)
+            {
+                auto const block = pList->head;
+
+                memcpy(&pList->head, block, sizeof(void*));
+                free(block);
+            }
+        }
+    }
+
+    memset( pAllocator, 0, sizeof(*pAllocator) );
+}
+
+// * getHostAllocationCallbacks
+//
+const VkAllocationCallbacks* getHostAllocationCallbacks(const HostAllocator* pAllocator)
+{
+    return (nullptr != pAllocator) ? &pAllocator->callbacks : nullptr;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Reporting
+//
+//====----------------------------------------------------------------------====
+
+// * getHostAllocationTotals
+//
+HostAllocationTotals getHostAllocationTotals(const HostAllocator* pAllocator)
+{
+    HostAllocationTotals totals = {};
+
+    for (uint32_t ss = 0; ss < hostAllocationScopeCount; ++ss)
+    {
+        auto const pCounters = &pAllocator->scopes[ss];
+
+        totals.calls      += atomic_load(&pCounters->allocations)
+                           + atomic_load(&pCounters->frees);
+        totals.bytes      += atomic_load(&pCounters->bytes);
+        totals.totalBytes += atomic_load(&pCounters->totalBytes);
+    }
+
+    return totals;
+}
+
+// * writeHostAllocatorReport
+//
+bool writeHostAllocatorReport(FILE* file, const HostAllocator* pAllocator)
+{
+    const char* const scopeNames[hostAllocationScopeCount] = {
+        "command", "object", "cache", "device", "instance"
+    };
+
+    fprintf( file, "{\n  \"mode\": \"%s\",\n  \"scopes\": {",
+             (HOST_ALLOCATOR_MODE_POOLED == pAllocator->mode) ? "pooled" : "counting" );
+
+    for (uint32_t ss = 0; ss < hostAllocationScopeCount; ++ss)
+    {
+        auto const pCounters = &pAllocator->scopes[ss];
+
+        fprintf( file,
+                 "%s\n    \"%s\": { \"allocations\": %llu, \"reallocations\": %llu, "
+                 "\"frees\": %llu, \"bytes\": %llu, \"peak_bytes\": %llu, "
+                 "\"total_bytes\": %llu, \"pool_hits\": %llu, "
+                 "\"internal_allocations\": %llu, \"internal_bytes\": %llu }",
+                 (0 < ss) ? "," : "", scopeNames[ss],
+                 (unsigned long long)atomic_load(&pCounters->allocations),
+                 (unsigned long long)atomic_load(&pCounters->reallocations),
+                 (unsigned long long)atomic_load(&pCounters->frees),
+                 (unsigned long long)atomic_load(&pCounters->bytes),
+                 (unsigned long long)atomic_load(&pCounters->peakBytes),
+                 (unsigned long long)atomic_load(&pCounters->totalBytes),
+                 (unsigned long long)atomic_load(&pCounters->poolHits),
+                 (unsigned long long)atomic_load(&pCounters->internalAllocations),
+                 (unsigned long long)atomic_load(&pCounters->internalBytes) );
+    }
+
+    fprintf(file, "\n  }\n}\n");
+
+    return 0 == ferror(file);
+}
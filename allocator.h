@@ -0,0 +1,117 @@
+//
+// allocator.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Host allocator : VkAllocationCallbacks with per-scope accounting, and
+//                    optionally a thread-caching pool per scope
+//
+//====----------------------------------------------------------------------====
+
+// * Scopes follow VkSystemAllocationScope : command, object, cache,
+//   device and instance
+//
+constexpr uint32_t hostAllocationScopeCount = 5;
+
+// * Pooled blocks are powers of two from 32 bytes to 64 KiB, including a
+//   16 byte header. Larger or over-aligned requests go to malloc
+//
+constexpr uint32_t hostPoolClassCount = 12;
+
+typedef enum HostAllocatorMode
+{
+    HOST_ALLOCATOR_MODE_COUNTING = 0,   // malloc, with accounting
+    HOST_ALLOCATOR_MODE_POOLED   = 1    // thread-caching pool per scope
+}
+HostAllocatorMode;
+
+// * HostAllocationCounters : bytes are as requested by the driver
+//
+typedef struct HostAllocationCounters
+{
+    atomic_uint_fast64_t allocations;
+    atomic_uint_fast64_t reallocations;
+    atomic_uint_fast64_t frees;
+    atomic_uint_fast64_t bytes;             // currently allocated
+    atomic_uint_fast64_t peakBytes;
+    atomic_uint_fast64_t totalBytes;        // allocated over the lifetime
+    atomic_uint_fast64_t poolHits;          // served from a pool free list
+    atomic_uint_fast64_t internalAllocations;
+    atomic_uint_fast64_t internalBytes;     // reported by the driver
+}
+HostAllocationCounters;
+
+// * HostPoolList : shared free list of one scope and size class
+//
+typedef struct HostPoolList
+{
+    atomic_flag lock;
+    void*       head;
+    uint32_t    count;
+}
+HostPoolList;
+
+typedef struct HostAllocator
+{
+    VkAllocationCallbacks  callbacks;
+    HostAllocatorMode      mode;
+    HostAllocationCounters scopes[hostAllocationScopeCount];
+    HostPoolList           pools[hostAllocationScopeCount][hostPoolClassCount];
+}
+HostAllocator;
+
+// * createHostAllocator : the allocator must outlive every Vulkan object
+//                         created with it, and every thread that used it
+//
+VkResult createHostAllocator(HostAllocatorMode mode, HostAllocator* pAllocator);
+
+// * destroyHostAllocator : releases pooled blocks, including those cached
+//                          by the calling thread
+//
+void destroyHostAllocator(HostAllocator* pAllocator);
+
+// * getHostAllocationCallbacks : null for a null allocator, so callers
+//                                can pass the result straight to Vulkan
+//
+const VkAllocationCallbacks* getHostAllocationCallbacks(const HostAllocator* pAllocator);
+
+// * HostAllocationTotals : a snapshot summed over every scope
+//
+typedef struct HostAllocationTotals
+{
+    uint64_t calls;             // allocations and frees, a reallocation
+                                // counting as one of each
+    uint64_t bytes;
+    uint64_t totalBytes;
+}
+HostAllocationTotals;
+
+HostAllocationTotals getHostAllocationTotals(const HostAllocator* pAllocator);
+
+// * writeHostAllocatorReport : JSON counters per scope
+//
+bool writeHostAllocatorReport(FILE* file, const HostAllocator* pAllocator);
@@ -0,0 +1,763 @@
+//
+// bench.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "encode.h"
+#include "renderer.h"
+#include "timing.h"
+#include "utilities.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Benchmark parameters : a GPU-less machine runs the same sweep on
+//                          lavapipe, which findFirstGPU falls back to
+//
+//====----------------------------------------------------------------------====
+
+const uint32_t benchSizes[]   = { 256, 512, 1024, 2048, 4096, 8192, 16384 };
+const uint32_t benchBatches[] = { 1, 4, 16 };
+
+// * Configurations with more pixels than this per batch are skipped
+//
+constexpr uint64_t benchMaxBatchPixels = 1ull << 30;
+
+// * Regressions are reported beyond this many percent by default
+//
+constexpr double benchDefaultTolerance = 10.0;
+
+// * Readback modes : the copy path, host image copy where the device has
+//                    it, the copy path into caller memory, and each packed
+//                    layout
+//
+typedef struct ReadbackMode
+{
+    const char* name;
+    PixelLayout pixelLayout;
+    bool        hostImageCopy;
+    bool        toMemory;       // renderFrameToMemory
+}
+ReadbackMode;
+
+const ReadbackMode readbackModes[] = {
+    { "copy",      PIXEL_LAYOUT_RGBA_PREMULTIPLIED, false, false },
+    { "host-copy", PIXEL_LAYOUT_RGBA_PREMULTIPLIED, true,  false },
+    { "to-memory", PIXEL_LAYOUT_RGBA_PREMULTIPLIED, false, true  },
+    { "pack-rgba", PIXEL_LAYOUT_RGBA,               false, false },
+    { "pack-rgb",  PIXEL_LAYOUT_RGB,                false, false },
+    { "pack-gray", PIXEL_LAYOUT_GRAY,               false, false }
+};
+
+// * Color formats : as named by square. One is swept per run, so each
+//                   format's bandwidth is compared across runs
+//
+typedef struct BenchFormat
+{
+    const char* name;
+    VkFormat    format;
+}
+BenchFormat;
+
+const BenchFormat benchFormats[] = {
+    { "rgba8",   VK_FORMAT_R8G8B8A8_UNORM           },
+    { "rgb10a2", VK_FORMAT_A2B10G10R10_UNORM_PACK32 },
+    { "rgba16",  VK_FORMAT_R16G16B16A16_UNORM       },
+    { "rgba16f", VK_FORMAT_R16G16B16A16_SFLOAT      }
+};
+
+// * Caller memory of the to-memory mode is aligned for import
+//
+constexpr size_t benchMemoryAlignment = 65536;
+
+//====----------------------------------------------------------------------====
+//
+// * Results
+//
+//====----------------------------------------------------------------------====
+
+typedef struct BenchResult
+{
+    uint32_t    size;
+    uint32_t    batch;
+    const char* readback;
+    bool        encode;
+    bool        skipped;
+    double      framesPerSecond;
+    double      gpuMs;              // median, negative when unavailable
+    double      readbackMBps;
+    double      encodeMBps;         // zero when not encoding
+    double      hostCallsPerFrame;  // negative without a host allocator
+}
+BenchResult;
+
+// * BenchOptions
+//
+typedef struct BenchOptions
+{
+    uint32_t          maxSize;
+    VkFormat          colorFormat;
+    bool              useAllocator;
+    HostAllocatorMode allocatorMode;
+    bool              writeJSON;
+    const char*       outputFilename;
+    const char*       baselineFilename;
+    double            tolerance;
+}
+BenchOptions;
+
+//====----------------------------------------------------------------------====
+//
+// * Running
+//
+//====----------------------------------------------------------------------====
+
+// * renderBenchFrame : into the caller memory of pImageContext, if any
+//
+VkResult renderBenchFrame( Renderer*     pRenderer,
+                           RenderTarget* pTarget,
+                           void*         pMemory,
+                           ImageContext* pImageContext,
+                           FrameTimings* pTimings )
+{
+    if (nullptr == pMemory) {
+        return renderFrame(pRenderer, pTarget, pImageContext, pTimings);
+    }
+
+    *pImageContext = (ImageContext){
+        .width            = pTarget->width,
+        .height           = pTarget->height,
+        .bytesPerRow      = (VkDeviceSize)pTarget->width
+                          * formatBytesPerPixel(readbackColorFormat(pRenderer)),
+        .colorPixelFormat = readbackColorFormat(pRenderer),
+        .pixelLayout      = pRenderer->pixelLayout,
+        .data             = nullptr
+    };
+
+    auto const result = renderFrameToMemory( pRenderer, pTarget, pMemory,
+                                             pImageContext->bytesPerRow, pTimings );
+
+    //  - the caller memory is borrowed for encoding, never disposed of
+    pImageContext->data = (VK_SUCCESS == result) ? pMemory : nullptr;
+
+    return result;
+}
+
+// * runBatch : one warm-up frame, then batch frames back to back on the
+//              same render target. The last frame is encoded when asked
+//
+bool runBatch( Renderer*     pRenderer,
+               RenderTarget* pTarget,
+               bool          toMemory,
+               BenchResult*  pResult )
+{
+    auto const batch = pResult->batch;
+
+    auto timings = (FrameTimings*)calloc(batch, sizeof(FrameTimings));
+
+    //  - caller memory, in whole alignment blocks
+    auto const memorySize = ( (size_t)pTarget->width * pTarget->height
+                              * formatBytesPerPixel(readbackColorFormat(pRenderer))
+                              + benchMemoryAlignment - 1 ) & ~(benchMemoryAlignment - 1);
+
+    auto pMemory = toMemory ? aligned_alloc(benchMemoryAlignment, memorySize) : nullptr;
+
+    if (nullptr == timings || (toMemory && nullptr == pMemory))
+    {
+        free(timings);
+        free(pMemory);
+        return false;
+    }
+
+    //  - warm-up
+    ImageContext imageContext = {};
+
+    auto result = renderBenchFrame(pRenderer, pTarget, pMemory, &imageContext, nullptr);
+
+    if (nullptr == pMemory) {
+        disposeImageContext(&imageContext);
+    }
+
+    //  - batch : host allocator calls are counted across the whole batch
+    auto const pHostAllocator = (nullptr != pRenderer->pAllocator)
+                              ? (const HostAllocator*)pRenderer->pAllocator->pUserData
+                              : nullptr;
+
+    auto const hostCallsBefore = (nullptr != pHostAllocator)
+                               ? getHostAllocationTotals(pHostAllocator).calls : 0;
+
+    auto const start = getTimeMs();
+
+    double readbackMs    = 0.0;
+    double readbackBytes = 0.0;
+    auto   hasGPUTimings = true;
+
+    for (uint32_t ff = 0; ff < batch && VK_SUCCESS == result; ++ff)
+    {
+        result = renderBenchFrame( pRenderer, pTarget, pMemory,
+                                   &imageContext, &timings[ff] );
+
+        readbackMs    += timings[ff].readbackMs;
+        readbackBytes += (double)imageContext.bytesPerRow * imageContext.height;
+        hasGPUTimings  = hasGPUTimings && timings[ff].hasGPUTimings;
+
+        if (ff + 1 < batch && nullptr == pMemory) {
+            disposeImageContext(&imageContext);
+        }
+    }
+
+    auto const elapsedMs = getTimeMs() - start;
+
+    if (nullptr != pHostAllocator)
+    {
+        auto const hostCalls = getHostAllocationTotals(pHostAllocator).calls
+                             - hostCallsBefore;
+
+        pResult->hostCallsPerFrame = (double)hostCalls / batch;
+    }
+
+    //  - encode
+    if (VK_SUCCESS == result && pResult->encode)
+    {
+        const TIFFWriteOptions writeOptions = {};
+
+        auto const encodeStart = getTimeMs();
+        auto const didSave     = saveRGBATIFFFile( "output.bench.tiff",
+                                                   &imageContext, &writeOptions );
+        auto const encodeMs    = getTimeMs() - encodeStart;
+
+        if (didSave)
+        {
+            auto const bytes = (double)imageContext.bytesPerRow * imageContext.height;
+
+            pResult->encodeMBps = bytes / (1e3 * encodeMs);
+        }
+
+        remove("output.bench.tiff");
+    }
+
+    if (nullptr == pMemory) {
+        disposeImageContext(&imageContext);
+    }
+
+    free(pMemory);
+
+    //  - summary
+    if (VK_SUCCESS == result)
+    {
+        pResult->framesPerSecond = 1e3 * batch / elapsedMs;
+        pResult->readbackMBps    = (0.0 < readbackMs)         // none when imported
+                                 ? readbackBytes / (1e3 * readbackMs) : 0.0;
+
+        pResult->gpuMs = hasGPUTimings
+            ? summarizeTimings( &timings[0].gpuMs, batch, sizeof(FrameTimings) ).median
+            : -1.0;
+    }
+
+    free(timings);
+
+    return VK_SUCCESS == result;
+}
+
+// * runBenchmarks : every readback mode, size, batch and encode option.
+//                   Returns the number of results written to pResults
+//
+uint32_t runBenchmarks( const BenchOptions* pOptions,
+                        BenchResult*        pResults,
+                        uint32_t            capacity )
+{
+    auto const modeCount  = (uint32_t)( sizeof(readbackModes)/sizeof(readbackModes[0]) );
+    auto const sizeCount  = (uint32_t)( sizeof(benchSizes)/sizeof(benchSizes[0]) );
+    auto const batchCount = (uint32_t)( sizeof(benchBatches)/sizeof(benchBatches[0]) );
+
+    uint32_t resultCount = 0;
+
+    for (uint32_t mm = 0; mm < modeCount; ++mm)
+    {
+        //  - a fresh host allocator per renderer
+        HostAllocator hostAllocator = {};
+
+        if (pOptions->useAllocator) {
+            createHostAllocator(pOptions->allocatorMode, &hostAllocator);
+        }
+
+        const RendererInfo rendererInfo = {
+            .colorFormat          = pOptions->colorFormat,
+            .pixelLayout          = readbackModes[mm].pixelLayout,
+            .enableValidation     = false,
+            .disableHostImageCopy = !readbackModes[mm].hostImageCopy,
+            .pAllocator           = pOptions->useAllocator
+                                  ? getHostAllocationCallbacks(&hostAllocator)
+                                  : nullptr
+        };
+
+        Renderer renderer = {};
+
+        auto const didCreateRenderer
+            = (VK_SUCCESS == createRenderer(&rendererInfo, &renderer));
+
+        //  - host image copy is skipped where the device falls back to the
+        //    copy path, which has its own results
+        auto const isModeSupported = didCreateRenderer &&
+            ( renderer.useHostImageCopy == readbackModes[mm].hostImageCopy );
+
+        for (uint32_t ss = 0; ss < sizeCount; ++ss)
+        {
+            auto const size = benchSizes[ss];
+
+            if (pOptions->maxSize < size) {
+                continue;
+            }
+
+            //  - one target per size, shared by every batch
+            RenderTarget target = {};
+
+            auto const didCreateTarget = isModeSupported &&
+                ( VK_SUCCESS == createRenderTarget(&renderer, size, size, &target) );
+
+            for (uint32_t bb = 0; bb < batchCount; ++bb)
+            {
+                for (uint32_t ee = 0; ee < 2 && resultCount < capacity; ++ee)
+                {
+                    auto const pResult = &pResults[resultCount++];
+
+                    *pResult = (BenchResult){
+                        .size     = size,
+                        .batch    = benchBatches[bb],
+                        .readback = readbackModes[mm].name,
+                        .encode   = (1 == ee),
+                        .gpuMs    = -1.0,
+
+                        .hostCallsPerFrame = -1.0
+                    };
+
+                    auto const pixels = (uint64_t)size * size * pResult->batch;
+
+                    pResult->skipped = !didCreateTarget
+                                    || benchMaxBatchPixels < pixels
+                                    || !runBatch( &renderer, &target,
+                                                  readbackModes[mm].toMemory, pResult );
+
+                    fprintf( stderr, "%-9s %5u^2 x %2u %-6s %s\n",
+                             pResult->readback, size, pResult->batch,
+                             pResult->encode ? "encode" : "",
+                             pResult->skipped ? "skipped" : "done" );
+                }
+            }
+
+            if (didCreateTarget) {
+                destroyRenderTarget(&renderer, &target);
+            }
+        }
+
+        if (didCreateRenderer) {
+            destroyRenderer(&renderer);
+        }
+
+        if (pOptions->useAllocator) {
+            destroyHostAllocator(&hostAllocator);
+        }
+    }
+
+    return resultCount;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Output
+//
+//====----------------------------------------------------------------------====
+
+// * writeCSV
+//
+void writeCSV(FILE* file, const BenchResult* pResults, uint32_t count)
+{
+    fprintf( file, "size,batch,readback,encode,status,"
+                   "frames_per_s,gpu_ms,readback_mb_s,encode_mb_s,"
+                   "host_calls_per_frame\n" );
+
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        auto const r = &pResults[ii];
+
+        fprintf( file, "%u,%u,%s,%s,%s,", r->size, r->batch, r->readback,
+                 r->encode ? "tiff" : "none", r->skipped ? "skipped" : "ok" );
+
+        if (r->skipped)
+        {
+            fprintf(file, ",,,,\n");
+            continue;
+        }
+
+        fprintf(file, "%.3f,", r->framesPerSecond);
+
+        if (0.0 <= r->gpuMs) {
+            fprintf(file, "%.4f", r->gpuMs);
+        }
+
+        fprintf(file, ",%.1f,", r->readbackMBps);
+
+        if (r->encode) {
+            fprintf(file, "%.1f", r->encodeMBps);
+        }
+
+        fprintf(file, ",");
+
+        if (0.0 <= r->hostCallsPerFrame) {
+            fprintf(file, "%.1f", r->hostCallsPerFrame);
+        }
+
+        fprintf(file, "\n");
+    }
+}
+
+// * writeJSON
+//
+void writeJSON(FILE* file, const BenchResult* pResults, uint32_t count)
+{
+    fprintf(file, "{\n  \"results\": [");
+
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        auto const r = &pResults[ii];
+
+        fprintf( file, "%s\n    { \"size\": %u, \"batch\": %u, \"readback\": \"%s\", "
+                       "\"encode\": \"%s\", \"status\": \"%s\"",
+                 (0 < ii) ? "," : "", r->size, r->batch, r->readback,
+                 r->encode ? "tiff" : "none", r->skipped ? "skipped" : "ok" );
+
+        if (!r->skipped)
+        {
+            fprintf(file, ", \"frames_per_s\": %.3f", r->framesPerSecond);
+
+            if (0.0 <= r->gpuMs) {
+                fprintf(file, ", \"gpu_ms\": %.4f", r->gpuMs);
+            }
+
+            fprintf(file, ", \"readback_mb_s\": %.1f", r->readbackMBps);
+
+            if (r->encode) {
+                fprintf(file, ", \"encode_mb_s\": %.1f", r->encodeMBps);
+            }
+
+            if (0.0 <= r->hostCallsPerFrame) {
+                fprintf(file, ", \"host_calls_per_frame\": %.1f", r->hostCallsPerFrame);
+            }
+        }
+
+        fprintf(file, " }");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Baseline comparison : baselines are previously saved CSV output
+//
+//====----------------------------------------------------------------------====
+
+// * splitCSVLine : fields are returned in place, empty fields included
+//
+uint32_t splitCSVLine(char* line, char* fields[], uint32_t capacity)
+{
+    uint32_t count = 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    while (count < capacity)
+    {
+        fields[count++] = line;
+
+        auto const comma = strchr(line, ',');
+
+        if (nullptr == comma) {
+            break;
+        }
+
+        *comma = '\0';
+        line   = comma + 1;
+    }
+
+    return count;
+}
+
+// * checkMetric : reports and returns true when current is worse than
+//                 baseline by more than tolerance percent
+//
+bool checkMetric( const BenchResult* pResult,
+                  const char*        metric,
+                  const char*        baselineField,
+                  double             current,
+                  bool               isHigherBetter,
+                  double             tolerance )
+{
+    if ('\0' == baselineField[0] || current < 0.0) {
+        return false;
+    }
+
+    auto const baseline = strtod(baselineField, nullptr);
+
+    if (baseline <= 0.0) {
+        return false;
+    }
+
+    auto const change  = 100.0 * (current - baseline) / baseline;
+    auto const isWorse = isHigherBetter ? (change < -tolerance)
+                                        : (tolerance < change);
+
+    printf( "%-9s %5u^2 x %2u %-4s %-14s %12.3f %12.3f %+8.1f%%%s\n",
+            pResult->readback, pResult->size, pResult->batch,
+            pResult->encode ? "tiff" : "none", metric,
+            baseline, current, change, isWorse ? "  REGRESSION" : "" );
+
+    return isWorse;
+}
+
+// * compareWithBaseline : returns the number of regressed metrics, or -1
+//                         when the baseline cannot be read
+//
+int compareWithBaseline( const char*        filename,
+                         const BenchResult* pResults,
+                         uint32_t           count,
+                         double             tolerance )
+{
+    auto file = fopen(filename, "r");
+
+    if (nullptr == file) {
+        return -1;
+    }
+
+    printf( "%-9s %12s %-4s %-14s %12s %12s %9s\n",
+            "readback", "size", "enc", "metric", "baseline", "current", "change" );
+
+    char line[512]   = {};
+    auto regressions = 0;
+
+    //  - header
+    if (nullptr == fgets(line, sizeof(line), file))
+    {
+        fclose(file);
+        return -1;
+    }
+
+    while (nullptr != fgets(line, sizeof(line), file))
+    {
+        char* fields[10] = {};
+
+        //  - baselines from before host_calls_per_frame have nine fields
+        if (9 > splitCSVLine(line, fields, 10) || 0 != strcmp(fields[4], "ok")) {
+            continue;
+        }
+
+        auto const size     = (uint32_t)strtoul(fields[0], nullptr, 10);
+        auto const batch    = (uint32_t)strtoul(fields[1], nullptr, 10);
+        auto const isEncode = (0 == strcmp(fields[3], "tiff"));
+
+        for (uint32_t ii = 0; ii < count; ++ii)
+        {
+            auto const r = &pResults[ii];
+
+            if ( r->skipped || r->size != size || r->batch != batch ||
+                 r->encode != isEncode || 0 != strcmp(r->readback, fields[2]) )
+            {
+                continue;
+            }
+
+            regressions += checkMetric( r, "frames_per_s", fields[5],
+                                        r->framesPerSecond, true, tolerance );
+            regressions += checkMetric( r, "gpu_ms", fields[6],
+                                        r->gpuMs, false, tolerance );
+            regressions += checkMetric( r, "readback_mb_s", fields[7],
+                                        r->readbackMBps, true, tolerance );
+
+            if (r->encode)
+            {
+                regressions += checkMetric( r, "encode_mb_s", fields[8],
+                                            r->encodeMBps, true, tolerance );
+            }
+
+            if (nullptr != fields[9])
+            {
+                regressions += checkMetric( r, "host_calls", fields[9],
+                                            r->hostCallsPerFrame, false, tolerance );
+            }
+        }
+    }
+
+    fclose(file);
+
+    return regressions;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+// * printUsage
+//
+void printUsage(const char* program)
+{
+    printf( "usage: %s [--json] [--output file] [--max-size n]\n"
+            "       %*s [--format rgba8|rgb10a2|rgba16|rgba16f]\n"
+            "       %*s [--allocator none|counting|pooled]\n"
+            "       %*s [--compare baseline.csv] [--tolerance percent]\n",
+            program, (int)strlen(program), "", (int)strlen(program), "",
+            (int)strlen(program), "" );
+}
+
+int main(const int argc, const char* const argv[])
+{
+    BenchOptions options = {
+        .maxSize          = 16384,
+        .colorFormat      = VK_FORMAT_R8G8B8A8_UNORM,
+        .useAllocator     = true,
+        .allocatorMode    = HOST_ALLOCATOR_MODE_COUNTING,
+        .writeJSON        = false,
+        .outputFilename   = nullptr,
+        .baselineFilename = nullptr,
+        .tolerance        = benchDefaultTolerance
+    };
+
+    // * Arguments
+    //
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        auto const arg     = argv[ii];
+        auto const hasNext = (ii + 1 < argc);
+
+        if (0 == strcmp(arg, "--json")) {
+            options.writeJSON = true;
+        }
+        else if (0 == strcmp(arg, "--output") && hasNext) {
+            options.outputFilename = argv[++ii];
+        }
+        else if (0 == strcmp(arg, "--max-size") && hasNext) {
+            options.maxSize = (uint32_t)strtoul(argv[++ii], nullptr, 10);
+        }
+        else if (0 == strcmp(arg, "--format") && hasNext)
+        {
+            auto const name = argv[++ii];
+
+            options.colorFormat = VK_FORMAT_UNDEFINED;
+
+            for (uint32_t ff = 0; ff < sizeof(benchFormats)/sizeof(benchFormats[0]); ++ff)
+            {
+                if (0 == strcmp(benchFormats[ff].name, name)) {
+                    options.colorFormat = benchFormats[ff].format;
+                }
+            }
+
+            if (VK_FORMAT_UNDEFINED == options.colorFormat)
+            {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (0 == strcmp(arg, "--allocator") && hasNext)
+        {
+            auto const mode = argv[++ii];
+
+            options.useAllocator  = (0 != strcmp(mode, "none"));
+            options.allocatorMode = (0 == strcmp(mode, "pooled"))
+                                  ? HOST_ALLOCATOR_MODE_POOLED
+                                  : HOST_ALLOCATOR_MODE_COUNTING;
+        }
+        else if (0 == strcmp(arg, "--compare") && hasNext) {
+            options.baselineFilename = argv[++ii];
+        }
+        else if (0 == strcmp(arg, "--tolerance") && hasNext) {
+            options.tolerance = strtod(argv[++ii], nullptr);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // * Run
+    //
+    auto const capacity = (uint32_t)( sizeof(readbackModes)/sizeof(readbackModes[0])
+                                    * sizeof(benchSizes)/sizeof(benchSizes[0])
+                                    * sizeof(benchBatches)/sizeof(benchBatches[0])
+                                    * 2 );
+
+    auto results = (BenchResult*)calloc(capacity, sizeof(BenchResult));
+
+    if (nullptr == results)
+    {
+        puts("Failed to allocate benchmark results");
+        return EXIT_FAILURE;
+    }
+
+    auto const count = runBenchmarks(&options, results, capacity);
+
+    // * Report
+    //
+    auto output = stdout;
+
+    if (nullptr != options.outputFilename)
+    {
+        output = fopen(options.outputFilename, "w");
+
+        if (nullptr == output)
+        {
+            printf("Failed to open %s\n", options.outputFilename);
+            free(results);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.writeJSON) {
+        writeJSON(output, results, count);
+    }
+    else {
+        writeCSV(output, results, count);
+    }
+
+    if (stdout != output) {
+        fclose(output);
+    }
+
+    // * Compare
+    //
+    auto regressions = 0;
+
+    if (nullptr != options.baselineFilename)
+    {
+        regressions = compareWithBaseline( options.baselineFilename,
+                                           results, count, options.tolerance );
+        if (regressions < 0) {
+            printf("Failed to read baseline %s\n", options.baselineFilename);
+        }
+        else {
+            printf("%d regression(s) beyond %.1f%%\n", regressions, options.tolerance);
+        }
+    }
+
+    free(results);
+
+    return (0 == regressions) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,310 @@
+//
+// client.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * squareclient : sends render requests to a square daemon from one or
+//                  more concurrent connections and reports the latencies
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t maxClientConnections = 64;
+
+typedef struct ClientOptions
+{
+    const char* socketPath;
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    requestCount;       // per connection
+    uint32_t    connectionCount;
+    bool        useMemfd;
+    const char* outputPath;         // file replies, empty : daemon's choice
+    bool        shutdown;
+}
+ClientOptions;
+
+// * ClientResults : per connection
+//
+typedef struct ClientResults
+{
+    const ClientOptions* pOptions;
+    uint32_t             okCount;
+    uint32_t             cachedCount;   // of okCount, from the render cache
+    uint32_t             busyCount;
+    uint32_t             errorCount;
+    double*              pLatencyMs;    // round trip of each successful request
+}
+ClientResults;
+
+// * runConnection
+//
+int runConnection(void* pArgument)
+{
+    auto const pResults = (ClientResults*)pArgument;
+    auto const pOptions = pResults->pOptions;
+
+    auto const socket = connectToDaemon(pOptions->socketPath);
+
+    if (socket < 0)
+    {
+        pResults->errorCount = pOptions->requestCount;
+        return 0;
+    }
+
+    DaemonRequest request = {
+        .magic     = daemonRequestMagic,
+        .version   = daemonVersion,
+        .type      = DAEMON_REQUEST_RENDER,
+        .width     = pOptions->width,
+        .height    = pOptions->height,
+        .replyMode = pOptions->useMemfd ? DAEMON_REPLY_MEMFD : DAEMON_REPLY_FILE
+    };
+
+    strncpy(request.path, pOptions->outputPath, daemonMaxPath - 1);
+
+    for (uint32_t rr = 0; rr < pOptions->requestCount; ++rr)
+    {
+        DaemonReply reply = {};
+        int         memfd = -1;
+
+        auto const start   = getTimeMs();
+        auto const didSend = sendDaemonRequest(socket, &request, &reply, &memfd);
+        auto const end     = getTimeMs();
+
+        //  - memfd replies hold the frame described by the reply
+        auto isFrameValid = true;
+
+        if (0 <= memfd)
+        {
+            FrameHeader header = {};
+
+            isFrameValid = (ssize_t)sizeof(header) == pread(memfd, &header, sizeof(header), 0) &&
+                           frameHeaderMagic == header.magic &&
+                           reply.width == header.width && reply.height == header.height &&
+                           reply.dataSize == header.size;
+            close(memfd);
+        }
+
+        if (!didSend) {
+            pResults->errorCount += pOptions->requestCount - rr;
+            break;
+        }
+
+        if (DAEMON_STATUS_OK == reply.status && isFrameValid)
+        {
+            pResults->pLatencyMs[pResults->okCount++] = end - start;
+            pResults->cachedCount += (0 != reply.isCached) ? 1 : 0;
+        }
+        else if (DAEMON_STATUS_BUSY == reply.status) {
+            pResults->busyCount += 1;
+        }
+        else {
+            pResults->errorCount += 1;
+        }
+    }
+
+    close(socket);
+
+    return 0;
+}
+
+// * sendShutdown
+//
+bool sendShutdown(const char* socketPath)
+{
+    auto const socket = connectToDaemon(socketPath);
+
+    if (socket < 0) {
+        return false;
+    }
+
+    const DaemonRequest request = {
+        .magic   = daemonRequestMagic,
+        .version = daemonVersion,
+        .type    = DAEMON_REQUEST_SHUTDOWN
+    };
+
+    DaemonReply reply = {};
+    int         memfd = -1;
+
+    auto const didSend = sendDaemonRequest(socket, &request, &reply, &memfd);
+
+    close(socket);
+
+    return didSend && DAEMON_STATUS_OK == reply.status;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+// * printUsage
+//
+void printUsage(const char* program)
+{
+    printf( "usage: %s socket [--size n] [--requests n] [--connections n]\n"
+            "       %*s [--memfd] [--output path] [--shutdown]\n",
+            program, (int)strlen(program), "" );
+}
+
+int main(const int argc, const char* const argv[])
+{
+    ClientOptions options = {
+        .width           = 1080,
+        .height          = 1080,
+        .requestCount    = 1,
+        .connectionCount = 1,
+        .useMemfd        = false,
+        .outputPath      = "",
+        .shutdown        = false
+    };
+
+    // * Arguments
+    //
+    auto isValid = (1 < argc);
+
+    for (int ii = 2; ii < argc && isValid; ++ii)
+    {
+        auto const arg     = argv[ii];
+        auto const hasNext = (ii + 1 < argc);
+
+        if (0 == strcmp(arg, "--memfd")) {
+            options.useMemfd = true;
+        }
+        else if (0 == strcmp(arg, "--shutdown")) {
+            options.shutdown = true;
+        }
+        else if (0 == strcmp(arg, "--size") && hasNext) {
+            options.width  = (uint32_t)strtoul(argv[++ii], nullptr, 10);
+            options.height = options.width;
+        }
+        else if (0 == strcmp(arg, "--requests") && hasNext) {
+            options.requestCount = (uint32_t)strtoul(argv[++ii], nullptr, 10);
+        }
+        else if (0 == strcmp(arg, "--connections") && hasNext) {
+            options.connectionCount = (uint32_t)strtoul(argv[++ii], nullptr, 10);
+        }
+        else if (0 == strcmp(arg, "--output") && hasNext) {
+            options.outputPath = argv[++ii];
+        }
+        else {
+            isValid = false;
+        }
+    }
+
+    isValid = isValid && 0 < options.connectionCount &&
+              options.connectionCount <= maxClientConnections;
+
+    if (!isValid)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    options.socketPath = argv[1];
+
+    if (options.shutdown)
+    {
+        auto const didStop = sendShutdown(options.socketPath);
+
+        puts(didStop ? "Daemon draining" : "Failed to reach daemon");
+
+        return didStop ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // * Connections
+    //
+    auto const totalCount = options.requestCount * options.connectionCount;
+
+    auto latencies = (double*)calloc(totalCount + 1, sizeof(double));
+
+    if (nullptr == latencies)
+    {
+        puts("Failed to allocate latencies");
+        return EXIT_FAILURE;
+    }
+
+    ClientResults results[maxClientConnections]   = {};
+    thrd_t        threads[maxClientConnections]   = {};
+    bool          isThreaded[maxClientConnections] = {};
+
+    auto const start = getTimeMs();
+
+    for (uint32_t cc = 0; cc < options.connectionCount; ++cc)
+    {
+        results[cc].pOptions   = &options;
+        results[cc].pLatencyMs = latencies + cc * options.requestCount;
+
+        isThreaded[cc] = ( thrd_success == thrd_create( &threads[cc], runConnection,
+                                                        &results[cc] ) );
+        if (!isThreaded[cc]) {
+            runConnection(&results[cc]);
+        }
+    }
+
+    for (uint32_t cc = 0; cc < options.connectionCount; ++cc)
+    {
+        if (isThreaded[cc]) {
+            thrd_join(threads[cc], nullptr);
+        }
+    }
+
+    auto const elapsedMs = getTimeMs() - start;
+
+    // * Report : latencies are compacted in front of the array
+    //
+    uint32_t okCount     = 0;
+    uint32_t cachedCount = 0;
+    uint32_t busyCount   = 0;
+    uint32_t errorCount  = 0;
+
+    for (uint32_t cc = 0; cc < options.connectionCount; ++cc)
+    {
+        memmove( latencies + okCount, results[cc].pLatencyMs,
+                 results[cc].okCount * sizeof(double) );
+
+        okCount     += results[cc].okCount;
+        cachedCount += results[cc].cachedCount;
+        busyCount   += results[cc].busyCount;
+        errorCount  += results[cc].errorCount;
+    }
+
+    auto const summary = summarizeTimings(latencies, okCount, sizeof(double));
+
+    printf( "ok %u (%u cached), busy %u, errors %u, %.1f frames/s\n"
+            "latency ms : min %.3f, median %.3f, p99 %.3f\n",
+            okCount, cachedCount, busyCount, errorCount,
+            (0.0 < elapsedMs) ? 1e3 * okCount / elapsedMs : 0.0,
+            summary.min, summary.median, summary.p99 );
+
+    free(latencies);
+
+    return (0 == errorCount) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
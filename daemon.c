@@ -0,0 +1,1314 @@
+//
+// daemon.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "scheduler.h"
+#include "timing.h"
+#include "trace.h"
+#include "utilities.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Parameters
+//
+//====----------------------------------------------------------------------====
+
+// * Idle connections and the accept loop check for a drain this often
+//
+constexpr int daemonPollMs = 200;
+
+// * Render targets kept warm : enough for two full batches
+//
+constexpr uint32_t daemonTargetCacheSize = 2 * schedulerMaxBatchSize;
+
+// * Longest wait for device memory to render a batch in, after which its
+//   jobs fail
+//
+constexpr double daemonMemoryWaitMs = 30000.0;
+
+//====----------------------------------------------------------------------====
+//
+// * Server state
+//
+//====----------------------------------------------------------------------====
+
+typedef struct CachedTarget
+{
+    RenderTarget target;
+    uint64_t     lastUse;
+}
+CachedTarget;
+
+typedef struct DaemonServer
+{
+    Renderer*            pRenderer;
+    const DaemonOptions* pOptions;
+    Scheduler            scheduler;
+
+    //  - guarded by mutex
+    mtx_t                mutex;
+    cnd_t                connectionClosed;
+    uint32_t             connectionCount;
+
+    //  - render threads waiting for device memory are signalled as the
+    //    others finish their batches. Guarded by mutex
+    cnd_t                batchFinished;
+    uint32_t             memoryWaiterCount;
+
+    //  - render threads, whose idle targets those waiting may release
+    struct DaemonWorker* pWorkers;
+    uint32_t             workerCount;
+
+    //  - output names for requests without a path
+    atomic_uint_fast64_t outputCount;
+}
+DaemonServer;
+
+// * DaemonWorker : state of one render thread, which alone uses its
+//                  targets and their command pools while rendering. Other
+//                  threads only release them between batches, holding the
+//                  target mutex
+//
+typedef struct DaemonWorker
+{
+    DaemonServer* pServer;
+    uint32_t      queueIndex;
+    mtx_t         targetMutex;
+    CachedTarget  targets[daemonTargetCacheSize];
+    uint64_t      batchCount;
+}
+DaemonWorker;
+
+// * Set from signal handlers and by connection threads for shutdown
+//   requests, and read by the accept loop. Always lock-free, which keeps
+//   it safe in a signal handler
+//
+atomic_bool daemonStopRequested = false;
+
+static_assert(2 == ATOMIC_BOOL_LOCK_FREE);
+
+// * handleStopSignal
+//
+void handleStopSignal([[maybe_unused]] int signalNumber)
+{
+    atomic_store(&daemonStopRequested, true);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Socket I/O
+//
+//====----------------------------------------------------------------------====
+
+// * readFully : false on end of stream or error
+//
+bool readFully(int socket, void* pBuffer, size_t size)
+{
+    auto bytes = (uint8_t*)pBuffer;
+
+    while (0 < size)
+    {
+        auto const count = read(socket, bytes, size);
+
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+
+        if (count <= 0) {
+            return false;
+        }
+
+        bytes += count;
+        size  -= (size_t)count;
+    }
+
+    return true;
+}
+
+// * writeFully
+//
+bool writeFully(int socket, const void* pBuffer, size_t size)
+{
+    auto bytes = (const uint8_t*)pBuffer;
+
+    while (0 < size)
+    {
+        auto const count = send(socket, bytes, size, MSG_NOSIGNAL);
+
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+
+        if (count <= 0) {
+            return false;
+        }
+
+        bytes += count;
+        size  -= (size_t)count;
+    }
+
+    return true;
+}
+
+// * sendWithDescriptor : the descriptor travels with the first byte, so it
+//                        is sent with the first sendmsg and the remainder
+//                        follows as plain data
+//
+bool sendWithDescriptor(int socket, const void* pBuffer, size_t size, int fd)
+{
+    if (fd < 0) {
+        return writeFully(socket, pBuffer, size);
+    }
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    struct iovec iov = {
+        .iov_base = (void*)pBuffer,
+        .iov_len  = size
+    };
+
+    struct msghdr message = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control,
+        .msg_controllen = sizeof(control)
+    };
+
+    auto const header = CMSG_FIRSTHDR(&message);
+
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type  = SCM_RIGHTS;
+    header->cmsg_len   = CMSG_LEN(sizeof(int));
+
+    memcpy(CMSG_DATA(header), &fd, sizeof(int));
+
+    ssize_t count = -1;
+
+    do {
+        count = sendmsg(socket, &message, MSG_NOSIGNAL);
+    } while (count < 0 && EINTR == errno);
+
+    if (count <= 0) {
+        return false;
+    }
+
+    return writeFully(socket, (const uint8_t*)pBuffer + count, size - (size_t)count);
+}
+
+// * receiveWithDescriptor : *pFd is -1 when no descriptor arrived, and on
+//                           failure, when any that did is closed. On a
+//                           message socket the buffer is one whole
+//                           message, as the rest of a longer one is
+//                           discarded. On a stream the remainder follows
+//                           as plain data
+//
+bool receiveWithDescriptor( int    socket,
+                            bool   isMessage,
+                            void*  pBuffer,
+                            size_t size,
+                            int*   pFd )
+{
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    struct iovec iov = {
+        .iov_base = pBuffer,
+        .iov_len  = size
+    };
+
+    struct msghdr message = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control,
+        .msg_controllen = sizeof(control)
+    };
+
+    *pFd = -1;
+
+    ssize_t count = -1;
+
+    do {
+        count = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    } while (count < 0 && EINTR == errno);
+
+    if (count <= 0) {
+        return false;
+    }
+
+    for ( auto header = CMSG_FIRSTHDR(&message);
+          nullptr != header;
+          header = CMSG_NXTHDR(&message, header) )
+    {
+        if (SOL_SOCKET == header->cmsg_level && SCM_RIGHTS == header->cmsg_type) {
+            memcpy(pFd, CMSG_DATA(header), sizeof(int));
+        }
+    }
+
+    //  - a truncated message, or descriptors that did not fit, are lost
+    //    along with the rest of the message
+    auto didReceive = 0 == (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC));
+
+    if (didReceive)
+    {
+        didReceive = isMessage
+                   ? size == (size_t)count
+                   : readFully(socket, (uint8_t*)pBuffer + count, size - (size_t)count);
+    }
+
+    if (!didReceive && 0 <= *pFd)
+    {
+        close(*pFd);
+        *pFd = -1;
+    }
+
+    return didReceive;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Render thread
+//
+//====----------------------------------------------------------------------====
+
+// * releaseIdleTarget : the least recently used cached target not taken
+//                       for this batch. False when there is none
+//
+bool releaseIdleTarget(DaemonWorker* pWorker, uint64_t batchNumber)
+{
+    CachedTarget* pVictim = nullptr;
+
+    for (uint32_t ii = 0; ii < daemonTargetCacheSize; ++ii)
+    {
+        auto const pCached = &pWorker->targets[ii];
+
+        if ( 0 != pCached->target.width && batchNumber != pCached->lastUse &&
+             (nullptr == pVictim || pCached->lastUse < pVictim->lastUse) )
+        {
+            pVictim = pCached;
+        }
+    }
+
+    if (nullptr == pVictim) {
+        return false;
+    }
+
+    destroyRenderTarget(pWorker->pServer->pRenderer, &pVictim->target);
+    pVictim->lastUse = 0;
+
+    return true;
+}
+
+// * acquireTargets : up to count cached targets of the requested size,
+//                    replacing the least recently used ones on a miss, as
+//                    many as fit the device memory once the worker's idle
+//                    targets have made way. Targets already taken for this
+//                    batch are skipped. Returns the number acquired
+//
+uint32_t acquireTargets( DaemonWorker*  pWorker,
+                         uint32_t       width,
+                         uint32_t       height,
+                         uint32_t       count,
+                         RenderTarget** ppTargets )
+{
+    auto const pRenderer   = pWorker->pServer->pRenderer;
+    auto const batchNumber = ++pWorker->batchCount;
+
+    uint32_t tt = 0;
+
+    for (; tt < count; ++tt)
+    {
+        CachedTarget* pMatch  = nullptr;
+        CachedTarget* pVictim = nullptr;
+
+        for (uint32_t ii = 0; ii < daemonTargetCacheSize && nullptr == pMatch; ++ii)
+        {
+            auto const pCached = &pWorker->targets[ii];
+
+            if (batchNumber == pCached->lastUse) {
+                continue;
+            }
+
+            if (width == pCached->target.width && height == pCached->target.height) {
+                pMatch = pCached;
+            }
+            else if (nullptr == pVictim || pCached->lastUse < pVictim->lastUse) {
+                pVictim = pCached;
+            }
+        }
+
+        if (nullptr == pMatch)
+        {
+            if (0 != pVictim->target.width) {
+                destroyRenderTarget(pRenderer, &pVictim->target);
+            }
+
+            pVictim->lastUse = 0;
+
+            auto result = createRenderTargetInBudget( pRenderer, width, height,
+                                                      &pVictim->target );
+
+            while ( VK_ERROR_OUT_OF_DEVICE_MEMORY == result &&
+                    releaseIdleTarget(pWorker, batchNumber) )
+            {
+                result = createRenderTargetInBudget( pRenderer, width, height,
+                                                     &pVictim->target );
+            }
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            pMatch = pVictim;
+        }
+
+        pMatch->lastUse           = batchNumber;
+        pMatch->target.queueIndex = pWorker->queueIndex;
+        ppTargets[tt]             = &pMatch->target;
+    }
+
+    return tt;
+}
+
+// * releaseOtherTargets : every target of the other render threads that
+//                         are between batches
+//
+void releaseOtherTargets(DaemonWorker* pWorker)
+{
+    auto const pServer = pWorker->pServer;
+
+    for (uint32_t ww = 0; ww < pServer->workerCount; ++ww)
+    {
+        auto const pOther = &pServer->pWorkers[ww];
+
+        if (pOther == pWorker || thrd_success != mtx_trylock(&pOther->targetMutex)) {
+            continue;
+        }
+
+        //  - batch zero is never taken, so every target is idle
+        while (releaseIdleTarget(pOther, 0)) {
+            continue;
+        }
+
+        mtx_unlock(&pOther->targetMutex);
+    }
+}
+
+// * waitForTargets : acquireTargets, releasing the targets of idle render
+//                    threads while not even one fits, and those of busy
+//                    ones as they finish their batches. Zero after
+//                    daemonMemoryWaitMs
+//
+uint32_t waitForTargets( DaemonWorker*  pWorker,
+                         uint32_t       width,
+                         uint32_t       height,
+                         uint32_t       count,
+                         RenderTarget** ppTargets )
+{
+    auto const pServer    = pWorker->pServer;
+    auto const deadlineMs = getTimeMs() + daemonMemoryWaitMs;
+
+    auto targetCount = acquireTargets(pWorker, width, height, count, ppTargets);
+
+    if (0 == targetCount)
+    {
+        releaseOtherTargets(pWorker);
+
+        targetCount = acquireTargets(pWorker, width, height, count, ppTargets);
+    }
+
+    while (0 == targetCount && getTimeMs() < deadlineMs)
+    {
+        //  - the live budget may also grow as other processes free memory
+        auto const deadline = toTimespec(getTimeMs() + daemonPollMs);
+
+        mtx_lock(&pServer->mutex);
+
+        pServer->memoryWaiterCount += 1;
+        cnd_timedwait(&pServer->batchFinished, &pServer->mutex, &deadline);
+        pServer->memoryWaiterCount -= 1;
+
+        mtx_unlock(&pServer->mutex);
+
+        releaseOtherTargets(pWorker);
+
+        targetCount = acquireTargets(pWorker, width, height, count, ppTargets);
+    }
+
+    return targetCount;
+}
+
+// * renderRound : jobs with a destination are rendered straight into it,
+//                 a frame at a time, as renderFrameToMemory has no batch
+//                 form. The others share one submission, and their image
+//                 contexts
+//
+VkResult renderRound( Renderer*            pRenderer,
+                      RenderTarget* const* ppTargets,
+                      RenderJob* const*    ppJobs,
+                      uint32_t             count,
+                      ImageContext*        pImageContexts )
+{
+    RenderTarget* batchTargets[schedulerMaxBatchSize]  = {};
+    ImageContext  batchContexts[schedulerMaxBatchSize] = {};
+    uint32_t      batchJobs[schedulerMaxBatchSize]     = {};
+    uint32_t      batchCount                           = 0;
+
+    auto result = VK_SUCCESS;
+
+    for (uint32_t jj = 0; jj < count && VK_SUCCESS == result; ++jj)
+    {
+        auto const pJob = ppJobs[jj];
+
+        if (nullptr == pJob->pDestination)
+        {
+            batchTargets[batchCount] = ppTargets[jj];
+            batchJobs[batchCount++]  = jj;
+            continue;
+        }
+
+        result = renderFrameToMemory( pRenderer, ppTargets[jj], pJob->pDestination,
+                                      pJob->destinationBytesPerRow, nullptr );
+    }
+
+    if (VK_SUCCESS == result && 0 < batchCount)
+    {
+        result = renderFrameBatch(pRenderer, batchTargets, batchCount, batchContexts, nullptr);
+
+        for (uint32_t bb = 0; bb < batchCount; ++bb) {
+            pImageContexts[batchJobs[bb]] = batchContexts[bb];
+        }
+    }
+
+    return result;
+}
+
+// * renderThread : takes batches until the scheduler is draining and
+//                  empty. Render threads share the renderer, and submit to
+//                  queues of their own while there are enough
+//
+int renderThread(void* pArgument)
+{
+    auto const pWorker = (DaemonWorker*)pArgument;
+    auto const pServer = pWorker->pServer;
+
+    RenderJob* batch[schedulerMaxBatchSize] = {};
+    uint32_t   batchSize                    = 0;
+
+    while (0 < (batchSize = takeBatch(&pServer->scheduler, batch)))
+    {
+        RenderTarget* targets[schedulerMaxBatchSize]       = {};
+        ImageContext  imageContexts[schedulerMaxBatchSize] = {};
+
+        //  - render : every job in a batch has the same size, and the
+        //    batch is rendered in rounds of as many jobs as there are
+        //    targets that fit the device memory
+        auto const startMs = getTimeMs();
+
+        mtx_lock(&pWorker->targetMutex);
+
+        auto const targetCount = waitForTargets( pWorker, batch[0]->width, batch[0]->height,
+                                                 batchSize, targets );
+
+        auto result = (0 < targetCount) ? VK_SUCCESS : VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+        for (uint32_t first = 0; first < batchSize && VK_SUCCESS == result; first += targetCount)
+        {
+            auto const remaining = batchSize - first;
+            auto const roundSize = (remaining < targetCount) ? remaining : targetCount;
+
+            TRACE_BEGIN(batchSpan, "render batch");
+
+            result = renderRound( pServer->pRenderer, targets, &batch[first], roundSize,
+                                  &imageContexts[first] );
+            TRACE_END(batchSpan);
+        }
+
+        mtx_unlock(&pWorker->targetMutex);
+
+        auto const endMs = getTimeMs();
+
+        //  - fan out
+        for (uint32_t ii = 0; ii < batchSize; ++ii)
+        {
+            auto const pJob = batch[ii];
+
+            pJob->startMs      = startMs;
+            pJob->endMs        = endMs;
+            pJob->imageContext = imageContexts[ii];
+            pJob->didRender    = (VK_SUCCESS == result) &&
+                                 ( nullptr != pJob->pDestination ||
+                                   nullptr != imageContexts[ii].data );
+        }
+
+        completeBatch(&pServer->scheduler, batch, batchSize);
+
+        //  - this thread's targets may now be released
+        mtx_lock(&pServer->mutex);
+
+        if (0 < pServer->memoryWaiterCount) {
+            cnd_broadcast(&pServer->batchFinished);
+        }
+
+        mtx_unlock(&pServer->mutex);
+    }
+
+    return 0;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Connections
+//
+//====----------------------------------------------------------------------====
+
+typedef struct Connection
+{
+    DaemonServer* pServer;
+    int           socket;
+}
+Connection;
+
+// * chooseReplyPath : the requested path, or a new one in the output
+//                     directory
+//
+DaemonStatus chooseReplyPath( DaemonServer*        pServer,
+                              const DaemonRequest* pRequest,
+                              DaemonReply*         pReply )
+{
+    if ('\0' != pRequest->path[0]) {
+        memcpy(pReply->path, pRequest->path, daemonMaxPath);
+    }
+    else
+    {
+        auto const number = atomic_fetch_add(&pServer->outputCount, 1);
+
+        auto const length = snprintf( pReply->path, daemonMaxPath,
+                                      "%s/square-%ld-%llu.tiff",
+                                      pServer->pOptions->outputDirectory,
+                                      (long)getpid(), (unsigned long long)number );
+
+        if (length < 0 || daemonMaxPath <= (uint32_t)length) {
+            return DAEMON_STATUS_OUTPUT_ERROR;
+        }
+    }
+
+    return DAEMON_STATUS_OK;
+}
+
+// * writeFileReply : TIFF at the reply's path
+//
+DaemonStatus writeFileReply( DaemonServer*       pServer,
+                             const ImageContext* pImageContext,
+                             DaemonReply*        pReply )
+{
+    auto const didSave = saveRGBATIFFFile( pReply->path, pImageContext,
+                                           pServer->pOptions->pWriteOptions );
+
+    return didSave ? DAEMON_STATUS_OK : DAEMON_STATUS_OUTPUT_ERROR;
+}
+
+// * makeFileCacheKey : the renderer's inputs, the frame size and the
+//                      encoding of file replies
+//
+CacheKey makeFileCacheKey(const DaemonServer* pServer, const DaemonRequest* pRequest)
+{
+    auto const pWriteOptions = pServer->pOptions->pWriteOptions;
+
+    const uint32_t encoding[] = {
+        pWriteOptions->narrowTo8Bits,
+        pWriteOptions->unassociateAlpha,
+        pWriteOptions->compression
+    };
+
+    CacheKeyHasher hasher = {};
+    beginCacheKey(&hasher);
+
+    addRendererToCacheKey(pServer->pRenderer, &hasher);
+
+    addCacheKeyData(&hasher, &pRequest->width, sizeof(pRequest->width));
+    addCacheKeyData(&hasher, &pRequest->height, sizeof(pRequest->height));
+    addCacheKeyData(&hasher, encoding, sizeof(encoding));
+
+    return finishCacheKey(&hasher);
+}
+
+// * handleRenderRequest : replies are sent by the caller, except for the
+//                         memfd, which is returned through pFd
+//
+void handleRenderRequest( DaemonServer*        pServer,
+                          const DaemonRequest* pRequest,
+                          DaemonReply*         pReply,
+                          int*                 pFd )
+{
+    auto const maxDimension = pServer->pOptions->maxDimension;
+
+    auto const isValid = 0 < pRequest->width  && pRequest->width  <= maxDimension &&
+                         0 < pRequest->height && pRequest->height <= maxDimension &&
+                         ( DAEMON_REPLY_FILE  == pRequest->replyMode ||
+                           DAEMON_REPLY_MEMFD == pRequest->replyMode ) &&
+                         nullptr != memchr(pRequest->path, '\0', daemonMaxPath);
+
+    //  - frames whose target could never fit the device memory are
+    //    refused, while those that only have to wait for it are queued
+    auto const pRenderer = pServer->pRenderer;
+
+    if ( !isValid ||
+         queryRendererMemory(pRenderer).capacity
+         < estimateRenderTargetMemory(pRenderer, pRequest->width, pRequest->height) )
+    {
+        pReply->status = DAEMON_STATUS_BAD_REQUEST;
+        return;
+    }
+
+    //  - file replies already rendered are copied from the render cache,
+    //    without a trip through the scheduler
+    auto const pCache      = pServer->pOptions->pCache;
+    auto const isFileReply = (DAEMON_REPLY_FILE == pRequest->replyMode);
+    auto const useCache    = isFileReply && nullptr != pCache;
+    CacheKey   key         = {};
+
+    if (isFileReply)
+    {
+        auto const pathStatus = chooseReplyPath(pServer, pRequest, pReply);
+
+        if (DAEMON_STATUS_OK != pathStatus)
+        {
+            pReply->status = pathStatus;
+            return;
+        }
+    }
+
+    if (useCache)
+    {
+        key = makeFileCacheKey(pServer, pRequest);
+
+        if (lookupRenderCache(pCache, &key, pReply->path))
+        {
+            pReply->status      = DAEMON_STATUS_OK;
+            pReply->isCached    = 1;
+            pReply->width       = pRequest->width;
+            pReply->height      = pRequest->height;
+            pReply->colorFormat = readbackColorFormat(pServer->pRenderer);
+            pReply->pixelLayout = pServer->pRenderer->pixelLayout;
+            return;
+        }
+    }
+
+    //  - memfd replies are rendered straight into the memfd, tightly
+    //    packed in the readback format
+    FrameMemfd memfd = { .fd = -1 };
+
+    if (!isFileReply)
+    {
+        auto const colorFormat = readbackColorFormat(pRenderer);
+        auto const bytesPerRow = (uint64_t)pRequest->width * formatBytesPerPixel(colorFormat);
+
+        if ( !createFrameMemfd( pRequest->width, pRequest->height, bytesPerRow, colorFormat,
+                                pRenderer->pixelLayout, 0, &memfd ) )
+        {
+            pReply->status = DAEMON_STATUS_OUTPUT_ERROR;
+            return;
+        }
+    }
+
+    //  - render, possibly batched with other connections' jobs
+    RenderJob job = {
+        .width                  = pRequest->width,
+        .height                 = pRequest->height,
+        .pDestination           = isFileReply ? nullptr
+                                              : memfd.pMapping + memfd.header.dataOffset,
+        .destinationBytesPerRow = memfd.header.bytesPerRow
+    };
+
+    auto const scheduleStatus = scheduleJob(&pServer->scheduler, &job);
+
+    if (SCHEDULE_STATUS_QUEUED != scheduleStatus)
+    {
+        pReply->status = (SCHEDULE_STATUS_BUSY == scheduleStatus)
+                       ? DAEMON_STATUS_BUSY
+                       : DAEMON_STATUS_DRAINING;
+        disposeFrameMemfd(&memfd);
+        return;
+    }
+
+    waitForJob(&pServer->scheduler, &job);
+
+    pReply->queueMs   = job.startMs - job.queuedMs;
+    pReply->renderMs  = job.endMs - job.startMs;
+    pReply->batchSize = job.batchSize;
+
+    if (!job.didRender)
+    {
+        pReply->status = DAEMON_STATUS_RENDER_ERROR;
+        disposeImageContext(&job.imageContext);
+        disposeFrameMemfd(&memfd);
+        return;
+    }
+
+    //  - output, on this connection's thread while the next job renders
+    if (isFileReply)
+    {
+        pReply->width       = job.imageContext.width;
+        pReply->height      = job.imageContext.height;
+        pReply->bytesPerRow = job.imageContext.bytesPerRow;
+        pReply->colorFormat = job.imageContext.colorPixelFormat;
+        pReply->pixelLayout = job.imageContext.pixelLayout;
+
+        pReply->status = writeFileReply(pServer, &job.imageContext, pReply);
+
+        if (DAEMON_STATUS_OK == pReply->status && useCache) {
+            storeRenderCache(pCache, &key, pReply->path);
+        }
+
+        disposeImageContext(&job.imageContext);
+    }
+    else
+    {
+        pReply->width       = memfd.header.width;
+        pReply->height      = memfd.header.height;
+        pReply->bytesPerRow = memfd.header.bytesPerRow;
+        pReply->colorFormat = memfd.header.colorFormat;
+        pReply->pixelLayout = memfd.header.pixelLayout;
+        pReply->dataSize    = memfd.header.size;
+
+        pReply->status = sealFrameMemfd(&memfd) ? DAEMON_STATUS_OK
+                                                : DAEMON_STATUS_OUTPUT_ERROR;
+
+        //  - the caller sends, then closes, the sealed memfd
+        if (DAEMON_STATUS_OK == pReply->status)
+        {
+            *pFd     = memfd.fd;
+            memfd.fd = -1;
+        }
+
+        disposeFrameMemfd(&memfd);
+    }
+}
+
+// * connectionThread : one request at a time until the client disconnects
+//                      or the daemon drains
+//
+int connectionThread(void* pArgument)
+{
+    auto const pConnection = (Connection*)pArgument;
+    auto const pServer     = pConnection->pServer;
+    auto const socket      = pConnection->socket;
+
+    free(pConnection);
+
+    while (!isSchedulerDraining(&pServer->scheduler))
+    {
+        struct pollfd pollFd = { .fd = socket, .events = POLLIN };
+
+        auto const ready = poll(&pollFd, 1, daemonPollMs);
+
+        if (0 == ready || (ready < 0 && EINTR == errno)) {
+            continue;
+        }
+
+        DaemonRequest request = {};
+
+        if (ready < 0 || !readFully(socket, &request, sizeof(request))) {
+            break;
+        }
+
+        DaemonReply reply = {
+            .magic  = daemonReplyMagic,
+            .status = DAEMON_STATUS_BAD_REQUEST
+        };
+
+        int fd = -1;
+
+        if (daemonRequestMagic == request.magic && daemonVersion == request.version)
+        {
+            if (DAEMON_REQUEST_RENDER == request.type) {
+                handleRenderRequest(pServer, &request, &reply, &fd);
+            }
+            else if (DAEMON_REQUEST_SHUTDOWN == request.type)
+            {
+                atomic_store(&daemonStopRequested, true);
+                reply.status = DAEMON_STATUS_OK;
+            }
+        }
+
+        auto const didSend = sendWithDescriptor(socket, &reply, sizeof(reply), fd);
+
+        if (0 <= fd) {
+            close(fd);
+        }
+
+        if (!didSend) {
+            break;
+        }
+    }
+
+    close(socket);
+
+    mtx_lock(&pServer->mutex);
+
+    pServer->connectionCount -= 1;
+    cnd_signal(&pServer->connectionClosed);
+
+    mtx_unlock(&pServer->mutex);
+
+    return 0;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * runDaemon
+//
+//====----------------------------------------------------------------------====
+
+// * createListeningSocket : replaces a stale socket file
+//
+int createListeningSocket(const char* socketPath, int type)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (sizeof(address.sun_path) <= strlen(socketPath)) {
+        return -1;
+    }
+
+    strcpy(address.sun_path, socketPath);
+
+    auto listener = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+
+    if (listener < 0) {
+        return -1;
+    }
+
+    unlink(socketPath);
+
+    if ( 0 != bind(listener, (const struct sockaddr*)&address, sizeof(address)) ||
+         0 != listen(listener, SOMAXCONN) )
+    {
+        close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+// * acceptConnection : the connection thread owns the socket from here on
+//
+void acceptConnection(DaemonServer* pServer, int listener)
+{
+    auto const socket = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+    if (socket < 0) {
+        return;
+    }
+
+    auto pConnection = (Connection*)malloc(sizeof(Connection));
+    thrd_t thread    = {};
+
+    if (nullptr != pConnection)
+    {
+        *pConnection = (Connection){ .pServer = pServer, .socket = socket };
+
+        mtx_lock(&pServer->mutex);
+        pServer->connectionCount += 1;
+        mtx_unlock(&pServer->mutex);
+
+        if (thrd_success == thrd_create(&thread, connectionThread, pConnection))
+        {
+            thrd_detach(thread);
+            return;
+        }
+
+        mtx_lock(&pServer->mutex);
+        pServer->connectionCount -= 1;
+        mtx_unlock(&pServer->mutex);
+
+        free(pConnection);
+    }
+
+    close(socket);
+}
+
+// * runDaemon
+//
+bool runDaemon(Renderer* pRenderer, const DaemonOptions* pOptions)
+{
+    DaemonServer server = {
+        .pRenderer = pRenderer,
+        .pOptions  = pOptions
+    };
+
+    const SchedulerInfo schedulerInfo = {
+        .queueDepth      = pOptions->queueDepth,
+        .maxBatchSize    = pOptions->maxBatchSize,
+        .latencyBudgetMs = pOptions->latencyBudgetMs
+    };
+
+    if (!createScheduler(&schedulerInfo, &server.scheduler)) {
+        return false;
+    }
+
+    if (thrd_success != mtx_init(&server.mutex, mtx_plain))
+    {
+        destroyScheduler(&server.scheduler);
+        return false;
+    }
+
+    cnd_init(&server.connectionClosed);
+    cnd_init(&server.batchFinished);
+
+    //  - render workers : a queue each, round-robin
+    auto const workerCount = (0 < pOptions->renderThreadCount)
+                           ? pOptions->renderThreadCount : 1;
+
+    auto workers = (DaemonWorker*)calloc(workerCount, sizeof(DaemonWorker));
+
+    if (nullptr == workers)
+    {
+        cnd_destroy(&server.batchFinished);
+        cnd_destroy(&server.connectionClosed);
+        mtx_destroy(&server.mutex);
+        destroyScheduler(&server.scheduler);
+        return false;
+    }
+
+    for (uint32_t ww = 0; ww < workerCount; ++ww)
+    {
+        workers[ww].pServer    = &server;
+        workers[ww].queueIndex = ww % pRenderer->queueCount;
+
+        mtx_init(&workers[ww].targetMutex, mtx_plain);
+    }
+
+    server.pWorkers    = workers;
+    server.workerCount = workerCount;
+
+    //  - stop on SIGINT and SIGTERM, without restarting poll
+    struct sigaction stopAction = { .sa_handler = handleStopSignal };
+    sigemptyset(&stopAction.sa_mask);
+
+    sigaction(SIGINT, &stopAction, nullptr);
+    sigaction(SIGTERM, &stopAction, nullptr);
+
+    atomic_store(&daemonStopRequested, false);
+
+    thrd_t   renderWorkers[daemonMaxRenderThreads] = {};
+    uint32_t startedCount                          = 0;
+
+    auto const listener = createListeningSocket(pOptions->socketPath, SOCK_STREAM);
+
+    while (0 <= listener && startedCount < workerCount &&
+           thrd_success == thrd_create( &renderWorkers[startedCount],
+                                        renderThread, &workers[startedCount] ))
+    {
+        ++startedCount;
+    }
+
+    auto const didStart = (workerCount == startedCount);
+
+    if (didStart)
+    {
+        printf( "Listening on %s with %u render threads\n",
+                pOptions->socketPath, workerCount );
+        fflush(stdout);
+
+        while (!atomic_load(&daemonStopRequested))
+        {
+            struct pollfd pollFd = { .fd = listener, .events = POLLIN };
+
+            if (0 < poll(&pollFd, 1, daemonPollMs)) {
+                acceptConnection(&server, listener);
+            }
+        }
+
+        //  - drain : queued jobs finish and are replied to, connections close
+        drainScheduler(&server.scheduler);
+
+        mtx_lock(&server.mutex);
+
+        while (0 < server.connectionCount) {
+            cnd_wait(&server.connectionClosed, &server.mutex);
+        }
+
+        mtx_unlock(&server.mutex);
+    }
+    else {
+        printf("Failed to start on %s\n", pOptions->socketPath);
+    }
+
+    //  - workers started before a failure exit once the scheduler drains
+    drainScheduler(&server.scheduler);
+
+    for (uint32_t ww = 0; ww < startedCount; ++ww) {
+        thrd_join(renderWorkers[ww], nullptr);
+    }
+
+    if (0 <= listener)
+    {
+        close(listener);
+        unlink(pOptions->socketPath);
+    }
+
+    //  - cleanup
+    for (uint32_t ww = 0; ww < workerCount; ++ww)
+    {
+        for (uint32_t ii = 0; ii < daemonTargetCacheSize; ++ii)
+        {
+            auto const pCached = &workers[ww].targets[ii];
+
+            if (0 != pCached->target.width) {
+                destroyRenderTarget(pRenderer, &pCached->target);
+            }
+        }
+
+        mtx_destroy(&workers[ww].targetMutex);
+    }
+
+    free(workers);
+
+    cnd_destroy(&server.batchFinished);
+    cnd_destroy(&server.connectionClosed);
+    mtx_destroy(&server.mutex);
+    destroyScheduler(&server.scheduler);
+
+    return didStart;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Client
+//
+//====----------------------------------------------------------------------====
+
+// * connectToSocket : a connected socket of the type, or -1
+//
+int connectToSocket(const char* socketPath, int type)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (sizeof(address.sun_path) <= strlen(socketPath)) {
+        return -1;
+    }
+
+    strcpy(address.sun_path, socketPath);
+
+    auto client = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+
+    if (0 <= client && 0 != connect( client, (const struct sockaddr*)&address,
+                                     sizeof(address) ))
+    {
+        close(client);
+        client = -1;
+    }
+
+    return client;
+}
+
+// * connectToDaemon
+//
+int connectToDaemon(const char* socketPath)
+{
+    return connectToSocket(socketPath, SOCK_STREAM);
+}
+
+// * sendDaemonRequest
+//
+bool sendDaemonRequest( int                  socket,
+                        const DaemonRequest* pRequest,
+                        DaemonReply*         pReply,
+                        int*                 pMemfd )
+{
+    *pMemfd = -1;
+
+    if (!writeFully(socket, pRequest, sizeof(*pRequest))) {
+        return false;
+    }
+
+    return receiveWithDescriptor(socket, false, pReply, sizeof(*pReply), pMemfd) &&
+           daemonReplyMagic == pReply->magic;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Frame handoff
+//
+//====----------------------------------------------------------------------====
+
+// * createFrameMemfd
+//
+bool createFrameMemfd( uint32_t    width,
+                       uint32_t    height,
+                       uint64_t    bytesPerRow,
+                       VkFormat    colorFormat,
+                       PixelLayout pixelLayout,
+                       uint32_t    frame,
+                       FrameMemfd* pMemfd )
+{
+    //  - rows start on the page after the header, so they may be mapped
+    //    on their own
+    auto const pageSize   = (uint64_t)sysconf(_SC_PAGESIZE);
+    auto const dataOffset = (sizeof(FrameHeader) + pageSize - 1) / pageSize * pageSize;
+
+    *pMemfd = (FrameMemfd){
+        .fd     = -1,
+        .header = {
+            .magic       = frameHeaderMagic,
+            .frame       = frame,
+            .width       = width,
+            .height      = height,
+            .bytesPerRow = bytesPerRow,
+            .colorFormat = colorFormat,
+            .pixelLayout = pixelLayout,
+            .dataOffset  = dataOffset,
+            .size        = dataOffset + bytesPerRow * height
+        }
+    };
+
+    pMemfd->fd = memfd_create("square-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (pMemfd->fd < 0 || 0 != ftruncate(pMemfd->fd, (off_t)pMemfd->header.size))
+    {
+        disposeFrameMemfd(pMemfd);
+        return false;
+    }
+
+    auto const pMapping = mmap( nullptr, pMemfd->header.size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, pMemfd->fd, 0 );
+    if (MAP_FAILED == pMapping)
+    {
+        disposeFrameMemfd(pMemfd);
+        return false;
+    }
+
+    pMemfd->pMapping = (uint8_t*)pMapping;
+
+    memcpy(pMemfd->pMapping, &pMemfd->header, sizeof(FrameHeader));
+
+    return true;
+}
+
+// * sealFrameMemfd : the write seal is refused while a writable mapping
+//                    remains
+//
+bool sealFrameMemfd(FrameMemfd* pMemfd)
+{
+    auto const seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+
+    if (nullptr != pMemfd->pMapping)
+    {
+        munmap(pMemfd->pMapping, pMemfd->header.size);
+        pMemfd->pMapping = nullptr;
+    }
+
+    return 0 == fcntl(pMemfd->fd, F_ADD_SEALS, seals);
+}
+
+// * disposeFrameMemfd
+//
+void disposeFrameMemfd(FrameMemfd* pMemfd)
+{
+    if (nullptr != pMemfd->pMapping) {
+        munmap(pMemfd->pMapping, pMemfd->header.size);
+    }
+
+    if (0 <= pMemfd->fd) {
+        close(pMemfd->fd);
+    }
+
+    pMemfd->pMapping = nullptr;
+    pMemfd->fd       = -1;
+}
+
+// * listenForFrames
+//
+int listenForFrames(const char* socketPath)
+{
+    return createListeningSocket(socketPath, SOCK_SEQPACKET);
+}
+
+// * connectFrameConsumer
+//
+int connectFrameConsumer(const char* socketPath)
+{
+    return connectToSocket(socketPath, SOCK_SEQPACKET);
+}
+
+// * sendFrame
+//
+bool sendFrame(int socket, const FrameMemfd* pMemfd)
+{
+    return sendWithDescriptor(socket, &pMemfd->header, sizeof(pMemfd->header), pMemfd->fd);
+}
+
+// * sendFrameCopy
+//
+bool sendFrameCopy(int socket, const ImageContext* pImageContext, uint32_t frame)
+{
+    FrameMemfd memfd = {};
+
+    auto didSend = createFrameMemfd( pImageContext->width, pImageContext->height,
+                                     pImageContext->bytesPerRow,
+                                     pImageContext->colorPixelFormat,
+                                     pImageContext->pixelLayout, frame, &memfd );
+    if (didSend)
+    {
+        memcpy( memfd.pMapping + memfd.header.dataOffset, pImageContext->data,
+                pImageContext->bytesPerRow * pImageContext->height );
+
+        didSend = sealFrameMemfd(&memfd) && sendFrame(socket, &memfd);
+    }
+
+    disposeFrameMemfd(&memfd);
+
+    return didSend;
+}
+
+// * receiveFrame
+//
+bool receiveFrame(int socket, FrameHeader* pHeader, int* pMemfd)
+{
+    auto const didReceive
+        = receiveWithDescriptor(socket, true, pHeader, sizeof(*pHeader), pMemfd);
+
+    if (didReceive && 0 <= *pMemfd && frameHeaderMagic == pHeader->magic) {
+        return true;
+    }
+
+    if (0 <= *pMemfd)
+    {
+        close(*pMemfd);
+        *pMemfd = -1;
+    }
+
+    return false;
+}
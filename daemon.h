@@ -0,0 +1,250 @@
+//
+// daemon.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "encode.h"
+#include "rendercache.h"
+#include "renderer.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Protocol : fixed-size native-endian messages over a Unix stream socket.
+//              A client sends any number of requests on one connection and
+//              receives one reply per request, in order
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t daemonRequestMagic = 0x51525153;     // "SQRQ"
+constexpr uint32_t daemonReplyMagic   = 0x50525153;     // "SQRP"
+constexpr uint16_t daemonVersion      = 4;
+
+// * Paths, including the terminating null, fit in the fixed-size messages
+//
+constexpr uint32_t daemonMaxPath = 256;
+
+// * Render threads, each submitting to its own queue while there are enough
+//
+constexpr uint32_t daemonMaxRenderThreads = 64;
+
+typedef enum DaemonRequestType
+{
+    DAEMON_REQUEST_RENDER   = 1,
+    DAEMON_REQUEST_SHUTDOWN = 2     // drain queued jobs, then exit
+}
+DaemonRequestType;
+
+// * DaemonReplyMode : a TIFF written to a path, or the frame in a sealed
+//                     memfd passed with SCM_RIGHTS alongside the reply, as
+//                     handed off by sendFrame
+//
+typedef enum DaemonReplyMode
+{
+    DAEMON_REPLY_FILE  = 1,
+    DAEMON_REPLY_MEMFD = 2
+}
+DaemonReplyMode;
+
+typedef enum DaemonStatus
+{
+    DAEMON_STATUS_OK           = 0,
+    DAEMON_STATUS_BAD_REQUEST  = 1,     // or too large for the device memory
+    DAEMON_STATUS_BUSY         = 2,     // the job queue is full, retry later
+    DAEMON_STATUS_DRAINING     = 3,     // shutting down, not accepting jobs
+    DAEMON_STATUS_RENDER_ERROR = 4,
+    DAEMON_STATUS_OUTPUT_ERROR = 5
+}
+DaemonStatus;
+
+// * DaemonRequest : an empty path asks the daemon to choose one in its
+//                   output directory
+//
+typedef struct DaemonRequest
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;                  // DaemonRequestType
+    uint32_t width;
+    uint32_t height;
+    uint32_t replyMode;             // DaemonReplyMode
+    uint32_t reserved;
+    char     path[daemonMaxPath];
+}
+DaemonRequest;
+
+// * DaemonReply : the pixel description applies to both reply modes, but
+//                for file replies from the render cache, bytesPerRow is
+//                zero and nothing was rendered
+//
+typedef struct DaemonReply
+{
+    uint32_t magic;
+    uint32_t status;                // DaemonStatus
+    uint32_t width;
+    uint32_t height;
+    uint64_t bytesPerRow;
+    uint32_t colorFormat;           // VkFormat
+    uint32_t pixelLayout;           // PixelLayout
+    uint32_t batchSize;             // jobs rendered in the same submission
+    uint32_t isCached;              // copied from the render cache
+    uint64_t dataSize;              // memfd size, zero for file replies
+    double   queueMs;               // waiting for the render thread
+    double   renderMs;              // render and read back
+    char     path[daemonMaxPath];
+}
+DaemonReply;
+
+//====----------------------------------------------------------------------====
+//
+// * Daemon
+//
+//====----------------------------------------------------------------------====
+
+typedef struct DaemonOptions
+{
+    const char*             socketPath;
+    const char*             outputDirectory;    // for requests without a path
+    uint32_t                queueDepth;         // jobs waiting to render
+    uint32_t                maxBatchSize;       // jobs per queue submission
+    uint32_t                renderThreadCount;  // at most daemonMaxRenderThreads
+    double                  latencyBudgetMs;    // longest wait for a batch
+    uint32_t                maxDimension;       // larger requests are refused
+    const TIFFWriteOptions* pWriteOptions;
+    RenderCache*            pCache;             // file replies, may be null
+}
+DaemonOptions;
+
+// * runDaemon : serves render requests with an existing renderer until
+//               SIGINT, SIGTERM or a shutdown request, then stops
+//               accepting jobs, finishes those already queued and returns.
+//               Concurrent requests of the same size are batched, and
+//               render targets are kept between batches. Jobs wait for
+//               device memory, see createRenderTargetInBudget, and a
+//               batch is rendered in rounds when only some of its targets
+//               fit. With a render cache, file replies already rendered
+//               are copied from it without rendering
+//
+bool runDaemon(Renderer* pRenderer, const DaemonOptions* pOptions);
+
+//====----------------------------------------------------------------------====
+//
+// * Client
+//
+//====----------------------------------------------------------------------====
+
+// * connectToDaemon : a connected socket, or -1
+//
+int connectToDaemon(const char* socketPath);
+
+// * sendDaemonRequest : the reply, and for memfd replies the descriptor,
+//                       which the caller closes. pMemfd is -1 otherwise
+//
+bool sendDaemonRequest( int                  socket,
+                        const DaemonRequest* pRequest,
+                        DaemonReply*         pReply,
+                        int*                 pMemfd );
+
+//====----------------------------------------------------------------------====
+//
+// * Frame handoff : a frame's rows in a sealed memfd, after a header that
+//                   describes them, passed with SCM_RIGHTS over a Unix
+//                   socket. The consumer maps the rows, which never reach
+//                   the filesystem
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t frameHeaderMagic = 0x46525153;       // "SQRF"
+
+// * FrameHeader : at the start of the memfd, and the message it is sent
+//                 with
+//
+typedef struct FrameHeader
+{
+    uint32_t magic;
+    uint32_t frame;                 // zero for daemon replies
+    uint32_t width;
+    uint32_t height;
+    uint64_t bytesPerRow;
+    uint32_t colorFormat;           // VkFormat
+    uint32_t pixelLayout;           // PixelLayout
+    uint64_t dataOffset;            // of the first row, page aligned
+    uint64_t size;                  // of the memfd
+}
+FrameHeader;
+
+// * FrameMemfd : a frame's memfd, mapped until it is sealed
+//
+typedef struct FrameMemfd
+{
+    int         fd;                 // -1 : none
+    FrameHeader header;
+    uint8_t*    pMapping;           // the whole memfd, nullptr once sealed
+}
+FrameMemfd;
+
+// * createFrameMemfd : the header of a frame of the size and format, then
+//                      room for its rows, mapped at pMapping +
+//                      header.dataOffset for the frame to be rendered
+//                      into, see renderFrameToMemory. False on failure
+//
+bool createFrameMemfd( uint32_t    width,
+                       uint32_t    height,
+                       uint64_t    bytesPerRow,
+                       VkFormat    colorFormat,
+                       PixelLayout pixelLayout,
+                       uint32_t    frame,
+                       FrameMemfd* pMemfd );
+
+// * sealFrameMemfd : unmaps the memfd and seals it against changes. False
+//                    on failure
+//
+bool sealFrameMemfd(FrameMemfd* pMemfd);
+
+// * disposeFrameMemfd : unmaps and closes what is left
+//
+void disposeFrameMemfd(FrameMemfd* pMemfd);
+
+// * listenForFrames : a listening SOCK_SEQPACKET socket, replacing a stale
+//                     socket file, or -1
+//
+int listenForFrames(const char* socketPath);
+
+// * connectFrameConsumer : a SOCK_SEQPACKET socket connected to a consumer,
+//                          or -1. Each frame is one message, so threads may
+//                          send frames concurrently
+//
+int connectFrameConsumer(const char* socketPath);
+
+// * sendFrame : the header of a sealed memfd, with the memfd
+//
+bool sendFrame(int socket, const FrameMemfd* pMemfd);
+
+// * sendFrameCopy : a frame held on the host, copied into a memfd of its
+//                   own. Frames still to be rendered are rendered into
+//                   the memfd instead, see createFrameMemfd
+//
+bool sendFrameCopy(int socket, const ImageContext* pImageContext, uint32_t frame);
+
+// * receiveFrame : the next frame's header, and its memfd, which the caller
+//                  closes. False once the producer disconnects
+//
+bool receiveFrame(int socket, FrameHeader* pHeader, int* pMemfd);
@@ -0,0 +1,415 @@
+//
+// damagebench.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "renderer.h"
+#include "scene.h"
+#include "timing.h"
+#include "utilities.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Benchmark parameters
+//
+//====----------------------------------------------------------------------====
+
+// * A 1080p sequence of a grid scene in which one rectangle moves and
+//   changes color each frame
+//
+constexpr uint32_t benchWidth     = 1920;
+constexpr uint32_t benchHeight    = 1080;
+constexpr uint32_t benchColumns   = 64;
+constexpr uint32_t benchRows      = 36;
+constexpr uint32_t benchFrames    = 60;
+constexpr uint32_t benchMaxDamage = 16;
+
+// * Layouts : read back by copy, and packed
+//
+const PixelLayout benchLayouts[]     = { PIXEL_LAYOUT_RGBA_PREMULTIPLIED, PIXEL_LAYOUT_RGB };
+const char* const benchLayoutNames[] = { "rgba", "rgb" };
+
+//====----------------------------------------------------------------------====
+//
+// * Scene
+//
+//====----------------------------------------------------------------------====
+
+// * makeGridScene : a rectangle inset by a quarter of its cell, half of them
+//                   translucent so that moved rectangles blend over others
+//
+void makeGridScene(SceneRect* pRects)
+{
+    for (uint32_t row = 0; row < benchRows; ++row)
+    {
+        for (uint32_t column = 0; column < benchColumns; ++column)
+        {
+            auto const cellWidth  = 2.0f / benchColumns;
+            auto const cellHeight = 2.0f / benchRows;
+            auto const left       = -1.0f + column * cellWidth;
+            auto const top        = -1.0f + row * cellHeight;
+
+            auto const alpha = ( 0 == (column + row) % 2 ) ? 255u : 128u;
+            auto const red   = alpha * column / benchColumns;
+            auto const green = alpha * row / benchRows;
+            auto const blue  = alpha - (red + green) / 2;
+
+            pRects[row * benchColumns + column] = (SceneRect){
+                .left   = left + 0.25f * cellWidth,
+                .top    = top + 0.25f * cellHeight,
+                .right  = left + 0.75f * cellWidth,
+                .bottom = top + 0.75f * cellHeight,
+                .color  = red | (green << 8) | (blue << 16) | (alpha << 24)
+            };
+        }
+    }
+}
+
+// * editRect : moves the rectangle half its width over its neighbour, or
+//              back, and rotates its color channels
+//
+void editRect(SceneRect* pRect, uint32_t frame)
+{
+    auto const shift = ( (0 == frame % 2) ? 0.5f : -0.5f )
+                     * (pRect->right - pRect->left);
+
+    pRect->left  += shift;
+    pRect->right += shift;
+
+    auto const rgb = pRect->color & 0x00ffffffu;
+
+    pRect->color = (pRect->color & 0xff000000u)
+                 | ( (rgb << 8) & 0x00ffff00u ) | (rgb >> 16);
+}
+
+// * writeScene
+//
+bool writeScene(const char* filename, const SceneRect* pRects, uint32_t rectCount)
+{
+    const SceneHeader header = {
+        .magic      = sceneMagic,
+        .version    = sceneVersion,
+        .recordSize = sizeof(SceneRect),
+        .rectCount  = rectCount,
+        .reserved   = 0
+    };
+
+    auto const file = fopen(filename, "wb");
+
+    if (nullptr == file) {
+        return false;
+    }
+
+    auto isWritten = (1 == fwrite(&header, sizeof(header), 1, file))
+                  && (rectCount == fwrite(pRects, sizeof(SceneRect), rectCount, file));
+
+    isWritten = (0 == fclose(file)) && isWritten;
+
+    return isWritten;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Running
+//
+//====----------------------------------------------------------------------====
+
+// * BenchResult : medians, and readback bytes per frame
+//
+typedef struct BenchResult
+{
+    double fullMs;
+    double damageMs;
+    double fullGPUMs;               // negative when unavailable
+    double damageGPUMs;
+    double fullReadbackMB;
+    double damageReadbackMB;
+    bool   isMatch;                 // every incremental frame was exact
+}
+BenchResult;
+
+// * isSameFrame : pixels only, rows may be padded
+//
+bool isSameFrame(const ImageContext* pLeft, const ImageContext* pRight)
+{
+    auto const rowBytes = (size_t)formatBytesPerPixel(pLeft->colorPixelFormat)
+                        * pLeft->width;
+
+    if ( pLeft->width != pRight->width || pLeft->height != pRight->height ||
+         pLeft->colorPixelFormat != pRight->colorPixelFormat )
+    {
+        return false;
+    }
+
+    for (uint32_t yy = 0; yy < pLeft->height; ++yy)
+    {
+        if ( 0 != memcmp( pLeft->data + yy * pLeft->bytesPerRow,
+                          pRight->data + yy * pRight->bytesPerRow, rowBytes ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// * runLayout : the sequence rendered incrementally on one target, and in
+//               full on another for reference
+//
+bool runLayout( PixelLayout  pixelLayout,
+                const char*  sceneFilename,
+                BenchResult* pResult )
+{
+    constexpr uint32_t rectCount = benchColumns * benchRows;
+
+    auto pPrevious = (SceneRect*)malloc(rectCount * sizeof(SceneRect));
+    auto pNext     = (SceneRect*)malloc(rectCount * sizeof(SceneRect));
+
+    if (nullptr == pPrevious || nullptr == pNext)
+    {
+        free(pNext);
+        free(pPrevious);
+        return false;
+    }
+
+    makeGridScene(pPrevious);
+
+    const RendererInfo rendererInfo = {
+        .colorFormat      = VK_FORMAT_R8G8B8A8_UNORM,
+        .pixelLayout      = pixelLayout,
+        .enableValidation = false,
+        .sceneFilename    = sceneFilename
+    };
+
+    Renderer     renderer        = {};
+    RenderTarget target          = {};
+    RenderTarget referenceTarget = {};
+    ImageContext frame           = {};
+
+    FrameTimings fullTimings[benchFrames]   = {};
+    FrameTimings damageTimings[benchFrames] = {};
+    double       fullMs[benchFrames]        = {};
+    double       damageMs[benchFrames]      = {};
+
+    auto result = createRenderer(&rendererInfo, &renderer);
+
+    if (VK_SUCCESS == result) {
+        result = createRenderTarget(&renderer, benchWidth, benchHeight, &target);
+    }
+
+    if (VK_SUCCESS == result) {
+        result = createRenderTarget(&renderer, benchWidth, benchHeight, &referenceTarget);
+    }
+
+    //  - first frame, in full
+    if (VK_SUCCESS == result) {
+        result = renderFrame(&renderer, &target, &frame, nullptr);
+    }
+
+    auto const bytesPerPixel = (double)formatBytesPerPixel(readbackColorFormat(&renderer));
+
+    auto hasGPUTimings = true;
+    auto damageBytes   = 0.0;
+
+    pResult->isMatch = (VK_SUCCESS == result);
+
+    for (uint32_t ff = 0; ff < benchFrames && VK_SUCCESS == result; ++ff)
+    {
+        //  - edit
+        auto const index = (uint32_t)( (ff * 7919ull) % rectCount );
+
+        memcpy(pNext, pPrevious, rectCount * sizeof(SceneRect));
+        editRect(&pNext[index], ff);
+
+        VkRect2D damage[benchMaxDamage] = {};
+
+        auto const damageCount = computeSceneDamage( pPrevious, pNext, rectCount,
+                                                     benchWidth, benchHeight,
+                                                     damage, benchMaxDamage );
+
+        result = updateRendererScene(&renderer, index, 1, &pNext[index]);
+
+        //  - incremental
+        if (VK_SUCCESS == result)
+        {
+            auto const start = getTimeMs();
+
+            result = renderFrameDamage( &renderer, &target, damage, damageCount,
+                                        &frame, &damageTimings[ff] );
+
+            damageMs[ff] = getTimeMs() - start;
+        }
+
+        for (uint32_t dd = 0; dd < damageCount; ++dd)
+        {
+            damageBytes += bytesPerPixel * damage[dd].extent.width
+                                         * damage[dd].extent.height;
+        }
+
+        //  - reference
+        ImageContext reference = {};
+
+        if (VK_SUCCESS == result)
+        {
+            auto const start = getTimeMs();
+
+            result = renderFrame(&renderer, &referenceTarget, &reference, &fullTimings[ff]);
+
+            fullMs[ff] = getTimeMs() - start;
+        }
+
+        if (VK_SUCCESS == result) {
+            pResult->isMatch = pResult->isMatch && isSameFrame(&frame, &reference);
+        }
+
+        disposeImageContext(&reference);
+
+        hasGPUTimings = hasGPUTimings && fullTimings[ff].hasGPUTimings
+                                      && damageTimings[ff].hasGPUTimings;
+
+        auto const pSwap = pPrevious;
+
+        pPrevious = pNext;
+        pNext     = pSwap;
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        pResult->fullMs   = summarizeTimings(fullMs, benchFrames, sizeof(double)).median;
+        pResult->damageMs = summarizeTimings(damageMs, benchFrames, sizeof(double)).median;
+
+        pResult->fullGPUMs   = hasGPUTimings
+                             ? summarizeTimings( &fullTimings[0].gpuMs, benchFrames,
+                                                 sizeof(FrameTimings) ).median
+                             : -1.0;
+        pResult->damageGPUMs = hasGPUTimings
+                             ? summarizeTimings( &damageTimings[0].gpuMs, benchFrames,
+                                                 sizeof(FrameTimings) ).median
+                             : -1.0;
+
+        pResult->fullReadbackMB   = 1e-6 * bytesPerPixel * benchWidth * benchHeight;
+        pResult->damageReadbackMB = 1e-6 * damageBytes / benchFrames;
+    }
+
+    disposeImageContext(&frame);
+
+    if (nullptr != renderer.device)
+    {
+        destroyRenderTarget(&renderer, &referenceTarget);
+        destroyRenderTarget(&renderer, &target);
+    }
+
+    destroyRenderer(&renderer);
+
+    free(pNext);
+    free(pPrevious);
+
+    return VK_SUCCESS == result;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main( [[maybe_unused]] const int         argc,
+          [[maybe_unused]] const char* const argv[] )
+{
+    //  - scene
+    auto pRects = (SceneRect*)malloc(benchColumns * benchRows * sizeof(SceneRect));
+
+    char sceneFilename[] = "/tmp/damagebench-XXXXXX";
+
+    auto const fd = mkstemp(sceneFilename);
+
+    if (0 <= fd) {
+        close(fd);
+    }
+
+    if (nullptr != pRects) {
+        makeGridScene(pRects);
+    }
+
+    auto const isWritten = (0 <= fd) && nullptr != pRects
+                        && writeScene(sceneFilename, pRects, benchColumns * benchRows);
+    free(pRects);
+
+    if (!isWritten)
+    {
+        puts("Failed to write the benchmark scene");
+
+        if (0 <= fd) {
+            unlink(sceneFilename);
+        }
+
+        return EXIT_FAILURE;
+    }
+
+    //  - runs
+    printf( "%ux%u, %u rectangles, one edited per frame, median of %u frames\n\n",
+            benchWidth, benchHeight, benchColumns * benchRows, benchFrames );
+
+    printf( "%-8s %-6s %12s %10s %10s %8s  %s\n",
+            "layout", "mode", "readback_mb", "gpu_ms", "frame_ms", "speedup", "check" );
+
+    auto const layoutCount = (uint32_t)( sizeof(benchLayouts)/sizeof(benchLayouts[0]) );
+
+    auto failed = false;
+
+    for (uint32_t ll = 0; ll < layoutCount; ++ll)
+    {
+        BenchResult result = {};
+
+        if (!runLayout(benchLayouts[ll], sceneFilename, &result))
+        {
+            printf("%-8s %-6s %12s\n", benchLayoutNames[ll], "", "failed");
+            failed = true;
+            continue;
+        }
+
+        char fullGPU[16]   = "-";
+        char damageGPU[16] = "-";
+
+        if (0.0 <= result.fullGPUMs)
+        {
+            snprintf(fullGPU, sizeof(fullGPU), "%.3f", result.fullGPUMs);
+            snprintf(damageGPU, sizeof(damageGPU), "%.3f", result.damageGPUMs);
+        }
+
+        printf( "%-8s %-6s %12.3f %10s %10.3f %8s  %s\n",
+                benchLayoutNames[ll], "full", result.fullReadbackMB,
+                fullGPU, result.fullMs, "", "" );
+
+        printf( "%-8s %-6s %12.3f %10s %10.3f %7.2fx  %s\n",
+                benchLayoutNames[ll], "damage", result.damageReadbackMB,
+                damageGPU, result.damageMs,
+                (0.0 < result.damageMs) ? result.fullMs / result.damageMs : 0.0,
+                result.isMatch ? "ok" : "MISMATCH" );
+
+        failed = failed || !result.isMatch;
+    }
+
+    unlink(sceneFilename);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
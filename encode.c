@@ -0,0 +1,281 @@
+//
+// encode.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <tiffio.h>
+
+#include <string.h>
+
+#include "encode.h"
+#include "pixels.h"
+#include "trace.h"
+
+//====----------------------------------------------------------------------====
+// * saveRGBATIFFFile
+//====----------------------------------------------------------------------====
+
+// * getTIFFSampleFormat : A2B10G10R10 is widened to 16 bits per sample
+//
+bool getTIFFSampleFormat( VkFormat  colorPixelFormat,
+                          uint16_t* pBitsPerSample,
+                          uint16_t* pSampleFormat )
+{
+    switch (colorPixelFormat)
+    {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8G8B8_UNORM:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            *pBitsPerSample = 8;
+            *pSampleFormat  = SAMPLEFORMAT_UINT;
+            return true;
+
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+            *pBitsPerSample = 16;
+            *pSampleFormat  = SAMPLEFORMAT_UINT;
+            return true;
+
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            *pBitsPerSample = 16;
+            *pSampleFormat  = SAMPLEFORMAT_IEEEFP;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// * getTIFFCompression
+//
+uint16_t getTIFFCompression(TIFFCompression compression) [[unsequenced]]
+{
+    switch (compression)
+    {
+        case TIFF_COMPRESSION_LZW:      return COMPRESSION_LZW;
+        case TIFF_COMPRESSION_DEFLATE:  return COMPRESSION_ADOBE_DEFLATE;
+        case TIFF_COMPRESSION_PACKBITS: return COMPRESSION_PACKBITS;
+        default:                        return COMPRESSION_NONE;
+    }
+}
+
+// * writeTIFFPage : the image properties and scanlines of one directory.
+//                   Reduced resolution pages are marked as such
+//
+bool writeTIFFPage( TIFF*                 file,
+                    const ImageContext*   pImageContext,
+                    const PixelRowKernel* stages,
+                    uint32_t              stageCount,
+                    uint16_t              bitsPerSample,
+                    uint16_t              sampleFormat,
+                    uint16_t              compression,
+                    bool                  isUnassociated,
+                    bool                  isReduced )
+{
+    //  - image properties
+    auto const width       = pImageContext->width;
+    auto const height      = pImageContext->height;
+    auto const bytesPerRow = (size_t)pImageContext->bytesPerRow;
+    auto const pixelLayout = pImageContext->pixelLayout;
+    auto const sampleCount = samplesPerPixel(pixelLayout);
+
+    if (isReduced) {
+        TIFFSetField(file, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+    }
+
+    TIFFSetField(file, TIFFTAG_IMAGEWIDTH, width);
+    TIFFSetField(file, TIFFTAG_IMAGELENGTH, height);
+    TIFFSetField(file, TIFFTAG_SAMPLESPERPIXEL, sampleCount);
+    TIFFSetField(file, TIFFTAG_BITSPERSAMPLE, bitsPerSample);
+    TIFFSetField(file, TIFFTAG_SAMPLEFORMAT, sampleFormat);
+    TIFFSetField(file, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+    TIFFSetField(file, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+
+    TIFFSetField( file, TIFFTAG_PHOTOMETRIC,
+                  (PIXEL_LAYOUT_GRAY == pixelLayout) ? PHOTOMETRIC_MINISBLACK
+                                                     : PHOTOMETRIC_RGB );
+
+    //  - compression
+    TIFFSetField(file, TIFFTAG_COMPRESSION, compression);
+
+    if ( SAMPLEFORMAT_UINT == sampleFormat &&
+         ( COMPRESSION_LZW == compression ||
+           COMPRESSION_ADOBE_DEFLATE == compression ) )
+    {
+        TIFFSetField(file, TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL);
+    }
+
+    //  - alpha, if any
+    if (4 == sampleCount)
+    {
+        const uint16_t extraSample = isUnassociated ? EXTRASAMPLE_UNASSALPHA
+                                                    : EXTRASAMPLE_ASSOCALPHA;
+
+        TIFFSetField(file, TIFFTAG_EXTRASAMPLES, 1, &extraSample);
+    }
+
+    TIFFSetField( file, TIFFTAG_ROWSPERSTRIP,
+                  TIFFDefaultStripSize(file, sampleCount*width) );
+
+    //  - scan line buffer, plus two intermediate rows of at most 16-bit RGBA
+    //    for multi-stage transforms
+    auto const preferredScanlineSize = (size_t)TIFFScanlineSize(file);
+    auto const stageRowSize          = (size_t)8 * width;
+
+    auto const scanlineSize = (0 < preferredScanlineSize)
+                               ? preferredScanlineSize
+                               : stageRowSize;
+
+    auto scanlineBuffer = (uint8_t*)_TIFFmalloc(scanlineSize + 2*stageRowSize);
+    auto result         = false;
+
+    if (nullptr != scanlineBuffer)
+    {
+        TRACE_BEGIN(encodeSpan, "tiff encode");
+
+        //  - write each scanline
+        auto const rowCopySize = (scanlineSize < bytesPerRow)
+                                  ? scanlineSize
+                                  : bytesPerRow;
+
+        uint8_t* const stageRows[2] = {
+            scanlineBuffer + scanlineSize,
+            scanlineBuffer + scanlineSize + stageRowSize
+        };
+
+        const uint8_t* row         = pImageContext->data;
+        int            writeResult = -1;
+
+        for (uint32_t yy = 0; yy < height; ++yy)
+        {
+            if (0 == stageCount) {
+                memcpy(scanlineBuffer, row, rowCopySize);
+            }
+
+            //  - the last stage writes the scanline itself
+            const uint8_t* source = row;
+
+            for (uint32_t ss = 0; ss < stageCount; ++ss)
+            {
+                auto const dest = (ss + 1 == stageCount) ? scanlineBuffer
+                                                         : stageRows[ss % 2];
+                stages[ss](dest, source, width);
+                source = dest;
+            }
+
+            writeResult = TIFFWriteScanline(file, scanlineBuffer, yy, 0);
+
+            if (writeResult < 0) {
+                break;
+            }
+
+            row += bytesPerRow;
+        }
+
+        TRACE_END(encodeSpan);
+
+        //  - cleanup buffer
+        _TIFFfree(scanlineBuffer);
+        scanlineBuffer = nullptr;
+
+        //  - result
+        result = (0 <= writeResult);
+    }
+
+    return result;
+}
+
+// * saveRGBATIFFFile
+//
+bool saveRGBATIFFFile( const char*             filename,
+                       const ImageContext*     pImageContext,
+                       const TIFFWriteOptions* pOptions )
+{
+    auto const format      = pImageContext->colorPixelFormat;
+    auto const pixelLayout = pImageContext->pixelLayout;
+
+    uint16_t bitsPerSample = 0;
+    uint16_t sampleFormat  = 0;
+
+    if (!getTIFFSampleFormat(format, &bitsPerSample, &sampleFormat)) {
+        return false;
+    }
+
+    //  - row transforms, in order
+    auto const kernels = getPixelKernels();
+
+    PixelRowKernel stages[3]  = {};
+    uint32_t       stageCount = 0;
+
+    if (VK_FORMAT_A2B10G10R10_UNORM_PACK32 == format) {
+        stages[stageCount++] = kernels->widenA2B10G10R10;
+    }
+
+    if (pOptions->narrowTo8Bits && 16 == bitsPerSample)
+    {
+        if (SAMPLEFORMAT_UINT != sampleFormat) {
+            return false;
+        }
+
+        stages[stageCount++] = kernels->narrowRGBA16;
+        bitsPerSample        = 8;
+    }
+
+    auto const isUnassociated = (PIXEL_LAYOUT_RGBA == pixelLayout) ||
+                                ( pOptions->unassociateAlpha &&
+                                  PIXEL_LAYOUT_RGBA_PREMULTIPLIED == pixelLayout );
+
+    if (isUnassociated && PIXEL_LAYOUT_RGBA != pixelLayout)
+    {
+        if (8 != bitsPerSample) {
+            return false;
+        }
+
+        stages[stageCount++] = kernels->unpremultiplyRGBA8;
+    }
+
+    auto file = TIFFOpen(filename, "w");
+
+    if (nullptr == file) {
+        return false;
+    }
+
+    //  - the frame, then its previews, each as a page of its own
+    auto const compression = getTIFFCompression(pOptions->compression);
+    auto const pageCount   = 1 + pImageContext->previewCount;
+    auto       result      = true;
+
+    for (uint32_t pp = 0; result && pp < pageCount; ++pp)
+    {
+        auto const pPage = (0 == pp) ? pImageContext
+                                     : &pImageContext->pPreviews[pp - 1];
+
+        result = writeTIFFPage( file, pPage, stages, stageCount,
+                                bitsPerSample, sampleFormat, compression,
+                                isUnassociated, 0 < pp );
+
+        if (result && pp + 1 < pageCount) {
+            result = (0 != TIFFWriteDirectory(file));
+        }
+    }
+
+    //  - cleanup file
+    TIFFClose(file);
+    file = nullptr;
+
+    return result;
+}
@@ -0,0 +1,56 @@
+//
+// encode.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include "renderer.h"
+
+//====----------------------------------------------------------------------====
+// * TIFF encoding
+//====----------------------------------------------------------------------====
+
+// * TIFFCompression : lossless schemes. LZW and deflate use the horizontal
+//                     differencing predictor for integer samples
+//
+typedef enum TIFFCompression
+{
+    TIFF_COMPRESSION_NONE     = 0,
+    TIFF_COMPRESSION_LZW      = 1,
+    TIFF_COMPRESSION_DEFLATE  = 2,
+    TIFF_COMPRESSION_PACKBITS = 3
+}
+TIFFCompression;
+
+// * TIFFWriteOptions : host-side transforms applied as each row is encoded
+//
+typedef struct TIFFWriteOptions
+{
+    bool            narrowTo8Bits;      // write 16-bit unorm samples as 8-bit
+    bool            unassociateAlpha;   // write premultiplied RGBA8 as unassociated
+    TIFFCompression compression;
+}
+TIFFWriteOptions;
+
+// * saveRGBATIFFFile : gray, RGB or RGBA samples according to the image
+//                      context's pixel layout. Previews follow the frame as
+//                      reduced resolution pages
+//
+bool saveRGBATIFFFile( const char*             filename,
+                       const ImageContext*     pImageContext,
+                       const TIFFWriteOptions* pOptions );
@@ -0,0 +1,418 @@
+//
+// pack.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pack.h"
+#include "rendercache.h"
+#include "utilities.h"
+
+#include <string.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Shader data
+//
+//====----------------------------------------------------------------------====
+
+const uint8_t alignas(uint32_t) packShaderData[] = {
+    #embed "pack.spv"
+};
+
+//====----------------------------------------------------------------------====
+//
+// * Pixel layout
+//
+//====----------------------------------------------------------------------====
+
+// * samplesPerPixel
+//
+uint32_t samplesPerPixel(PixelLayout pixelLayout) [[unsequenced]]
+{
+    switch (pixelLayout)
+    {
+        case PIXEL_LAYOUT_RGB:  return 3;
+        case PIXEL_LAYOUT_GRAY: return 1;
+        default:                return 4;
+    }
+}
+
+// * isPackedPixelLayout
+//
+bool isPackedPixelLayout(PixelLayout pixelLayout) [[unsequenced]]
+{
+    return PIXEL_LAYOUT_RGBA_PREMULTIPLIED != pixelLayout;
+}
+
+// * packedPixelFormat
+//
+VkFormat packedPixelFormat(PixelLayout pixelLayout) [[unsequenced]]
+{
+    switch (pixelLayout)
+    {
+        case PIXEL_LAYOUT_RGB:  return VK_FORMAT_R8G8B8_UNORM;
+        case PIXEL_LAYOUT_GRAY: return VK_FORMAT_R8_UNORM;
+        default:                return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+// * packedWordsPerRow
+//
+uint32_t packedWordsPerRow(PixelLayout pixelLayout, uint32_t width) [[unsequenced]]
+{
+    //  - four pixels of n samples fill exactly n words
+    auto const groupsPerRow = (width + 3) / 4;
+
+    return groupsPerRow * samplesPerPixel(pixelLayout);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Pack pipeline
+//
+//====----------------------------------------------------------------------====
+
+// * PackParameters : push constants, see pack.glsl
+//
+typedef struct PackParameters
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelLayout;
+    uint32_t wordsPerRow;
+}
+PackParameters;
+
+// * createPackPipeline
+//
+VkResult createPackPipeline( VkDevice                     device,
+                             VkPipelineCache              pipelineCache,
+                             const VkAllocationCallbacks* pAllocator,
+                             PackPipeline*                pPackPipeline )
+{
+    VkResult       result       = VK_SUCCESS;
+    PackPipeline   packPipeline = {};
+    VkShaderModule packShader   = nullptr;
+
+    do
+    {
+        //  - descriptor set layout
+        const VkDescriptorSetLayoutBinding bindings[] = {
+            {
+                .binding            = 0,
+                .descriptorType     = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                .descriptorCount    = 1,
+                .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr
+            },
+            {
+                .binding            = 1,
+                .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount    = 1,
+                .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+                .pImmutableSamplers = nullptr
+            }
+        };
+
+        const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = {
+            .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext        = nullptr,
+            .flags        = 0,
+            .bindingCount = ARRAY_LENGTH(bindings),
+            .pBindings    = bindings
+        };
+
+        result = vkCreateDescriptorSetLayout( device, &descriptorSetLayoutInfo,
+                                              pAllocator,
+                                              &packPipeline.descriptorSetLayout );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - pipeline layout
+        const VkPushConstantRange pushConstantRange = {
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset     = 0,
+            .size       = sizeof(PackParameters)
+        };
+
+        const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+            .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext                  = nullptr,
+            .flags                  = 0,
+            .setLayoutCount         = 1,
+            .pSetLayouts            = &packPipeline.descriptorSetLayout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges    = &pushConstantRange
+        };
+
+        result = vkCreatePipelineLayout( device, &pipelineLayoutInfo, pAllocator,
+                                         &packPipeline.pipelineLayout );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - shader
+        const VkShaderModuleCreateInfo packShaderInfo = {
+            .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext    = nullptr,
+            .flags    = 0,
+            .codeSize = sizeof(packShaderData),
+            .pCode    = (const uint32_t*)packShaderData
+        };
+
+        result = vkCreateShaderModule( device, &packShaderInfo, pAllocator,
+                                       &packShader );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - pipeline
+        const VkComputePipelineCreateInfo pipelineInfo = {
+            .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .pNext  = nullptr,
+            .flags  = 0,
+            .stage  = {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext               = nullptr,
+                .flags               = 0,
+                .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module              = packShader,
+                .pName               = "main",
+                .pSpecializationInfo = nullptr
+            },
+            .layout             = packPipeline.pipelineLayout,
+            .basePipelineHandle = nullptr,
+            .basePipelineIndex  = -1
+        };
+
+        result = vkCreateComputePipelines( device, pipelineCache, 1,
+                                           &pipelineInfo, pAllocator,
+                                           &packPipeline.pipeline );
+    }
+    while (0);
+
+    //  - shader module no longer in use
+    vkDestroyShaderModule(device, packShader, pAllocator);
+    packShader = nullptr;
+
+    if (VK_SUCCESS != result) {
+        destroyPackPipeline(device, pAllocator, &packPipeline);
+    }
+
+    *pPackPipeline = packPipeline;
+
+    return result;
+}
+
+// * destroyPackPipeline
+//
+void destroyPackPipeline( VkDevice                     device,
+                          const VkAllocationCallbacks* pAllocator,
+                          PackPipeline*                pPackPipeline )
+{
+    vkDestroyPipeline(device, pPackPipeline->pipeline, pAllocator);
+    vkDestroyPipelineLayout(device, pPackPipeline->pipelineLayout, pAllocator);
+
+    vkDestroyDescriptorSetLayout( device, pPackPipeline->descriptorSetLayout,
+                                  pAllocator );
+
+    memset( pPackPipeline, 0, sizeof(*pPackPipeline) );
+}
+
+// * addPackShaderToCacheKey
+//
+void addPackShaderToCacheKey(CacheKeyHasher* pHasher)
+{
+    addCacheKeyData(pHasher, packShaderData, sizeof(packShaderData));
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Pack descriptor set
+//
+//====----------------------------------------------------------------------====
+
+// * createPackDescriptorSet
+//
+VkResult createPackDescriptorSet
+(
+    VkDevice                     device,
+    const PackPipeline*          pPackPipeline,
+    VkImageView                  sourceImageView,
+    VkBuffer                     destinationBuffer,
+    const VkAllocationCallbacks* pAllocator,
+    VkDescriptorPool*            pDescriptorPool,
+    VkDescriptorSet*             pDescriptorSet
+)
+{
+    //  - pool
+    const VkDescriptorPoolSize poolSizes[] = {
+        { .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,  .descriptorCount = 1 },
+        { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 }
+    };
+
+    const VkDescriptorPoolCreateInfo descriptorPoolInfo = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext         = nullptr,
+        .flags         = 0,
+        .maxSets       = 1,
+        .poolSizeCount = ARRAY_LENGTH(poolSizes),
+        .pPoolSizes    = poolSizes
+    };
+
+    VkDescriptorPool descriptorPool = nullptr;
+    VkDescriptorSet  descriptorSet  = nullptr;
+
+    auto result = vkCreateDescriptorPool( device, &descriptorPoolInfo, pAllocator,
+                                          &descriptorPool );
+    if (VK_SUCCESS == result)
+    {
+        //  - set
+        const VkDescriptorSetAllocateInfo descriptorSetInfo = {
+            .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext              = nullptr,
+            .descriptorPool     = descriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts        = &pPackPipeline->descriptorSetLayout
+        };
+
+        result = vkAllocateDescriptorSets( device, &descriptorSetInfo,
+                                           &descriptorSet );
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        //  - update
+        const VkDescriptorImageInfo sourceImageInfo = {
+            .sampler     = nullptr,
+            .imageView   = sourceImageView,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        };
+
+        const VkDescriptorBufferInfo destinationBufferInfo = {
+            .buffer = destinationBuffer,
+            .offset = 0,
+            .range  = VK_WHOLE_SIZE
+        };
+
+        const VkWriteDescriptorSet descriptorWrites[] = {
+            {
+                .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext            = nullptr,
+                .dstSet           = descriptorSet,
+                .dstBinding       = 0,
+                .dstArrayElement  = 0,
+                .descriptorCount  = 1,
+                .descriptorType   = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                .pImageInfo       = &sourceImageInfo,
+                .pBufferInfo      = nullptr,
+                .pTexelBufferView = nullptr
+            },
+            {
+                .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext            = nullptr,
+                .dstSet           = descriptorSet,
+                .dstBinding       = 1,
+                .dstArrayElement  = 0,
+                .descriptorCount  = 1,
+                .descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo       = nullptr,
+                .pBufferInfo      = &destinationBufferInfo,
+                .pTexelBufferView = nullptr
+            }
+        };
+
+        vkUpdateDescriptorSets( device, ARRAY_LENGTH(descriptorWrites),
+                                descriptorWrites, 0, nullptr );
+    }
+    else
+    {
+        vkDestroyDescriptorPool(device, descriptorPool, pAllocator);
+        descriptorPool = nullptr;
+        descriptorSet  = nullptr;
+    }
+
+    *pDescriptorPool = descriptorPool;
+    *pDescriptorSet  = descriptorSet;
+
+    return result;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Commands
+//
+//====----------------------------------------------------------------------====
+
+// * recordPackCommands
+//
+void recordPackCommands
+(
+    VkCommandBuffer     commandBuffer,
+    const PackPipeline* pPackPipeline,
+    VkDescriptorSet     descriptorSet,
+    VkBuffer            destinationBuffer,
+    PixelLayout         pixelLayout,
+    uint32_t            width,
+    uint32_t            height
+)
+{
+    //  - pipeline and resources
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                       pPackPipeline->pipeline );
+
+    vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                             pPackPipeline->pipelineLayout, 0, 1,
+                             &descriptorSet, 0, nullptr );
+
+    const PackParameters parameters = {
+        .width       = width,
+        .height      = height,
+        .pixelLayout = (uint32_t)pixelLayout,
+        .wordsPerRow = packedWordsPerRow(pixelLayout, width)
+    };
+
+    vkCmdPushConstants( commandBuffer, pPackPipeline->pipelineLayout,
+                        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters),
+                        &parameters );
+
+    //  - dispatch : one invocation per group of four pixels, 8x8 workgroups
+    auto const groupsPerRow = (width + 3) / 4;
+
+    vkCmdDispatch( commandBuffer, (groupsPerRow + 7) / 8, (height + 7) / 8, 1 );
+
+    //  - make shader writes available to host reads
+    const VkBufferMemoryBarrier hostReadBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = destinationBuffer,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE
+    };
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr,
+                          1, &hostReadBarrier,
+                          0, nullptr );
+}
@@ -0,0 +1,116 @@
+//
+// pack.glsl
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#version 450
+#extension GL_EXT_samplerless_texture_functions : require
+#pragma shader_stage(compute)
+
+// * Pixel layouts : must match PixelLayout in pack.h
+//
+const uint PIXEL_LAYOUT_RGBA = 1;
+const uint PIXEL_LAYOUT_RGB  = 2;
+const uint PIXEL_LAYOUT_GRAY = 3;
+
+// * Each invocation packs a group of four horizontally adjacent pixels, which
+//   always fills a whole number of 32-bit words: 4 (RGBA), 3 (RGB) or 1 (Gray)
+//
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform texture2D sourceImage;
+
+layout(set = 0, binding = 1, std430) writeonly buffer Destination {
+    uint words[];
+}
+destination;
+
+layout(push_constant) uniform PackParameters {
+    uvec2 extent;
+    uint  pixelLayout;
+    uint  wordsPerRow;
+}
+parameters;
+
+vec4 loadPixel(uint x, uint y)
+{
+    return (x < parameters.extent.x)
+        ? texelFetch(sourceImage, ivec2(x, y), 0)
+        : vec4(0.0);
+}
+
+vec4 unpremultiply(vec4 color)
+{
+    return (0.0 < color.a) ? vec4(color.rgb / color.a, color.a) : vec4(0.0);
+}
+
+float luminance(vec4 color)
+{
+    return dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    const uint group = gl_GlobalInvocationID.x;
+    const uint y     = gl_GlobalInvocationID.y;
+    const uint x     = 4 * group;
+
+    if (parameters.extent.x <= x || parameters.extent.y <= y) {
+        return;
+    }
+
+    //  - opaque layouts composite over black, which for associated alpha
+    //    is simply the stored color
+    const vec4 p0 = loadPixel(x + 0, y);
+    const vec4 p1 = loadPixel(x + 1, y);
+    const vec4 p2 = loadPixel(x + 2, y);
+    const vec4 p3 = loadPixel(x + 3, y);
+
+    const uint row = y * parameters.wordsPerRow;
+
+    switch (parameters.pixelLayout)
+    {
+        case PIXEL_LAYOUT_RGBA:
+        {
+            const uint word = row + 4 * group;
+
+            destination.words[word + 0] = packUnorm4x8(unpremultiply(p0));
+            destination.words[word + 1] = packUnorm4x8(unpremultiply(p1));
+            destination.words[word + 2] = packUnorm4x8(unpremultiply(p2));
+            destination.words[word + 3] = packUnorm4x8(unpremultiply(p3));
+            break;
+        }
+        case PIXEL_LAYOUT_RGB:
+        {
+            //  r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+            const uint word = row + 3 * group;
+
+            destination.words[word + 0] = packUnorm4x8(vec4(p0.rgb, p1.r));
+            destination.words[word + 1] = packUnorm4x8(vec4(p1.gb, p2.rg));
+            destination.words[word + 2] = packUnorm4x8(vec4(p2.b, p3.rgb));
+            break;
+        }
+        case PIXEL_LAYOUT_GRAY:
+        {
+            destination.words[row + group] = packUnorm4x8( vec4( luminance(p0),
+                                                                 luminance(p1),
+                                                                 luminance(p2),
+                                                                 luminance(p3) ) );
+            break;
+        }
+    }
+}
@@ -0,0 +1,132 @@
+//
+// pack.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// * CacheKeyHasher : rendercache.h
+//
+typedef struct CacheKeyHasher CacheKeyHasher;
+
+//====----------------------------------------------------------------------====
+//
+// * Pixel layout
+//
+//====----------------------------------------------------------------------====
+
+// * PixelLayout : host-side layout of each pixel. All layouts other than
+//                 PIXEL_LAYOUT_RGBA_PREMULTIPLIED are produced on the device
+//                 by the pack compute pass (see pack.glsl)
+//
+typedef enum PixelLayout
+{
+    PIXEL_LAYOUT_RGBA_PREMULTIPLIED = 0,    // associated alpha, as rendered
+    PIXEL_LAYOUT_RGBA               = 1,    // unassociated alpha
+    PIXEL_LAYOUT_RGB                = 2,    // opaque, composited over black
+    PIXEL_LAYOUT_GRAY               = 3     // opaque luminance
+}
+PixelLayout;
+
+// * samplesPerPixel
+//
+uint32_t samplesPerPixel(PixelLayout pixelLayout) [[unsequenced]];
+
+// * isPackedPixelLayout
+//
+bool isPackedPixelLayout(PixelLayout pixelLayout) [[unsequenced]];
+
+// * packedPixelFormat : format of the host-side samples of a packed layout
+//
+VkFormat packedPixelFormat(PixelLayout pixelLayout) [[unsequenced]];
+
+// * packedWordsPerRow : rows are padded to a whole group of four pixels
+//
+uint32_t packedWordsPerRow(PixelLayout pixelLayout, uint32_t width) [[unsequenced]];
+
+//====----------------------------------------------------------------------====
+//
+// * Pack pipeline
+//
+//====----------------------------------------------------------------------====
+
+typedef struct PackPipeline
+{
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout      pipelineLayout;
+    VkPipeline            pipeline;
+}
+PackPipeline;
+
+// * createPackPipeline
+//
+VkResult createPackPipeline( VkDevice                     device,
+                             VkPipelineCache              pipelineCache,
+                             const VkAllocationCallbacks* pAllocator,
+                             PackPipeline*                pPackPipeline );
+
+// * destroyPackPipeline
+//
+void destroyPackPipeline( VkDevice                     device,
+                          const VkAllocationCallbacks* pAllocator,
+                          PackPipeline*                pPackPipeline );
+
+// * addPackShaderToCacheKey : the SPIR-V of the pack pass
+//
+void addPackShaderToCacheKey(CacheKeyHasher* pHasher);
+
+//====----------------------------------------------------------------------====
+//
+// * Pack descriptor set
+//
+//====----------------------------------------------------------------------====
+
+// * createPackDescriptorSet : source image must be in the shader read only
+//                             optimal layout when the pack is dispatched
+//
+VkResult createPackDescriptorSet
+(
+    VkDevice                     device,
+    const PackPipeline*          pPackPipeline,
+    VkImageView                  sourceImageView,
+    VkBuffer                     destinationBuffer,
+    const VkAllocationCallbacks* pAllocator,
+    VkDescriptorPool*            pDescriptorPool,
+    VkDescriptorSet*             pDescriptorSet
+);
+
+//====----------------------------------------------------------------------====
+//
+// * Commands
+//
+//====----------------------------------------------------------------------====
+
+// * recordPackCommands : dispatch the pack and make the destination buffer
+//                        visible to the host
+//
+void recordPackCommands
+(
+    VkCommandBuffer     commandBuffer,
+    const PackPipeline* pPackPipeline,
+    VkDescriptorSet     descriptorSet,
+    VkBuffer            destinationBuffer,
+    PixelLayout         pixelLayout,
+    uint32_t            width,
+    uint32_t            height
+);
@@ -0,0 +1,204 @@
+//
+// pixelbench.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pixels.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Benchmark parameters
+//
+//====----------------------------------------------------------------------====
+
+// * A 4k frame, streamed one row at a time as the encoder would
+//
+constexpr uint32_t benchWidth  = 3840;
+constexpr uint32_t benchHeight = 2160;
+constexpr uint32_t benchRounds = 5;
+
+//====----------------------------------------------------------------------====
+//
+// * Kernels under test
+//
+//====----------------------------------------------------------------------====
+
+typedef struct KernelInfo
+{
+    const char* name;
+    size_t      sourceBytesPerPixel;
+    size_t      destBytesPerPixel;
+    size_t      kernelOffset;
+}
+KernelInfo;
+
+const KernelInfo kernelInfos[] = {
+    { "swizzleRGBA8",       4, 4, offsetof(PixelKernels, swizzleRGBA8)       },
+    { "unpremultiplyRGBA8", 4, 4, offsetof(PixelKernels, unpremultiplyRGBA8) },
+    { "narrowRGBA16",       8, 4, offsetof(PixelKernels, narrowRGBA16)       },
+    { "widenA2B10G10R10",   4, 8, offsetof(PixelKernels, widenA2B10G10R10)   }
+};
+
+// * getKernel
+//
+PixelRowKernel getKernel(const PixelKernels* kernels, const KernelInfo* info)
+{
+    PixelRowKernel kernel = nullptr;
+
+    memcpy( &kernel, (const uint8_t*)kernels + info->kernelOffset,
+            sizeof(kernel) );
+
+    return kernel;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Timing
+//
+//====----------------------------------------------------------------------====
+
+// * nowSeconds
+//
+double nowSeconds(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + 1e-9 * (double)time.tv_nsec;
+}
+
+// * runKernel : best of benchRounds, in seconds
+//
+double runKernel( PixelRowKernel kernel,
+                  uint8_t*       pDest,
+                  size_t         destBytesPerRow,
+                  const uint8_t* pSource,
+                  size_t         sourceBytesPerRow )
+{
+    auto best = 0.0;
+
+    for (uint32_t round = 0; round < benchRounds; ++round)
+    {
+        auto const start = nowSeconds();
+
+        transformRows( kernel, pDest, destBytesPerRow,
+                       pSource, sourceBytesPerRow,
+                       benchWidth, benchHeight );
+
+        auto const elapsed = nowSeconds() - start;
+
+        if (0 == round || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main( [[maybe_unused]] const int         argc,
+          [[maybe_unused]] const char* const argv[] )
+{
+    //  - buffers : random data, with premultiplied-valid RGBA8 for the
+    //              unpremultiply kernel
+    auto const sourceSize = (size_t)8 * benchWidth * benchHeight;
+    auto const destSize   = (size_t)8 * benchWidth * benchHeight;
+
+    auto source    = (uint8_t*)malloc(sourceSize);
+    auto reference = (uint8_t*)malloc(destSize);
+    auto dest      = (uint8_t*)malloc(destSize);
+
+    if (nullptr == source || nullptr == reference || nullptr == dest)
+    {
+        puts("Failed to allocate benchmark buffers");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+
+    for (size_t ii = 0; ii < sourceSize; ii += 4)
+    {
+        auto const alpha = (uint8_t)rand();
+
+        source[ii + 0] = (uint8_t)( alpha ? rand() % (alpha + 1) : 0 );
+        source[ii + 1] = (uint8_t)( alpha ? rand() % (alpha + 1) : 0 );
+        source[ii + 2] = (uint8_t)( alpha ? rand() % (alpha + 1) : 0 );
+        source[ii + 3] = alpha;
+    }
+
+    //  - implementations
+    const PixelKernels* implementations[4] = {};
+
+    auto const implementationCount = getSupportedPixelKernels(implementations, 4);
+    auto const scalar              = getScalarPixelKernels();
+
+    printf( "%-20s %-8s %10s %10s %8s  %s\n",
+            "kernel", "impl", "ms", "MB/s", "speedup", "check" );
+
+    auto failed = false;
+
+    auto const kernelCount = (uint32_t)( sizeof(kernelInfos)/sizeof(kernelInfos[0]) );
+
+    for (uint32_t kk = 0; kk < kernelCount; ++kk)
+    {
+        auto const info = &kernelInfos[kk];
+
+        auto const sourceBytesPerRow = info->sourceBytesPerPixel * benchWidth;
+        auto const destBytesPerRow   = info->destBytesPerPixel * benchWidth;
+
+        //  - scalar reference result and time
+        auto const scalarTime = runKernel( getKernel(scalar, info),
+                                           reference, destBytesPerRow,
+                                           source, sourceBytesPerRow );
+
+        for (uint32_t ii = 0; ii < implementationCount && ii < 4; ++ii)
+        {
+            memset(dest, 0, destSize);
+
+            auto const time = runKernel( getKernel(implementations[ii], info),
+                                         dest, destBytesPerRow,
+                                         source, sourceBytesPerRow );
+
+            auto const isMatch = ( 0 == memcmp( dest, reference,
+                                                destBytesPerRow * benchHeight ) );
+
+            auto const bytes = (double)(sourceBytesPerRow + destBytesPerRow)
+                             * benchHeight;
+
+            printf( "%-20s %-8s %10.3f %10.1f %7.2fx  %s\n",
+                    info->name, implementations[ii]->name,
+                    1e3 * time, bytes / (1e6 * time), scalarTime / time,
+                    isMatch ? "ok" : "MISMATCH" );
+
+            failed = failed || !isMatch;
+        }
+    }
+
+    free(dest);
+    free(reference);
+    free(source);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,678 @@
+//
+// pixels.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "pixels.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define PIXELS_X86 1
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+    #define PIXELS_NEON 1
+#endif
+
+//====----------------------------------------------------------------------====
+//
+// * Scalar
+//
+//====----------------------------------------------------------------------====
+
+// * swizzleRGBA8Scalar
+//
+void swizzleRGBA8Scalar(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    for (uint32_t xx = 0; xx < width; ++xx, pDest += 4, pSource += 4)
+    {
+        pDest[0] = pSource[2];
+        pDest[1] = pSource[1];
+        pDest[2] = pSource[0];
+        pDest[3] = pSource[3];
+    }
+}
+
+// * unpremultiplyRGBA8Scalar : round(min(255, c * 255 / a)), ties to even.
+//                              Fully transparent pixels become zero
+//
+void unpremultiplyRGBA8Scalar(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    for (uint32_t xx = 0; xx < width; ++xx, pDest += 4, pSource += 4)
+    {
+        auto const alpha = pSource[3];
+
+        if (0 == alpha)
+        {
+            memset(pDest, 0, 4);
+            continue;
+        }
+
+        for (uint32_t cc = 0; cc < 3; ++cc)
+        {
+            auto const color = (float)(255 * pSource[cc]) / (float)alpha;
+
+            pDest[cc] = (uint8_t)lrintf( (color < 255.0f) ? color : 255.0f );
+        }
+
+        pDest[3] = alpha;
+    }
+}
+
+// * narrowRGBA16Scalar : round(v / 257)
+//
+void narrowRGBA16Scalar(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    for (uint32_t ii = 0; ii < 4*width; ++ii)
+    {
+        uint16_t sample = 0;
+        memcpy(&sample, pSource + 2*ii, sizeof(sample));
+
+        pDest[ii] = (uint8_t)( (255u * sample + 32895u) >> 16 );
+    }
+}
+
+// * widenA2B10G10R10Scalar : replicate the high bits into the low bits so
+//                            that full scale maps to full scale
+//
+void widenA2B10G10R10Scalar(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    for (uint32_t xx = 0; xx < width; ++xx, pDest += 8, pSource += 4)
+    {
+        uint32_t pixel = 0;
+        memcpy(&pixel, pSource, sizeof(pixel));
+
+        auto const r = (pixel >>  0) & 0x3ff;
+        auto const g = (pixel >> 10) & 0x3ff;
+        auto const b = (pixel >> 20) & 0x3ff;
+        auto const a = (pixel >> 30) & 0x003;
+
+        const uint16_t samples[4] = {
+            (uint16_t)( (r << 6) | (r >> 4) ),
+            (uint16_t)( (g << 6) | (g >> 4) ),
+            (uint16_t)( (b << 6) | (b >> 4) ),
+            (uint16_t)( a * 0x5555 )
+        };
+
+        memcpy(pDest, samples, sizeof(samples));
+    }
+}
+
+const PixelKernels scalarPixelKernels = {
+    .name               = "scalar",
+    .swizzleRGBA8       = swizzleRGBA8Scalar,
+    .unpremultiplyRGBA8 = unpremultiplyRGBA8Scalar,
+    .narrowRGBA16       = narrowRGBA16Scalar,
+    .widenA2B10G10R10   = widenA2B10G10R10Scalar
+};
+
+#if PIXELS_X86
+
+//====----------------------------------------------------------------------====
+//
+// * SSE4.1
+//
+//====----------------------------------------------------------------------====
+
+// * swizzleRGBA8SSE41 : 4 pixels per iteration
+//
+[[gnu::target("sse4.1")]]
+void swizzleRGBA8SSE41(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    auto const shuffle = _mm_setr_epi8( 2, 1, 0, 3,  6, 5, 4, 7,
+                                        10, 9, 8, 11, 14, 13, 12, 15 );
+    uint32_t xx = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const pixels = _mm_loadu_si128( (const __m128i*)(pSource + 4*xx) );
+
+        _mm_storeu_si128( (__m128i*)(pDest + 4*xx),
+                          _mm_shuffle_epi8(pixels, shuffle) );
+    }
+
+    swizzleRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * unpremultiplyPixelSSE41 : one pixel as 32-bit lanes
+//
+[[gnu::target("sse4.1")]]
+__m128i unpremultiplyPixelSSE41(__m128i pixel)
+{
+    auto const color = _mm_cvtepi32_ps(pixel);
+    auto const alpha = _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+
+    //  - division by zero alpha is masked below. min returns 255 for NaN
+    auto const scaled = _mm_div_ps(_mm_mul_ps(color, _mm_set1_ps(255.0f)), alpha);
+    auto const result = _mm_cvtps_epi32( _mm_min_ps(scaled, _mm_set1_ps(255.0f)) );
+
+    auto const isTransparent = _mm_cmpeq_epi32(
+        _mm_shuffle_epi32(pixel, _MM_SHUFFLE(3, 3, 3, 3)), _mm_setzero_si128() );
+
+    //  - alpha passes through unchanged
+    return _mm_andnot_si128( isTransparent, _mm_blend_epi16(result, pixel, 0xc0) );
+}
+
+// * unpremultiplyRGBA8SSE41 : 4 pixels per iteration
+//
+[[gnu::target("sse4.1")]]
+void unpremultiplyRGBA8SSE41(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const pixels = _mm_loadu_si128( (const __m128i*)(pSource + 4*xx) );
+
+        auto const p0 = unpremultiplyPixelSSE41( _mm_cvtepu8_epi32(pixels) );
+        auto const p1 = unpremultiplyPixelSSE41( _mm_cvtepu8_epi32(_mm_srli_si128(pixels,  4)) );
+        auto const p2 = unpremultiplyPixelSSE41( _mm_cvtepu8_epi32(_mm_srli_si128(pixels,  8)) );
+        auto const p3 = unpremultiplyPixelSSE41( _mm_cvtepu8_epi32(_mm_srli_si128(pixels, 12)) );
+
+        auto const result = _mm_packus_epi16( _mm_packus_epi32(p0, p1),
+                                              _mm_packus_epi32(p2, p3) );
+
+        _mm_storeu_si128( (__m128i*)(pDest + 4*xx), result );
+    }
+
+    unpremultiplyRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * narrowSamplesSSE41 : 8 samples, (255 * v + 32895) >> 16 in 32-bit lanes
+//
+[[gnu::target("sse4.1")]]
+__m128i narrowSamplesSSE41(__m128i samples)
+{
+    auto const bias = _mm_set1_epi32(32895);
+
+    auto lo = _mm_cvtepu16_epi32(samples);
+    auto hi = _mm_unpackhi_epi16(samples, _mm_setzero_si128());
+
+    lo = _mm_srli_epi32( _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(lo, 8), lo), bias), 16 );
+    hi = _mm_srli_epi32( _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(hi, 8), hi), bias), 16 );
+
+    return _mm_packus_epi32(lo, hi);
+}
+
+// * narrowRGBA16SSE41 : 4 pixels per iteration
+//
+[[gnu::target("sse4.1")]]
+void narrowRGBA16SSE41(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const a = _mm_loadu_si128( (const __m128i*)(pSource + 8*xx) );
+        auto const b = _mm_loadu_si128( (const __m128i*)(pSource + 8*xx + 16) );
+
+        _mm_storeu_si128( (__m128i*)(pDest + 4*xx),
+                          _mm_packus_epi16( narrowSamplesSSE41(a),
+                                            narrowSamplesSSE41(b) ) );
+    }
+
+    narrowRGBA16Scalar(pDest + 4*xx, pSource + 8*xx, width - xx);
+}
+
+// * widenA2B10G10R10SSE41 : 4 pixels per iteration
+//
+[[gnu::target("sse4.1")]]
+void widenA2B10G10R10SSE41(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    auto const mask = _mm_set1_epi32(0x3ff);
+    uint32_t   xx   = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const pixels = _mm_loadu_si128( (const __m128i*)(pSource + 4*xx) );
+
+        auto r = _mm_and_si128(pixels, mask);
+        auto g = _mm_and_si128(_mm_srli_epi32(pixels, 10), mask);
+        auto b = _mm_and_si128(_mm_srli_epi32(pixels, 20), mask);
+        auto a = _mm_srli_epi32(pixels, 30);
+
+        r = _mm_or_si128(_mm_slli_epi32(r, 6), _mm_srli_epi32(r, 4));
+        g = _mm_or_si128(_mm_slli_epi32(g, 6), _mm_srli_epi32(g, 4));
+        b = _mm_or_si128(_mm_slli_epi32(b, 6), _mm_srli_epi32(b, 4));
+        a = _mm_mullo_epi32(a, _mm_set1_epi32(0x5555));
+
+        //  - (r | g << 16, b | a << 16) pairs interleave into whole pixels
+        auto const rg = _mm_or_si128(r, _mm_slli_epi32(g, 16));
+        auto const ba = _mm_or_si128(b, _mm_slli_epi32(a, 16));
+
+        _mm_storeu_si128( (__m128i*)(pDest + 8*xx),      _mm_unpacklo_epi32(rg, ba) );
+        _mm_storeu_si128( (__m128i*)(pDest + 8*xx + 16), _mm_unpackhi_epi32(rg, ba) );
+    }
+
+    widenA2B10G10R10Scalar(pDest + 8*xx, pSource + 4*xx, width - xx);
+}
+
+const PixelKernels sse41PixelKernels = {
+    .name               = "sse4.1",
+    .swizzleRGBA8       = swizzleRGBA8SSE41,
+    .unpremultiplyRGBA8 = unpremultiplyRGBA8SSE41,
+    .narrowRGBA16       = narrowRGBA16SSE41,
+    .widenA2B10G10R10   = widenA2B10G10R10SSE41
+};
+
+//====----------------------------------------------------------------------====
+//
+// * AVX2
+//
+//====----------------------------------------------------------------------====
+
+// * swizzleRGBA8AVX2 : 8 pixels per iteration
+//
+[[gnu::target("avx2")]]
+void swizzleRGBA8AVX2(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    auto const shuffle = _mm256_setr_epi8( 2, 1, 0, 3,  6, 5, 4, 7,
+                                           10, 9, 8, 11, 14, 13, 12, 15,
+                                           2, 1, 0, 3,  6, 5, 4, 7,
+                                           10, 9, 8, 11, 14, 13, 12, 15 );
+    uint32_t xx = 0;
+
+    for (; xx + 8 <= width; xx += 8)
+    {
+        auto const pixels = _mm256_loadu_si256( (const __m256i*)(pSource + 4*xx) );
+
+        _mm256_storeu_si256( (__m256i*)(pDest + 4*xx),
+                             _mm256_shuffle_epi8(pixels, shuffle) );
+    }
+
+    swizzleRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * unpremultiplyPixelsAVX2 : two pixels as 32-bit lanes, one per 128-bit lane
+//
+[[gnu::target("avx2")]]
+__m256i unpremultiplyPixelsAVX2(__m256i pixels)
+{
+    auto const color = _mm256_cvtepi32_ps(pixels);
+    auto const alpha = _mm256_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+
+    auto const scaled = _mm256_div_ps( _mm256_mul_ps(color, _mm256_set1_ps(255.0f)),
+                                       alpha );
+    auto const result = _mm256_cvtps_epi32( _mm256_min_ps(scaled, _mm256_set1_ps(255.0f)) );
+
+    auto const isTransparent = _mm256_cmpeq_epi32(
+        _mm256_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _mm256_setzero_si256() );
+
+    return _mm256_andnot_si256( isTransparent,
+                                _mm256_blend_epi16(result, pixels, 0xc0) );
+}
+
+// * unpremultiplyRGBA8AVX2 : 8 pixels per iteration
+//
+[[gnu::target("avx2")]]
+void unpremultiplyRGBA8AVX2(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    //  - packing within 128-bit lanes leaves pixels ordered 0 2 4 6 | 1 3 5 7
+    auto const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t   xx    = 0;
+
+    for (; xx + 8 <= width; xx += 8)
+    {
+        auto const lo = _mm_loadu_si128( (const __m128i*)(pSource + 4*xx) );
+        auto const hi = _mm_loadu_si128( (const __m128i*)(pSource + 4*xx + 16) );
+
+        auto const p01 = unpremultiplyPixelsAVX2( _mm256_cvtepu8_epi32(lo) );
+        auto const p23 = unpremultiplyPixelsAVX2( _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)) );
+        auto const p45 = unpremultiplyPixelsAVX2( _mm256_cvtepu8_epi32(hi) );
+        auto const p67 = unpremultiplyPixelsAVX2( _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)) );
+
+        auto const packed = _mm256_packus_epi16( _mm256_packus_epi32(p01, p23),
+                                                 _mm256_packus_epi32(p45, p67) );
+
+        _mm256_storeu_si256( (__m256i*)(pDest + 4*xx),
+                             _mm256_permutevar8x32_epi32(packed, order) );
+    }
+
+    unpremultiplyRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * narrowSamplesAVX2 : 16 samples, unpack and pack within 128-bit lanes
+//                       keeps them in order
+//
+[[gnu::target("avx2")]]
+__m256i narrowSamplesAVX2(__m256i samples)
+{
+    auto const bias = _mm256_set1_epi32(32895);
+    auto const zero = _mm256_setzero_si256();
+
+    auto lo = _mm256_unpacklo_epi16(samples, zero);
+    auto hi = _mm256_unpackhi_epi16(samples, zero);
+
+    lo = _mm256_srli_epi32( _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(lo, 8), lo), bias), 16 );
+    hi = _mm256_srli_epi32( _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(hi, 8), hi), bias), 16 );
+
+    return _mm256_packus_epi32(lo, hi);
+}
+
+// * narrowRGBA16AVX2 : 8 pixels per iteration
+//
+[[gnu::target("avx2")]]
+void narrowRGBA16AVX2(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 8 <= width; xx += 8)
+    {
+        auto const a = _mm256_loadu_si256( (const __m256i*)(pSource + 8*xx) );
+        auto const b = _mm256_loadu_si256( (const __m256i*)(pSource + 8*xx + 32) );
+
+        auto const packed = _mm256_packus_epi16( narrowSamplesAVX2(a),
+                                                 narrowSamplesAVX2(b) );
+
+        _mm256_storeu_si256( (__m256i*)(pDest + 4*xx),
+                             _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)) );
+    }
+
+    narrowRGBA16Scalar(pDest + 4*xx, pSource + 8*xx, width - xx);
+}
+
+// * widenA2B10G10R10AVX2 : 8 pixels per iteration
+//
+[[gnu::target("avx2")]]
+void widenA2B10G10R10AVX2(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    auto const mask = _mm256_set1_epi32(0x3ff);
+    uint32_t   xx   = 0;
+
+    for (; xx + 8 <= width; xx += 8)
+    {
+        auto const pixels = _mm256_loadu_si256( (const __m256i*)(pSource + 4*xx) );
+
+        auto r = _mm256_and_si256(pixels, mask);
+        auto g = _mm256_and_si256(_mm256_srli_epi32(pixels, 10), mask);
+        auto b = _mm256_and_si256(_mm256_srli_epi32(pixels, 20), mask);
+        auto a = _mm256_srli_epi32(pixels, 30);
+
+        r = _mm256_or_si256(_mm256_slli_epi32(r, 6), _mm256_srli_epi32(r, 4));
+        g = _mm256_or_si256(_mm256_slli_epi32(g, 6), _mm256_srli_epi32(g, 4));
+        b = _mm256_or_si256(_mm256_slli_epi32(b, 6), _mm256_srli_epi32(b, 4));
+        a = _mm256_mullo_epi32(a, _mm256_set1_epi32(0x5555));
+
+        auto const rg = _mm256_or_si256(r, _mm256_slli_epi32(g, 16));
+        auto const ba = _mm256_or_si256(b, _mm256_slli_epi32(a, 16));
+
+        //  - unpacking within 128-bit lanes yields pixels 0 1 | 4 5 and 2 3 | 6 7
+        auto const lo = _mm256_unpacklo_epi32(rg, ba);
+        auto const hi = _mm256_unpackhi_epi32(rg, ba);
+
+        _mm256_storeu_si256( (__m256i*)(pDest + 8*xx),
+                             _mm256_permute2x128_si256(lo, hi, 0x20) );
+
+        _mm256_storeu_si256( (__m256i*)(pDest + 8*xx + 32),
+                             _mm256_permute2x128_si256(lo, hi, 0x31) );
+    }
+
+    widenA2B10G10R10Scalar(pDest + 8*xx, pSource + 4*xx, width - xx);
+}
+
+const PixelKernels avx2PixelKernels = {
+    .name               = "avx2",
+    .swizzleRGBA8       = swizzleRGBA8AVX2,
+    .unpremultiplyRGBA8 = unpremultiplyRGBA8AVX2,
+    .narrowRGBA16       = narrowRGBA16AVX2,
+    .widenA2B10G10R10   = widenA2B10G10R10AVX2
+};
+
+#endif // PIXELS_X86
+
+#if PIXELS_NEON
+
+//====----------------------------------------------------------------------====
+//
+// * NEON
+//
+//====----------------------------------------------------------------------====
+
+// * swizzleRGBA8NEON : 16 pixels per iteration
+//
+void swizzleRGBA8NEON(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 16 <= width; xx += 16)
+    {
+        auto pixels = vld4q_u8(pSource + 4*xx);
+
+        auto const red = pixels.val[0];
+        pixels.val[0]  = pixels.val[2];
+        pixels.val[2]  = red;
+
+        vst4q_u8(pDest + 4*xx, pixels);
+    }
+
+    swizzleRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * unpremultiplyQuarterNEON : 4 samples of one channel
+//
+uint16x4_t unpremultiplyQuarterNEON(uint16x4_t color, uint16x4_t alpha)
+{
+    auto const scaled = vdivq_f32( vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(color)), 255.0f),
+                                   vcvtq_f32_u32(vmovl_u16(alpha)) );
+
+    //  - NaN from zero alpha converts to zero and is masked by the caller
+    return vmovn_u32( vcvtnq_u32_f32(vminq_f32(scaled, vdupq_n_f32(255.0f))) );
+}
+
+// * unpremultiplyChannelNEON : 16 samples of one channel
+//
+uint8x16_t unpremultiplyChannelNEON(uint8x16_t color, uint8x16_t alpha)
+{
+    auto const colorLo = vmovl_u8(vget_low_u8(color));
+    auto const colorHi = vmovl_high_u8(color);
+    auto const alphaLo = vmovl_u8(vget_low_u8(alpha));
+    auto const alphaHi = vmovl_high_u8(alpha);
+
+    auto const lo = vcombine_u16(
+        unpremultiplyQuarterNEON(vget_low_u16(colorLo),  vget_low_u16(alphaLo)),
+        unpremultiplyQuarterNEON(vget_high_u16(colorLo), vget_high_u16(alphaLo)) );
+
+    auto const hi = vcombine_u16(
+        unpremultiplyQuarterNEON(vget_low_u16(colorHi),  vget_low_u16(alphaHi)),
+        unpremultiplyQuarterNEON(vget_high_u16(colorHi), vget_high_u16(alphaHi)) );
+
+    auto const result = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+
+    return vbicq_u8(result, vceqzq_u8(alpha));
+}
+
+// * unpremultiplyRGBA8NEON : 16 pixels per iteration
+//
+void unpremultiplyRGBA8NEON(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 16 <= width; xx += 16)
+    {
+        auto pixels = vld4q_u8(pSource + 4*xx);
+
+        pixels.val[0] = unpremultiplyChannelNEON(pixels.val[0], pixels.val[3]);
+        pixels.val[1] = unpremultiplyChannelNEON(pixels.val[1], pixels.val[3]);
+        pixels.val[2] = unpremultiplyChannelNEON(pixels.val[2], pixels.val[3]);
+
+        vst4q_u8(pDest + 4*xx, pixels);
+    }
+
+    unpremultiplyRGBA8Scalar(pDest + 4*xx, pSource + 4*xx, width - xx);
+}
+
+// * narrowQuarterNEON : 4 samples, (255 * v + 32895) >> 16
+//
+uint16x4_t narrowQuarterNEON(uint16x4_t samples)
+{
+    auto const wide = vmovl_u16(samples);
+
+    auto const scaled = vaddq_u32( vsubq_u32(vshlq_n_u32(wide, 8), wide),
+                                   vdupq_n_u32(32895) );
+
+    return vshrn_n_u32(scaled, 16);
+}
+
+// * narrowRGBA16NEON : 4 pixels per iteration
+//
+void narrowRGBA16NEON(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    uint32_t xx = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const a = vreinterpretq_u16_u8( vld1q_u8(pSource + 8*xx) );
+        auto const b = vreinterpretq_u16_u8( vld1q_u8(pSource + 8*xx + 16) );
+
+        auto const lo = vcombine_u16( narrowQuarterNEON(vget_low_u16(a)),
+                                      narrowQuarterNEON(vget_high_u16(a)) );
+
+        auto const hi = vcombine_u16( narrowQuarterNEON(vget_low_u16(b)),
+                                      narrowQuarterNEON(vget_high_u16(b)) );
+
+        vst1q_u8( pDest + 4*xx, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)) );
+    }
+
+    narrowRGBA16Scalar(pDest + 4*xx, pSource + 8*xx, width - xx);
+}
+
+// * widenA2B10G10R10NEON : 4 pixels per iteration
+//
+void widenA2B10G10R10NEON(uint8_t* pDest, const uint8_t* pSource, uint32_t width)
+{
+    auto const mask = vdupq_n_u32(0x3ff);
+    uint32_t   xx   = 0;
+
+    for (; xx + 4 <= width; xx += 4)
+    {
+        auto const pixels = vreinterpretq_u32_u8( vld1q_u8(pSource + 4*xx) );
+
+        auto r = vandq_u32(pixels, mask);
+        auto g = vandq_u32(vshrq_n_u32(pixels, 10), mask);
+        auto b = vandq_u32(vshrq_n_u32(pixels, 20), mask);
+        auto a = vshrq_n_u32(pixels, 30);
+
+        r = vorrq_u32(vshlq_n_u32(r, 6), vshrq_n_u32(r, 4));
+        g = vorrq_u32(vshlq_n_u32(g, 6), vshrq_n_u32(g, 4));
+        b = vorrq_u32(vshlq_n_u32(b, 6), vshrq_n_u32(b, 4));
+        a = vmulq_n_u32(a, 0x5555);
+
+        auto const rg = vorrq_u32(r, vshlq_n_u32(g, 16));
+        auto const ba = vorrq_u32(b, vshlq_n_u32(a, 16));
+
+        auto const zipped = vzipq_u32(rg, ba);
+
+        vst1q_u8( pDest + 8*xx,      vreinterpretq_u8_u32(zipped.val[0]) );
+        vst1q_u8( pDest + 8*xx + 16, vreinterpretq_u8_u32(zipped.val[1]) );
+    }
+
+    widenA2B10G10R10Scalar(pDest + 8*xx, pSource + 4*xx, width - xx);
+}
+
+const PixelKernels neonPixelKernels = {
+    .name               = "neon",
+    .swizzleRGBA8       = swizzleRGBA8NEON,
+    .unpremultiplyRGBA8 = unpremultiplyRGBA8NEON,
+    .narrowRGBA16       = narrowRGBA16NEON,
+    .widenA2B10G10R10   = widenA2B10G10R10NEON
+};
+
+#endif // PIXELS_NEON
+
+//====----------------------------------------------------------------------====
+//
+// * Dispatch
+//
+//====----------------------------------------------------------------------====
+
+// * getPixelKernels
+//
+const PixelKernels* getPixelKernels(void)
+{
+    const PixelKernels* kernels[4] = {};
+
+    auto const count = getSupportedPixelKernels( kernels,
+                                                 sizeof(kernels)/sizeof(kernels[0]) );
+
+    return kernels[count - 1];
+}
+
+// * getScalarPixelKernels
+//
+const PixelKernels* getScalarPixelKernels(void)
+{
+    return &scalarPixelKernels;
+}
+
+// * getSupportedPixelKernels
+//
+uint32_t getSupportedPixelKernels( const PixelKernels** ppKernels,
+                                   uint32_t             capacity )
+{
+    const PixelKernels* supported[4] = { &scalarPixelKernels };
+    uint32_t            count        = 1;
+
+#if PIXELS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.1")) {
+        supported[count++] = &sse41PixelKernels;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        supported[count++] = &avx2PixelKernels;
+    }
+#elif PIXELS_NEON
+    supported[count++] = &neonPixelKernels;
+#endif
+
+    for (uint32_t ii = 0; ii < count && ii < capacity; ++ii) {
+        ppKernels[ii] = supported[ii];
+    }
+
+    return count;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Rows
+//
+//====----------------------------------------------------------------------====
+
+// * transformRows
+//
+void transformRows
+(
+    PixelRowKernel kernel,
+    uint8_t*       pDest,
+    size_t         destBytesPerRow,
+    const uint8_t* pSource,
+    size_t         sourceBytesPerRow,
+    uint32_t       width,
+    uint32_t       height
+)
+{
+    for (uint32_t yy = 0; yy < height; ++yy)
+    {
+        kernel(pDest, pSource, width);
+
+        pDest   += destBytesPerRow;
+        pSource += sourceBytesPerRow;
+    }
+}
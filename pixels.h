@@ -0,0 +1,88 @@
+//
+// pixels.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Row kernels
+//
+//====----------------------------------------------------------------------====
+
+// * PixelRowKernel : transform one row of width pixels. Rows may be unaligned
+//                    but must not overlap
+//
+typedef void (*PixelRowKernel)( uint8_t*       pDest,
+                                const uint8_t* pSource,
+                                uint32_t       width );
+
+// * PixelKernels : every implementation produces results bit-identical to
+//                  the scalar reference
+//
+typedef struct PixelKernels
+{
+    const char*    name;
+    PixelRowKernel swizzleRGBA8;            // RGBA8 <-> BGRA8
+    PixelRowKernel unpremultiplyRGBA8;      // associated -> unassociated alpha
+    PixelRowKernel narrowRGBA16;            // RGBA16 unorm -> RGBA8 unorm
+    PixelRowKernel widenA2B10G10R10;        // A2B10G10R10 -> RGBA16 unorm
+}
+PixelKernels;
+
+//====----------------------------------------------------------------------====
+//
+// * Dispatch
+//
+//====----------------------------------------------------------------------====
+
+// * getPixelKernels : fastest implementation supported by this CPU
+//
+const PixelKernels* getPixelKernels(void);
+
+// * getScalarPixelKernels : portable reference implementation
+//
+const PixelKernels* getScalarPixelKernels(void);
+
+// * getSupportedPixelKernels : every implementation supported by this CPU,
+//                              slowest first. Returns the total count
+//
+uint32_t getSupportedPixelKernels( const PixelKernels** ppKernels,
+                                   uint32_t             capacity );
+
+//====----------------------------------------------------------------------====
+//
+// * Rows
+//
+//====----------------------------------------------------------------------====
+
+// * transformRows
+//
+void transformRows
+(
+    PixelRowKernel kernel,
+    uint8_t*       pDest,
+    size_t         destBytesPerRow,
+    const uint8_t* pSource,
+    size_t         sourceBytesPerRow,
+    uint32_t       width,
+    uint32_t       height
+);
@@ -0,0 +1,205 @@
+//
+// recordbench.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Benchmark parameters
+//
+//====----------------------------------------------------------------------====
+
+// * A large draw list on a small target, so recording dominates the frame
+//
+constexpr uint32_t benchDefaultDrawCount = 1u << 16;
+constexpr uint32_t benchSize             = 256;
+constexpr uint32_t benchFrames           = 32;
+
+// * Recording threads : 0 records inline, without secondary command buffers
+//
+const uint32_t benchRecordThreads[] = { 0, 1, 2, 4, 8, 16 };
+
+//====----------------------------------------------------------------------====
+//
+// * Running
+//
+//====----------------------------------------------------------------------====
+
+// * BenchResult
+//
+typedef struct BenchResult
+{
+    double recordMs;                // median
+    double gpuMs;                   // median, negative when unavailable
+    double frameMs;                 // median
+}
+BenchResult;
+
+// * runRecordThreads : one warm-up frame, then benchFrames frames on the
+//                      same target
+//
+bool runRecordThreads( uint32_t     drawCount,
+                       uint32_t     recordThreadCount,
+                       BenchResult* pResult )
+{
+    const RendererInfo rendererInfo = {
+        .colorFormat       = VK_FORMAT_R8G8B8A8_UNORM,
+        .pixelLayout       = PIXEL_LAYOUT_RGBA_PREMULTIPLIED,
+        .enableValidation  = false,
+        .drawCount         = drawCount,
+        .recordThreadCount = recordThreadCount
+    };
+
+    Renderer     renderer = {};
+    RenderTarget target   = {};
+
+    FrameTimings timings[benchFrames] = {};
+    double       frameMs[benchFrames] = {};
+
+    auto result = createRenderer(&rendererInfo, &renderer);
+
+    if (VK_SUCCESS == result) {
+        result = createRenderTarget(&renderer, benchSize, benchSize, &target);
+    }
+
+    //  - warm-up
+    ImageContext imageContext = {};
+
+    if (VK_SUCCESS == result)
+    {
+        result = renderFrame(&renderer, &target, &imageContext, nullptr);
+        disposeImageContext(&imageContext);
+    }
+
+    //  - frames
+    auto hasGPUTimings = true;
+
+    for (uint32_t ff = 0; ff < benchFrames && VK_SUCCESS == result; ++ff)
+    {
+        auto const start = getTimeMs();
+
+        result = renderFrame(&renderer, &target, &imageContext, &timings[ff]);
+
+        frameMs[ff]   = getTimeMs() - start;
+        hasGPUTimings = hasGPUTimings && timings[ff].hasGPUTimings;
+
+        disposeImageContext(&imageContext);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        pResult->recordMs = summarizeTimings( &timings[0].recordMs, benchFrames,
+                                              sizeof(FrameTimings) ).median;
+        pResult->frameMs  = summarizeTimings( frameMs, benchFrames,
+                                              sizeof(double) ).median;
+        pResult->gpuMs    = hasGPUTimings
+                          ? summarizeTimings( &timings[0].gpuMs, benchFrames,
+                                              sizeof(FrameTimings) ).median
+                          : -1.0;
+    }
+
+    if (nullptr != renderer.device) {
+        destroyRenderTarget(&renderer, &target);
+    }
+
+    destroyRenderer(&renderer);
+
+    return VK_SUCCESS == result;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main(const int argc, const char* const argv[])
+{
+    //  - recordbench [draw count]
+    auto drawCount = benchDefaultDrawCount;
+
+    if (2 <= argc)
+    {
+        char* end   = nullptr;
+        auto  value = strtoul(argv[1], &end, 10);
+
+        if (end == argv[1] || '\0' != *end || 0 == value || UINT32_MAX < value)
+        {
+            printf("usage: %s [draw count]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        drawCount = (uint32_t)value;
+    }
+
+    printf( "%u draws, %u^2, median of %u frames\n\n",
+            drawCount, benchSize, benchFrames );
+
+    printf( "%-8s %12s %8s %10s %10s\n",
+            "threads", "record_ms", "speedup", "gpu_ms", "frame_ms" );
+
+    auto const runCount = (uint32_t)( sizeof(benchRecordThreads)/sizeof(benchRecordThreads[0]) );
+
+    auto inlineMs = 0.0;
+    auto failed   = false;
+
+    for (uint32_t rr = 0; rr < runCount; ++rr)
+    {
+        auto const recordThreadCount = benchRecordThreads[rr];
+
+        char threads[16] = "inline";
+
+        if (0 < recordThreadCount) {
+            snprintf(threads, sizeof(threads), "%u", recordThreadCount);
+        }
+
+        BenchResult benchResult = {};
+
+        if (!runRecordThreads(drawCount, recordThreadCount, &benchResult))
+        {
+            printf("%-8s %12s\n", threads, "failed");
+            failed = true;
+            continue;
+        }
+
+        if (0 == recordThreadCount) {
+            inlineMs = benchResult.recordMs;
+        }
+
+        printf( "%-8s %12.3f %7.2fx ", threads, benchResult.recordMs,
+                (0.0 < benchResult.recordMs) ? inlineMs / benchResult.recordMs : 0.0 );
+
+        if (0.0 <= benchResult.gpuMs) {
+            printf("%10.3f", benchResult.gpuMs);
+        }
+        else {
+            printf("%10s", "-");
+        }
+
+        printf(" %10.3f\n", benchResult.frameMs);
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,584 @@
+//
+// rendercache.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rendercache.h"
+
+//====----------------------------------------------------------------------====
+//
+// * SHA-256 : FIPS 180-4
+//
+//====----------------------------------------------------------------------====
+
+const uint32_t sha256RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// * sha256Rotate
+//
+uint32_t sha256Rotate(uint32_t value, uint32_t count) [[unsequenced]]
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+// * sha256Block : one 64 byte block into the state
+//
+void sha256Block(uint32_t state[8], const uint8_t block[64])
+{
+    uint32_t words[64] = {};
+
+    for (uint32_t ii = 0; ii < 16; ++ii)
+    {
+        words[ii] = ( (uint32_t)block[4*ii + 0] << 24 )
+                  | ( (uint32_t)block[4*ii + 1] << 16 )
+                  | ( (uint32_t)block[4*ii + 2] <<  8 )
+                  | ( (uint32_t)block[4*ii + 3] );
+    }
+
+    for (uint32_t ii = 16; ii < 64; ++ii)
+    {
+        auto const s0 = sha256Rotate(words[ii - 15], 7) ^ sha256Rotate(words[ii - 15], 18)
+                      ^ (words[ii - 15] >> 3);
+        auto const s1 = sha256Rotate(words[ii - 2], 17) ^ sha256Rotate(words[ii - 2], 19)
+                      ^ (words[ii - 2] >> 10);
+
+        words[ii] = words[ii - 16] + s0 + words[ii - 7] + s1;
+    }
+
+    uint32_t v[8] = {};
+    memcpy(v, state, sizeof(v));
+
+    for (uint32_t ii = 0; ii < 64; ++ii)
+    {
+        auto const s1     = sha256Rotate(v[4], 6) ^ sha256Rotate(v[4], 11)
+                          ^ sha256Rotate(v[4], 25);
+        auto const choice = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        auto const t1     = v[7] + s1 + choice + sha256RoundConstants[ii] + words[ii];
+        auto const s0     = sha256Rotate(v[0], 2) ^ sha256Rotate(v[0], 13)
+                          ^ sha256Rotate(v[0], 22);
+        auto const major  = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + t1;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = t1 + s0 + major;
+    }
+
+    for (uint32_t ii = 0; ii < 8; ++ii) {
+        state[ii] += v[ii];
+    }
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Cache keys
+//
+//====----------------------------------------------------------------------====
+
+// * beginCacheKey
+//
+void beginCacheKey(CacheKeyHasher* pHasher)
+{
+    const uint32_t initialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(pHasher->state, initialState, sizeof(initialState));
+
+    pHasher->byteCount = 0;
+}
+
+// * addCacheKeyData
+//
+void addCacheKeyData(CacheKeyHasher* pHasher, const void* pData, size_t size)
+{
+    auto bytes = (const uint8_t*)pData;
+
+    while (0 < size)
+    {
+        auto const offset = (size_t)(pHasher->byteCount % 64);
+        auto const count  = (size < 64 - offset) ? size : 64 - offset;
+
+        memcpy(pHasher->block + offset, bytes, count);
+
+        pHasher->byteCount += count;
+        bytes              += count;
+        size               -= count;
+
+        if (0 == pHasher->byteCount % 64) {
+            sha256Block(pHasher->state, pHasher->block);
+        }
+    }
+}
+
+// * finishCacheKey
+//
+CacheKey finishCacheKey(CacheKeyHasher* pHasher)
+{
+    auto const bitCount = 8 * pHasher->byteCount;
+
+    //  - a one bit, zeros up to 56 mod 64, and the big-endian bit count
+    uint8_t padding[72] = { 0x80 };
+
+    auto const offset       = (size_t)(pHasher->byteCount % 64);
+    auto const paddingCount = (offset < 56) ? 56 - offset : 120 - offset;
+
+    for (uint32_t ii = 0; ii < 8; ++ii) {
+        padding[paddingCount + ii] = (uint8_t)( bitCount >> (56 - 8*ii) );
+    }
+
+    addCacheKeyData(pHasher, padding, paddingCount + 8);
+
+    CacheKey key = {};
+
+    for (uint32_t ii = 0; ii < 8; ++ii)
+    {
+        key.bytes[4*ii + 0] = (uint8_t)( pHasher->state[ii] >> 24 );
+        key.bytes[4*ii + 1] = (uint8_t)( pHasher->state[ii] >> 16 );
+        key.bytes[4*ii + 2] = (uint8_t)( pHasher->state[ii] >>  8 );
+        key.bytes[4*ii + 3] = (uint8_t)( pHasher->state[ii] );
+    }
+
+    return key;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Files
+//
+//====----------------------------------------------------------------------====
+
+// * Entries are named by the hexadecimal key
+//
+constexpr char renderCacheSuffix[] = ".tiff";
+
+// * getEntryPath
+//
+bool getEntryPath(const RenderCache* pCache, const CacheKey* pKey, char path[PATH_MAX])
+{
+    char name[2 * sizeof(pKey->bytes) + 1] = {};
+
+    for (uint32_t ii = 0; ii < sizeof(pKey->bytes); ++ii) {
+        snprintf(&name[2*ii], 3, "%02x", pKey->bytes[ii]);
+    }
+
+    auto const length = snprintf( path, PATH_MAX, "%s/%s%s",
+                                  pCache->directory, name, renderCacheSuffix );
+
+    return 0 <= length && length < PATH_MAX;
+}
+
+// * copyFileContents : from the current offsets, to the end of the source
+//
+bool copyFileContents(int sourceFd, int destFd, uint64_t* pByteCount)
+{
+    uint8_t buffer[64 << 10];
+
+    *pByteCount = 0;
+
+    while (true)
+    {
+        auto count = read(sourceFd, buffer, sizeof(buffer));
+
+        if (count < 0 && EINTR == errno) {
+            continue;
+        }
+
+        if (count <= 0) {
+            return 0 == count;
+        }
+
+        for (ssize_t offset = 0; offset < count; )
+        {
+            auto const written = write(destFd, buffer + offset, (size_t)(count - offset));
+
+            if (written < 0 && EINTR == errno) {
+                continue;
+            }
+
+            if (written <= 0) {
+                return false;
+            }
+
+            offset += written;
+        }
+
+        *pByteCount += (uint64_t)count;
+    }
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Eviction
+//
+//====----------------------------------------------------------------------====
+
+typedef struct CacheEntry
+{
+    struct timespec lastUse;
+    uint64_t        size;
+    char            name[NAME_MAX + 1];
+}
+CacheEntry;
+
+// * compareCacheEntries : least recently used first
+//
+int compareCacheEntries(const void* pLeft, const void* pRight)
+{
+    auto const left  = &((const CacheEntry*)pLeft)->lastUse;
+    auto const right = &((const CacheEntry*)pRight)->lastUse;
+
+    if (left->tv_sec != right->tv_sec) {
+        return (left->tv_sec > right->tv_sec) - (left->tv_sec < right->tv_sec);
+    }
+
+    return (left->tv_nsec > right->tv_nsec) - (left->tv_nsec < right->tv_nsec);
+}
+
+// * scanRenderCache : the entries of the directory, skipping entries being
+//                     stored and the lock. The caller frees *ppEntries
+//
+bool scanRenderCache( const RenderCache* pCache,
+                      CacheEntry**       ppEntries,
+                      uint32_t*          pEntryCount,
+                      uint64_t*          pTotalBytes )
+{
+    auto directory = opendir(pCache->directory);
+
+    *ppEntries   = nullptr;
+    *pEntryCount = 0;
+    *pTotalBytes = 0;
+
+    if (nullptr == directory) {
+        return false;
+    }
+
+    CacheEntry* pEntries = nullptr;
+    uint32_t    capacity = 0;
+    auto        isValid  = true;
+
+    struct dirent* pDirEntry = nullptr;
+
+    while (nullptr != (pDirEntry = readdir(directory)))
+    {
+        struct stat status = {};
+
+        if ( '.' == pDirEntry->d_name[0] ||
+             0 != fstatat(dirfd(directory), pDirEntry->d_name, &status, 0) ||
+             !S_ISREG(status.st_mode) )
+        {
+            continue;
+        }
+
+        if (capacity == *pEntryCount)
+        {
+            capacity = (0 < capacity) ? 2 * capacity : 64;
+
+            auto pGrown = (CacheEntry*)realloc(pEntries, capacity * sizeof(CacheEntry));
+
+            if (nullptr == pGrown)
+            {
+                isValid = false;
+                break;
+            }
+
+            pEntries = pGrown;
+        }
+
+        auto const pEntry = &pEntries[(*pEntryCount)++];
+
+        pEntry->lastUse = status.st_mtim;
+        pEntry->size    = (uint64_t)status.st_size;
+        strcpy(pEntry->name, pDirEntry->d_name);
+
+        *pTotalBytes += pEntry->size;
+    }
+
+    closedir(directory);
+
+    if (!isValid)
+    {
+        free(pEntries);
+
+        *pEntryCount = 0;
+        *pTotalBytes = 0;
+
+        return false;
+    }
+
+    *ppEntries = pEntries;
+
+    return true;
+}
+
+// * trimRenderCache : removes the least recently used entries until the
+//                     directory fits. Only one thread of one process trims
+//                     at a time, but others may keep reading entries
+//                     already opened
+//
+void trimRenderCache(RenderCache* pCache)
+{
+    mtx_lock(&pCache->trimMutex);
+
+    if (0 != flock(pCache->lockFd, LOCK_EX))
+    {
+        mtx_unlock(&pCache->trimMutex);
+        return;
+    }
+
+    CacheEntry* pEntries   = nullptr;
+    uint32_t    entryCount = 0;
+    uint64_t    totalBytes = 0;
+
+    if ( scanRenderCache(pCache, &pEntries, &entryCount, &totalBytes) &&
+         pCache->maxBytes < totalBytes )
+    {
+        qsort(pEntries, entryCount, sizeof(CacheEntry), compareCacheEntries);
+
+        auto directory = opendir(pCache->directory);
+
+        for (uint32_t ii = 0; nullptr != directory && ii < entryCount &&
+                              pCache->maxBytes < totalBytes; ++ii)
+        {
+            if (0 == unlinkat(dirfd(directory), pEntries[ii].name, 0))
+            {
+                totalBytes -= pEntries[ii].size;
+                atomic_fetch_add(&pCache->counters.evictions, 1);
+            }
+        }
+
+        if (nullptr != directory) {
+            closedir(directory);
+        }
+    }
+
+    free(pEntries);
+
+    flock(pCache->lockFd, LOCK_UN);
+    mtx_unlock(&pCache->trimMutex);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * RenderCache
+//
+//====----------------------------------------------------------------------====
+
+// * openRenderCache
+//
+bool openRenderCache(const char* directory, uint64_t maxBytes, RenderCache* pCache)
+{
+    memset( pCache, 0, sizeof(*pCache) );
+
+    pCache->directory = directory;
+    pCache->maxBytes  = maxBytes;
+    pCache->lockFd    = -1;
+
+    if (0 != mkdir(directory, 0755) && EEXIST != errno) {
+        return false;
+    }
+
+    char lockPath[PATH_MAX] = {};
+
+    auto const length = snprintf(lockPath, PATH_MAX, "%s/.lock", directory);
+
+    if (length < 0 || PATH_MAX <= length) {
+        return false;
+    }
+
+    pCache->lockFd = open(lockPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    //  - an open lock file implies an initialized mutex
+    if (0 <= pCache->lockFd && thrd_success != mtx_init(&pCache->trimMutex, mtx_plain))
+    {
+        close(pCache->lockFd);
+        pCache->lockFd = -1;
+    }
+
+    return 0 <= pCache->lockFd;
+}
+
+// * closeRenderCache
+//
+void closeRenderCache(RenderCache* pCache)
+{
+    if (0 <= pCache->lockFd)
+    {
+        close(pCache->lockFd);
+        mtx_destroy(&pCache->trimMutex);
+    }
+
+    pCache->lockFd = -1;
+}
+
+// * lookupRenderCache
+//
+bool lookupRenderCache( RenderCache*    pCache,
+                        const CacheKey* pKey,
+                        const char*     destPath )
+{
+    char entryPath[PATH_MAX] = {};
+
+    auto const entryFd = getEntryPath(pCache, pKey, entryPath)
+                       ? open(entryPath, O_RDONLY | O_CLOEXEC)
+                       : -1;
+
+    auto     isHit     = false;
+    uint64_t byteCount = 0;
+
+    if (0 <= entryFd)
+    {
+        auto const destFd = open(destPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (0 <= destFd)
+        {
+            isHit = copyFileContents(entryFd, destFd, &byteCount);
+            isHit = (0 == close(destFd)) && isHit;
+        }
+
+        //  - most recently used : the entry's modification time is its last use
+        if (isHit) {
+            futimens(entryFd, nullptr);
+        }
+
+        close(entryFd);
+    }
+
+    if (isHit)
+    {
+        atomic_fetch_add(&pCache->counters.hits, 1);
+        atomic_fetch_add(&pCache->counters.hitBytes, byteCount);
+    }
+    else {
+        atomic_fetch_add(&pCache->counters.misses, 1);
+    }
+
+    return isHit;
+}
+
+// * storeRenderCache : written under a temporary name and renamed, so that
+//                      other processes see a whole entry or none
+//
+bool storeRenderCache( RenderCache*    pCache,
+                       const CacheKey* pKey,
+                       const char*     sourcePath )
+{
+    char entryPath[PATH_MAX] = {};
+    char tempPath[PATH_MAX]  = {};
+
+    auto const tempNumber = atomic_fetch_add(&pCache->tempCount, 1);
+
+    auto const length = snprintf( tempPath, PATH_MAX, "%s/.store-%ld-%u",
+                                  pCache->directory, (long)getpid(), tempNumber );
+
+    if (!getEntryPath(pCache, pKey, entryPath) || length < 0 || PATH_MAX <= length) {
+        return false;
+    }
+
+    auto const sourceFd = open(sourcePath, O_RDONLY | O_CLOEXEC);
+
+    if (sourceFd < 0) {
+        return false;
+    }
+
+    auto     didStore  = false;
+    uint64_t byteCount = 0;
+
+    auto const tempFd = open(tempPath, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if (0 <= tempFd)
+    {
+        didStore = copyFileContents(sourceFd, tempFd, &byteCount);
+        didStore = (0 == close(tempFd)) && didStore;
+        didStore = didStore && (0 == rename(tempPath, entryPath));
+
+        if (!didStore) {
+            unlink(tempPath);
+        }
+    }
+
+    close(sourceFd);
+
+    if (didStore)
+    {
+        atomic_fetch_add(&pCache->counters.stores, 1);
+        atomic_fetch_add(&pCache->counters.storedBytes, byteCount);
+
+        trimRenderCache(pCache);
+    }
+
+    return didStore;
+}
+
+// * writeRenderCacheReport
+//
+bool writeRenderCacheReport(FILE* file, RenderCache* pCache)
+{
+    auto const pCounters = &pCache->counters;
+
+    CacheEntry* pEntries   = nullptr;
+    uint32_t    entryCount = 0;
+    uint64_t    totalBytes = 0;
+
+    scanRenderCache(pCache, &pEntries, &entryCount, &totalBytes);
+    free(pEntries);
+
+    auto const hits    = (unsigned long long)atomic_load(&pCounters->hits);
+    auto const misses  = (unsigned long long)atomic_load(&pCounters->misses);
+    auto const lookups = hits + misses;
+
+    fprintf( file,
+             "{\n  \"cache\": { \"hits\": %llu, \"misses\": %llu, \"hit_rate\": %.4f, "
+             "\"stores\": %llu, \"evictions\": %llu, \"hit_bytes\": %llu, "
+             "\"stored_bytes\": %llu, \"entries\": %u, \"bytes\": %llu, "
+             "\"max_bytes\": %llu }\n}\n",
+             hits, misses, (0 < lookups) ? (double)hits / (double)lookups : 0.0,
+             (unsigned long long)atomic_load(&pCounters->stores),
+             (unsigned long long)atomic_load(&pCounters->evictions),
+             (unsigned long long)atomic_load(&pCounters->hitBytes),
+             (unsigned long long)atomic_load(&pCounters->storedBytes),
+             entryCount, (unsigned long long)totalBytes,
+             (unsigned long long)pCache->maxBytes );
+
+    return 0 == ferror(file);
+}
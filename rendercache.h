@@ -0,0 +1,120 @@
+//
+// rendercache.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <threads.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Cache keys : SHA-256 of every input that affects an encoded result
+//
+//====----------------------------------------------------------------------====
+
+typedef struct CacheKey
+{
+    uint8_t bytes[32];
+}
+CacheKey;
+
+typedef struct CacheKeyHasher
+{
+    uint32_t state[8];
+    uint64_t byteCount;
+    uint8_t  block[64];
+}
+CacheKeyHasher;
+
+// * beginCacheKey
+//
+void beginCacheKey(CacheKeyHasher* pHasher);
+
+// * addCacheKeyData : values are hashed as stored, so callers add fields
+//                     one by one rather than structs with padding
+//
+void addCacheKeyData(CacheKeyHasher* pHasher, const void* pData, size_t size);
+
+// * finishCacheKey
+//
+CacheKey finishCacheKey(CacheKeyHasher* pHasher);
+
+//====----------------------------------------------------------------------====
+//
+// * RenderCache : encoded results in a directory, one file per key, with
+//                 the least recently used evicted past a size limit.
+//                 Several processes may share a directory: entries appear
+//                 by atomic rename, and eviction holds an exclusive lock.
+//                 flock locks belong to the open file, which the threads of
+//                 a process share, so they also take trimMutex
+//
+//====----------------------------------------------------------------------====
+
+typedef struct RenderCacheCounters
+{
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t stores;
+    atomic_uint_fast64_t evictions;
+    atomic_uint_fast64_t hitBytes;          // copied out of the cache
+    atomic_uint_fast64_t storedBytes;
+}
+RenderCacheCounters;
+
+typedef struct RenderCache
+{
+    const char*         directory;
+    uint64_t            maxBytes;
+    int                 lockFd;             // flock'ed while evicting
+    mtx_t               trimMutex;          // held while evicting
+    atomic_uint         tempCount;          // names of entries being stored
+    RenderCacheCounters counters;           // this process only
+}
+RenderCache;
+
+// * openRenderCache : creates the directory if need be
+//
+bool openRenderCache(const char* directory, uint64_t maxBytes, RenderCache* pCache);
+
+// * closeRenderCache
+//
+void closeRenderCache(RenderCache* pCache);
+
+// * lookupRenderCache : on a hit, copies the entry to destPath and marks
+//                       it most recently used
+//
+bool lookupRenderCache( RenderCache*    pCache,
+                        const CacheKey* pKey,
+                        const char*     destPath );
+
+// * storeRenderCache : adds a copy of sourcePath under the key, then evicts
+//                      entries until the cache fits its size limit again
+//
+bool storeRenderCache( RenderCache*    pCache,
+                       const CacheKey* pKey,
+                       const char*     sourcePath );
+
+// * writeRenderCacheReport : JSON counters of this process, and the
+//                            current size of the shared directory
+//
+bool writeRenderCacheReport(FILE* file, RenderCache* pCache);
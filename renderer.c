@@ -0,0 +1,4800 @@
+//
+// renderer.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "renderer.h"
+#include "pixels.h"
+#include "trace.h"
+#include "utilities.h"
+
+#include <stdbit.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Shader data
+//
+//====----------------------------------------------------------------------====
+
+const uint8_t alignas(uint32_t) vertexShaderData[] = {
+    #embed "vertex.spv"
+};
+
+const uint8_t alignas(uint32_t) fragmentShaderData[] = {
+    #embed "fragment.spv"
+};
+
+const uint8_t alignas(uint32_t) sceneVertexShaderData[] = {
+    #embed "scenevertex.spv"
+};
+
+const uint8_t alignas(uint32_t) sceneFragmentShaderData[] = {
+    #embed "scenefragment.spv"
+};
+
+// * Render cache keys change with this version too, for changes to the
+//   frame that the shaders and settings hashed do not capture, such as the
+//   clear color
+//
+constexpr uint32_t rendererCacheVersion = 2;
+
+//====----------------------------------------------------------------------====
+//
+// * Timestamps
+//
+//====----------------------------------------------------------------------====
+
+// * Timestamp query indices. The render command buffer writes the first
+//   three, the copy command buffer the remainder
+//
+enum
+{
+    TIMESTAMP_FRAME_BEGIN = 0,
+    TIMESTAMP_RENDER_END,
+    TIMESTAMP_PACK_END,
+    TIMESTAMP_COPY_BEGIN,
+    TIMESTAMP_DEST_LAYOUT_END,
+    TIMESTAMP_COPY_END,
+    TIMESTAMP_GENERAL_LAYOUT_END,
+    TIMESTAMP_PREVIEW_END,
+    TIMESTAMP_COUNT
+};
+
+//====----------------------------------------------------------------------====
+//
+// * ImageContext
+//
+//====----------------------------------------------------------------------====
+
+// * disposeImageContext
+//
+void disposeImageContext(ImageContext* ctx)
+{
+    for (uint32_t pp = 0; pp < ctx->previewCount; ++pp) {
+        disposeImageContext(&ctx->pPreviews[pp]);
+    }
+
+    free(ctx->pPreviews);
+    free(ctx->data);
+
+    memset( ctx, 0, sizeof(*ctx) );
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Renderer
+//
+//====----------------------------------------------------------------------====
+
+// * supportsHostImageCopy : the host may copy out of an optimally tiled
+//                           render image of the format, left in the layout
+//                           the render pass ends in, without slowing the
+//                           device's own access to it. apiVersion is the
+//                           older of the instance's and the device's. Below
+//                           1.4, *pIsExtension is set where the device has
+//                           VK_EXT_host_image_copy instead, whose
+//                           dependencies are core from 1.3
+//
+bool supportsHostImageCopy( VkPhysicalDevice physicalDevice,
+                            uint32_t         apiVersion,
+                            VkFormat         format,
+                            bool*            pIsExtension )
+{
+    //  - core or extension : the structures below are those of either
+    auto const isCore      = (VK_API_VERSION_1_4 <= apiVersion);
+    auto const isExtension = !isCore && VK_API_VERSION_1_3 <= apiVersion &&
+                             hasDeviceExtension( physicalDevice,
+                                                 VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME );
+    if (!isCore && !isExtension) {
+        return false;
+    }
+
+    *pIsExtension = isExtension;
+
+    //  - feature
+    VkPhysicalDeviceHostImageCopyFeatures hostImageCopyFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES,
+        .pNext = nullptr
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &hostImageCopyFeatures
+    };
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    if (!hostImageCopyFeatures.hostImageCopy) {
+        return false;
+    }
+
+    //  - format
+    VkFormatProperties3 formatProperties3 = {
+        .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3,
+        .pNext = nullptr
+    };
+
+    VkFormatProperties2 formatProperties = {
+        .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+        .pNext = &formatProperties3
+    };
+
+    vkGetPhysicalDeviceFormatProperties2(physicalDevice, format, &formatProperties);
+
+    if ( !IS_FLAG_SET( formatProperties3.optimalTilingFeatures,
+                       VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT ) )
+    {
+        return false;
+    }
+
+    //  - source layout
+    VkImageLayout copySrcLayouts[64] = {};
+
+    VkPhysicalDeviceHostImageCopyProperties hostImageCopyProperties = {
+        .sType              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES,
+        .pNext              = nullptr,
+        .copySrcLayoutCount = ARRAY_LENGTH(copySrcLayouts),
+        .pCopySrcLayouts    = copySrcLayouts
+    };
+
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &hostImageCopyProperties
+    };
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    auto hasLayout = false;
+
+    for (uint32_t ll = 0; ll < hostImageCopyProperties.copySrcLayoutCount; ++ll) {
+        hasLayout = hasLayout || VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL == copySrcLayouts[ll];
+    }
+
+    if (!hasLayout) {
+        return false;
+    }
+
+    //  - render image : host transfer usage must not cost the render pass
+    VkHostImageCopyDevicePerformanceQuery performanceQuery = {
+        .sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY,
+        .pNext = nullptr
+    };
+
+    VkImageFormatProperties2 imageFormatProperties = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+        .pNext = &performanceQuery
+    };
+
+    const VkPhysicalDeviceImageFormatInfo2 imageFormatInfo = {
+        .sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+        .pNext  = nullptr,
+        .format = format,
+        .type   = VK_IMAGE_TYPE_2D,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage  = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                | VK_IMAGE_USAGE_HOST_TRANSFER_BIT,
+        .flags  = 0
+    };
+
+    auto const result = vkGetPhysicalDeviceImageFormatProperties2( physicalDevice,
+                                                                   &imageFormatInfo,
+                                                                   &imageFormatProperties );
+
+    return VK_SUCCESS == result && performanceQuery.optimalDeviceAccess;
+}
+
+// * GraphicsPipelineInfo : what the graphics pipeline is compiled against,
+//                          so it may be compiled away from createRenderer
+//
+typedef struct GraphicsPipelineInfo
+{
+    VkDevice                     device;
+    VkPipelineCache              pipelineCache;
+    VkPipelineLayout             pipelineLayout;
+    VkRenderPass                 renderPass;
+    VkSampleCountFlagBits        sampleCount;
+    bool                         hasScene;
+    const VkAllocationCallbacks* pAllocator;
+}
+GraphicsPipelineInfo;
+
+// * createGraphicsPipeline : the square's, or the scene's rectangles'
+//
+VkResult createGraphicsPipeline( const GraphicsPipelineInfo* pInfo,
+                                 VkPipeline*                 pPipeline )
+{
+    auto const hasScene = pInfo->hasScene;
+
+    VkShaderModule vertexShader   = nullptr;
+    VkShaderModule fragmentShader = nullptr;
+    VkResult       result         = VK_SUCCESS;
+
+    do
+    {
+        //====--------------------------------------------------------------====
+        // * Shaders
+
+        //  - vertex
+        const VkShaderModuleCreateInfo vertexShaderInfo = {
+            .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext    = nullptr,
+            .flags    = 0,
+            .codeSize = hasScene ? sizeof(sceneVertexShaderData)
+                                 : sizeof(vertexShaderData),
+            .pCode    = hasScene ? (const uint32_t*)sceneVertexShaderData
+                                 : (const uint32_t*)vertexShaderData
+        };
+
+        result = vkCreateShaderModule( pInfo->device, &vertexShaderInfo, pInfo->pAllocator,
+                                       &vertexShader );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - fragment
+        const VkShaderModuleCreateInfo fragmentShaderInfo = {
+            .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext    = nullptr,
+            .flags    = 0,
+            .codeSize = hasScene ? sizeof(sceneFragmentShaderData)
+                                 : sizeof(fragmentShaderData),
+            .pCode    = hasScene ? (const uint32_t*)sceneFragmentShaderData
+                                 : (const uint32_t*)fragmentShaderData
+        };
+
+        result = vkCreateShaderModule( pInfo->device, &fragmentShaderInfo, pInfo->pAllocator,
+                                       &fragmentShader );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - stages
+        const VkPipelineShaderStageCreateInfo shaderStages[] = {
+            {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext               = nullptr,
+                .flags               = 0,
+                .stage               = VK_SHADER_STAGE_VERTEX_BIT,
+                .module              = vertexShader,
+                .pName               = "main",
+                .pSpecializationInfo = nullptr
+            },
+            {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext               = nullptr,
+                .flags               = 0,
+                .stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module              = fragmentShader,
+                .pName               = "main",
+                .pSpecializationInfo = nullptr
+            }
+        };
+
+        //====--------------------------------------------------------------====
+        // * Fixed function settings
+
+        //  - vertex input : none for the square, which is built into the
+        //    vertex shader. A scene reads one SceneRect per instance
+        const VkVertexInputBindingDescription sceneBinding = {
+            .binding   = 0,
+            .stride    = sizeof(SceneRect),
+            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+        };
+
+        const VkVertexInputAttributeDescription sceneAttributes[] = {
+            {
+                .location = 0,
+                .binding  = 0,
+                .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+                .offset   = offsetof(SceneRect, left)
+            },
+            {
+                .location = 1,
+                .binding  = 0,
+                .format   = VK_FORMAT_R8G8B8A8_UNORM,
+                .offset   = offsetof(SceneRect, color)
+            }
+        };
+
+        const VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+            .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .pNext                           = nullptr,
+            .flags                           = 0,
+            .vertexBindingDescriptionCount   = hasScene ? 1 : 0,
+            .pVertexBindingDescriptions      = hasScene ? &sceneBinding : nullptr,
+            .vertexAttributeDescriptionCount = hasScene ? ARRAY_LENGTH(sceneAttributes) : 0,
+            .pVertexAttributeDescriptions    = hasScene ? sceneAttributes : nullptr
+        };
+
+        //  - input assembly
+        const VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
+            .sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+            .pNext                  = nullptr,
+            .flags                  = 0,
+            .topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+            .primitiveRestartEnable = false
+        };
+
+        //  - viewport : dynamic, so that one pipeline serves every target size
+        const VkPipelineViewportStateCreateInfo viewportInfo = {
+            .sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+            .pNext         = nullptr,
+            .flags         = 0,
+            .viewportCount = 1,
+            .pViewports    = nullptr,
+            .scissorCount  = 1,
+            .pScissors     = nullptr
+        };
+
+        //  - rasterization
+        const VkPipelineRasterizationStateCreateInfo rasterizationInfo = {
+            .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .pNext                   = nullptr,
+            .flags                   = 0,
+            .depthClampEnable        = false,
+            .rasterizerDiscardEnable = false,
+            .polygonMode             = VK_POLYGON_MODE_FILL,
+            .cullMode                = VK_CULL_MODE_BACK_BIT,
+            .frontFace               = VK_FRONT_FACE_CLOCKWISE,
+            .depthBiasEnable         = false,
+            .depthBiasConstantFactor = 0.0f,
+            .depthBiasClamp          = 0.0f,
+            .depthBiasSlopeFactor    = 0.0f,
+            .lineWidth               = 1.0f
+        };
+
+        //  - multisampling
+        const VkPipelineMultisampleStateCreateInfo multisamplingInfo = {
+            .sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+            .pNext                 = nullptr,
+            .flags                 = 0,
+            .rasterizationSamples  = pInfo->sampleCount,
+            .sampleShadingEnable   = false,
+            .minSampleShading      = 1.0f,
+            .pSampleMask           = nullptr,
+            .alphaToCoverageEnable = false,
+            .alphaToOneEnable      = false
+        };
+
+        //  - blend mode : scene rectangles are premultiplied, each composited
+        //    over those before it
+        auto const dstBlendFactor = hasScene ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA
+                                             : VK_BLEND_FACTOR_ZERO;
+
+        const VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+            .blendEnable         = hasScene,
+            .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstColorBlendFactor = dstBlendFactor,
+            .colorBlendOp        = VK_BLEND_OP_ADD,
+            .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstAlphaBlendFactor = dstBlendFactor,
+            .alphaBlendOp        = VK_BLEND_OP_ADD,
+            .colorWriteMask      = VK_COLOR_COMPONENT_R_BIT
+                                 | VK_COLOR_COMPONENT_G_BIT
+                                 | VK_COLOR_COMPONENT_B_BIT
+                                 | VK_COLOR_COMPONENT_A_BIT
+        };
+
+        const VkPipelineColorBlendStateCreateInfo colorBlendInfo = {
+            .sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+            .pNext           = nullptr,
+            .flags           = 0,
+            .logicOpEnable   = false,
+            .logicOp         = VK_LOGIC_OP_COPY,
+            .attachmentCount = 1,
+            .pAttachments    = &colorBlendAttachment,
+            .blendConstants  = { 0.0f, 0.0f, 0.0f, 0.0f }
+        };
+
+        //  - dynamic states
+        const VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        const VkPipelineDynamicStateCreateInfo dynamicStateInfo = {
+            .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+            .pNext             = nullptr,
+            .flags             = 0,
+            .dynamicStateCount = ARRAY_LENGTH(dynamicStates),
+            .pDynamicStates    = dynamicStates
+        };
+
+        //====--------------------------------------------------------------====
+        // * Pipeline
+        //
+        const VkGraphicsPipelineCreateInfo pipelineInfo = {
+            .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .pNext               = nullptr,
+            .flags               = 0,
+            .stageCount          = ARRAY_LENGTH(shaderStages),
+            .pStages             = shaderStages,
+            .pVertexInputState   = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssemblyInfo,
+            .pTessellationState  = nullptr,
+            .pViewportState      = &viewportInfo,
+            .pRasterizationState = &rasterizationInfo,
+            .pMultisampleState   = &multisamplingInfo,
+            .pDepthStencilState  = nullptr,
+            .pColorBlendState    = &colorBlendInfo,
+            .pDynamicState       = &dynamicStateInfo,
+            .layout              = pInfo->pipelineLayout,
+            .renderPass          = pInfo->renderPass,
+            .subpass             = 0,
+            .basePipelineHandle  = nullptr,
+            .basePipelineIndex   = -1
+        };
+
+        result = vkCreateGraphicsPipelines( pInfo->device, pInfo->pipelineCache, 1,
+                                            &pipelineInfo, pInfo->pAllocator,
+                                            pPipeline );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+    }
+    while (0);
+
+    //  - shader modules no longer in use
+    vkDestroyShaderModule(pInfo->device, fragmentShader, pInfo->pAllocator);
+    vkDestroyShaderModule(pInfo->device, vertexShader, pInfo->pAllocator);
+
+    return result;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Deferred pipeline compile : frames draw with shader objects, which
+//                               need no pipeline, while the graphics
+//                               pipeline compiles on a thread of its own
+//
+//====----------------------------------------------------------------------====
+
+// * supportsShaderObjects : and the dynamic rendering they draw within, as
+//                           they have no render pass to be compatible
+//                           with. Both, and the extended dynamic state
+//                           bindShaderObjects sets, are core from 1.3
+//
+bool supportsShaderObjects(VkPhysicalDevice physicalDevice, uint32_t apiVersion)
+{
+    if ( apiVersion < VK_API_VERSION_1_3 ||
+         !hasDeviceExtension(physicalDevice, VK_EXT_SHADER_OBJECT_EXTENSION_NAME) )
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+        .pNext = nullptr
+    };
+
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+        .pNext = &dynamicRenderingFeatures
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &shaderObjectFeatures
+    };
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return shaderObjectFeatures.shaderObject && dynamicRenderingFeatures.dynamicRendering;
+}
+
+// * PipelineStartup
+//
+typedef struct PipelineStartup
+{
+    //  - shader objects : vertex and fragment, linked
+    VkShaderEXT                            shaders[2];
+
+    //  - extension entry points
+    PFN_vkCreateShadersEXT                 pfnCreateShaders;
+    PFN_vkDestroyShaderEXT                 pfnDestroyShader;
+    PFN_vkCmdBindShadersEXT                pfnCmdBindShaders;
+    PFN_vkCmdSetVertexInputEXT             pfnCmdSetVertexInput;
+    PFN_vkCmdSetPolygonModeEXT             pfnCmdSetPolygonMode;
+    PFN_vkCmdSetRasterizationSamplesEXT    pfnCmdSetRasterizationSamples;
+    PFN_vkCmdSetSampleMaskEXT              pfnCmdSetSampleMask;
+    PFN_vkCmdSetAlphaToCoverageEnableEXT   pfnCmdSetAlphaToCoverageEnable;
+    PFN_vkCmdSetColorBlendEnableEXT        pfnCmdSetColorBlendEnable;
+    PFN_vkCmdSetColorBlendEquationEXT      pfnCmdSetColorBlendEquation;
+    PFN_vkCmdSetColorWriteMaskEXT          pfnCmdSetColorWriteMask;
+    PFN_vkCmdBeginRendering                pfnCmdBeginRendering;
+    PFN_vkCmdEndRendering                  pfnCmdEndRendering;
+
+    //  - background compile : pipeline may be bound once isReady is set
+    GraphicsPipelineInfo                   pipelineInfo;
+    thrd_t                                 thread;
+    mtx_t                                  joinMutex;
+    bool                                   isJoined;    // guarded by joinMutex
+    VkResult                               result;
+    VkPipeline                             pipeline;
+    atomic_bool                            isReady;
+}
+PipelineStartup;
+
+// * compileStartupPipeline : thread function
+//
+int compileStartupPipeline(void* pContext)
+{
+    auto const pStartup = (PipelineStartup*)pContext;
+
+    TRACE_BEGIN(pipelineSpan, "compile deferred pipeline");
+
+    pStartup->result = createGraphicsPipeline(&pStartup->pipelineInfo, &pStartup->pipeline);
+
+    TRACE_END(pipelineSpan);
+
+    if (VK_SUCCESS == pStartup->result) {
+        atomic_store_explicit(&pStartup->isReady, true, memory_order_release);
+    }
+
+    return 0;
+}
+
+// * waitForPipelineStartup : joins the compile thread, at most once
+//
+VkResult waitForPipelineStartup(PipelineStartup* pStartup)
+{
+    mtx_lock(&pStartup->joinMutex);
+
+    if (!pStartup->isJoined)
+    {
+        thrd_join(pStartup->thread, nullptr);
+        pStartup->isJoined = true;
+    }
+
+    mtx_unlock(&pStartup->joinMutex);
+
+    return pStartup->result;
+}
+
+// * destroyPipelineStartup : waits for the compile thread
+//
+void destroyPipelineStartup(PipelineStartup* pStartup)
+{
+    auto const device     = pStartup->pipelineInfo.device;
+    auto const pAllocator = pStartup->pipelineInfo.pAllocator;
+
+    waitForPipelineStartup(pStartup);
+
+    vkDestroyPipeline(device, pStartup->pipeline, pAllocator);
+
+    if (nullptr != pStartup->pfnDestroyShader)
+    {
+        for (uint32_t ss = 0; ss < ARRAY_LENGTH(pStartup->shaders); ++ss) {
+            pStartup->pfnDestroyShader(device, pStartup->shaders[ss], pAllocator);
+        }
+    }
+
+    mtx_destroy(&pStartup->joinMutex);
+
+    free(pStartup);
+}
+
+// * createPipelineStartup : shader objects, then the compile thread. The
+//                           pipeline is compiled here if the thread can't
+//                           be started
+//
+VkResult createPipelineStartup( const GraphicsPipelineInfo* pInfo,
+                                PipelineStartup**           ppStartup )
+{
+    auto pStartup = (PipelineStartup*)calloc(1, sizeof(PipelineStartup));
+
+    if (nullptr == pStartup) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (thrd_success != mtx_init(&pStartup->joinMutex, mtx_plain))
+    {
+        free(pStartup);
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    pStartup->pipelineInfo = *pInfo;
+    pStartup->isJoined     = true;
+    pStartup->result       = VK_NOT_READY;
+
+    atomic_init(&pStartup->isReady, false);
+
+    auto const device = pInfo->device;
+    VkResult   result = VK_SUCCESS;
+
+    do
+    {
+        //  - entry points
+        pStartup->pfnCreateShaders
+            = (PFN_vkCreateShadersEXT)vkGetDeviceProcAddr(device, "vkCreateShadersEXT");
+        pStartup->pfnDestroyShader
+            = (PFN_vkDestroyShaderEXT)vkGetDeviceProcAddr(device, "vkDestroyShaderEXT");
+        pStartup->pfnCmdBindShaders
+            = (PFN_vkCmdBindShadersEXT)vkGetDeviceProcAddr(device, "vkCmdBindShadersEXT");
+        pStartup->pfnCmdSetVertexInput
+            = (PFN_vkCmdSetVertexInputEXT)vkGetDeviceProcAddr(device, "vkCmdSetVertexInputEXT");
+        pStartup->pfnCmdSetPolygonMode
+            = (PFN_vkCmdSetPolygonModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetPolygonModeEXT");
+        pStartup->pfnCmdSetRasterizationSamples
+            = (PFN_vkCmdSetRasterizationSamplesEXT)vkGetDeviceProcAddr(
+                device, "vkCmdSetRasterizationSamplesEXT" );
+        pStartup->pfnCmdSetSampleMask
+            = (PFN_vkCmdSetSampleMaskEXT)vkGetDeviceProcAddr(device, "vkCmdSetSampleMaskEXT");
+        pStartup->pfnCmdSetAlphaToCoverageEnable
+            = (PFN_vkCmdSetAlphaToCoverageEnableEXT)vkGetDeviceProcAddr(
+                device, "vkCmdSetAlphaToCoverageEnableEXT" );
+        pStartup->pfnCmdSetColorBlendEnable
+            = (PFN_vkCmdSetColorBlendEnableEXT)vkGetDeviceProcAddr(
+                device, "vkCmdSetColorBlendEnableEXT" );
+        pStartup->pfnCmdSetColorBlendEquation
+            = (PFN_vkCmdSetColorBlendEquationEXT)vkGetDeviceProcAddr(
+                device, "vkCmdSetColorBlendEquationEXT" );
+        pStartup->pfnCmdSetColorWriteMask
+            = (PFN_vkCmdSetColorWriteMaskEXT)vkGetDeviceProcAddr(
+                device, "vkCmdSetColorWriteMaskEXT" );
+        pStartup->pfnCmdBeginRendering
+            = (PFN_vkCmdBeginRendering)vkGetDeviceProcAddr(device, "vkCmdBeginRendering");
+        pStartup->pfnCmdEndRendering
+            = (PFN_vkCmdEndRendering)vkGetDeviceProcAddr(device, "vkCmdEndRendering");
+
+        if ( nullptr == pStartup->pfnCreateShaders ||
+             nullptr == pStartup->pfnDestroyShader ||
+             nullptr == pStartup->pfnCmdBindShaders ||
+             nullptr == pStartup->pfnCmdSetVertexInput ||
+             nullptr == pStartup->pfnCmdSetPolygonMode ||
+             nullptr == pStartup->pfnCmdSetRasterizationSamples ||
+             nullptr == pStartup->pfnCmdSetSampleMask ||
+             nullptr == pStartup->pfnCmdSetAlphaToCoverageEnable ||
+             nullptr == pStartup->pfnCmdSetColorBlendEnable ||
+             nullptr == pStartup->pfnCmdSetColorBlendEquation ||
+             nullptr == pStartup->pfnCmdSetColorWriteMask ||
+             nullptr == pStartup->pfnCmdBeginRendering ||
+             nullptr == pStartup->pfnCmdEndRendering )
+        {
+            result = VK_ERROR_EXTENSION_NOT_PRESENT;
+            break;
+        }
+
+        //  - shader objects : the same SPIR-V the pipeline compiles
+        auto const hasScene = pInfo->hasScene;
+
+        const VkShaderCreateInfoEXT shaderInfos[] = {
+            {
+                .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+                .pNext                  = nullptr,
+                .flags                  = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT,
+                .stage                  = VK_SHADER_STAGE_VERTEX_BIT,
+                .nextStage              = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+                .codeSize               = hasScene ? sizeof(sceneVertexShaderData)
+                                                   : sizeof(vertexShaderData),
+                .pCode                  = hasScene ? sceneVertexShaderData
+                                                   : vertexShaderData,
+                .pName                  = "main",
+                .setLayoutCount         = 0,
+                .pSetLayouts            = nullptr,
+                .pushConstantRangeCount = 0,
+                .pPushConstantRanges    = nullptr,
+                .pSpecializationInfo    = nullptr
+            },
+            {
+                .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+                .pNext                  = nullptr,
+                .flags                  = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT,
+                .stage                  = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .nextStage              = 0,
+                .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+                .codeSize               = hasScene ? sizeof(sceneFragmentShaderData)
+                                                   : sizeof(fragmentShaderData),
+                .pCode                  = hasScene ? sceneFragmentShaderData
+                                                   : fragmentShaderData,
+                .pName                  = "main",
+                .setLayoutCount         = 0,
+                .pSetLayouts            = nullptr,
+                .pushConstantRangeCount = 0,
+                .pPushConstantRanges    = nullptr,
+                .pSpecializationInfo    = nullptr
+            }
+        };
+
+        TRACE_BEGIN(shaderSpan, "create shader objects");
+
+        result = pStartup->pfnCreateShaders( device, ARRAY_LENGTH(shaderInfos), shaderInfos,
+                                             pInfo->pAllocator, pStartup->shaders );
+
+        TRACE_END(shaderSpan);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - compile thread
+        if (thrd_success == thrd_create(&pStartup->thread, compileStartupPipeline, pStartup))
+        {
+            pStartup->isJoined = false;
+        }
+        else
+        {
+            compileStartupPipeline(pStartup);
+            result = pStartup->result;
+        }
+    }
+    while (0);
+
+    if (VK_SUCCESS != result)
+    {
+        destroyPipelineStartup(pStartup);
+        pStartup = nullptr;
+    }
+
+    *ppStartup = pStartup;
+
+    return result;
+}
+
+// * getGraphicsPipeline : null while a deferred pipeline is compiling, or
+//                         if its compile failed
+//
+VkPipeline getGraphicsPipeline(const Renderer* pRenderer)
+{
+    auto const pStartup = pRenderer->pStartup;
+
+    if (nullptr == pStartup) {
+        return pRenderer->graphicsPipeline;
+    }
+
+    return atomic_load_explicit(&pStartup->isReady, memory_order_acquire)
+         ? pStartup->pipeline
+         : nullptr;
+}
+
+// * bindShaderObjects : the shaders, and as dynamic state every fixed
+//                       function setting the pipeline would have compiled
+//                       in. See createGraphicsPipeline
+//
+void bindShaderObjects( VkCommandBuffer        commandBuffer,
+                        const PipelineStartup* pStartup,
+                        const RenderTarget*    pTarget,
+                        const VkViewport*      pViewport )
+{
+    auto const hasScene    = pStartup->pipelineInfo.hasScene;
+    auto const sampleCount = pStartup->pipelineInfo.sampleCount;
+
+    //  - shaders
+    const VkShaderStageFlagBits stages[] = {
+        VK_SHADER_STAGE_VERTEX_BIT,
+        VK_SHADER_STAGE_FRAGMENT_BIT
+    };
+
+    pStartup->pfnCmdBindShaders( commandBuffer, ARRAY_LENGTH(stages), stages,
+                                 pStartup->shaders );
+
+    //  - vertex input : one SceneRect per instance for a scene
+    const VkVertexInputBindingDescription2EXT sceneBinding = {
+        .sType     = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT,
+        .pNext     = nullptr,
+        .binding   = 0,
+        .stride    = sizeof(SceneRect),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+        .divisor   = 1
+    };
+
+    const VkVertexInputAttributeDescription2EXT sceneAttributes[] = {
+        {
+            .sType    = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+            .pNext    = nullptr,
+            .location = 0,
+            .binding  = 0,
+            .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset   = offsetof(SceneRect, left)
+        },
+        {
+            .sType    = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+            .pNext    = nullptr,
+            .location = 1,
+            .binding  = 0,
+            .format   = VK_FORMAT_R8G8B8A8_UNORM,
+            .offset   = offsetof(SceneRect, color)
+        }
+    };
+
+    pStartup->pfnCmdSetVertexInput( commandBuffer,
+                                    hasScene ? 1 : 0,
+                                    hasScene ? &sceneBinding : nullptr,
+                                    hasScene ? ARRAY_LENGTH(sceneAttributes) : 0,
+                                    hasScene ? sceneAttributes : nullptr );
+
+    //  - input assembly
+    vkCmdSetPrimitiveTopology(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
+    vkCmdSetPrimitiveRestartEnable(commandBuffer, false);
+
+    //  - viewport and scissor counts : the draws set their own scissors
+    const VkRect2D scissor = {
+        .offset = { 0, 0 },
+        .extent = { pTarget->width, pTarget->height }
+    };
+
+    vkCmdSetViewportWithCount(commandBuffer, 1, pViewport);
+    vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+
+    //  - rasterization
+    vkCmdSetRasterizerDiscardEnable(commandBuffer, false);
+    pStartup->pfnCmdSetPolygonMode(commandBuffer, VK_POLYGON_MODE_FILL);
+    vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_BACK_BIT);
+    vkCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_CLOCKWISE);
+    vkCmdSetDepthBiasEnable(commandBuffer, false);
+    vkCmdSetDepthTestEnable(commandBuffer, false);
+    vkCmdSetDepthWriteEnable(commandBuffer, false);
+    vkCmdSetStencilTestEnable(commandBuffer, false);
+
+    //  - multisampling : a mask word per 32 samples
+    const VkSampleMask sampleMask[] = { ~0u, ~0u };
+
+    pStartup->pfnCmdSetRasterizationSamples(commandBuffer, sampleCount);
+    pStartup->pfnCmdSetSampleMask(commandBuffer, sampleCount, sampleMask);
+    pStartup->pfnCmdSetAlphaToCoverageEnable(commandBuffer, false);
+
+    //  - blend mode : scene rectangles are premultiplied
+    auto const dstBlendFactor = hasScene ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA
+                                         : VK_BLEND_FACTOR_ZERO;
+
+    const VkBool32 blendEnable = hasScene;
+
+    const VkColorBlendEquationEXT blendEquation = {
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = dstBlendFactor,
+        .colorBlendOp        = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = dstBlendFactor,
+        .alphaBlendOp        = VK_BLEND_OP_ADD
+    };
+
+    const VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT
+                                          | VK_COLOR_COMPONENT_G_BIT
+                                          | VK_COLOR_COMPONENT_B_BIT
+                                          | VK_COLOR_COMPONENT_A_BIT;
+
+    pStartup->pfnCmdSetColorBlendEnable(commandBuffer, 0, 1, &blendEnable);
+    pStartup->pfnCmdSetColorBlendEquation(commandBuffer, 0, 1, &blendEquation);
+    pStartup->pfnCmdSetColorWriteMask(commandBuffer, 0, 1, &writeMask);
+}
+
+// * createRenderPasses : the frame's, and the damage render pass. Needs
+//                        only the device and the formats it supports
+//
+VkResult createRenderPasses(Renderer* pRenderer, bool hasScene)
+{
+    auto const isPacked       = isPackedPixelLayout(pRenderer->pixelLayout);
+    auto const isMultisampled = (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount);
+
+    //  - attachments : the render image, and when multisampled the
+    //    samples it is resolved from. Samples are cleared and drawn, and
+    //    never stored
+    auto const finalLayout = isPacked ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                      : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    const VkAttachmentDescription attachments[] = {
+        {
+            .flags          = 0,
+            .format         = pRenderer->colorFormat,
+            .samples        = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp         = isMultisampled ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                                             : VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout    = finalLayout
+        },
+        {
+            .flags          = 0,
+            .format         = pRenderer->colorFormat,
+            .samples        = pRenderer->sampleCount,
+            .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+        }
+    };
+
+    //  - subpass : draws to the samples, if any, resolved into the image
+    const VkAttachmentReference colorAttachmentRef = {
+        .attachment = 0,
+        .layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+
+    const VkAttachmentReference msaaAttachmentRef = {
+        .attachment = 1,
+        .layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+
+    const VkSubpassDescription subpass = {
+        .flags                   = 0,
+        .pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .inputAttachmentCount    = 0,
+        .pInputAttachments       = nullptr,
+        .colorAttachmentCount    = 1,
+        .pColorAttachments       = isMultisampled ? &msaaAttachmentRef
+                                                  : &colorAttachmentRef,
+        .pResolveAttachments     = isMultisampled ? &colorAttachmentRef
+                                                  : nullptr,
+        .pDepthStencilAttachment = nullptr,
+        .preserveAttachmentCount = 0,
+        .pPreserveAttachments    = nullptr
+    };
+
+    //  - subpass dependencies : post-image render, preceded for a scene by
+    //                           its upload to the vertex buffer. Packed
+    //                           layouts are read by the pack compute pass
+    //                           recorded after the render pass, and
+    //                           host image copies by the host once the
+    //                           frame completes
+    const VkSubpassDependency subpassDependencies[] = {
+        {
+            .srcSubpass      = 0,
+            .dstSubpass      = VK_SUBPASS_EXTERNAL,
+            .srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask    = isPacked ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                             : pRenderer->useHostImageCopy ? VK_PIPELINE_STAGE_HOST_BIT
+                                                         : VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                             | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask   = isPacked ? VK_ACCESS_SHADER_READ_BIT
+                             : pRenderer->useHostImageCopy ? VK_ACCESS_HOST_READ_BIT
+                                                         : VK_ACCESS_TRANSFER_READ_BIT,
+            .dependencyFlags = (isPacked || pRenderer->useHostImageCopy)
+                             ? 0 : VK_DEPENDENCY_BY_REGION_BIT
+        },
+        {
+            .srcSubpass      = VK_SUBPASS_EXTERNAL,
+            .dstSubpass      = 0,
+            .srcStageMask    = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            .srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask   = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            .dependencyFlags = 0
+        }
+    };
+
+    //  - render pass
+    const VkRenderPassCreateInfo renderPassInfo = {
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext           = nullptr,
+        .flags           = 0,
+        .attachmentCount = isMultisampled ? 2 : 1,
+        .pAttachments    = attachments,
+        .subpassCount    = 1,
+        .pSubpasses      = &subpass,
+        .dependencyCount = hasScene ? 2 : 1,
+        .pDependencies   = subpassDependencies
+    };
+
+    auto const result = vkCreateRenderPass( pRenderer->device, &renderPassInfo,
+                                            pRenderer->pAllocator, &pRenderer->renderPass );
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //  - damage render pass : compatible with the render pass, but keeps
+    //    the previous frame, in the layout it was left in, outside the
+    //    render area. Single-sampled frames are loaded, multisampled
+    //    ones are redrawn and resolved across the render area. The
+    //    readback, by copy or pack, completes before the frame is drawn
+    //    over
+    VkAttachmentDescription damageAttachments[] = { attachments[0], attachments[1] };
+
+    damageAttachments[0].loadOp        = isMultisampled ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                                                        : VK_ATTACHMENT_LOAD_OP_LOAD;
+    damageAttachments[0].initialLayout = finalLayout;
+
+    const VkSubpassDependency damageDependencies[] = {
+        subpassDependencies[0],
+        {
+            .srcSubpass      = VK_SUBPASS_EXTERNAL,
+            .dstSubpass      = 0,
+            .srcStageMask    = isPacked ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                        : VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask   = 0,
+            .dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                             | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = 0
+        },
+        subpassDependencies[1]
+    };
+
+    const VkRenderPassCreateInfo damageRenderPassInfo = {
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext           = nullptr,
+        .flags           = 0,
+        .attachmentCount = isMultisampled ? 2 : 1,
+        .pAttachments    = damageAttachments,
+        .subpassCount    = 1,
+        .pSubpasses      = &subpass,
+        .dependencyCount = hasScene ? 3 : 2,
+        .pDependencies   = damageDependencies
+    };
+
+    return vkCreateRenderPass( pRenderer->device, &damageRenderPassInfo,
+                               pRenderer->pAllocator, &pRenderer->damageRenderPass );
+}
+
+// * createRendererDevice : the instance, device and queues, and what the
+//                          device supports of the info. The caller destroys
+//                          a partially created renderer
+//
+VkResult createRendererDevice( const RendererInfo* pInfo,
+                               Renderer*           pRenderer,
+                               bool*               pUseShaderObjects )
+{
+    Renderer renderer = {
+        .pixelLayout       = pInfo->pixelLayout,
+        .pAllocator        = pInfo->pAllocator,
+        .drawCount         = (0 < pInfo->drawCount) ? pInfo->drawCount : 1,
+        .recordThreadCount = (rendererMaxRecordThreads < pInfo->recordThreadCount)
+                           ? rendererMaxRecordThreads : pInfo->recordThreadCount,
+        .startupTimings    = { .beginMs = getTimeMs() }
+    };
+
+    //  - packed layouts are read back through the pack compute pass rather
+    //    than by copying to a linear image
+    auto const isPacked = isPackedPixelLayout(pInfo->pixelLayout);
+
+    VkResult result = VK_SUCCESS;
+
+    do
+    {
+        //====--------------------------------------------------------------====
+        // * Common layer names
+        //
+        const char* layerNames[] = { "VK_LAYER_KHRONOS_validation" };
+
+        //  - validation is left out when measuring performance
+        auto const layerCount = pInfo->enableValidation ? ARRAY_LENGTH(layerNames)
+                                                        : 0;
+
+        //====--------------------------------------------------------------====
+        // * Instance
+
+        //  - the loader's version, which caps what the instance may use.
+        //    Loaders older than 1.1 lack the query
+        uint32_t instanceVersion = VK_API_VERSION_1_0;
+
+        auto const pfnEnumerateInstanceVersion
+            = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+                nullptr, "vkEnumerateInstanceVersion" );
+
+        if (nullptr != pfnEnumerateInstanceVersion) {
+            pfnEnumerateInstanceVersion(&instanceVersion);
+        }
+
+        //  - application info
+        const VkApplicationInfo applicationInfo = {
+            .sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+            .pNext              = nullptr,
+            .pApplicationName   = "base",
+            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+            .pEngineName        = "no engine",
+            .engineVersion      = VK_MAKE_VERSION(0, 0, 0),
+            .apiVersion         = VK_API_VERSION_1_4
+        };
+
+        //  - instance
+        const VkInstanceCreateInfo instanceInfo = {
+            .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+            .pNext                   = nullptr,
+            .flags                   = 0,
+            .pApplicationInfo        = &applicationInfo,
+            .enabledLayerCount       = layerCount,
+            .ppEnabledLayerNames     = layerNames,
+            .enabledExtensionCount   = 0,
+            .ppEnabledExtensionNames = nullptr
+        };
+
+        auto const instanceStartMs = getTimeMs();
+
+        TRACE_BEGIN(instanceSpan, "create instance");
+
+        result = vkCreateInstance(&instanceInfo, renderer.pAllocator, &renderer.instance);
+
+        TRACE_END(instanceSpan);
+
+        addStartupPhase( &renderer.startupTimings, "create instance",
+                         instanceStartMs, getTimeMs() );
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Physical device
+        //
+        result = findPhysicalDevice( renderer.instance, pInfo->deviceNumber,
+                                     &renderer.physicalDevice );
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - memory properties
+        vkGetPhysicalDeviceMemoryProperties( renderer.physicalDevice,
+                                             &renderer.memoryProperties );
+
+        //  - timestamp period, in nanoseconds per tick
+        VkPhysicalDeviceProperties physicalDeviceProperties = {};
+
+        vkGetPhysicalDeviceProperties( renderer.physicalDevice,
+                                       &physicalDeviceProperties );
+
+        renderer.timestampPeriod = physicalDeviceProperties.limits.timestampPeriod;
+
+        //  - core functionality needs both the instance and the device
+        auto const apiVersion = (instanceVersion < physicalDeviceProperties.apiVersion)
+                              ? instanceVersion : physicalDeviceProperties.apiVersion;
+
+        //====--------------------------------------------------------------====
+        // * Queue family
+        //
+        result = findGraphicsAndComputeQueueFamily( renderer.physicalDevice,
+                                                    &renderer.queueFamilyIndex );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - timestamps are unsupported on the queue when no bits are valid
+        uint32_t queueFamilyCount = 0;
+
+        vkGetPhysicalDeviceQueueFamilyProperties( renderer.physicalDevice,
+                                                  &queueFamilyCount, nullptr );
+
+        VkQueueFamilyProperties queueFamilyProperties[queueFamilyCount] = {};
+
+        vkGetPhysicalDeviceQueueFamilyProperties( renderer.physicalDevice,
+                                                  &queueFamilyCount,
+                                                  queueFamilyProperties );
+
+        renderer.timestampValidBits
+            = queueFamilyProperties[renderer.queueFamilyIndex].timestampValidBits;
+
+        //====--------------------------------------------------------------====
+        // * Color format : VK_FORMAT_UNDEFINED selects the supported high
+        //                  precision format with the least bandwidth
+        //
+        const VkFormat highPrecisionFormats[] = {
+            VK_FORMAT_A2B10G10R10_UNORM_PACK32,     // 4 bytes per pixel
+            VK_FORMAT_R16G16B16A16_SFLOAT,          // 8 bytes per pixel
+            VK_FORMAT_R16G16B16A16_UNORM            // 8 bytes per pixel
+        };
+
+        //  - the pack pass samples the render target, the copy path reads it
+        //    back through a linear image of the same format
+        auto const optimalTilingFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT
+                                         | ( isPacked
+                                             ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                                             : VK_FORMAT_FEATURE_TRANSFER_SRC_BIT );
+
+        auto const linearTilingFeatures = isPacked
+                                        ? (VkFormatFeatureFlags)0
+                                        : VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+        //  - drivers preferring BGRA may only support it for some features,
+        //    the readback swizzles it back to RGBA on the host
+        const VkFormat eightBitFormats[] = {
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_FORMAT_B8G8R8A8_UNORM
+        };
+
+        const VkFormat* candidateFormats     = &pInfo->colorFormat;
+        uint32_t        candidateFormatCount = 1;
+
+        if (VK_FORMAT_UNDEFINED == pInfo->colorFormat)
+        {
+            candidateFormats     = highPrecisionFormats;
+            candidateFormatCount = ARRAY_LENGTH(highPrecisionFormats);
+        }
+        else if (VK_FORMAT_R8G8B8A8_UNORM == pInfo->colorFormat)
+        {
+            candidateFormats     = eightBitFormats;
+            candidateFormatCount = ARRAY_LENGTH(eightBitFormats);
+        }
+
+        result = findSupportedFormat( renderer.physicalDevice,
+                                      candidateFormats,
+                                      candidateFormatCount,
+                                      optimalTilingFeatures,
+                                      linearTilingFeatures,
+                                      &renderer.colorFormat );
+
+        if (VK_SUCCESS == result && 0 == formatBytesPerPixel(renderer.colorFormat)) {
+            result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+        }
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Sample count : the largest supported for transient attachments of
+        //                  the color format, up to the one requested
+        //
+        renderer.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+        if (VK_SAMPLE_COUNT_1_BIT < pInfo->sampleCount)
+        {
+            VkImageFormatProperties formatProperties = {};
+
+            auto const formatResult = vkGetPhysicalDeviceImageFormatProperties(
+                renderer.physicalDevice, renderer.colorFormat,
+                VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                0, &formatProperties );
+
+            auto const supportedCounts = (VK_SUCCESS == formatResult)
+                ? formatProperties.sampleCounts
+                  & physicalDeviceProperties.limits.framebufferColorSampleCounts
+                : (VkSampleCountFlags)VK_SAMPLE_COUNT_1_BIT;
+
+            for (uint32_t count = pInfo->sampleCount; VK_SAMPLE_COUNT_1_BIT < count; count >>= 1)
+            {
+                if (IS_FLAG_SET(supportedCounts, count))
+                {
+                    renderer.sampleCount = (VkSampleCountFlagBits)count;
+                    break;
+                }
+            }
+        }
+
+        //====--------------------------------------------------------------====
+        // * Previews : the render image is blitted into its own mip levels,
+        //              filtered where the format allows
+        //
+        VkFormatProperties colorFormatProperties = {};
+
+        vkGetPhysicalDeviceFormatProperties( renderer.physicalDevice, renderer.colorFormat,
+                                             &colorFormatProperties );
+
+        auto const blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                                | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+
+        auto const optimalFeatures = colorFormatProperties.optimalTilingFeatures;
+
+        if (!isPacked && blitFeatures == (optimalFeatures & blitFeatures))
+        {
+            //  - level 0 is the frame itself
+            renderer.previewLevels = pInfo->previewLevels
+                                   & ~1u & ( (1u << rendererMaxMipLevels) - 1 );
+
+            renderer.previewFilter
+                = IS_FLAG_SET(optimalFeatures, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+                ? VK_FILTER_LINEAR
+                : VK_FILTER_NEAREST;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Host image copy : the host reads the render image itself, with
+        //                     neither a destination image nor copy commands.
+        //                     Previews and BGRA's swizzle keep the copy path
+        //
+        const char* extensionNames[4] = {};
+        auto        extensionCount    = 0u;
+
+        auto isHostImageCopyExtension = false;
+
+        if ( !isPacked && !pInfo->disableHostImageCopy && 0 == renderer.previewLevels &&
+             VK_FORMAT_B8G8R8A8_UNORM != renderer.colorFormat )
+        {
+            renderer.useHostImageCopy
+                = supportsHostImageCopy( renderer.physicalDevice, apiVersion,
+                                         renderer.colorFormat, &isHostImageCopyExtension );
+        }
+
+        if (renderer.useHostImageCopy && isHostImageCopyExtension) {
+            extensionNames[extensionCount++] = VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Host pointer import : caller memory that frames are copied into
+        //                         directly, see renderFrameToMemory
+        //
+        auto const canImportHostPointers
+            = hasDeviceExtension( renderer.physicalDevice,
+                                  VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME );
+
+        if (canImportHostPointers)
+        {
+            extensionNames[extensionCount++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+
+            VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostMemoryProperties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT,
+                .pNext = nullptr
+            };
+
+            VkPhysicalDeviceProperties2 properties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &hostMemoryProperties
+            };
+
+            vkGetPhysicalDeviceProperties2(renderer.physicalDevice, &properties);
+
+            renderer.hostPointerAlignment = hostMemoryProperties.minImportedHostPointerAlignment;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Shader objects : a deferred pipeline compile needs them to draw
+        //                    in the meantime, and is otherwise compiled up
+        //                    front
+        //
+        *pUseShaderObjects
+            = pInfo->deferPipelineCompile
+           && supportsShaderObjects(renderer.physicalDevice, apiVersion);
+
+        auto const useShaderObjects = *pUseShaderObjects;
+
+        if (useShaderObjects) {
+            extensionNames[extensionCount++] = VK_EXT_SHADER_OBJECT_EXTENSION_NAME;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Memory budget : live heap budgets and usage, which render targets
+        //                   are admitted against
+        //
+        renderer.hasMemoryBudget
+            = hasDeviceExtension( renderer.physicalDevice,
+                                  VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+
+        if (renderer.hasMemoryBudget) {
+            extensionNames[extensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Logical device
+
+        //  - device queues : as many as requested and available, at equal
+        //    priority
+        auto const availableQueueCount
+            = queueFamilyProperties[renderer.queueFamilyIndex].queueCount;
+
+        auto queueCount = (0 < pInfo->queueCount) ? pInfo->queueCount
+                                                  : availableQueueCount;
+
+        if (availableQueueCount < queueCount) {
+            queueCount = availableQueueCount;
+        }
+
+        if (rendererMaxQueues < queueCount) {
+            queueCount = rendererMaxQueues;
+        }
+
+        float queuePriorities[rendererMaxQueues] = {};
+
+        for (uint32_t qq = 0; qq < queueCount; ++qq) {
+            queuePriorities[qq] = 1.0f;
+        }
+
+        const VkDeviceQueueCreateInfo deviceQueueInfo = {
+            .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext            = nullptr,
+            .flags            = 0,
+            .queueFamilyIndex = renderer.queueFamilyIndex,
+            .queueCount       = queueCount,
+            .pQueuePriorities = queuePriorities
+        };
+
+        //  - physical device features
+        const VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
+
+        VkPhysicalDeviceHostImageCopyFeatures hostImageCopyFeatures = {
+            .sType         = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES,
+            .pNext         = nullptr,
+            .hostImageCopy = renderer.useHostImageCopy
+        };
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {
+            .sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
+            .pNext            = nullptr,
+            .dynamicRendering = useShaderObjects
+        };
+
+        VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures = {
+            .sType        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+            .pNext        = &dynamicRenderingFeatures,
+            .shaderObject = useShaderObjects
+        };
+
+        //  - feature chain : only what is enabled
+        void* pFeatures = nullptr;
+
+        if (renderer.useHostImageCopy)
+        {
+            hostImageCopyFeatures.pNext = pFeatures;
+            pFeatures                   = &hostImageCopyFeatures;
+        }
+
+        if (useShaderObjects)
+        {
+            dynamicRenderingFeatures.pNext = pFeatures;
+            pFeatures                      = &shaderObjectFeatures;
+        }
+
+        //  - device
+        const VkDeviceCreateInfo deviceInfo = {
+            .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+            .pNext                   = pFeatures,
+            .flags                   = 0,
+            .queueCreateInfoCount    = 1,
+            .pQueueCreateInfos       = &deviceQueueInfo,
+            .enabledLayerCount       = layerCount,
+            .ppEnabledLayerNames     = layerNames,
+            .enabledExtensionCount   = extensionCount,
+            .ppEnabledExtensionNames = extensionNames,
+            .pEnabledFeatures        = &physicalDeviceFeatures
+        };
+
+        auto const deviceStartMs = getTimeMs();
+
+        TRACE_BEGIN(deviceSpan, "create device");
+
+        result = vkCreateDevice( renderer.physicalDevice, &deviceInfo, renderer.pAllocator,
+                                 &renderer.device );
+
+        TRACE_END(deviceSpan);
+
+        addStartupPhase( &renderer.startupTimings, "create device",
+                         deviceStartMs, getTimeMs() );
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - queues, each with the mutex that externally synchronizes it
+        auto pQueueMutexes = (mtx_t*)calloc(queueCount, sizeof(mtx_t));
+        auto mutexCount    = 0u;
+
+        for (; nullptr != pQueueMutexes && mutexCount < queueCount; ++mutexCount)
+        {
+            if (thrd_success != mtx_init(&pQueueMutexes[mutexCount], mtx_plain)) {
+                break;
+            }
+        }
+
+        if (nullptr == pQueueMutexes || mutexCount < queueCount)
+        {
+            for (uint32_t qq = 0; qq < mutexCount; ++qq) {
+                mtx_destroy(&pQueueMutexes[qq]);
+            }
+
+            free(pQueueMutexes);
+
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            break;
+        }
+
+        for (uint32_t qq = 0; qq < queueCount; ++qq)
+        {
+            vkGetDeviceQueue( renderer.device, renderer.queueFamilyIndex, qq,
+                              &renderer.queues[qq] );
+        }
+
+        renderer.pQueueMutexes = pQueueMutexes;
+        renderer.queueCount    = queueCount;
+
+        //  - render target admission, see createRenderTargetInBudget
+        auto pBudgetMutex = (mtx_t*)malloc(sizeof(mtx_t));
+
+        if (nullptr == pBudgetMutex || thrd_success != mtx_init(pBudgetMutex, mtx_plain))
+        {
+            free(pBudgetMutex);
+
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            break;
+        }
+
+        renderer.pBudgetMutex = pBudgetMutex;
+
+        auto const device = renderer.device;
+
+        //  - extension entry point, without which nothing is imported
+        if (canImportHostPointers)
+        {
+            renderer.pfnGetMemoryHostPointerProperties
+                = (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(
+                    device, "vkGetMemoryHostPointerPropertiesEXT" );
+
+            if (nullptr == renderer.pfnGetMemoryHostPointerProperties) {
+                renderer.hostPointerAlignment = 0;
+            }
+        }
+
+        //  - host image copy entry point, core or the extension's, without
+        //    which frames take the copy path
+        if (renderer.useHostImageCopy)
+        {
+            renderer.pfnCopyImageToMemory
+                = (PFN_vkCopyImageToMemory)vkGetDeviceProcAddr(
+                    device, isHostImageCopyExtension ? "vkCopyImageToMemoryEXT"
+                                                     : "vkCopyImageToMemory" );
+
+            renderer.useHostImageCopy = (nullptr != renderer.pfnCopyImageToMemory);
+        }
+    }
+    while (0);
+
+    *pRenderer = renderer;
+
+    return result;
+}
+
+// * destroyRenderer
+//
+void destroyRenderer(Renderer* pRenderer)
+{
+    auto const device     = pRenderer->device;
+    auto const pAllocator = pRenderer->pAllocator;
+
+    if (nullptr != device)
+    {
+        destroyPackPipeline(device, pAllocator, &pRenderer->packPipeline);
+
+        if (nullptr != pRenderer->pStartup) {
+            destroyPipelineStartup(pRenderer->pStartup);
+        }
+
+        vkDestroyPipeline(device, pRenderer->graphicsPipeline, pAllocator);
+        vkDestroyRenderPass(device, pRenderer->damageRenderPass, pAllocator);
+        vkDestroyRenderPass(device, pRenderer->renderPass, pAllocator);
+        vkDestroyPipelineLayout(device, pRenderer->pipelineLayout, pAllocator);
+        vkDestroyPipelineCache(device, pRenderer->pipelineCache, pAllocator);
+
+        destroyScene(device, pAllocator, &pRenderer->scene);
+
+        vkDestroyDevice(device, pAllocator);
+    }
+
+    if (nullptr != pRenderer->pQueueMutexes)
+    {
+        for (uint32_t qq = 0; qq < pRenderer->queueCount; ++qq) {
+            mtx_destroy(&pRenderer->pQueueMutexes[qq]);
+        }
+
+        free(pRenderer->pQueueMutexes);
+    }
+
+    if (nullptr != pRenderer->pBudgetMutex)
+    {
+        mtx_destroy(pRenderer->pBudgetMutex);
+        free(pRenderer->pBudgetMutex);
+    }
+
+    vkDestroyInstance(pRenderer->instance, pAllocator);
+
+    memset( pRenderer, 0, sizeof(*pRenderer) );
+}
+
+// * waitForGraphicsPipeline
+//
+VkResult waitForGraphicsPipeline(Renderer* pRenderer)
+{
+    if (nullptr == pRenderer->pStartup) {
+        return VK_SUCCESS;
+    }
+
+    return waitForPipelineStartup(pRenderer->pStartup);
+}
+
+// * addRendererToCacheKey
+//
+void addRendererToCacheKey(const Renderer* pRenderer, CacheKeyHasher* pHasher)
+{
+    auto const colorFormat = (uint32_t)pRenderer->colorFormat;
+    auto const pixelLayout = (uint32_t)pRenderer->pixelLayout;
+    auto const sampleCount = (uint32_t)pRenderer->sampleCount;
+    auto const previews    = (uint64_t)pRenderer->previewLevels
+                           | ( (uint64_t)pRenderer->previewFilter << 32 );
+
+    addCacheKeyData(pHasher, &rendererCacheVersion, sizeof(rendererCacheVersion));
+    addCacheKeyData(pHasher, &colorFormat, sizeof(colorFormat));
+    addCacheKeyData(pHasher, &pixelLayout, sizeof(pixelLayout));
+    addCacheKeyData(pHasher, &sampleCount, sizeof(sampleCount));
+    addCacheKeyData(pHasher, &previews, sizeof(previews));
+
+    //  - shaders, and the scene they draw
+    if (0 < pRenderer->scene.rectCount)
+    {
+        addCacheKeyData(pHasher, sceneVertexShaderData, sizeof(sceneVertexShaderData));
+        addCacheKeyData(pHasher, sceneFragmentShaderData, sizeof(sceneFragmentShaderData));
+        addCacheKeyData( pHasher, pRenderer->scene.digest.bytes,
+                         sizeof(pRenderer->scene.digest.bytes) );
+    }
+    else
+    {
+        addCacheKeyData(pHasher, vertexShaderData, sizeof(vertexShaderData));
+        addCacheKeyData(pHasher, fragmentShaderData, sizeof(fragmentShaderData));
+    }
+
+    if (isPackedPixelLayout(pRenderer->pixelLayout)) {
+        addPackShaderToCacheKey(pHasher);
+    }
+}
+
+// * updateRendererScene : on the queue the scene was loaded with
+//
+VkResult updateRendererScene( Renderer*        pRenderer,
+                              uint32_t         firstRect,
+                              uint32_t         rectCount,
+                              const SceneRect* pRects )
+{
+    const SceneUploadInfo sceneUploadInfo = {
+        .device            = pRenderer->device,
+        .pMemoryProperties = &pRenderer->memoryProperties,
+        .queueFamilyIndex  = pRenderer->queueFamilyIndex,
+        .queue             = pRenderer->queues[0],
+        .pQueueMutex       = &pRenderer->pQueueMutexes[0],
+        .pAllocator        = pRenderer->pAllocator
+    };
+
+    return updateSceneRects( &sceneUploadInfo, &pRenderer->scene,
+                             firstRect, rectCount, pRects );
+}
+
+//====----------------------------------------------------------------------====
+//
+// * RenderTarget
+//
+//====----------------------------------------------------------------------====
+
+// * initRenderTarget : the target's size, queue and mip levels, before any
+//                      of its objects are created
+//
+RenderTarget initRenderTarget( Renderer* pRenderer,
+                               uint32_t  width,
+                               uint32_t  height )
+{
+    RenderTarget target = {
+        .width      = width,
+        .height     = height,
+        .queueIndex = atomic_fetch_add(&pRenderer->nextQueueIndex, 1)
+                    % pRenderer->queueCount
+    };
+
+    //  - previews : levels of the full mip chain only, so that none is
+    //    smaller than a pixel
+    auto const largestSide = (width < height) ? height : width;
+    auto const chainLevels = stdc_bit_width(largestSide);
+
+    target.previewLevels = pRenderer->previewLevels
+                         & (uint32_t)( (1ull << chainLevels) - 1 );
+
+    target.mipLevels = (0 != target.previewLevels) ? stdc_bit_width(target.previewLevels)
+                                                   : 1;
+
+    return target;
+}
+
+// * createTargetImages : the render image and its view, and when
+//                        multisampled the samples resolved into it
+//
+VkResult createTargetImages(const Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const device     = pRenderer->device;
+    auto const pAllocator = pRenderer->pAllocator;
+    auto const width      = pTarget->width;
+    auto const height     = pTarget->height;
+    auto const isPacked   = isPackedPixelLayout(pRenderer->pixelLayout);
+
+    VkResult result = VK_SUCCESS;
+
+    TRACE_BEGIN(allocationSpan, "allocate images");
+
+    do
+    {
+        //  - image
+        const VkImageCreateInfo imageInfo = {
+            .sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext                 = nullptr,
+            .flags                 = 0,
+            .imageType             = VK_IMAGE_TYPE_2D,
+            .format                = pRenderer->colorFormat,
+            .extent                = { width, height, 1 },
+            .mipLevels             = pTarget->mipLevels,
+            .arrayLayers           = 1,
+            .samples               = VK_SAMPLE_COUNT_1_BIT,
+            .tiling                = VK_IMAGE_TILING_OPTIMAL,
+            .usage                 = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                                   | ( isPacked ? VK_IMAGE_USAGE_SAMPLED_BIT
+                                                : VK_IMAGE_USAGE_TRANSFER_SRC_BIT )
+                                   | ( (1 < pTarget->mipLevels) ? VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                                                              : 0 )
+                                   | ( pRenderer->useHostImageCopy
+                                       ? VK_IMAGE_USAGE_HOST_TRANSFER_BIT : 0 ),
+            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices   = nullptr,
+            .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+        };
+
+        result = createImageAndMemory( device, &imageInfo,
+                                       &pRenderer->memoryProperties,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                       pAllocator,
+                                       &pTarget->image, &pTarget->imageMemory );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - image view
+        const VkImageViewCreateInfo imageViewInfo = {
+            .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext      = nullptr,
+            .flags      = 0,
+            .image      = pTarget->image,
+            .viewType   = VK_IMAGE_VIEW_TYPE_2D,
+            .format     = imageInfo.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = 0,
+                .levelCount     = 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+
+        result = vkCreateImageView( device, &imageViewInfo, pAllocator,
+                                    &pTarget->imageView );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - multisample image : lazily allocated memory, where there is
+        //    any, is only committed if the samples ever leave tile memory
+        auto const isMultisampled = (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount);
+
+        if (isMultisampled)
+        {
+            auto msaaImageInfo = imageInfo;
+
+            msaaImageInfo.mipLevels = 1;
+            msaaImageInfo.samples   = pRenderer->sampleCount;
+            msaaImageInfo.usage     = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                                    | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+            result = createImageAndMemory( device, &msaaImageInfo,
+                                           &pRenderer->memoryProperties,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                           | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                                           pAllocator,
+                                           &pTarget->msaaImage, &pTarget->msaaImageMemory );
+
+            if (VK_ERROR_FEATURE_NOT_PRESENT == result)
+            {
+                result = createImageAndMemory( device, &msaaImageInfo,
+                                               &pRenderer->memoryProperties,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                               pAllocator,
+                                               &pTarget->msaaImage, &pTarget->msaaImageMemory );
+            }
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            auto msaaImageViewInfo = imageViewInfo;
+
+            msaaImageViewInfo.image = pTarget->msaaImage;
+
+            result = vkCreateImageView( device, &msaaImageViewInfo, pAllocator,
+                                        &pTarget->msaaImageView );
+            if (VK_SUCCESS != result) {
+                break;
+            }
+        }
+    }
+    while (0);
+
+    TRACE_END(allocationSpan);
+
+    return result;
+}
+
+// * createTargetFramebuffer : needs the render pass and the target's images
+//
+VkResult createTargetFramebuffer(const Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const isMultisampled = (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount);
+
+    //  - framebuffer : attachments in render pass order
+    const VkImageView framebufferAttachments[] = {
+        pTarget->imageView,
+        pTarget->msaaImageView
+    };
+
+    const VkFramebufferCreateInfo framebufferInfo = {
+        .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .pNext           = nullptr,
+        .flags           = 0,
+        .renderPass      = pRenderer->renderPass,
+        .attachmentCount = isMultisampled ? 2 : 1,
+        .pAttachments    = framebufferAttachments,
+        .width           = pTarget->width,
+        .height          = pTarget->height,
+        .layers          = 1
+    };
+
+    return vkCreateFramebuffer( pRenderer->device, &framebufferInfo,
+                                pRenderer->pAllocator, &pTarget->framebuffer );
+}
+
+// * createTargetReadback : memory the frame is read back from, and its
+//                          previews
+//
+VkResult createTargetReadback(const Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const device     = pRenderer->device;
+    auto const pAllocator = pRenderer->pAllocator;
+    auto const width      = pTarget->width;
+    auto const height     = pTarget->height;
+    auto const isPacked   = isPackedPixelLayout(pRenderer->pixelLayout);
+
+    VkResult result = VK_SUCCESS;
+
+    TRACE_BEGIN(readbackSpan, "allocate readback");
+
+    do
+    {
+        if (isPacked)
+        {
+            //  - pack buffer : rows are packed to whole words
+            pTarget->packBytesPerRow
+                = sizeof(uint32_t) * packedWordsPerRow(pRenderer->pixelLayout, width);
+
+            const VkBufferCreateInfo packBufferInfo = {
+                .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext                 = nullptr,
+                .flags                 = 0,
+                .size                  = pTarget->packBytesPerRow * height,
+                .usage                 = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices   = nullptr
+            };
+
+            result = createBufferAndMemory( device, &packBufferInfo,
+                                            &pRenderer->memoryProperties,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            pAllocator,
+                                            &pTarget->packBuffer,
+                                            &pTarget->packBufferMemory );
+            if (VK_SUCCESS != result) {
+                break;
+            }
+        }
+        else if (!pRenderer->useHostImageCopy)
+        {
+            //  - destination image
+            const VkImageCreateInfo destImageInfo = {
+                .sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .pNext                 = nullptr,
+                .flags                 = 0,
+                .imageType             = VK_IMAGE_TYPE_2D,
+                .format                = pRenderer->colorFormat,
+                .extent                = { width, height, 1 },
+                .mipLevels             = 1,
+                .arrayLayers           = 1,
+                .samples               = VK_SAMPLE_COUNT_1_BIT,
+                .tiling                = VK_IMAGE_TILING_LINEAR,
+                .usage                 = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices   = nullptr,
+                .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+            };
+
+            result = createImageAndMemory( device, &destImageInfo,
+                                           &pRenderer->memoryProperties,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           pAllocator,
+                                           &pTarget->destImage,
+                                           &pTarget->destImageMemory );
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            //  - image memory layout
+            const VkImageSubresource destImageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel   = 0,
+                .arrayLayer = 0
+            };
+
+            vkGetImageSubresourceLayout( device, pTarget->destImage,
+                                         &destImageSubresource,
+                                         &pTarget->destImageLayout );
+        }
+
+        //  - preview buffer : each selected level's tightly packed rows, at
+        //    offsets aligned for any texel size
+        if (0 != pTarget->previewLevels)
+        {
+            auto const bytesPerPixel = (VkDeviceSize)formatBytesPerPixel(pRenderer->colorFormat);
+
+            VkDeviceSize previewBufferSize = 0;
+
+            for (uint32_t level = 1; level < pTarget->mipLevels; ++level)
+            {
+                if (!IS_FLAG_SET(pTarget->previewLevels, 1u << level)) {
+                    continue;
+                }
+
+                auto const levelWidth  = (1 < (width >> level)) ? (width >> level) : 1;
+                auto const levelHeight = (1 < (height >> level)) ? (height >> level) : 1;
+
+                pTarget->previewOffsets[level] = previewBufferSize;
+
+                previewBufferSize += (bytesPerPixel * levelWidth * levelHeight + 15) & ~15ull;
+            }
+
+            const VkBufferCreateInfo previewBufferInfo = {
+                .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext                 = nullptr,
+                .flags                 = 0,
+                .size                  = previewBufferSize,
+                .usage                 = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 0,
+                .pQueueFamilyIndices   = nullptr
+            };
+
+            result = createBufferAndMemory( device, &previewBufferInfo,
+                                            &pRenderer->memoryProperties,
+                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                            | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                            pAllocator,
+                                            &pTarget->previewBuffer,
+                                            &pTarget->previewBufferMemory );
+            if (VK_SUCCESS != result) {
+                break;
+            }
+        }
+    }
+    while (0);
+
+    TRACE_END(readbackSpan);
+
+    return result;
+}
+
+// * createTargetPackDescriptors : needs the pack pipeline, the render image
+//                                 and the pack buffer. Packed layouts only
+//
+VkResult createTargetPackDescriptors(const Renderer* pRenderer, RenderTarget* pTarget)
+{
+    if (!isPackedPixelLayout(pRenderer->pixelLayout)) {
+        return VK_SUCCESS;
+    }
+
+    return createPackDescriptorSet( pRenderer->device, &pRenderer->packPipeline,
+                                    pTarget->imageView,
+                                    pTarget->packBuffer,
+                                    pRenderer->pAllocator,
+                                    &pTarget->packDescriptorPool,
+                                    &pTarget->packDescriptorSet );
+}
+
+// * createTargetCommands : from pools of the target's own, so threads
+//                          rendering different targets never share one
+//
+VkResult createTargetCommands(const Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const device     = pRenderer->device;
+    auto const pAllocator = pRenderer->pAllocator;
+
+    VkResult result = VK_SUCCESS;
+
+    do
+    {
+        //  - pool
+        const VkCommandPoolCreateInfo commandPoolInfo = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = nullptr,
+            .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = pRenderer->queueFamilyIndex
+        };
+
+        result = vkCreateCommandPool( device, &commandPoolInfo, pAllocator,
+                                      &pTarget->commandPool );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - allocate
+        const VkCommandBufferAllocateInfo commandBufferInfo = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = nullptr,
+            .commandPool        = pTarget->commandPool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 2
+        };
+
+        VkCommandBuffer commandBuffers[2] = {};
+
+        result = vkAllocateCommandBuffers( device, &commandBufferInfo,
+                                           commandBuffers );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        pTarget->renderCommandBuffer = commandBuffers[0];
+        pTarget->copyCommandBuffer   = commandBuffers[1];
+
+        //  - secondary : each recording thread resets and records from its
+        //    own pool, every frame
+        const VkCommandPoolCreateInfo secondaryPoolInfo = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = nullptr,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = pRenderer->queueFamilyIndex
+        };
+
+        for ( uint32_t tt = 0;
+              tt < pRenderer->recordThreadCount && VK_SUCCESS == result; ++tt )
+        {
+            result = vkCreateCommandPool( device, &secondaryPoolInfo, pAllocator,
+                                          &pTarget->secondaryCommandPools[tt] );
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            const VkCommandBufferAllocateInfo secondaryBufferInfo = {
+                .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .pNext              = nullptr,
+                .commandPool        = pTarget->secondaryCommandPools[tt],
+                .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                .commandBufferCount = 1
+            };
+
+            result = vkAllocateCommandBuffers( device, &secondaryBufferInfo,
+                                               &pTarget->secondaryCommandBuffers[tt] );
+        }
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - recording threads : the thread rendering a frame records one
+        //    of its secondary command buffers itself
+        if (0 < pRenderer->recordThreadCount)
+        {
+            auto pRecordPool = (TaskPool*)calloc(1, sizeof(TaskPool));
+
+            if ( nullptr == pRecordPool ||
+                 !createTaskPool(pRenderer->recordThreadCount - 1, pRecordPool) )
+            {
+                free(pRecordPool);
+                result = VK_ERROR_OUT_OF_HOST_MEMORY;
+                break;
+            }
+
+            pTarget->pRecordPool = pRecordPool;
+        }
+
+        //  - timestamp queries : only where the queue supports them
+        if (0 < pRenderer->timestampValidBits)
+        {
+            const VkQueryPoolCreateInfo queryPoolInfo = {
+                .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                .pNext              = nullptr,
+                .flags              = 0,
+                .queryType          = VK_QUERY_TYPE_TIMESTAMP,
+                .queryCount         = TIMESTAMP_COUNT,
+                .pipelineStatistics = 0
+            };
+
+            result = vkCreateQueryPool( device, &queryPoolInfo, pAllocator,
+                                        &pTarget->timestampQueryPool );
+        }
+    }
+    while (0);
+
+    return result;
+}
+
+// * measureTargetMemory : what the target's images and buffers allocated,
+//                         which it holds of the renderer's targetMemory
+//                         until destroyed
+//
+void measureTargetMemory(Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const device = pRenderer->device;
+
+    const VkImage  images[]  = { pTarget->image, pTarget->msaaImage, pTarget->destImage };
+    const VkBuffer buffers[] = { pTarget->packBuffer, pTarget->previewBuffer };
+
+    VkDeviceSize memorySize = 0;
+
+    for (uint32_t ii = 0; ii < ARRAY_LENGTH(images); ++ii)
+    {
+        if (nullptr != images[ii])
+        {
+            VkMemoryRequirements requirements = {};
+            vkGetImageMemoryRequirements(device, images[ii], &requirements);
+
+            memorySize += requirements.size;
+        }
+    }
+
+    for (uint32_t bb = 0; bb < ARRAY_LENGTH(buffers); ++bb)
+    {
+        if (nullptr != buffers[bb])
+        {
+            VkMemoryRequirements requirements = {};
+            vkGetBufferMemoryRequirements(device, buffers[bb], &requirements);
+
+            memorySize += requirements.size;
+        }
+    }
+
+    pTarget->memorySize = memorySize;
+
+    atomic_fetch_add(&pRenderer->targetMemory, memorySize);
+}
+
+// * createRenderTarget
+//
+VkResult createRenderTarget( Renderer*     pRenderer,
+                             uint32_t      width,
+                             uint32_t      height,
+                             RenderTarget* pTarget )
+{
+    auto target = initRenderTarget(pRenderer, width, height);
+    auto result = createTargetImages(pRenderer, &target);
+
+    if (VK_SUCCESS == result) {
+        result = createTargetFramebuffer(pRenderer, &target);
+    }
+
+    if (VK_SUCCESS == result) {
+        result = createTargetReadback(pRenderer, &target);
+    }
+
+    if (VK_SUCCESS == result) {
+        result = createTargetPackDescriptors(pRenderer, &target);
+    }
+
+    if (VK_SUCCESS == result) {
+        result = createTargetCommands(pRenderer, &target);
+    }
+
+    if (VK_SUCCESS == result) {
+        measureTargetMemory(pRenderer, &target);
+    }
+    else {
+        destroyRenderTarget(pRenderer, &target);
+    }
+
+    *pTarget = target;
+
+    return result;
+}
+
+// * destroyRenderTarget
+//
+void destroyRenderTarget(Renderer* pRenderer, RenderTarget* pTarget)
+{
+    auto const device     = pRenderer->device;
+    auto const pAllocator = pRenderer->pAllocator;
+
+    vkDestroyQueryPool(device, pTarget->timestampQueryPool, pAllocator);
+
+    if (nullptr != pTarget->pRecordPool)
+    {
+        destroyTaskPool(pTarget->pRecordPool);
+        free(pTarget->pRecordPool);
+    }
+
+    if (nullptr != pTarget->renderCommandBuffer)
+    {
+        const VkCommandBuffer commandBuffers[] = {
+            pTarget->renderCommandBuffer,
+            pTarget->copyCommandBuffer
+        };
+
+        vkFreeCommandBuffers( device, pTarget->commandPool,
+                              ARRAY_LENGTH(commandBuffers), commandBuffers );
+    }
+
+    vkDestroyCommandPool(device, pTarget->commandPool, pAllocator);
+
+    //  - secondary command buffers are freed with their pools
+    for (uint32_t tt = 0; tt < rendererMaxRecordThreads; ++tt) {
+        vkDestroyCommandPool(device, pTarget->secondaryCommandPools[tt], pAllocator);
+    }
+
+    vkDestroyBuffer(device, pTarget->previewBuffer, pAllocator);
+    vkFreeMemory(device, pTarget->previewBufferMemory, pAllocator);
+
+    vkDestroyImage(device, pTarget->destImage, pAllocator);
+    vkFreeMemory(device, pTarget->destImageMemory, pAllocator);
+
+    vkDestroyDescriptorPool(device, pTarget->packDescriptorPool, pAllocator);
+    vkDestroyBuffer(device, pTarget->packBuffer, pAllocator);
+    vkFreeMemory(device, pTarget->packBufferMemory, pAllocator);
+
+    vkDestroyFramebuffer(device, pTarget->framebuffer, pAllocator);
+
+    vkDestroyImageView(device, pTarget->msaaImageView, pAllocator);
+    vkDestroyImage(device, pTarget->msaaImage, pAllocator);
+    vkFreeMemory(device, pTarget->msaaImageMemory, pAllocator);
+
+    vkDestroyImageView(device, pTarget->imageView, pAllocator);
+    vkDestroyImage(device, pTarget->image, pAllocator);
+    vkFreeMemory(device, pTarget->imageMemory, pAllocator);
+
+    atomic_fetch_sub(&pRenderer->targetMemory, pTarget->memorySize);
+
+    memset( pTarget, 0, sizeof(*pTarget) );
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Device memory
+//
+//====----------------------------------------------------------------------====
+
+// * queryRendererMemory
+//
+RendererMemory queryRendererMemory(const Renderer* pRenderer)
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+        .pNext = nullptr
+    };
+
+    VkPhysicalDeviceMemoryProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = pRenderer->hasMemoryBudget ? &budgetProperties : nullptr
+    };
+
+    vkGetPhysicalDeviceMemoryProperties2(pRenderer->physicalDevice, &properties);
+
+    //  - device-local heaps, of which there is at least one. Readback
+    //    memory is counted against them too, wherever it lives
+    auto const pHeaps = properties.memoryProperties.memoryHeaps;
+
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage  = 0;
+
+    for (uint32_t hh = 0; hh < properties.memoryProperties.memoryHeapCount; ++hh)
+    {
+        if (!IS_FLAG_SET(pHeaps[hh].flags, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+            continue;
+        }
+
+        if (pRenderer->hasMemoryBudget)
+        {
+            budget += budgetProperties.heapBudget[hh];
+            usage  += budgetProperties.heapUsage[hh];
+        }
+        else {
+            budget += pHeaps[hh].size;
+        }
+    }
+
+    if (!pRenderer->hasMemoryBudget) {
+        usage = atomic_load(&pRenderer->targetMemory);
+    }
+
+    auto const capacity = budget - budget / 100 * rendererMemoryReservePercent;
+
+    return (RendererMemory){
+        .capacity  = capacity,
+        .available = (usage < capacity) ? capacity - usage : 0
+    };
+}
+
+// * estimateRenderTargetMemory
+//
+VkDeviceSize estimateRenderTargetMemory( const Renderer* pRenderer,
+                                         uint32_t        width,
+                                         uint32_t        height )
+{
+    auto const bytesPerPixel = (VkDeviceSize)formatBytesPerPixel(pRenderer->colorFormat);
+    auto const frameSize     = bytesPerPixel * width * height;
+
+    //  - render image : a mip chain adds at most a third, as do the
+    //    previews read back from it
+    auto memorySize = frameSize;
+
+    if (0 != pRenderer->previewLevels) {
+        memorySize += 2 * (frameSize / 3);
+    }
+
+    //  - multisample image
+    if (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount) {
+        memorySize += frameSize * pRenderer->sampleCount;
+    }
+
+    //  - readback
+    if (isPackedPixelLayout(pRenderer->pixelLayout))
+    {
+        memorySize += sizeof(uint32_t) * height
+                    * (VkDeviceSize)packedWordsPerRow(pRenderer->pixelLayout, width);
+    }
+    else if (!pRenderer->useHostImageCopy) {
+        memorySize += frameSize;
+    }
+
+    return memorySize;
+}
+
+// * createRenderTargetInBudget
+//
+VkResult createRenderTargetInBudget( Renderer*     pRenderer,
+                                     uint32_t      width,
+                                     uint32_t      height,
+                                     RenderTarget* pTarget )
+{
+    auto const memorySize = estimateRenderTargetMemory(pRenderer, width, height);
+
+    mtx_lock(pRenderer->pBudgetMutex);
+
+    auto const memory = queryRendererMemory(pRenderer);
+
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    if (memorySize <= memory.available) {
+        result = createRenderTarget(pRenderer, width, height, pTarget);
+    }
+    else {
+        memset( pTarget, 0, sizeof(*pTarget) );
+    }
+
+    mtx_unlock(pRenderer->pBudgetMutex);
+
+    return result;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Initialization : once the device exists, the renderer's objects, and
+//                    those of a first target, are created by a task graph,
+//                    so pipeline compiles overlap allocations and the scene
+//                    upload
+//
+//====----------------------------------------------------------------------====
+
+// * Threads running the graph besides the caller, at most as many as nodes
+//   that can run at once
+//
+constexpr uint32_t rendererInitThreads = 3;
+
+// * InitNode : node indices, the first target's last
+//
+typedef enum InitNode
+{
+    INIT_NODE_SCENE,
+    INIT_NODE_PIPELINE_CACHE,
+    INIT_NODE_PIPELINE_LAYOUT,
+    INIT_NODE_RENDER_PASSES,
+    INIT_NODE_GRAPHICS_PIPELINE,
+    INIT_NODE_PACK_PIPELINE,
+    INIT_NODE_TARGET_IMAGES,
+    INIT_NODE_TARGET_READBACK,
+    INIT_NODE_TARGET_FRAMEBUFFER,
+    INIT_NODE_TARGET_PACK,
+    INIT_NODE_TARGET_COMMANDS,
+    INIT_NODE_COUNT
+}
+InitNode;
+
+// * RendererInit : shared by the nodes, each of which creates its own
+//                  objects and sets only its own result
+//
+typedef struct RendererInit
+{
+    const RendererInfo* pInfo;
+    Renderer*           pRenderer;
+    RenderTarget*       pTarget;            // null : no first target
+    bool                useShaderObjects;
+
+    //  - loadScene rejects empty scenes, so whether there is one is known
+    //    before it is loaded
+    bool                hasScene;
+    VkResult            results[INIT_NODE_COUNT];
+}
+RendererInit;
+
+// * setInitResult : a node's return value
+//
+bool setInitResult(RendererInit* pInit, InitNode node, VkResult result)
+{
+    pInit->results[node] = result;
+
+    return VK_SUCCESS == result;
+}
+
+// * initScene : uploaded through the first queue before any frame uses it
+//
+bool initScene(void* pContext)
+{
+    auto const pInit     = (RendererInit*)pContext;
+    auto const pRenderer = pInit->pRenderer;
+
+    if (!pInit->hasScene) {
+        return true;
+    }
+
+    const SceneUploadInfo sceneUploadInfo = {
+        .device            = pRenderer->device,
+        .pMemoryProperties = &pRenderer->memoryProperties,
+        .queueFamilyIndex  = pRenderer->queueFamilyIndex,
+        .queue             = pRenderer->queues[0],
+        .pQueueMutex       = &pRenderer->pQueueMutexes[0],
+        .pAllocator        = pRenderer->pAllocator
+    };
+
+    auto const result = loadScene( &sceneUploadInfo, pInit->pInfo->sceneFilename,
+                                   &pRenderer->scene );
+
+    return setInitResult(pInit, INIT_NODE_SCENE, result);
+}
+
+// * initPipelineCache
+//
+bool initPipelineCache(void* pContext)
+{
+    auto const pInit     = (RendererInit*)pContext;
+    auto const pRenderer = pInit->pRenderer;
+
+    const VkPipelineCacheCreateInfo pipelineCacheInfo = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext           = nullptr,
+        .flags           = 0,
+        .initialDataSize = 0,
+        .pInitialData    = nullptr
+    };
+
+    auto const result = vkCreatePipelineCache( pRenderer->device, &pipelineCacheInfo,
+                                               pRenderer->pAllocator,
+                                               &pRenderer->pipelineCache );
+
+    return setInitResult(pInit, INIT_NODE_PIPELINE_CACHE, result);
+}
+
+// * initPipelineLayout
+//
+bool initPipelineLayout(void* pContext)
+{
+    auto const pInit     = (RendererInit*)pContext;
+    auto const pRenderer = pInit->pRenderer;
+
+    const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext                  = nullptr,
+        .flags                  = 0,
+        .setLayoutCount         = 0,
+        .pSetLayouts            = nullptr,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges    = nullptr
+    };
+
+    auto const result = vkCreatePipelineLayout( pRenderer->device, &pipelineLayoutInfo,
+                                                pRenderer->pAllocator,
+                                                &pRenderer->pipelineLayout );
+
+    return setInitResult(pInit, INIT_NODE_PIPELINE_LAYOUT, result);
+}
+
+// * initRenderPasses
+//
+bool initRenderPasses(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createRenderPasses(pInit->pRenderer, pInit->hasScene);
+
+    return setInitResult(pInit, INIT_NODE_RENDER_PASSES, result);
+}
+
+// * initGraphicsPipeline : compiled here, or on a thread of its own when
+//                          deferred
+//
+bool initGraphicsPipeline(void* pContext)
+{
+    auto const pInit     = (RendererInit*)pContext;
+    auto const pRenderer = pInit->pRenderer;
+
+    const GraphicsPipelineInfo graphicsPipelineInfo = {
+        .device         = pRenderer->device,
+        .pipelineCache  = pRenderer->pipelineCache,
+        .pipelineLayout = pRenderer->pipelineLayout,
+        .renderPass     = pRenderer->renderPass,
+        .sampleCount    = pRenderer->sampleCount,
+        .hasScene       = pInit->hasScene,
+        .pAllocator     = pRenderer->pAllocator
+    };
+
+    TRACE_BEGIN(pipelineSpan, "compile pipeline");
+
+    auto const result
+        = pInit->useShaderObjects
+        ? createPipelineStartup(&graphicsPipelineInfo, &pRenderer->pStartup)
+        : createGraphicsPipeline(&graphicsPipelineInfo, &pRenderer->graphicsPipeline);
+
+    TRACE_END(pipelineSpan);
+
+    return setInitResult(pInit, INIT_NODE_GRAPHICS_PIPELINE, result);
+}
+
+// * initPackPipeline : packed layouts only
+//
+bool initPackPipeline(void* pContext)
+{
+    auto const pInit     = (RendererInit*)pContext;
+    auto const pRenderer = pInit->pRenderer;
+
+    if (!isPackedPixelLayout(pRenderer->pixelLayout)) {
+        return true;
+    }
+
+    TRACE_BEGIN(pipelineSpan, "compile pack pipeline");
+
+    auto const result = createPackPipeline( pRenderer->device, pRenderer->pipelineCache,
+                                            pRenderer->pAllocator,
+                                            &pRenderer->packPipeline );
+
+    TRACE_END(pipelineSpan);
+
+    return setInitResult(pInit, INIT_NODE_PACK_PIPELINE, result);
+}
+
+// * initTargetImages
+//
+bool initTargetImages(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createTargetImages(pInit->pRenderer, pInit->pTarget);
+
+    return setInitResult(pInit, INIT_NODE_TARGET_IMAGES, result);
+}
+
+// * initTargetReadback
+//
+bool initTargetReadback(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createTargetReadback(pInit->pRenderer, pInit->pTarget);
+
+    return setInitResult(pInit, INIT_NODE_TARGET_READBACK, result);
+}
+
+// * initTargetFramebuffer
+//
+bool initTargetFramebuffer(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createTargetFramebuffer(pInit->pRenderer, pInit->pTarget);
+
+    return setInitResult(pInit, INIT_NODE_TARGET_FRAMEBUFFER, result);
+}
+
+// * initTargetPack
+//
+bool initTargetPack(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createTargetPackDescriptors(pInit->pRenderer, pInit->pTarget);
+
+    return setInitResult(pInit, INIT_NODE_TARGET_PACK, result);
+}
+
+// * initTargetCommands
+//
+bool initTargetCommands(void* pContext)
+{
+    auto const pInit = (RendererInit*)pContext;
+
+    auto const result = createTargetCommands(pInit->pRenderer, pInit->pTarget);
+
+    return setInitResult(pInit, INIT_NODE_TARGET_COMMANDS, result);
+}
+
+// * initializeRenderer : createRenderer, with a first target of the given
+//                        size when pTarget isn't null
+//
+VkResult initializeRenderer( const RendererInfo* pInfo,
+                             uint32_t            width,
+                             uint32_t            height,
+                             Renderer*           pRenderer,
+                             RenderTarget*       pTarget )
+{
+    Renderer     renderer         = {};
+    RenderTarget target           = {};
+    bool         useShaderObjects = false;
+
+    auto result = createRendererDevice(pInfo, &renderer, &useShaderObjects);
+
+    if (VK_SUCCESS == result && nullptr != pTarget) {
+        target = initRenderTarget(&renderer, width, height);
+    }
+
+    //  - graph
+    RendererInit init = {
+        .pInfo            = pInfo,
+        .pRenderer        = &renderer,
+        .pTarget          = (nullptr != pTarget) ? &target : nullptr,
+        .useShaderObjects = useShaderObjects,
+        .hasScene         = (nullptr != pInfo->sceneFilename)
+    };
+
+    constexpr uint32_t renderPasses = 1u << INIT_NODE_RENDER_PASSES;
+    constexpr uint32_t targetImages = 1u << INIT_NODE_TARGET_IMAGES;
+
+    TaskGraphNode nodes[] = {
+        [INIT_NODE_SCENE] = {
+            .name         = "load scene",
+            .function     = initScene,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_PIPELINE_CACHE] = {
+            .name         = "create pipeline cache",
+            .function     = initPipelineCache,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_PIPELINE_LAYOUT] = {
+            .name         = "create pipeline layout",
+            .function     = initPipelineLayout,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_RENDER_PASSES] = {
+            .name         = "create render passes",
+            .function     = initRenderPasses,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_GRAPHICS_PIPELINE] = {
+            .name         = "compile graphics pipeline",
+            .function     = initGraphicsPipeline,
+            .pContext     = &init,
+            .dependencies = (1u << INIT_NODE_PIPELINE_CACHE)
+                          | (1u << INIT_NODE_PIPELINE_LAYOUT)
+                          | renderPasses
+        },
+        [INIT_NODE_PACK_PIPELINE] = {
+            .name         = "compile pack pipeline",
+            .function     = initPackPipeline,
+            .pContext     = &init,
+            .dependencies = (1u << INIT_NODE_PIPELINE_CACHE)
+        },
+        [INIT_NODE_TARGET_IMAGES] = {
+            .name         = "allocate target images",
+            .function     = initTargetImages,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_TARGET_READBACK] = {
+            .name         = "allocate target readback",
+            .function     = initTargetReadback,
+            .pContext     = &init,
+            .dependencies = 0
+        },
+        [INIT_NODE_TARGET_FRAMEBUFFER] = {
+            .name         = "create target framebuffer",
+            .function     = initTargetFramebuffer,
+            .pContext     = &init,
+            .dependencies = renderPasses | targetImages
+        },
+        [INIT_NODE_TARGET_PACK] = {
+            .name         = "create target pack descriptors",
+            .function     = initTargetPack,
+            .pContext     = &init,
+            .dependencies = (1u << INIT_NODE_PACK_PIPELINE)
+                          | (1u << INIT_NODE_TARGET_READBACK)
+                          | targetImages
+        },
+        [INIT_NODE_TARGET_COMMANDS] = {
+            .name         = "create target commands",
+            .function     = initTargetCommands,
+            .pContext     = &init,
+            .dependencies = 0
+        }
+    };
+
+    auto const nodeCount = (nullptr != pTarget) ? (uint32_t)INIT_NODE_COUNT
+                                                : (uint32_t)INIT_NODE_TARGET_IMAGES;
+
+    //  - the caller takes part, so the graph still runs if no thread starts
+    TaskPool initPool = {};
+
+    if ( VK_SUCCESS == result &&
+         !createTaskPool(rendererInitThreads, &initPool) && !createTaskPool(0, &initPool) )
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        auto const succeededNodes = runTaskGraph(&initPool, nodes, nodeCount);
+
+        destroyTaskPool(&initPool);
+
+        //  - the first failure, in node order
+        for (uint32_t nn = 0; nn < nodeCount; ++nn)
+        {
+            if (VK_SUCCESS == result) {
+                result = init.results[nn];
+            }
+
+            if (0.0 < nodes[nn].endMs)
+            {
+                addStartupPhase( &renderer.startupTimings, nodes[nn].name,
+                                 nodes[nn].startMs, nodes[nn].endMs );
+            }
+        }
+
+        if (VK_SUCCESS == result && (1ull << nodeCount) - 1 != succeededNodes) {
+            result = VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+
+    if (VK_SUCCESS == result && nullptr != pTarget) {
+        measureTargetMemory(&renderer, &target);
+    }
+
+    renderer.startupTimings.totalMs = getTimeMs() - renderer.startupTimings.beginMs;
+
+    if (VK_SUCCESS != result)
+    {
+        if (nullptr != renderer.device) {
+            destroyRenderTarget(&renderer, &target);
+        }
+
+        destroyRenderer(&renderer);
+    }
+
+    *pRenderer = renderer;
+
+    if (nullptr != pTarget) {
+        *pTarget = target;
+    }
+
+    return result;
+}
+
+// * createRenderer
+//
+VkResult createRenderer(const RendererInfo* pInfo, Renderer* pRenderer)
+{
+    return initializeRenderer(pInfo, 0, 0, pRenderer, nullptr);
+}
+
+// * createRendererAndTarget
+//
+VkResult createRendererAndTarget( const RendererInfo* pInfo,
+                                  uint32_t            width,
+                                  uint32_t            height,
+                                  Renderer*           pRenderer,
+                                  RenderTarget*       pTarget )
+{
+    return initializeRenderer(pInfo, width, height, pRenderer, pTarget);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Frames
+//
+//====----------------------------------------------------------------------====
+
+// * writeTimestamp
+//
+void writeTimestamp( VkCommandBuffer         commandBuffer,
+                     VkPipelineStageFlagBits stage,
+                     const RenderTarget*     pTarget,
+                     uint32_t                query )
+{
+    if (nullptr != pTarget->timestampQueryPool)
+    {
+        vkCmdWriteTimestamp( commandBuffer, stage,
+                             pTarget->timestampQueryPool, query );
+    }
+}
+
+// * getTimestamps : ticks of a contiguous range of queries
+//
+bool getTimestamps( const Renderer*     pRenderer,
+                    const RenderTarget* pTarget,
+                    uint32_t            firstQuery,
+                    uint32_t            queryCount,
+                    uint64_t*           pTicks )
+{
+    auto const result = vkGetQueryPoolResults( pRenderer->device,
+                                               pTarget->timestampQueryPool,
+                                               firstQuery, queryCount,
+                                               queryCount * sizeof(uint64_t),
+                                               pTicks + firstQuery,
+                                               sizeof(uint64_t),
+                                               VK_QUERY_RESULT_64_BIT
+                                               | VK_QUERY_RESULT_WAIT_BIT );
+
+    //  - bits above timestampValidBits are undefined
+    auto const validMask = (64 <= pRenderer->timestampValidBits)
+                         ? UINT64_MAX
+                         : (1ull << pRenderer->timestampValidBits) - 1;
+
+    for (uint32_t ii = firstQuery; ii < firstQuery + queryCount; ++ii) {
+        pTicks[ii] &= validMask;
+    }
+
+    return VK_SUCCESS == result;
+}
+
+// * elapsedMs
+//
+double elapsedMs( const uint64_t* pTicks,
+                  uint32_t        first,
+                  uint32_t        last,
+                  double          msPerTick )
+{
+    return msPerTick * (double)( pTicks[last] - pTicks[first] );
+}
+
+// * hasCopyCommands : copy readback through the destination image, rather
+//                     than packed or copied by the host
+//
+bool hasCopyCommands(const Renderer* pRenderer)
+{
+    return !isPackedPixelLayout(pRenderer->pixelLayout) && !pRenderer->useHostImageCopy;
+}
+
+// * collectFrameTimings : GPU stage durations from the frame's timestamps
+//
+void collectFrameTimings( const Renderer*     pRenderer,
+                          const RenderTarget* pTarget,
+                          FrameTimings*       pTimings )
+{
+    if (nullptr == pTarget->timestampQueryPool) {
+        return;
+    }
+
+    //  - only the queries written this frame are available
+    auto const isPacked = isPackedPixelLayout(pRenderer->pixelLayout);
+    auto const hasCopy  = hasCopyCommands(pRenderer);
+
+    uint64_t ticks[TIMESTAMP_COUNT] = {};
+
+    auto const hasTimings = isPacked
+        ? getTimestamps( pRenderer, pTarget, TIMESTAMP_FRAME_BEGIN, 3, ticks )
+        : getTimestamps( pRenderer, pTarget, TIMESTAMP_FRAME_BEGIN, 2, ticks )
+          && ( !hasCopy ||
+               getTimestamps( pRenderer, pTarget, TIMESTAMP_COPY_BEGIN, 5, ticks ) );
+
+    if (!hasTimings) {
+        return;
+    }
+
+    //  - timestampPeriod is in nanoseconds per tick
+    auto const msPerTick = 1e-6 * (double)pRenderer->timestampPeriod;
+
+    pTimings->renderMs = elapsedMs( ticks, TIMESTAMP_FRAME_BEGIN,
+                                    TIMESTAMP_RENDER_END, msPerTick );
+    if (isPacked)
+    {
+        pTimings->packMs = elapsedMs( ticks, TIMESTAMP_RENDER_END,
+                                      TIMESTAMP_PACK_END, msPerTick );
+    }
+    else if (hasCopy)
+    {
+        pTimings->transitionMs = elapsedMs( ticks, TIMESTAMP_COPY_BEGIN,
+                                            TIMESTAMP_DEST_LAYOUT_END, msPerTick )
+                               + elapsedMs( ticks, TIMESTAMP_COPY_END,
+                                            TIMESTAMP_GENERAL_LAYOUT_END, msPerTick );
+
+        pTimings->copyMs = elapsedMs( ticks, TIMESTAMP_DEST_LAYOUT_END,
+                                      TIMESTAMP_COPY_END, msPerTick );
+
+        pTimings->previewMs = elapsedMs( ticks, TIMESTAMP_GENERAL_LAYOUT_END,
+                                         TIMESTAMP_PREVIEW_END, msPerTick );
+    }
+
+    pTimings->gpuMs = pTimings->renderMs + pTimings->packMs
+                    + pTimings->transitionMs + pTimings->copyMs
+                    + pTimings->previewMs;
+
+    pTimings->hasGPUTimings = true;
+}
+
+// * Background of every frame, and of damage before it is redrawn
+//
+const VkClearColorValue frameClearColor = { .float32 = { 0.1f, 0.0f, 0.1f, 1.0f } };
+
+// * beginShaderObjectRendering : dynamic rendering, which shader objects
+//                                draw within, in place of the render pass.
+//                                Barriers stand in for its layouts and
+//                                dependencies. isDamage keeps the previous
+//                                frame outside the render area, as the
+//                                damage render pass does. See
+//                                createRenderPasses
+//
+void beginShaderObjectRendering( VkCommandBuffer     commandBuffer,
+                                 const Renderer*     pRenderer,
+                                 const RenderTarget* pTarget,
+                                 VkRect2D            renderArea,
+                                 bool                isDamage,
+                                 VkRenderingFlags    flags )
+{
+    auto const pStartup       = pRenderer->pStartup;
+    auto const isPacked       = isPackedPixelLayout(pRenderer->pixelLayout);
+    auto const isMultisampled = (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount);
+    auto const hasScene       = pStartup->pipelineInfo.hasScene;
+
+    //  - layouts : the render image is kept from the previous frame's
+    //    readback when damaged, and the samples never are
+    auto const readbackStage  = isPacked ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                         : VK_PIPELINE_STAGE_TRANSFER_BIT;
+    auto const readbackLayout = isPacked ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                         : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    const VkImageMemoryBarrier imageBarriers[] = {
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                                 | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .oldLayout           = isDamage ? readbackLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = pTarget->image,
+            .subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+        },
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                                 | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = pTarget->msaaImage,
+            .subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+        }
+    };
+
+    //  - scene : uploaded to the vertex buffer before the draws read it
+    const VkMemoryBarrier sceneBarrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+    };
+
+    auto const srcStageMask = (isDamage ? readbackStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+                            | (hasScene ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0);
+    auto const dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                            | (hasScene ? VK_PIPELINE_STAGE_VERTEX_INPUT_BIT : 0);
+
+    vkCmdPipelineBarrier( commandBuffer, srcStageMask, dstStageMask, 0,
+                          hasScene ? 1 : 0, &sceneBarrier,
+                          0, nullptr,
+                          isMultisampled ? 2 : 1, imageBarriers );
+
+    //  - attachment : the samples, if any, resolved into the image.
+    //    Single-sampled damage loads the previous frame
+    const VkRenderingAttachmentInfo colorAttachment = {
+        .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext              = nullptr,
+        .imageView          = isMultisampled ? pTarget->msaaImageView : pTarget->imageView,
+        .imageLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .resolveMode        = isMultisampled ? VK_RESOLVE_MODE_AVERAGE_BIT
+                                             : VK_RESOLVE_MODE_NONE,
+        .resolveImageView   = isMultisampled ? pTarget->imageView : nullptr,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp             = (isDamage && !isMultisampled) ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                                            : VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp            = isMultisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+                                             : VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue         = { .color = frameClearColor }
+    };
+
+    const VkRenderingInfo renderingInfo = {
+        .sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext                = nullptr,
+        .flags                = flags,
+        .renderArea           = renderArea,
+        .layerCount           = 1,
+        .viewMask             = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments    = &colorAttachment,
+        .pDepthAttachment     = nullptr,
+        .pStencilAttachment   = nullptr
+    };
+
+    pStartup->pfnCmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+// * endShaderObjectRendering : and leaves the render image for its
+//                              readback, as the render pass would
+//
+void endShaderObjectRendering( VkCommandBuffer     commandBuffer,
+                               const Renderer*     pRenderer,
+                               const RenderTarget* pTarget )
+{
+    auto const isPacked = isPackedPixelLayout(pRenderer->pixelLayout);
+
+    pRenderer->pStartup->pfnCmdEndRendering(commandBuffer);
+
+    const VkImageMemoryBarrier imageBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                             | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask       = isPacked ? VK_ACCESS_SHADER_READ_BIT
+                             : pRenderer->useHostImageCopy ? VK_ACCESS_HOST_READ_BIT
+                                                         : VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .newLayout           = isPacked ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                        : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = pTarget->image,
+        .subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+    };
+
+    auto const dstStageMask = isPacked ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                            : pRenderer->useHostImageCopy ? VK_PIPELINE_STAGE_HOST_BIT
+                                                        : VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                          dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier );
+}
+
+// * bindDrawState : pipeline, viewport and scene. Returns the instance
+//                   count of a draw. graphicsPipeline is that of
+//                   getGraphicsPipeline when the recording began, null for
+//                   shader objects
+//
+uint32_t bindDrawState( VkCommandBuffer     commandBuffer,
+                        const Renderer*     pRenderer,
+                        const RenderTarget* pTarget,
+                        VkPipeline          graphicsPipeline )
+{
+    const VkViewport viewport = {
+        .x        = 0.0f,
+        .y        = 0.0f,
+        .width    = (float)pTarget->width,
+        .height   = (float)pTarget->height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+
+    //  - pipeline and viewport, or shader objects until a deferred
+    //    pipeline is compiled
+    if (nullptr != graphicsPipeline)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    }
+    else
+    {
+        bindShaderObjects(commandBuffer, pRenderer->pStartup, pTarget, &viewport);
+    }
+
+    //  - scene : one instance per rectangle
+    auto instanceCount = 1u;
+
+    if (nullptr != pRenderer->scene.buffer)
+    {
+        const VkDeviceSize offset = 0;
+
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &pRenderer->scene.buffer, &offset);
+
+        instanceCount = pRenderer->scene.rectCount;
+    }
+
+    return instanceCount;
+}
+
+// * recordDraws : draws firstDraw up to endDraw of the square, or of every
+//                 scene rectangle, each scissored to its band of rows. The
+//                 bands partition the target, so any draw count renders
+//                 the same image. Bands may be empty when there are more
+//                 draws than rows
+//
+void recordDraws( VkCommandBuffer     commandBuffer,
+                  const Renderer*     pRenderer,
+                  const RenderTarget* pTarget,
+                  VkPipeline          graphicsPipeline,
+                  uint32_t            firstDraw,
+                  uint32_t            endDraw )
+{
+    auto const instanceCount
+        = bindDrawState(commandBuffer, pRenderer, pTarget, graphicsPipeline);
+
+    //  - draws
+    auto const drawCount = (uint64_t)pRenderer->drawCount;
+
+    for (uint32_t dd = firstDraw; dd < endDraw; ++dd)
+    {
+        auto const top    = (uint32_t)( dd * (uint64_t)pTarget->height / drawCount );
+        auto const bottom = (uint32_t)( (dd + 1) * (uint64_t)pTarget->height / drawCount );
+
+        const VkRect2D scissor = {
+            .offset = { 0, (int32_t)top },
+            .extent = { pTarget->width, bottom - top }
+        };
+
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        vkCmdDraw(commandBuffer, 4, instanceCount, 0, 0);
+    }
+}
+
+// * SecondaryRecording : the draws of one frame, split between recording
+//                        tasks
+//
+typedef struct SecondaryRecording
+{
+    const Renderer*     pRenderer;
+    const RenderTarget* pTarget;
+    VkPipeline          graphicsPipeline;   // null within dynamic rendering
+    VkResult            results[rendererMaxRecordThreads];
+}
+SecondaryRecording;
+
+// * recordSecondaryTask : records the task's share of the draws into its
+//                         own secondary command buffer
+//
+void recordSecondaryTask(void* pContext, uint32_t taskIndex)
+{
+    auto const pRecording = (SecondaryRecording*)pContext;
+    auto const pRenderer  = pRecording->pRenderer;
+    auto const pTarget    = pRecording->pTarget;
+
+    auto const commandBuffer = pTarget->secondaryCommandBuffers[taskIndex];
+
+    //  - the previous frame on this target has completed
+    auto result = vkResetCommandPool( pRenderer->device,
+                                      pTarget->secondaryCommandPools[taskIndex], 0 );
+
+    //  - inheritance : the render pass, or for shader objects the
+    //    attachment of the dynamic rendering
+    auto const graphicsPipeline = pRecording->graphicsPipeline;
+
+    const VkCommandBufferInheritanceRenderingInfo renderingInfo = {
+        .sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .pNext                   = nullptr,
+        .flags                   = 0,
+        .viewMask                = 0,
+        .colorAttachmentCount    = 1,
+        .pColorAttachmentFormats = &pRenderer->colorFormat,
+        .depthAttachmentFormat   = VK_FORMAT_UNDEFINED,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples    = pRenderer->sampleCount
+    };
+
+    const VkCommandBufferInheritanceInfo inheritanceInfo = {
+        .sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext                = (nullptr != graphicsPipeline) ? nullptr : &renderingInfo,
+        .renderPass           = (nullptr != graphicsPipeline) ? pRenderer->renderPass
+                                                              : nullptr,
+        .subpass              = 0,
+        .framebuffer          = (nullptr != graphicsPipeline) ? pTarget->framebuffer
+                                                              : nullptr,
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags           = 0,
+        .pipelineStatistics   = 0
+    };
+
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                          | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo
+    };
+
+    if (VK_SUCCESS == result) {
+        result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        auto const taskCount = (uint64_t)pRenderer->recordThreadCount;
+        auto const drawCount = (uint64_t)pRenderer->drawCount;
+
+        recordDraws( commandBuffer, pRenderer, pTarget, graphicsPipeline,
+                     (uint32_t)( taskIndex * drawCount / taskCount ),
+                     (uint32_t)( (taskIndex + 1) * drawCount / taskCount ) );
+
+        result = vkEndCommandBuffer(commandBuffer);
+    }
+
+    pRecording->results[taskIndex] = result;
+}
+
+// * recordRenderCommands
+//
+VkResult recordRenderCommands(const Renderer* pRenderer, const RenderTarget* pTarget)
+{
+    auto const commandBuffer = pTarget->renderCommandBuffer;
+
+    //  - begin
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
+    };
+
+    auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //  - timestamps : the whole pool is reset before the first is written
+    if (nullptr != pTarget->timestampQueryPool)
+    {
+        vkCmdResetQueryPool( commandBuffer, pTarget->timestampQueryPool,
+                             0, TIMESTAMP_COUNT );
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_FRAME_BEGIN );
+
+    //  - render pass : the clear value of a multisampled frame is its
+    //    samples'
+    const VkClearValue clearValues[] = {
+        { .color = frameClearColor },
+        { .color = frameClearColor }
+    };
+
+    const VkRenderPassBeginInfo renderPassBeginInfo = {
+        .sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext       = nullptr,
+        .renderPass  = pRenderer->renderPass,
+        .framebuffer = pTarget->framebuffer,
+        .renderArea  = {
+            .offset = { 0, 0 },
+            .extent = { pTarget->width, pTarget->height }
+        },
+        .clearValueCount = ARRAY_LENGTH(clearValues),
+        .pClearValues    = clearValues
+    };
+
+    //  - pipeline : chosen once, as shader objects draw within dynamic
+    //    rendering rather than the render pass
+    auto const graphicsPipeline = getGraphicsPipeline(pRenderer);
+
+    //  - draws : inline, or executed from secondary command buffers the
+    //    recording threads fill in parallel
+    if (0 == pRenderer->recordThreadCount)
+    {
+        if (nullptr != graphicsPipeline)
+        {
+            vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo,
+                                  VK_SUBPASS_CONTENTS_INLINE );
+        }
+        else
+        {
+            beginShaderObjectRendering( commandBuffer, pRenderer, pTarget,
+                                        renderPassBeginInfo.renderArea, false, 0 );
+        }
+
+        recordDraws( commandBuffer, pRenderer, pTarget, graphicsPipeline,
+                     0, pRenderer->drawCount );
+    }
+    else
+    {
+        SecondaryRecording recording = {
+            .pRenderer        = pRenderer,
+            .pTarget          = pTarget,
+            .graphicsPipeline = graphicsPipeline
+        };
+
+        runTasks( pTarget->pRecordPool, pRenderer->recordThreadCount,
+                  recordSecondaryTask, &recording );
+
+        for (uint32_t tt = 0; tt < pRenderer->recordThreadCount; ++tt)
+        {
+            if (VK_SUCCESS != recording.results[tt]) {
+                result = recording.results[tt];
+            }
+        }
+
+        if (VK_SUCCESS != result)
+        {
+            vkEndCommandBuffer(commandBuffer);
+            return result;
+        }
+
+        if (nullptr != graphicsPipeline)
+        {
+            vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo,
+                                  VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+        }
+        else
+        {
+            beginShaderObjectRendering( commandBuffer, pRenderer, pTarget,
+                                        renderPassBeginInfo.renderArea, false,
+                                        VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT );
+        }
+
+        vkCmdExecuteCommands( commandBuffer, pRenderer->recordThreadCount,
+                              pTarget->secondaryCommandBuffers );
+    }
+
+    //  - end
+    if (nullptr != graphicsPipeline)
+    {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+    else
+    {
+        endShaderObjectRendering(commandBuffer, pRenderer, pTarget);
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_RENDER_END );
+
+    //  - pack
+    if (isPackedPixelLayout(pRenderer->pixelLayout))
+    {
+        recordPackCommands( commandBuffer, &pRenderer->packPipeline,
+                            pTarget->packDescriptorSet, pTarget->packBuffer,
+                            pRenderer->pixelLayout,
+                            pTarget->width, pTarget->height );
+
+        writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        pTarget, TIMESTAMP_PACK_END );
+    }
+
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+// * boundDamage : bounds of one or more rectangles
+//
+VkRect2D boundDamage(const VkRect2D* pDamage, uint32_t damageCount)
+{
+    auto bounds = pDamage[0];
+
+    for (uint32_t dd = 1; dd < damageCount; ++dd)
+    {
+        auto const pRect = &pDamage[dd];
+
+        auto const right      = bounds.offset.x + bounds.extent.width;
+        auto const bottom     = bounds.offset.y + bounds.extent.height;
+        auto const rectRight  = pRect->offset.x + pRect->extent.width;
+        auto const rectBottom = pRect->offset.y + pRect->extent.height;
+
+        bounds.offset.x = (pRect->offset.x < bounds.offset.x) ? pRect->offset.x
+                                                              : bounds.offset.x;
+        bounds.offset.y = (pRect->offset.y < bounds.offset.y) ? pRect->offset.y
+                                                              : bounds.offset.y;
+        bounds.extent.width  = ( (right < rectRight) ? rectRight : right )
+                             - bounds.offset.x;
+        bounds.extent.height = ( (bottom < rectBottom) ? rectBottom : bottom )
+                             - bounds.offset.y;
+    }
+
+    return bounds;
+}
+
+// * recordDamageCommands : loads the previous frame and, for each damaged
+//                          rectangle in turn, clears it and redraws every
+//                          draw scissored to it. Clears and draws execute in
+//                          rasterization order, so overlapping damage is
+//                          simply redrawn
+//
+VkResult recordDamageCommands( const Renderer*     pRenderer,
+                               const RenderTarget* pTarget,
+                               const VkRect2D*     pDamage,
+                               uint32_t            damageCount )
+{
+    auto const commandBuffer = pTarget->renderCommandBuffer;
+
+    //  - begin
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
+    };
+
+    auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    if (nullptr != pTarget->timestampQueryPool)
+    {
+        vkCmdResetQueryPool( commandBuffer, pTarget->timestampQueryPool,
+                             0, TIMESTAMP_COUNT );
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_FRAME_BEGIN );
+
+    //  - render pass : over the bounds of the damage only. Multisampled
+    //    frames clear their samples
+    const VkClearValue clearValues[] = {
+        { .color = frameClearColor },
+        { .color = frameClearColor }
+    };
+
+    const VkRenderPassBeginInfo renderPassBeginInfo = {
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext           = nullptr,
+        .renderPass      = pRenderer->damageRenderPass,
+        .framebuffer     = pTarget->framebuffer,
+        .renderArea      = boundDamage(pDamage, damageCount),
+        .clearValueCount = ARRAY_LENGTH(clearValues),
+        .pClearValues    = clearValues
+    };
+
+    auto const graphicsPipeline = getGraphicsPipeline(pRenderer);
+
+    if (nullptr != graphicsPipeline)
+    {
+        vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo,
+                              VK_SUBPASS_CONTENTS_INLINE );
+    }
+    else
+    {
+        beginShaderObjectRendering( commandBuffer, pRenderer, pTarget,
+                                    renderPassBeginInfo.renderArea, true, 0 );
+    }
+
+    auto const instanceCount
+        = bindDrawState(commandBuffer, pRenderer, pTarget, graphicsPipeline);
+
+    //  - damage
+    const VkClearAttachment clearAttachment = {
+        .aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT,
+        .colorAttachment = 0,
+        .clearValue      = { .color = frameClearColor }
+    };
+
+    for (uint32_t dd = 0; dd < damageCount; ++dd)
+    {
+        const VkClearRect clearRect = {
+            .rect           = pDamage[dd],
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        };
+
+        vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+
+        vkCmdSetScissor(commandBuffer, 0, 1, &pDamage[dd]);
+        vkCmdDraw(commandBuffer, 4, instanceCount, 0, 0);
+    }
+
+    //  - end
+    if (nullptr != graphicsPipeline)
+    {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+    else
+    {
+        endShaderObjectRendering(commandBuffer, pRenderer, pTarget);
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_RENDER_END );
+
+    //  - pack : the whole frame, as the packed layout has no region form
+    if (isPackedPixelLayout(pRenderer->pixelLayout))
+    {
+        recordPackCommands( commandBuffer, &pRenderer->packPipeline,
+                            pTarget->packDescriptorSet, pTarget->packBuffer,
+                            pRenderer->pixelLayout,
+                            pTarget->width, pTarget->height );
+
+        writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        pTarget, TIMESTAMP_PACK_END );
+    }
+
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+// * recordPreviewCommands : blits each mip level from the one above it,
+//                           starting from the frame in level 0, and copies
+//                           the selected levels to the preview buffer
+//
+void recordPreviewCommands( VkCommandBuffer     commandBuffer,
+                            const Renderer*     pRenderer,
+                            const RenderTarget* pTarget )
+{
+    VkBufferImageCopy previewCopies[rendererMaxMipLevels];
+    uint32_t          previewCopyCount = 0;
+
+    for (uint32_t level = 1; level < pTarget->mipLevels; ++level)
+    {
+        const VkImageSubresourceRange levelRange = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = level,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        };
+
+        //  - level to transfer destination, discarding the last frame's
+        const VkImageMemoryBarrier destBarrier = {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = pTarget->image,
+            .subresourceRange    = levelRange
+        };
+
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0, 0, nullptr, 0, nullptr,
+                              1, &destBarrier );
+
+        //  - blit from the level above
+        auto const sourceWidth  = (1 < (pTarget->width >> (level - 1)))
+                                ? (int32_t)(pTarget->width >> (level - 1)) : 1;
+        auto const sourceHeight = (1 < (pTarget->height >> (level - 1)))
+                                ? (int32_t)(pTarget->height >> (level - 1)) : 1;
+        auto const levelWidth   = (1 < sourceWidth / 2) ? sourceWidth / 2 : 1;
+        auto const levelHeight  = (1 < sourceHeight / 2) ? sourceHeight / 2 : 1;
+
+        const VkImageBlit blit = {
+            .srcSubresource = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level - 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .srcOffsets     = { { 0, 0, 0 }, { sourceWidth, sourceHeight, 1 } },
+            .dstSubresource = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .dstOffsets     = { { 0, 0, 0 }, { levelWidth, levelHeight, 1 } }
+        };
+
+        vkCmdBlitImage( commandBuffer,
+                        pTarget->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        pTarget->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1, &blit, pRenderer->previewFilter );
+
+        //  - level to transfer source, for the next blit and its copy
+        const VkImageMemoryBarrier sourceBarrier = {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = pTarget->image,
+            .subresourceRange    = levelRange
+        };
+
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0, 0, nullptr, 0, nullptr,
+                              1, &sourceBarrier );
+
+        //  - copy, if selected
+        if (IS_FLAG_SET(pTarget->previewLevels, 1u << level))
+        {
+            previewCopies[previewCopyCount++] = (VkBufferImageCopy){
+                .bufferOffset      = pTarget->previewOffsets[level],
+                .bufferRowLength   = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource  = {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = level,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1
+                },
+                .imageOffset = { 0, 0, 0 },
+                .imageExtent = { (uint32_t)levelWidth, (uint32_t)levelHeight, 1 }
+            };
+        }
+    }
+
+    vkCmdCopyImageToBuffer( commandBuffer,
+                            pTarget->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            pTarget->previewBuffer,
+                            previewCopyCount, previewCopies );
+
+    //  - previews to the host
+    const VkBufferMemoryBarrier hostBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = pTarget->previewBuffer,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE
+    };
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &hostBarrier, 0, nullptr );
+}
+
+// * recordCopyCommands : copies only the given regions of the render image,
+//                        and renders the previews if asked. The rest of the
+//                        destination image is undefined
+//
+VkResult recordCopyCommands( const Renderer*     pRenderer,
+                             const RenderTarget* pTarget,
+                             const VkRect2D*     pRegions,
+                             uint32_t            regionCount,
+                             bool                recordPreviews )
+{
+    auto const commandBuffer = pTarget->copyCommandBuffer;
+
+    //  - begin
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
+    };
+
+    auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_COPY_BEGIN );
+
+    //  - transition destination image to transfer destination layout
+    const VkImageMemoryBarrier destLayoutBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = 0,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = 0,
+        .dstQueueFamilyIndex = 0,
+        .image               = pTarget->destImage,
+        .subresourceRange = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        }
+    };
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr,
+                          1, &destLayoutBarrier );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    pTarget, TIMESTAMP_DEST_LAYOUT_END );
+
+    //  - copy image
+    VkImageCopy imageCopies[regionCount];
+
+    for (uint32_t rr = 0; rr < regionCount; ++rr)
+    {
+        auto const pRegion = &pRegions[rr];
+
+        imageCopies[rr] = (VkImageCopy){
+            .srcSubresource = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = 0,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .srcOffset      = { .x = pRegion->offset.x, .y = pRegion->offset.y, .z = 0 },
+            .dstSubresource = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = 0,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .dstOffset = { .x = pRegion->offset.x, .y = pRegion->offset.y, .z = 0 },
+            .extent    = { pRegion->extent.width, pRegion->extent.height, 1 }
+        };
+    }
+
+    vkCmdCopyImage( commandBuffer,
+                    pTarget->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    pTarget->destImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    regionCount, imageCopies );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    pTarget, TIMESTAMP_COPY_END );
+
+    //  - transition destination image to general layout
+    const VkImageMemoryBarrier generalLayoutBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = 0,
+        .dstQueueFamilyIndex = 0,
+        .image               = pTarget->destImage,
+        .subresourceRange = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        }
+    };
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr,
+                          1, &generalLayoutBarrier );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_GENERAL_LAYOUT_END );
+
+    //  - previews
+    if (recordPreviews && 0 != pTarget->previewLevels) {
+        recordPreviewCommands(commandBuffer, pRenderer, pTarget);
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_PREVIEW_END );
+
+    //  - end
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+// * readbackColorFormat
+//
+VkFormat readbackColorFormat(const Renderer* pRenderer)
+{
+    if (isPackedPixelLayout(pRenderer->pixelLayout)) {
+        return packedPixelFormat(pRenderer->pixelLayout);
+    }
+
+    //  - BGRA is swizzled back to RGBA as it is read back
+    return (VK_FORMAT_B8G8R8A8_UNORM == pRenderer->colorFormat) ? VK_FORMAT_R8G8B8A8_UNORM
+                                                                : pRenderer->colorFormat;
+}
+
+// * readBackPreviews : copy each selected preview level out of the preview
+//                      buffer into an image context of its own
+//
+VkResult readBackPreviews( const Renderer*     pRenderer,
+                           const RenderTarget* pTarget,
+                           ImageContext*       pImageContext )
+{
+    auto const previewCount = stdc_count_ones(pTarget->previewLevels);
+
+    auto pPreviews = (ImageContext*)calloc(previewCount, sizeof(ImageContext));
+
+    if (nullptr == pPreviews) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    //  - map memory
+    uint8_t* pData = nullptr;
+
+    auto result = vkMapMemory( pRenderer->device, pTarget->previewBufferMemory,
+                               0, VK_WHOLE_SIZE, 0, (void**)&pData );
+    if (VK_SUCCESS != result)
+    {
+        free(pPreviews);
+        return result;
+    }
+
+    //  - copy each level, largest first, swizzling BGRA as the frame is
+    auto const isBGRA        = (VK_FORMAT_B8G8R8A8_UNORM == pRenderer->colorFormat);
+    auto const bytesPerPixel = (VkDeviceSize)formatBytesPerPixel(pRenderer->colorFormat);
+
+    uint32_t readCount = 0;
+
+    for (uint32_t level = 1; level < pTarget->mipLevels; ++level)
+    {
+        if (!IS_FLAG_SET(pTarget->previewLevels, 1u << level)) {
+            continue;
+        }
+
+        auto const levelWidth  = (1 < (pTarget->width >> level)) ? (pTarget->width >> level) : 1;
+        auto const levelHeight = (1 < (pTarget->height >> level)) ? (pTarget->height >> level) : 1;
+        auto const bytesPerRow = bytesPerPixel * levelWidth;
+        auto const pSource     = pData + pTarget->previewOffsets[level];
+
+        ImageContext preview = {
+            .width            = levelWidth,
+            .height           = levelHeight,
+            .bytesPerRow      = bytesPerRow,
+            .colorPixelFormat = pImageContext->colorPixelFormat,
+            .pixelLayout      = pImageContext->pixelLayout,
+            .data             = malloc(bytesPerRow * levelHeight)
+        };
+
+        if (nullptr == preview.data)
+        {
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+            break;
+        }
+
+        if (isBGRA)
+        {
+            transformRows( getPixelKernels()->swizzleRGBA8,
+                           preview.data, bytesPerRow,
+                           pSource, bytesPerRow,
+                           levelWidth, levelHeight );
+        }
+        else {
+            memcpy(preview.data, pSource, bytesPerRow * levelHeight);
+        }
+
+        pPreviews[readCount++] = preview;
+    }
+
+    vkUnmapMemory(pRenderer->device, pTarget->previewBufferMemory);
+
+    if (VK_SUCCESS != result)
+    {
+        for (uint32_t pp = 0; pp < readCount; ++pp) {
+            disposeImageContext(&pPreviews[pp]);
+        }
+
+        free(pPreviews);
+        return result;
+    }
+
+    pImageContext->pPreviews    = pPreviews;
+    pImageContext->previewCount = readCount;
+
+    return VK_SUCCESS;
+}
+
+// * copyRenderImageToHost : host image copy of the given regions of the
+//                           render image straight into the image context's
+//                           rows, at the same offsets
+//
+VkResult copyRenderImageToHost( const Renderer*     pRenderer,
+                                const RenderTarget* pTarget,
+                                const VkRect2D*     pRegions,
+                                uint32_t            regionCount,
+                                ImageContext*       pImageContext )
+{
+    auto const bytesPerPixel = (size_t)formatBytesPerPixel(pImageContext->colorPixelFormat);
+    auto const bytesPerRow   = (size_t)pImageContext->bytesPerRow;
+
+    VkImageToMemoryCopy copies[regionCount];
+
+    for (uint32_t rr = 0; rr < regionCount; ++rr)
+    {
+        auto const pRegion = &pRegions[rr];
+
+        copies[rr] = (VkImageToMemoryCopy){
+            .sType             = VK_STRUCTURE_TYPE_IMAGE_TO_MEMORY_COPY,
+            .pNext             = nullptr,
+            .pHostPointer      = pImageContext->data
+                               + (size_t)pRegion->offset.y * bytesPerRow
+                               + (size_t)pRegion->offset.x * bytesPerPixel,
+            .memoryRowLength   = (uint32_t)(bytesPerRow / bytesPerPixel),
+            .memoryImageHeight = 0,
+            .imageSubresource  = {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = 0,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            },
+            .imageOffset = { .x = pRegion->offset.x, .y = pRegion->offset.y, .z = 0 },
+            .imageExtent = { pRegion->extent.width, pRegion->extent.height, 1 }
+        };
+    }
+
+    const VkCopyImageToMemoryInfo copyInfo = {
+        .sType          = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_MEMORY_INFO,
+        .pNext          = nullptr,
+        .flags          = 0,
+        .srcImage       = pTarget->image,
+        .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .regionCount    = regionCount,
+        .pRegions       = copies
+    };
+
+    return pRenderer->pfnCopyImageToMemory(pRenderer->device, &copyInfo);
+}
+
+// * readBackFrame : copy the readback memory into a host allocated buffer
+//
+VkResult readBackFrame( const Renderer*     pRenderer,
+                        const RenderTarget* pTarget,
+                        ImageContext*       pImageContext )
+{
+    //  - host image copy : tightly packed rows, straight from the render image
+    if (pRenderer->useHostImageCopy)
+    {
+        auto const bytesPerRow
+            = (VkDeviceSize)formatBytesPerPixel(pRenderer->colorFormat) * pTarget->width;
+
+        ImageContext imageContext = {
+            .width            = pTarget->width,
+            .height           = pTarget->height,
+            .bytesPerRow      = bytesPerRow,
+            .colorPixelFormat = readbackColorFormat(pRenderer),
+            .pixelLayout      = pRenderer->pixelLayout,
+            .data             = malloc(bytesPerRow * pTarget->height)
+        };
+
+        if (nullptr == imageContext.data) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+
+        const VkRect2D frameRegion = {
+            .offset = { 0, 0 },
+            .extent = { pTarget->width, pTarget->height }
+        };
+
+        auto const result = copyRenderImageToHost( pRenderer, pTarget, &frameRegion, 1,
+                                                   &imageContext );
+        if (VK_SUCCESS != result)
+        {
+            disposeImageContext(&imageContext);
+            return result;
+        }
+
+        *pImageContext = imageContext;
+
+        return VK_SUCCESS;
+    }
+
+    auto const isPacked = isPackedPixelLayout(pRenderer->pixelLayout);
+
+    auto const memory = isPacked ? pTarget->packBufferMemory
+                                 : pTarget->destImageMemory;
+
+    auto const offset      = isPacked ? 0 : pTarget->destImageLayout.offset;
+    auto const bytesPerRow = isPacked ? pTarget->packBytesPerRow
+                                      : pTarget->destImageLayout.rowPitch;
+
+    //  - map memory
+    uint8_t* pData = nullptr;
+
+    auto const result = vkMapMemory( pRenderer->device, memory, 0, VK_WHOLE_SIZE,
+                                     0, (void**)&pData );
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    pData += offset;
+
+    //  - copy to local buffer. BGRA rows are swizzled to RGBA as they are
+    //    streamed out of the mapped image
+    auto const dataSize = (size_t)pTarget->height * bytesPerRow;
+    auto const isBGRA   = (VK_FORMAT_B8G8R8A8_UNORM == pRenderer->colorFormat);
+
+    ImageContext imageContext = {
+        .width            = pTarget->width,
+        .height           = pTarget->height,
+        .bytesPerRow      = bytesPerRow,
+        .colorPixelFormat = readbackColorFormat(pRenderer),
+        .pixelLayout      = pRenderer->pixelLayout,
+        .data             = malloc(dataSize)
+    };
+
+    if (nullptr != imageContext.data)
+    {
+        if (!isPacked && isBGRA)
+        {
+            transformRows( getPixelKernels()->swizzleRGBA8,
+                           imageContext.data, bytesPerRow,
+                           pData, bytesPerRow,
+                           pTarget->width, pTarget->height );
+        }
+        else {
+            memcpy(imageContext.data, pData, dataSize);
+        }
+    }
+
+    vkUnmapMemory(pRenderer->device, memory);
+
+    if (nullptr == imageContext.data) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    //  - previews
+    if (0 != pTarget->previewLevels)
+    {
+        auto const previewResult = readBackPreviews(pRenderer, pTarget, &imageContext);
+
+        if (VK_SUCCESS != previewResult)
+        {
+            disposeImageContext(&imageContext);
+            return previewResult;
+        }
+    }
+
+    *pImageContext = imageContext;
+
+    return VK_SUCCESS;
+}
+
+// * readBackRegions : copy only the given rectangles of the readback memory
+//                     into the image context's buffer, at the same offsets
+//
+VkResult readBackRegions( const Renderer*     pRenderer,
+                          const RenderTarget* pTarget,
+                          const VkRect2D*     pRegions,
+                          uint32_t            regionCount,
+                          ImageContext*       pImageContext )
+{
+    if (pRenderer->useHostImageCopy)
+    {
+        return copyRenderImageToHost( pRenderer, pTarget, pRegions, regionCount,
+                                      pImageContext );
+    }
+
+    auto const isPacked = isPackedPixelLayout(pRenderer->pixelLayout);
+
+    auto const memory = isPacked ? pTarget->packBufferMemory
+                                 : pTarget->destImageMemory;
+
+    auto const offset      = isPacked ? 0 : pTarget->destImageLayout.offset;
+    auto const bytesPerRow = isPacked ? pTarget->packBytesPerRow
+                                      : pTarget->destImageLayout.rowPitch;
+
+    //  - map memory
+    uint8_t* pData = nullptr;
+
+    auto const result = vkMapMemory( pRenderer->device, memory, 0, VK_WHOLE_SIZE,
+                                     0, (void**)&pData );
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    pData += offset;
+
+    //  - copy each rectangle's span of its rows, swizzling BGRA as the
+    //    whole frame would be
+    auto const isBGRA        = (VK_FORMAT_B8G8R8A8_UNORM == pRenderer->colorFormat);
+    auto const bytesPerPixel = (size_t)formatBytesPerPixel(pImageContext->colorPixelFormat);
+
+    for (uint32_t dd = 0; dd < regionCount; ++dd)
+    {
+        auto const pRect      = &pRegions[dd];
+        auto const spanOffset = (size_t)pRect->offset.x * bytesPerPixel;
+
+        auto const pSource = pData + (size_t)pRect->offset.y * bytesPerRow + spanOffset;
+        auto const pDest   = pImageContext->data
+                           + (size_t)pRect->offset.y * pImageContext->bytesPerRow
+                           + spanOffset;
+
+        if (!isPacked && isBGRA)
+        {
+            transformRows( getPixelKernels()->swizzleRGBA8,
+                           pDest, pImageContext->bytesPerRow,
+                           pSource, bytesPerRow,
+                           pRect->extent.width, pRect->extent.height );
+        }
+        else
+        {
+            for (uint32_t yy = 0; yy < pRect->extent.height; ++yy)
+            {
+                memcpy( pDest + yy * pImageContext->bytesPerRow,
+                        pSource + yy * bytesPerRow,
+                        pRect->extent.width * bytesPerPixel );
+            }
+        }
+    }
+
+    vkUnmapMemory(pRenderer->device, memory);
+
+    return VK_SUCCESS;
+}
+
+// * renderFrameBatch
+//
+VkResult renderFrameBatch( Renderer*            pRenderer,
+                           RenderTarget* const* ppTargets,
+                           uint32_t             frameCount,
+                           ImageContext*        pImageContexts,
+                           FrameTimings*        pTimings )
+{
+    if (0 == frameCount) {
+        return VK_SUCCESS;
+    }
+
+    auto const hasCopy = hasCopyCommands(pRenderer);
+
+    //====------------------------------------------------------------------====
+    // * Record : the subpass dependency orders each copy after its render
+    //            pass, so render and copy share one submit info
+
+    VkCommandBuffer commandBuffers[2*frameCount];
+    VkSubmitInfo    submitInfos[frameCount];
+    double          recordMs[frameCount];
+
+    auto result = VK_SUCCESS;
+
+    TRACE_BEGIN(recordSpan, "record commands");
+
+    for (uint32_t ff = 0; ff < frameCount && VK_SUCCESS == result; ++ff)
+    {
+        auto const pTarget     = ppTargets[ff];
+        auto const recordStart = getTimeMs();
+
+        result = recordRenderCommands(pRenderer, pTarget);
+
+        const VkRect2D frameRegion = {
+            .offset = { 0, 0 },
+            .extent = { pTarget->width, pTarget->height }
+        };
+
+        if (VK_SUCCESS == result && hasCopy) {
+            result = recordCopyCommands(pRenderer, pTarget, &frameRegion, 1, true);
+        }
+
+        recordMs[ff] = getTimeMs() - recordStart;
+
+        commandBuffers[2*ff + 0] = pTarget->renderCommandBuffer;
+        commandBuffers[2*ff + 1] = pTarget->copyCommandBuffer;
+
+        submitInfos[ff] = (VkSubmitInfo){
+            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext                = nullptr,
+            .waitSemaphoreCount   = 0,
+            .pWaitSemaphores      = nullptr,
+            .pWaitDstStageMask    = nullptr,
+            .commandBufferCount   = hasCopy ? 2 : 1,
+            .pCommandBuffers      = &commandBuffers[2*ff],
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores    = nullptr
+        };
+    }
+
+    TRACE_END(recordSpan);
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //====------------------------------------------------------------------====
+    // * Submit every frame at once and wait for the batch to complete
+
+    auto const queueIndex = ppTargets[0]->queueIndex;
+
+    result = submitAndWait( pRenderer->device, pRenderer->queues[queueIndex],
+                            &pRenderer->pQueueMutexes[queueIndex],
+                            frameCount, submitInfos, pRenderer->pAllocator );
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //====------------------------------------------------------------------====
+    // * Read back
+
+    for (uint32_t ff = 0; ff < frameCount && VK_SUCCESS == result; ++ff)
+    {
+        FrameTimings timings = {};
+
+        auto const readbackStart = getTimeMs();
+
+        TRACE_BEGIN(readbackSpan, "map and copy");
+
+        result = readBackFrame(pRenderer, ppTargets[ff], &pImageContexts[ff]);
+
+        TRACE_END(readbackSpan);
+
+        timings.readbackMs = getTimeMs() - readbackStart;
+        timings.recordMs   = recordMs[ff];
+
+        //  - timings
+        if (nullptr != pTimings)
+        {
+            collectFrameTimings(pRenderer, ppTargets[ff], &timings);
+
+            pTimings[ff] = timings;
+        }
+    }
+
+    return result;
+}
+
+// * renderFrame
+//
+VkResult renderFrame( Renderer*     pRenderer,
+                      RenderTarget* pTarget,
+                      ImageContext* pImageContext,
+                      FrameTimings* pTimings )
+{
+    return renderFrameBatch(pRenderer, &pTarget, 1, pImageContext, pTimings);
+}
+
+// * renderFrameDamage
+//
+VkResult renderFrameDamage( Renderer*       pRenderer,
+                            RenderTarget*   pTarget,
+                            const VkRect2D* pDamage,
+                            uint32_t        damageCount,
+                            ImageContext*   pImageContext,
+                            FrameTimings*   pTimings )
+{
+    //  - the image context must hold this target's last frame
+    if ( nullptr == pImageContext->data ||
+         pTarget->width != pImageContext->width ||
+         pTarget->height != pImageContext->height ||
+         readbackColorFormat(pRenderer) != pImageContext->colorPixelFormat )
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    //  - damage clamped to the target, without empty rectangles
+    VkRect2D damage[damageCount + 1];
+    uint32_t clampedCount = 0;
+
+    for (uint32_t dd = 0; dd < damageCount; ++dd)
+    {
+        auto const left   = (0 < pDamage[dd].offset.x) ? (int64_t)pDamage[dd].offset.x : 0;
+        auto const top    = (0 < pDamage[dd].offset.y) ? (int64_t)pDamage[dd].offset.y : 0;
+        auto       right  = pDamage[dd].offset.x + (int64_t)pDamage[dd].extent.width;
+        auto       bottom = pDamage[dd].offset.y + (int64_t)pDamage[dd].extent.height;
+
+        right  = (right < pTarget->width) ? right : pTarget->width;
+        bottom = (bottom < pTarget->height) ? bottom : pTarget->height;
+
+        if (left < right && top < bottom)
+        {
+            damage[clampedCount++] = (VkRect2D){
+                .offset = { (int32_t)left, (int32_t)top },
+                .extent = { (uint32_t)(right - left), (uint32_t)(bottom - top) }
+            };
+        }
+    }
+
+    FrameTimings timings = {};
+
+    if (0 == clampedCount)
+    {
+        if (nullptr != pTimings) {
+            *pTimings = timings;
+        }
+
+        return VK_SUCCESS;
+    }
+
+    //  - record
+    auto const hasCopy     = hasCopyCommands(pRenderer);
+    auto const recordStart = getTimeMs();
+
+    TRACE_BEGIN(recordSpan, "record damage");
+
+    //  - a multisampled frame is redrawn across the damage bounds, all of
+    //    which its resolve writes. Only the damage itself is read back
+    auto const bounds = boundDamage(damage, clampedCount);
+
+    auto result = (VK_SAMPLE_COUNT_1_BIT < pRenderer->sampleCount)
+                ? recordDamageCommands(pRenderer, pTarget, &bounds, 1)
+                : recordDamageCommands(pRenderer, pTarget, damage, clampedCount);
+
+    if (VK_SUCCESS == result && hasCopy) {
+        result = recordCopyCommands(pRenderer, pTarget, damage, clampedCount, false);
+    }
+
+    TRACE_END(recordSpan);
+
+    timings.recordMs = getTimeMs() - recordStart;
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //  - submit
+    const VkCommandBuffer commandBuffers[] = {
+        pTarget->renderCommandBuffer,
+        pTarget->copyCommandBuffer
+    };
+
+    const VkSubmitInfo submitInfo = {
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = nullptr,
+        .waitSemaphoreCount   = 0,
+        .pWaitSemaphores      = nullptr,
+        .pWaitDstStageMask    = nullptr,
+        .commandBufferCount   = hasCopy ? 2 : 1,
+        .pCommandBuffers      = commandBuffers,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores    = nullptr
+    };
+
+    auto const queueIndex = pTarget->queueIndex;
+
+    result = submitAndWait( pRenderer->device, pRenderer->queues[queueIndex],
+                            &pRenderer->pQueueMutexes[queueIndex],
+                            1, &submitInfo, pRenderer->pAllocator );
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    //  - read back
+    auto const readbackStart = getTimeMs();
+
+    TRACE_BEGIN(readbackSpan, "map and copy damage");
+
+    result = readBackRegions(pRenderer, pTarget, damage, clampedCount, pImageContext);
+
+    TRACE_END(readbackSpan);
+
+    timings.readbackMs = getTimeMs() - readbackStart;
+
+    if (nullptr != pTimings)
+    {
+        collectFrameTimings(pRenderer, pTarget, &timings);
+
+        *pTimings = timings;
+    }
+
+    return result;
+}
+
+// * importHostMemory : caller memory as a transfer destination buffer. The
+//                      import spans the aligned blocks around the memory,
+//                      and pOffset locates its first byte in the buffer
+//
+VkResult importHostMemory( const Renderer* pRenderer,
+                           void*           pData,
+                           size_t          size,
+                           VkBuffer*       pBuffer,
+                           VkDeviceMemory* pMemory,
+                           VkDeviceSize*   pOffset )
+{
+    auto const device    = pRenderer->device;
+    auto const alignment = (uintptr_t)pRenderer->hostPointerAlignment;
+
+    auto const address    = (uintptr_t)pData;
+    auto const base       = address & ~(alignment - 1);
+    auto const importSize = (VkDeviceSize)( (address + size - base + alignment - 1)
+                                            & ~(alignment - 1) );
+
+    //  - memory types the pointer may be imported as
+    VkMemoryHostPointerPropertiesEXT pointerProperties = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT,
+        .pNext = nullptr
+    };
+
+    auto result = pRenderer->pfnGetMemoryHostPointerProperties(
+        device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+        (void*)base, &pointerProperties );
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    VkBuffer       buffer = nullptr;
+    VkDeviceMemory memory = nullptr;
+
+    do
+    {
+        //  - buffer
+        const VkExternalMemoryBufferCreateInfo externalInfo = {
+            .sType       = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+            .pNext       = nullptr,
+            .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT
+        };
+
+        const VkBufferCreateInfo bufferInfo = {
+            .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext                 = &externalInfo,
+            .flags                 = 0,
+            .size                  = importSize,
+            .usage                 = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices   = nullptr
+        };
+
+        result = vkCreateBuffer(device, &bufferInfo, pRenderer->pAllocator, &buffer);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - memory : the imported pages themselves, coherent so the
+        //    caller sees the copy without mapping them
+        VkMemoryRequirements memoryRequirements = {};
+        vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+        if (importSize < memoryRequirements.size)
+        {
+            result = VK_ERROR_INVALID_EXTERNAL_HANDLE;
+            break;
+        }
+
+        uint32_t memoryTypeIndex = 0;
+
+        result = findMemoryTypeIndex( &pRenderer->memoryProperties,
+                                      memoryRequirements.memoryTypeBits
+                                      & pointerProperties.memoryTypeBits,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      &memoryTypeIndex );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        const VkImportMemoryHostPointerInfoEXT importInfo = {
+            .sType        = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+            .pNext        = nullptr,
+            .handleType   = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+            .pHostPointer = (void*)base
+        };
+
+        const VkMemoryAllocateInfo memoryAllocInfo = {
+            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext           = &importInfo,
+            .allocationSize  = importSize,
+            .memoryTypeIndex = memoryTypeIndex
+        };
+
+        result = vkAllocateMemory(device, &memoryAllocInfo, pRenderer->pAllocator, &memory);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        result = vkBindBufferMemory(device, buffer, memory, 0);
+    }
+    while (0);
+
+    if (VK_SUCCESS != result)
+    {
+        vkDestroyBuffer(device, buffer, pRenderer->pAllocator);
+        vkFreeMemory(device, memory, pRenderer->pAllocator);
+
+        return result;
+    }
+
+    *pBuffer = buffer;
+    *pMemory = memory;
+    *pOffset = (VkDeviceSize)(address - base);
+
+    return VK_SUCCESS;
+}
+
+// * recordImportCopyCommands : copies the render image into an imported
+//                              buffer. The buffer needs no layout
+//                              transitions, and its host barrier is timed
+//                              as one
+//
+VkResult recordImportCopyCommands( const RenderTarget* pTarget,
+                                   VkBuffer            buffer,
+                                   VkDeviceSize        offset,
+                                   uint32_t            rowLength )
+{
+    auto const commandBuffer = pTarget->copyCommandBuffer;
+
+    //  - begin
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr
+    };
+
+    auto result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    if (VK_SUCCESS != result) {
+        return result;
+    }
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_COPY_BEGIN );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_DEST_LAYOUT_END );
+
+    //  - copy image, at the caller's row pitch
+    const VkBufferImageCopy bufferCopy = {
+        .bufferOffset      = offset,
+        .bufferRowLength   = rowLength,
+        .bufferImageHeight = 0,
+        .imageSubresource  = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { pTarget->width, pTarget->height, 1 }
+    };
+
+    vkCmdCopyImageToBuffer( commandBuffer,
+                            pTarget->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            buffer, 1, &bufferCopy );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    pTarget, TIMESTAMP_COPY_END );
+
+    //  - frame to the host
+    const VkBufferMemoryBarrier hostBarrier = {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = buffer,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE
+    };
+
+    vkCmdPipelineBarrier( commandBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &hostBarrier, 0, nullptr );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_GENERAL_LAYOUT_END );
+
+    writeTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    pTarget, TIMESTAMP_PREVIEW_END );
+
+    //  - end
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+// * renderFrameToMemory
+//
+VkResult renderFrameToMemory( Renderer*     pRenderer,
+                              RenderTarget* pTarget,
+                              void*         pData,
+                              size_t        bytesPerRow,
+                              FrameTimings* pTimings )
+{
+    auto const colorPixelFormat = readbackColorFormat(pRenderer);
+    auto const bytesPerPixel    = (size_t)formatBytesPerPixel(colorPixelFormat);
+    auto const rowSize          = bytesPerPixel * pTarget->width;
+
+    if (nullptr == pData || bytesPerRow < rowSize) {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    //  - the caller's memory, as the frame's image context
+    ImageContext imageContext = {
+        .width            = pTarget->width,
+        .height           = pTarget->height,
+        .bytesPerRow      = bytesPerRow,
+        .colorPixelFormat = colorPixelFormat,
+        .pixelLayout      = pRenderer->pixelLayout,
+        .data             = pData
+    };
+
+    const VkRect2D frameRegion = {
+        .offset = { 0, 0 },
+        .extent = { pTarget->width, pTarget->height }
+    };
+
+    //  - copy commands write the memory directly when it can be imported at
+    //    a whole pixel offset, and the format needs no swizzle on the way
+    auto const hasCopy = hasCopyCommands(pRenderer);
+
+    auto const canImport = hasCopy && 0 != pRenderer->hostPointerAlignment
+                        && VK_FORMAT_B8G8R8A8_UNORM != pRenderer->colorFormat
+                        && 0 == (uintptr_t)pData % bytesPerPixel
+                        && 0 == bytesPerRow % bytesPerPixel;
+
+    FrameTimings timings = {};
+
+    VkBuffer       importBuffer = nullptr;
+    VkDeviceMemory importMemory = nullptr;
+    VkDeviceSize   importOffset = 0;
+
+    //  - record
+    auto const recordStart = getTimeMs();
+
+    TRACE_BEGIN(recordSpan, "record commands");
+
+    auto result = recordRenderCommands(pRenderer, pTarget);
+
+    auto isImported = false;
+
+    if (VK_SUCCESS == result && canImport)
+    {
+        auto const size = bytesPerRow * (pTarget->height - 1) + rowSize;
+
+        isImported = ( VK_SUCCESS == importHostMemory( pRenderer, pData, size,
+                                                       &importBuffer, &importMemory,
+                                                       &importOffset ) );
+    }
+
+    if (VK_SUCCESS == result && isImported)
+    {
+        result = recordImportCopyCommands( pTarget, importBuffer, importOffset,
+                                           (uint32_t)(bytesPerRow / bytesPerPixel) );
+    }
+    else if (VK_SUCCESS == result && hasCopy) {
+        result = recordCopyCommands(pRenderer, pTarget, &frameRegion, 1, false);
+    }
+
+    TRACE_END(recordSpan);
+
+    timings.recordMs = getTimeMs() - recordStart;
+
+    //  - submit
+    if (VK_SUCCESS == result)
+    {
+        const VkCommandBuffer commandBuffers[] = {
+            pTarget->renderCommandBuffer,
+            pTarget->copyCommandBuffer
+        };
+
+        const VkSubmitInfo submitInfo = {
+            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext                = nullptr,
+            .waitSemaphoreCount   = 0,
+            .pWaitSemaphores      = nullptr,
+            .pWaitDstStageMask    = nullptr,
+            .commandBufferCount   = hasCopy ? 2 : 1,
+            .pCommandBuffers      = commandBuffers,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores    = nullptr
+        };
+
+        auto const queueIndex = pTarget->queueIndex;
+
+        result = submitAndWait( pRenderer->device, pRenderer->queues[queueIndex],
+                                &pRenderer->pQueueMutexes[queueIndex],
+                                1, &submitInfo, pRenderer->pAllocator );
+    }
+
+    //  - read back : otherwise the rows are staged through the readback
+    //    memory, or copied by the host from the render image
+    if (VK_SUCCESS == result && !isImported)
+    {
+        auto const readbackStart = getTimeMs();
+
+        TRACE_BEGIN(readbackSpan, "map and copy");
+
+        result = readBackRegions(pRenderer, pTarget, &frameRegion, 1, &imageContext);
+
+        TRACE_END(readbackSpan);
+
+        timings.readbackMs = getTimeMs() - readbackStart;
+    }
+
+    vkDestroyBuffer(pRenderer->device, importBuffer, pRenderer->pAllocator);
+    vkFreeMemory(pRenderer->device, importMemory, pRenderer->pAllocator);
+
+    if (VK_SUCCESS == result && nullptr != pTimings)
+    {
+        collectFrameTimings(pRenderer, pTarget, &timings);
+
+        *pTimings = timings;
+    }
+
+    return result;
+}
+
+//====----------------------------------------------------------------------====
+// renderImage
+//====----------------------------------------------------------------------====
+
+ImageContext renderImage( uint32_t        width,
+                          uint32_t        height,
+                          VkFormat        requestedColorFormat,
+                          PixelLayout     pixelLayout,
+                          FrameTimings*   pTimings,
+                          StartupTimings* pStartupTimings )
+{
+    ImageContext imageContext = {};
+
+    const RendererInfo rendererInfo = {
+        .colorFormat      = requestedColorFormat,
+        .pixelLayout      = pixelLayout,
+        .enableValidation = true
+    };
+
+    Renderer     renderer = {};
+    RenderTarget target   = {};
+
+    TRACE_BEGIN(rendererSpan, "create renderer");
+
+    auto const result = createRendererAndTarget( &rendererInfo, width, height,
+                                                 &renderer, &target );
+
+    TRACE_END(rendererSpan);
+
+    if (VK_SUCCESS != result) {
+        return imageContext;
+    }
+
+    TRACE_BEGIN(frameSpan, "render frame");
+
+    auto const frameStartMs = getTimeMs();
+
+    renderFrame(&renderer, &target, &imageContext, pTimings);
+
+    addStartupPhase( &renderer.startupTimings, "render first frame",
+                     frameStartMs, getTimeMs() );
+
+    TRACE_END(frameSpan);
+
+    if (nullptr != pStartupTimings)
+    {
+        *pStartupTimings         = renderer.startupTimings;
+        pStartupTimings->totalMs = getTimeMs() - pStartupTimings->beginMs;
+    }
+
+    destroyRenderTarget(&renderer, &target);
+    destroyRenderer(&renderer);
+
+    return imageContext;
+}
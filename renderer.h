@@ -0,0 +1,407 @@
+//
+// renderer.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdatomic.h>
+#include <threads.h>
+
+#include "pack.h"
+#include "rendercache.h"
+#include "scene.h"
+#include "taskpool.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * ImageContext
+//
+//====----------------------------------------------------------------------====
+
+typedef struct ImageContext
+{
+    uint32_t             width;
+    uint32_t             height;
+    VkDeviceSize         bytesPerRow;
+    VkFormat             colorPixelFormat;
+    PixelLayout          pixelLayout;
+    uint8_t*             data;
+
+    //  - downsampled previews of the frame, largest first
+    struct ImageContext* pPreviews;
+    uint32_t             previewCount;
+}
+ImageContext;
+
+// * disposeImageContext : previews included
+//
+void disposeImageContext(ImageContext* ctx);
+
+//====----------------------------------------------------------------------====
+//
+// * Renderer : device-level state shared by every frame. Safe to use from
+//              several threads, each rendering its own render targets
+//
+//====----------------------------------------------------------------------====
+
+// * Queues requested from the graphics and compute family, at most
+//
+constexpr uint32_t rendererMaxQueues = 16;
+
+// * Threads recording secondary command buffers for a frame, at most
+//
+constexpr uint32_t rendererMaxRecordThreads = 16;
+
+// * Mip levels of a render image, at most, enough for 16384 pixels
+//
+constexpr uint32_t rendererMaxMipLevels = 15;
+
+typedef struct RendererInfo
+{
+    VkFormat    colorFormat;        // VK_FORMAT_UNDEFINED : fastest high precision
+    PixelLayout pixelLayout;
+    bool        enableValidation;   // VK_LAYER_KHRONOS_validation
+    uint32_t    deviceNumber;       // 0 : first GPU, see findPhysicalDevice
+    uint32_t    queueCount;         // 0 : every queue of the family
+    uint32_t    drawCount;          // 0 : one draw, see recordDraws
+    uint32_t    recordThreadCount;  // 0 : draws are recorded inline
+    const char* sceneFilename;      // nullptr : the built-in square
+
+    //  - 0 or 1 : one sample. Otherwise lowered to the largest count the
+    //    device supports for the color format, and resolved in the pass
+    VkSampleCountFlagBits sampleCount;
+
+    //  - bit n : mip level n, a 2^n downsample, is read back as a preview.
+    //    Levels are blitted from the render image in the frame's own
+    //    submission. Copy readback only, ignored for packed layouts
+    uint32_t    previewLevels;
+
+    //  - copy readback goes through a destination image and copy commands
+    //    even where the host could copy the render image itself
+    bool        disableHostImageCopy;
+
+    //  - the graphics pipeline is compiled on a thread of its own, and
+    //    frames draw with shader objects until it is ready. Compiled up
+    //    front without VK_EXT_shader_object
+    bool        deferPipelineCompile;
+
+    //  - host allocations of every object the renderer creates, may be null
+    const VkAllocationCallbacks* pAllocator;
+}
+RendererInfo;
+
+typedef struct Renderer
+{
+    VkInstance                       instance;
+    VkPhysicalDevice                 physicalDevice;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    float                            timestampPeriod;
+    uint32_t                         timestampValidBits;
+    uint32_t                         queueFamilyIndex;
+    VkDevice                         device;
+
+    //  - submissions to a queue hold its mutex, see submitAndWait. The
+    //    mutexes are allocated so the renderer itself may be copied
+    VkQueue                          queues[rendererMaxQueues];
+    mtx_t*                           pQueueMutexes;
+    uint32_t                         queueCount;
+    atomic_uint                      nextQueueIndex;
+
+    VkPipelineCache                  pipelineCache;
+    VkPipelineLayout                 pipelineLayout;
+    VkRenderPass                     renderPass;
+    VkRenderPass                     damageRenderPass;  // loads the previous frame
+    VkPipeline                       graphicsPipeline;  // see pStartup
+    PackPipeline                     packPipeline;
+    VkFormat                         colorFormat;
+    PixelLayout                      pixelLayout;
+    VkSampleCountFlagBits            sampleCount;
+    uint32_t                         previewLevels;     // zero when unsupported
+    VkFilter                         previewFilter;
+    bool                             useHostImageCopy;  // copy readback by the host
+    PFN_vkCopyImageToMemory          pfnCopyImageToMemory;
+
+    //  - caller memory imported as a copy destination, see
+    //    renderFrameToMemory. Zero alignment without the extension
+    VkDeviceSize                     hostPointerAlignment;
+    PFN_vkGetMemoryHostPointerPropertiesEXT pfnGetMemoryHostPointerProperties;
+    const VkAllocationCallbacks*     pAllocator;
+
+    //  - device-local memory render targets are admitted against, see
+    //    createRenderTargetInBudget. targetMemory, held by the renderer's
+    //    targets, is the usage without VK_EXT_memory_budget
+    bool                             hasMemoryBudget;
+    mtx_t*                           pBudgetMutex;
+    atomic_uint_fast64_t             targetMemory;
+
+    //  - draws are split between secondary command buffers, one per
+    //    recording thread, when recordThreadCount is set
+    uint32_t                         drawCount;
+    uint32_t                         recordThreadCount;
+
+    //  - rectangles drawn instead of the square when a scene file is given
+    Scene                            scene;
+
+    //  - shader objects and the background compile of a deferred graphics
+    //    pipeline, null when it was compiled up front
+    struct PipelineStartup*          pStartup;
+
+    //  - createRenderer's phases, and those of a first target
+    StartupTimings                   startupTimings;
+}
+Renderer;
+
+// * createRenderer : once the device exists, pipelines are compiled while
+//                    the scene is uploaded, by a task graph. See
+//                    Renderer.startupTimings
+//
+VkResult createRenderer(const RendererInfo* pInfo, Renderer* pRenderer);
+
+// * destroyRenderer : also releases a partially created renderer
+//
+void destroyRenderer(Renderer* pRenderer);
+
+// * waitForGraphicsPipeline : joins the background compile of a deferred
+//                             graphics pipeline, and returns its result.
+//                             Frames draw with it from then on
+//
+VkResult waitForGraphicsPipeline(Renderer* pRenderer);
+
+// * addRendererToCacheKey : every renderer input to a frame's pixels, the
+//                           SPIR-V included. The frame size and encoding
+//                           are up to the caller
+//
+void addRendererToCacheKey(const Renderer* pRenderer, CacheKeyHasher* pHasher);
+
+// * updateRendererScene : see updateSceneRects. No frame may be rendering
+//
+VkResult updateRendererScene( Renderer*        pRenderer,
+                              uint32_t         firstRect,
+                              uint32_t         rectCount,
+                              const SceneRect* pRects );
+
+//====----------------------------------------------------------------------====
+//
+// * RenderTarget : per-resolution images, buffers and command buffers,
+//                  reused from frame to frame. A target, and its command
+//                  pool, belong to one thread at a time
+//
+//====----------------------------------------------------------------------====
+
+typedef struct RenderTarget
+{
+    uint32_t            width;
+    uint32_t            height;
+    VkDeviceSize        memorySize;     // allocated by its images and buffers
+
+    //  - render image
+    VkImage             image;
+    VkDeviceMemory      imageMemory;
+    VkImageView         imageView;
+    VkFramebuffer       framebuffer;
+
+    //  - multisample image : transient, resolved into the render image, and
+    //    lazily allocated where the device can, so its samples need never
+    //    reach memory
+    VkImage             msaaImage;
+    VkDeviceMemory      msaaImageMemory;
+    VkImageView         msaaImageView;
+
+    //  - packed readback
+    VkBuffer            packBuffer;
+    VkDeviceMemory      packBufferMemory;
+    VkDeviceSize        packBytesPerRow;
+    VkDescriptorPool    packDescriptorPool;
+    VkDescriptorSet     packDescriptorSet;
+
+    //  - copy readback, unless the host copies the render image itself
+    VkImage             destImage;
+    VkDeviceMemory      destImageMemory;
+    VkSubresourceLayout destImageLayout;
+
+    //  - previews : the render image's mip levels, those selected copied
+    //    into one buffer. Levels smaller than a pixel are dropped
+    uint32_t            mipLevels;
+    uint32_t            previewLevels;
+    VkBuffer            previewBuffer;
+    VkDeviceMemory      previewBufferMemory;
+    VkDeviceSize        previewOffsets[rendererMaxMipLevels];
+
+    //  - commands : submitted to queues[queueIndex], assigned round-robin
+    //    when the target is created and free to be changed between frames
+    uint32_t            queueIndex;
+    VkCommandPool       commandPool;
+    VkCommandBuffer     renderCommandBuffer;
+    VkCommandBuffer     copyCommandBuffer;
+    VkQueryPool         timestampQueryPool;
+
+    //  - secondary commands : a pool per recording thread, recorded by
+    //    the target's own threads, so targets rendering on different
+    //    threads record at once
+    VkCommandPool       secondaryCommandPools[rendererMaxRecordThreads];
+    VkCommandBuffer     secondaryCommandBuffers[rendererMaxRecordThreads];
+    TaskPool*           pRecordPool;
+}
+RenderTarget;
+
+// * createRenderTarget
+//
+VkResult createRenderTarget( Renderer*     pRenderer,
+                             uint32_t      width,
+                             uint32_t      height,
+                             RenderTarget* pTarget );
+
+// * destroyRenderTarget
+//
+void destroyRenderTarget(Renderer* pRenderer, RenderTarget* pTarget);
+
+// * createRendererAndTarget : createRenderer and createRenderTarget, the
+//                             target's objects created by the same task
+//                             graph as the renderer's, so its allocations
+//                             overlap the pipeline compiles
+//
+VkResult createRendererAndTarget( const RendererInfo* pInfo,
+                                  uint32_t            width,
+                                  uint32_t            height,
+                                  Renderer*           pRenderer,
+                                  RenderTarget*       pTarget );
+
+//====----------------------------------------------------------------------====
+//
+// * Device memory : render targets are only created once they fit the
+//                   device-local budget, so callers can wait, or render
+//                   fewer frames at once, rather than fail
+//
+//====----------------------------------------------------------------------====
+
+// * Share of the device-local budget, in percent, left to other processes
+//   and to the driver
+//
+constexpr uint32_t rendererMemoryReservePercent = 10;
+
+typedef struct RendererMemory
+{
+    VkDeviceSize capacity;          // the budget, less the reserve
+    VkDeviceSize available;         // the capacity less the usage
+}
+RendererMemory;
+
+// * queryRendererMemory : across the device-local heaps, live with
+//                         VK_EXT_memory_budget. Without it, the heap sizes
+//                         are the budget and the renderer's targets the
+//                         only usage
+//
+RendererMemory queryRendererMemory(const Renderer* pRenderer);
+
+// * estimateRenderTargetMemory : bytes a target of the size allocates,
+//                                readback included, before alignment
+//
+VkDeviceSize estimateRenderTargetMemory( const Renderer* pRenderer,
+                                         uint32_t        width,
+                                         uint32_t        height );
+
+// * createRenderTargetInBudget : createRenderTarget once the target's
+//                                estimate fits the available memory, or
+//                                VK_ERROR_OUT_OF_DEVICE_MEMORY without
+//                                allocating anything. Targets are admitted
+//                                one at a time, each seeing the memory of
+//                                those before it
+//
+VkResult createRenderTargetInBudget( Renderer*     pRenderer,
+                                     uint32_t      width,
+                                     uint32_t      height,
+                                     RenderTarget* pTarget );
+
+//====----------------------------------------------------------------------====
+//
+// * Frames
+//
+//====----------------------------------------------------------------------====
+
+// * readbackColorFormat : format of the samples in frames' image contexts
+//
+VkFormat readbackColorFormat(const Renderer* pRenderer);
+
+// * renderFrame : render and read back one frame, and its previews. The
+//                 caller disposes of the image context. pTimings may be
+//                 null
+//
+VkResult renderFrame( Renderer*     pRenderer,
+                      RenderTarget* pTarget,
+                      ImageContext* pImageContext,
+                      FrameTimings* pTimings );
+
+// * renderFrameBatch : render every frame with a single queue submission,
+//                      one submit info per frame, then read each back.
+//                      Each frame needs its own target, and the batch is
+//                      submitted to the first target's queue. The caller
+//                      disposes of the image contexts. pTimings may be
+//                      null, or hold frameCount timings
+//
+VkResult renderFrameBatch( Renderer*            pRenderer,
+                           RenderTarget* const* ppTargets,
+                           uint32_t             frameCount,
+                           ImageContext*        pImageContexts,
+                           FrameTimings*        pTimings );
+
+// * renderFrameDamage : redraw only the damaged rectangles over the frame
+//                       last rendered on the target, and read back only
+//                       those into pImageContext, which holds that frame.
+//                       Each rectangle is cleared and redrawn in turn, so
+//                       they may overlap. A multisampled frame is redrawn
+//                       over the damage bounds, as its resolve writes the
+//                       whole render area. Draws are recorded inline, and
+//                       a packed frame is packed whole. Previews are not
+//                       rendered, and those of pImageContext are kept.
+//                       pTimings may be null
+//
+VkResult renderFrameDamage( Renderer*       pRenderer,
+                            RenderTarget*   pTarget,
+                            const VkRect2D* pDamage,
+                            uint32_t        damageCount,
+                            ImageContext*   pImageContext,
+                            FrameTimings*   pTimings );
+
+// * renderFrameToMemory : render one frame and read it back into caller
+//                         memory of the target's height in rows, each
+//                         bytesPerRow apart, in the readback format. Copy
+//                         readback imports the memory as a buffer the
+//                         frame is copied into on the GPU, where the device
+//                         has VK_EXT_external_memory_host. Otherwise, and
+//                         for BGRA, the rows are staged through the
+//                         readback memory. Previews are not rendered.
+//                         pTimings may be null
+//
+VkResult renderFrameToMemory( Renderer*     pRenderer,
+                              RenderTarget* pTarget,
+                              void*         pData,
+                              size_t        bytesPerRow,
+                              FrameTimings* pTimings );
+
+// * renderImage : one-shot renderer, target and frame. pTimings may be
+//                 null, as may pStartupTimings, which ends with the frame
+//
+ImageContext renderImage( uint32_t        width,
+                          uint32_t        height,
+                          VkFormat        requestedColorFormat,
+                          PixelLayout     pixelLayout,
+                          FrameTimings*   pTimings,
+                          StartupTimings* pStartupTimings );
@@ -0,0 +1,789 @@
+//
+// scene.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scene.h"
+#include "trace.h"
+#include "utilities.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Staging ring : chunks of the file are copied into one slot while the
+//                  copies out of the others are in flight
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t     sceneStagingSlotCount = 4;
+constexpr VkDeviceSize sceneStagingSlotSize  = 4 << 20;
+
+// * readSceneHeader : VK_ERROR_FORMAT_NOT_SUPPORTED unless the header
+//                     matches this build and the file holds every record
+//
+VkResult readSceneHeader( const uint8_t* pFileData,
+                          size_t         fileSize,
+                          SceneHeader*   pHeader )
+{
+    if (fileSize < sizeof(SceneHeader)) {
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+
+    memcpy(pHeader, pFileData, sizeof(SceneHeader));
+
+    auto const recordBytes = (uint64_t)pHeader->rectCount * sizeof(SceneRect);
+
+    if ( sceneMagic != pHeader->magic ||
+         sceneVersion != pHeader->version ||
+         sizeof(SceneRect) != pHeader->recordSize ||
+         0 == pHeader->rectCount ||
+         fileSize - sizeof(SceneHeader) < recordBytes )
+    {
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+
+    return VK_SUCCESS;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Scene
+//
+//====----------------------------------------------------------------------====
+
+// * loadScene
+//
+VkResult loadScene( const SceneUploadInfo* pInfo,
+                    const char*            filename,
+                    Scene*                 pScene )
+{
+    auto const device     = pInfo->device;
+    auto const pAllocator = pInfo->pAllocator;
+
+    Scene          scene         = {};
+    void*          pFileData     = MAP_FAILED;
+    size_t         fileSize      = 0;
+    VkBuffer       stagingBuffer = nullptr;
+    VkDeviceMemory stagingMemory = nullptr;
+    VkCommandPool  commandPool   = nullptr;
+    VkResult       result        = VK_SUCCESS;
+
+    VkFence fences[sceneStagingSlotCount] = {};
+
+    TRACE_BEGIN(sceneSpan, "load scene");
+
+    do
+    {
+        //====--------------------------------------------------------------====
+        // * File : mapped rather than read, so that only the pages of the
+        //          chunks in flight need be resident
+        //
+        auto const fd = open(filename, O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+        {
+            result = VK_ERROR_UNKNOWN;
+            break;
+        }
+
+        struct stat status = {};
+
+        auto const hasStatus = (0 == fstat(fd, &status));
+
+        if (hasStatus && sizeof(SceneHeader) <= (size_t)status.st_size)
+        {
+            fileSize  = (size_t)status.st_size;
+            pFileData = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        close(fd);
+
+        if (!hasStatus || (0 < fileSize && MAP_FAILED == pFileData))
+        {
+            result = VK_ERROR_UNKNOWN;
+            break;
+        }
+
+        if (0 == fileSize)
+        {
+            result = VK_ERROR_FORMAT_NOT_SUPPORTED;
+            break;
+        }
+
+        madvise(pFileData, fileSize, MADV_SEQUENTIAL);
+
+        SceneHeader header = {};
+
+        result = readSceneHeader((const uint8_t*)pFileData, fileSize, &header);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        scene.rectCount = header.rectCount;
+
+        auto const recordBytes = (VkDeviceSize)header.rectCount * sizeof(SceneRect);
+
+        //====--------------------------------------------------------------====
+        // * Vertex buffer
+        //
+        const VkBufferCreateInfo bufferInfo = {
+            .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext                 = nullptr,
+            .flags                 = 0,
+            .size                  = recordBytes,
+            .usage                 = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+                                   | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices   = nullptr
+        };
+
+        result = createBufferAndMemory( device, &bufferInfo, pInfo->pMemoryProperties,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                        pAllocator, &scene.buffer, &scene.memory );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Staging ring : persistently mapped, with slots no larger than
+        //                  the scene itself
+        //
+        auto const slotSize = (recordBytes < sceneStagingSlotSize) ? recordBytes
+                                                                   : sceneStagingSlotSize;
+
+        const VkBufferCreateInfo stagingBufferInfo = {
+            .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext                 = nullptr,
+            .flags                 = 0,
+            .size                  = sceneStagingSlotCount * slotSize,
+            .usage                 = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices   = nullptr
+        };
+
+        result = createBufferAndMemory( device, &stagingBufferInfo, pInfo->pMemoryProperties,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                        pAllocator, &stagingBuffer, &stagingMemory );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        uint8_t* pStagingData = nullptr;
+
+        result = vkMapMemory( device, stagingMemory, 0, VK_WHOLE_SIZE, 0,
+                              (void**)&pStagingData );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - a command buffer and fence per slot. Fences start signaled, as
+        //    if each slot had already been consumed
+        const VkCommandPoolCreateInfo commandPoolInfo = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = nullptr,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+                              | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = pInfo->queueFamilyIndex
+        };
+
+        result = vkCreateCommandPool(device, &commandPoolInfo, pAllocator, &commandPool);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo commandBufferInfo = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = nullptr,
+            .commandPool        = commandPool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = sceneStagingSlotCount
+        };
+
+        VkCommandBuffer commandBuffers[sceneStagingSlotCount] = {};
+
+        result = vkAllocateCommandBuffers(device, &commandBufferInfo, commandBuffers);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        const VkFenceCreateInfo fenceInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT
+        };
+
+        for (uint32_t ss = 0; ss < sceneStagingSlotCount && VK_SUCCESS == result; ++ss) {
+            result = vkCreateFence(device, &fenceInfo, pAllocator, &fences[ss]);
+        }
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //====--------------------------------------------------------------====
+        // * Stream : each chunk waits only for the copy last made from its
+        //            slot, and is hashed while its pages are resident. Pages
+        //            already staged are dropped from the mapping
+        //
+        auto const pRecords  = (const uint8_t*)pFileData + sizeof(SceneHeader);
+        auto const pageSize  = (size_t)sysconf(_SC_PAGESIZE);
+        auto       slotIndex = 0u;
+
+        CacheKeyHasher hasher = {};
+        beginCacheKey(&hasher);
+
+        for (VkDeviceSize offset = 0; offset < recordBytes; offset += slotSize)
+        {
+            auto const chunkSize = (recordBytes - offset < slotSize) ? recordBytes - offset
+                                                                     : slotSize;
+            auto const fence         = fences[slotIndex];
+            auto const commandBuffer = commandBuffers[slotIndex];
+            auto const slotOffset    = slotIndex * slotSize;
+
+            result = vkWaitForFences(device, 1, &fence, true, UINT64_MAX);
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            memcpy(pStagingData + slotOffset, pRecords + offset, chunkSize);
+            addCacheKeyData(&hasher, pRecords + offset, chunkSize);
+
+            auto const consumed = (sizeof(SceneHeader) + offset + chunkSize)
+                                / pageSize * pageSize;
+
+            if (0 < consumed) {
+                madvise(pFileData, consumed, MADV_DONTNEED);
+            }
+
+            //  - copy
+            const VkCommandBufferBeginInfo beginInfo = {
+                .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                .pNext            = nullptr,
+                .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                .pInheritanceInfo = nullptr
+            };
+
+            result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            const VkBufferCopy region = {
+                .srcOffset = slotOffset,
+                .dstOffset = offset,
+                .size      = chunkSize
+            };
+
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, scene.buffer, 1, &region);
+
+            result = vkEndCommandBuffer(commandBuffer);
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            //  - submit
+            const VkSubmitInfo submitInfo = {
+                .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .pNext                = nullptr,
+                .waitSemaphoreCount   = 0,
+                .pWaitSemaphores      = nullptr,
+                .pWaitDstStageMask    = nullptr,
+                .commandBufferCount   = 1,
+                .pCommandBuffers      = &commandBuffer,
+                .signalSemaphoreCount = 0,
+                .pSignalSemaphores    = nullptr
+            };
+
+            result = vkResetFences(device, 1, &fence);
+
+            if (VK_SUCCESS != result) {
+                break;
+            }
+
+            if (nullptr != pInfo->pQueueMutex) {
+                mtx_lock(pInfo->pQueueMutex);
+            }
+
+            result = vkQueueSubmit(pInfo->queue, 1, &submitInfo, fence);
+
+            if (nullptr != pInfo->pQueueMutex) {
+                mtx_unlock(pInfo->pQueueMutex);
+            }
+
+            //  - the fence was reset but never submitted, so it is not waited on
+            if (VK_SUCCESS != result)
+            {
+                vkDestroyFence(device, fence, pAllocator);
+                fences[slotIndex] = nullptr;
+                break;
+            }
+
+            slotIndex = (slotIndex + 1) % sceneStagingSlotCount;
+        }
+
+        scene.digest = finishCacheKey(&hasher);
+    }
+    while (0);
+
+    //  - every copy has completed, or failed, before the ring is released
+    VkFence  pendingFences[sceneStagingSlotCount] = {};
+    uint32_t pendingFenceCount = 0;
+
+    for (uint32_t ss = 0; ss < sceneStagingSlotCount; ++ss)
+    {
+        if (nullptr != fences[ss]) {
+            pendingFences[pendingFenceCount++] = fences[ss];
+        }
+    }
+
+    if (0 < pendingFenceCount)
+    {
+        auto const waitResult = vkWaitForFences( device, pendingFenceCount, pendingFences,
+                                                 true, UINT64_MAX );
+        if (VK_SUCCESS == result) {
+            result = waitResult;
+        }
+    }
+
+    for (uint32_t ss = 0; ss < pendingFenceCount; ++ss) {
+        vkDestroyFence(device, pendingFences[ss], pAllocator);
+    }
+
+    vkDestroyCommandPool(device, commandPool, pAllocator);
+    vkDestroyBuffer(device, stagingBuffer, pAllocator);
+    vkFreeMemory(device, stagingMemory, pAllocator);
+
+    if (MAP_FAILED != pFileData) {
+        munmap(pFileData, fileSize);
+    }
+
+    TRACE_END(sceneSpan);
+
+    if (VK_SUCCESS != result) {
+        destroyScene(device, pAllocator, &scene);
+    }
+
+    *pScene = scene;
+
+    return result;
+}
+
+// * destroyScene
+//
+void destroyScene( VkDevice                     device,
+                   const VkAllocationCallbacks* pAllocator,
+                   Scene*                       pScene )
+{
+    vkDestroyBuffer(device, pScene->buffer, pAllocator);
+    vkFreeMemory(device, pScene->memory, pAllocator);
+
+    memset( pScene, 0, sizeof(*pScene) );
+}
+
+// * Bytes of records a single vkCmdUpdateBuffer may write
+//
+constexpr VkDeviceSize sceneUpdateChunkSize = 65536 / sizeof(SceneRect) * sizeof(SceneRect);
+
+// * updateSceneRects
+//
+VkResult updateSceneRects( const SceneUploadInfo* pInfo,
+                           Scene*                 pScene,
+                           uint32_t               firstRect,
+                           uint32_t               rectCount,
+                           const SceneRect*       pRects )
+{
+    if (pScene->rectCount < firstRect || pScene->rectCount - firstRect < rectCount) {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    if (0 == rectCount) {
+        return VK_SUCCESS;
+    }
+
+    auto const device     = pInfo->device;
+    auto const pAllocator = pInfo->pAllocator;
+
+    VkCommandPool commandPool = nullptr;
+    VkResult      result      = VK_SUCCESS;
+
+    do
+    {
+        //  - command buffer
+        const VkCommandPoolCreateInfo commandPoolInfo = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext            = nullptr,
+            .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = pInfo->queueFamilyIndex
+        };
+
+        result = vkCreateCommandPool(device, &commandPoolInfo, pAllocator, &commandPool);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo commandBufferInfo = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = nullptr,
+            .commandPool        = commandPool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+
+        VkCommandBuffer commandBuffer = nullptr;
+
+        result = vkAllocateCommandBuffers(device, &commandBufferInfo, &commandBuffer);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        const VkCommandBufferBeginInfo beginInfo = {
+            .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext            = nullptr,
+            .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr
+        };
+
+        result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - records : inline in the command buffer, so no staging is needed
+        //    for a delta
+        auto const pData       = (const uint8_t*)pRects;
+        auto const firstOffset = (VkDeviceSize)firstRect * sizeof(SceneRect);
+        auto const updateBytes = (VkDeviceSize)rectCount * sizeof(SceneRect);
+
+        for (VkDeviceSize offset = 0; offset < updateBytes; offset += sceneUpdateChunkSize)
+        {
+            auto const chunkSize = (updateBytes - offset < sceneUpdateChunkSize)
+                                 ? updateBytes - offset
+                                 : sceneUpdateChunkSize;
+
+            vkCmdUpdateBuffer( commandBuffer, pScene->buffer, firstOffset + offset,
+                               chunkSize, pData + offset );
+        }
+
+        result = vkEndCommandBuffer(commandBuffer);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - submit
+        const VkSubmitInfo submitInfo = {
+            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext                = nullptr,
+            .waitSemaphoreCount   = 0,
+            .pWaitSemaphores      = nullptr,
+            .pWaitDstStageMask    = nullptr,
+            .commandBufferCount   = 1,
+            .pCommandBuffers      = &commandBuffer,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores    = nullptr
+        };
+
+        result = submitAndWait( device, pInfo->queue, pInfo->pQueueMutex,
+                                1, &submitInfo, pAllocator );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - digest
+        CacheKeyHasher hasher = {};
+        beginCacheKey(&hasher);
+
+        addCacheKeyData(&hasher, &pScene->digest, sizeof(pScene->digest));
+        addCacheKeyData(&hasher, &firstRect, sizeof(firstRect));
+        addCacheKeyData(&hasher, &rectCount, sizeof(rectCount));
+        addCacheKeyData(&hasher, pRects, updateBytes);
+
+        pScene->digest = finishCacheKey(&hasher);
+    }
+    while (0);
+
+    vkDestroyCommandPool(device, commandPool, pAllocator);
+
+    return result;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Damage
+//
+//====----------------------------------------------------------------------====
+
+// * readSceneRects
+//
+VkResult readSceneRects( const char* filename,
+                         SceneRect** ppRects,
+                         uint32_t*   pRectCount )
+{
+    auto const fd = open(filename, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    struct stat status    = {};
+    void*       pFileData = MAP_FAILED;
+    size_t      fileSize  = 0;
+
+    auto const hasStatus = (0 == fstat(fd, &status));
+
+    if (hasStatus && 0 < status.st_size)
+    {
+        fileSize  = (size_t)status.st_size;
+        pFileData = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    close(fd);
+
+    if (!hasStatus || (0 < fileSize && MAP_FAILED == pFileData)) {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    if (0 == fileSize) {
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+
+    SceneHeader header = {};
+
+    auto result = readSceneHeader((const uint8_t*)pFileData, fileSize, &header);
+
+    SceneRect* pRects = nullptr;
+
+    if (VK_SUCCESS == result)
+    {
+        pRects = (SceneRect*)malloc((size_t)header.rectCount * sizeof(SceneRect));
+        result = (nullptr != pRects) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (VK_SUCCESS == result)
+    {
+        memcpy( pRects, (const uint8_t*)pFileData + sizeof(SceneHeader),
+                (size_t)header.rectCount * sizeof(SceneRect) );
+
+        *ppRects    = pRects;
+        *pRectCount = header.rectCount;
+    }
+
+    munmap(pFileData, fileSize);
+
+    return result;
+}
+
+// * pixelEdges : first and end pixel of an edge pair in normalized device
+//                coordinates, clamped to size. A pixel is covered when its
+//                center is, so these hold every covered pixel
+//
+void pixelEdges( float     low,
+                 float     high,
+                 uint32_t  size,
+                 uint32_t* pFirst,
+                 uint32_t* pEnd )
+{
+    auto const scale = 0.5f * (float)size;
+
+    auto first = (low + 1.0f) * scale;
+    auto end   = (high + 1.0f) * scale;
+
+    //  - also rejects NaN
+    first = (0.0f < first) ? first : 0.0f;
+    end   = (0.0f < end) ? end : 0.0f;
+
+    first = (first < (float)size) ? first : (float)size;
+    end   = (end < (float)size) ? end : (float)size;
+
+    //  - floor and ceiling of non-negative values
+    *pFirst = (uint32_t)first;
+    *pEnd   = (uint32_t)end + ( (float)(uint32_t)end < end );
+
+    if (*pEnd < *pFirst) {
+        *pEnd = *pFirst;
+    }
+}
+
+// * getSceneRectBounds
+//
+VkRect2D getSceneRectBounds( const SceneRect* pRect,
+                             uint32_t         width,
+                             uint32_t         height )
+{
+    uint32_t left = 0, right = 0, top = 0, bottom = 0;
+
+    pixelEdges(pRect->left, pRect->right, width, &left, &right);
+    pixelEdges(pRect->top, pRect->bottom, height, &top, &bottom);
+
+    if (left == right || top == bottom) {
+        return (VkRect2D){};
+    }
+
+    return (VkRect2D){
+        .offset = { (int32_t)left, (int32_t)top },
+        .extent = { right - left, bottom - top }
+    };
+}
+
+// * isEmptyRect
+//
+bool isEmptyRect(const VkRect2D* pRect)
+{
+    return 0 == pRect->extent.width || 0 == pRect->extent.height;
+}
+
+// * unionRects : either may be empty
+//
+VkRect2D unionRects(const VkRect2D* pLeft, const VkRect2D* pRight)
+{
+    if (isEmptyRect(pLeft)) {
+        return *pRight;
+    }
+
+    if (isEmptyRect(pRight)) {
+        return *pLeft;
+    }
+
+    auto const leftEnd   = pLeft->offset.x + (int64_t)pLeft->extent.width;
+    auto const rightEnd  = pRight->offset.x + (int64_t)pRight->extent.width;
+    auto const leftBase  = pLeft->offset.y + (int64_t)pLeft->extent.height;
+    auto const rightBase = pRight->offset.y + (int64_t)pRight->extent.height;
+
+    auto const left   = (pLeft->offset.x < pRight->offset.x) ? pLeft->offset.x : pRight->offset.x;
+    auto const top    = (pLeft->offset.y < pRight->offset.y) ? pLeft->offset.y : pRight->offset.y;
+    auto const right  = (leftEnd < rightEnd) ? rightEnd : leftEnd;
+    auto const bottom = (leftBase < rightBase) ? rightBase : leftBase;
+
+    return (VkRect2D){
+        .offset = { left, top },
+        .extent = { (uint32_t)(right - left), (uint32_t)(bottom - top) }
+    };
+}
+
+// * overlapRects : touching rectangles count, so that neighbours merge
+//
+bool overlapRects(const VkRect2D* pLeft, const VkRect2D* pRight)
+{
+    return pLeft->offset.x <= pRight->offset.x + (int64_t)pRight->extent.width
+        && pRight->offset.x <= pLeft->offset.x + (int64_t)pLeft->extent.width
+        && pLeft->offset.y <= pRight->offset.y + (int64_t)pRight->extent.height
+        && pRight->offset.y <= pLeft->offset.y + (int64_t)pLeft->extent.height;
+}
+
+// * rectArea
+//
+uint64_t rectArea(const VkRect2D* pRect)
+{
+    return (uint64_t)pRect->extent.width * pRect->extent.height;
+}
+
+// * computeSceneDamage
+//
+uint32_t computeSceneDamage( const SceneRect* pPrevious,
+                             const SceneRect* pNext,
+                             uint32_t         rectCount,
+                             uint32_t         width,
+                             uint32_t         height,
+                             VkRect2D*        pDamage,
+                             uint32_t         maxDamage )
+{
+    uint32_t damageCount = 0;
+
+    if (0 == maxDamage) {
+        return 0;
+    }
+
+    for (uint32_t rr = 0; rr < rectCount; ++rr)
+    {
+        if (0 == memcmp(&pPrevious[rr], &pNext[rr], sizeof(SceneRect))) {
+            continue;
+        }
+
+        //  - where the rectangle was, and where it is now
+        auto const previous = getSceneRectBounds(&pPrevious[rr], width, height);
+        auto const next     = getSceneRectBounds(&pNext[rr], width, height);
+
+        auto damage = unionRects(&previous, &next);
+
+        if (isEmptyRect(&damage)) {
+            continue;
+        }
+
+        //  - absorb the damage it overlaps, until it overlaps none
+        for (uint32_t dd = 0; dd < damageCount; )
+        {
+            if (overlapRects(&damage, &pDamage[dd]))
+            {
+                damage = unionRects(&damage, &pDamage[dd]);
+
+                pDamage[dd] = pDamage[--damageCount];
+                dd = 0;
+            }
+            else {
+                ++dd;
+            }
+        }
+
+        if (damageCount < maxDamage)
+        {
+            pDamage[damageCount++] = damage;
+            continue;
+        }
+
+        //  - out of rectangles : grow the one it grows least. The result
+        //    may overlap others, which redraws those pixels twice
+        auto bestIndex  = 0u;
+        auto bestGrowth = UINT64_MAX;
+
+        for (uint32_t dd = 0; dd < damageCount; ++dd)
+        {
+            auto const merged = unionRects(&damage, &pDamage[dd]);
+            auto const growth = rectArea(&merged) - rectArea(&pDamage[dd]);
+
+            if (growth < bestGrowth)
+            {
+                bestIndex  = dd;
+                bestGrowth = growth;
+            }
+        }
+
+        pDamage[bestIndex] = unionRects(&damage, &pDamage[bestIndex]);
+    }
+
+    return damageCount;
+}
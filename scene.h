@@ -0,0 +1,161 @@
+//
+// scene.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+#include <threads.h>
+
+#include "rendercache.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Scene file : a header followed by packed rectangle records, in host
+//                byte order. Rectangles are drawn in file order, each over
+//                those before it
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t sceneMagic   = 0x43535153;   // "SQSC"
+constexpr uint16_t sceneVersion = 1;
+
+typedef struct SceneHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;            // sizeof(SceneRect)
+    uint32_t rectCount;
+    uint32_t reserved;
+}
+SceneHeader;
+
+// * SceneRect : edges in normalized device coordinates, with y down, and
+//               left < right, top < bottom. Colors are premultiplied RGBA8
+//               with red in the low byte
+//
+typedef struct SceneRect
+{
+    float    left;
+    float    top;
+    float    right;
+    float    bottom;
+    uint32_t color;
+}
+SceneRect;
+
+//====----------------------------------------------------------------------====
+//
+// * Scene : the records of a scene file in a device-local vertex buffer,
+//           one rectangle per instance, and their digest for render cache
+//           keys
+//
+//====----------------------------------------------------------------------====
+
+typedef struct Scene
+{
+    VkBuffer       buffer;
+    VkDeviceMemory memory;
+    uint32_t       rectCount;
+    CacheKey       digest;
+}
+Scene;
+
+// * SceneUploadInfo : where the upload is submitted, and the mutex that
+//                     guards the queue, if any
+//
+typedef struct SceneUploadInfo
+{
+    VkDevice                                device;
+    const VkPhysicalDeviceMemoryProperties* pMemoryProperties;
+    uint32_t                                queueFamilyIndex;
+    VkQueue                                 queue;
+    mtx_t*                                  pQueueMutex;
+    const VkAllocationCallbacks*            pAllocator;
+}
+SceneUploadInfo;
+
+// * loadScene : maps the file and streams its records to the device through
+//               a small staging ring, so a scene is never read into memory
+//               whole. Returns once the upload is complete.
+//               VK_ERROR_FORMAT_NOT_SUPPORTED for a malformed or empty file
+//
+VkResult loadScene( const SceneUploadInfo* pInfo,
+                    const char*            filename,
+                    Scene*                 pScene );
+
+// * destroyScene
+//
+void destroyScene( VkDevice                     device,
+                   const VkAllocationCallbacks* pAllocator,
+                   Scene*                       pScene );
+
+// * updateSceneRects : replaces rectCount records starting at firstRect,
+//                      for the small deltas between the frames of a
+//                      sequence. Returns once the update is complete. No
+//                      frame may be rendering the scene meanwhile. The
+//                      digest folds the update into the previous one, so
+//                      it names the sequence of edits rather than the
+//                      records alone
+//
+VkResult updateSceneRects( const SceneUploadInfo* pInfo,
+                           Scene*                 pScene,
+                           uint32_t               firstRect,
+                           uint32_t               rectCount,
+                           const SceneRect*       pRects );
+
+//====----------------------------------------------------------------------====
+//
+// * Damage : the pixels a scene edit can change
+//
+//====----------------------------------------------------------------------====
+
+// * readSceneRects : the records of a scene file in host memory, which the
+//                    caller frees, to compute damage from.
+//                    VK_ERROR_FORMAT_NOT_SUPPORTED for a malformed or empty
+//                    file
+//
+VkResult readSceneRects( const char* filename,
+                         SceneRect** ppRects,
+                         uint32_t*   pRectCount );
+
+// * getSceneRectBounds : pixels a rectangle may cover on a width x height
+//                        target, clamped to it. Zero extent when it covers
+//                        none
+//
+VkRect2D getSceneRectBounds( const SceneRect* pRect,
+                             uint32_t         width,
+                             uint32_t         height );
+
+// * computeSceneDamage : rectangles covering every pixel that differs when
+//                        the previous records are replaced by the next.
+//                        Overlapping damage is merged, and once maxDamage
+//                        rectangles are in use each further one is merged
+//                        into the rectangle it grows least. Returns the
+//                        damage count, zero when nothing changed
+//
+uint32_t computeSceneDamage( const SceneRect* pPrevious,
+                             const SceneRect* pNext,
+                             uint32_t         rectCount,
+                             uint32_t         width,
+                             uint32_t         height,
+                             VkRect2D*        pDamage,
+                             uint32_t         maxDamage );
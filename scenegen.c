@@ -0,0 +1,151 @@
+//
+// scenegen.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scene.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Grid scene : columns x rows of cells, each with a rectangle inset by a
+//                quarter of its size, written a row at a time so that no
+//                scene is held in memory whole
+//
+//====----------------------------------------------------------------------====
+
+// * gridColor : premultiplied, varying across the grid, half of the cells
+//               translucent
+//
+uint32_t gridColor(uint32_t column, uint32_t row, uint32_t columns, uint32_t rows)
+{
+    auto const alpha = ( 0 == (column + row) % 2 ) ? 255u : 128u;
+    auto const red   = (uint32_t)( (uint64_t)alpha * column / columns );
+    auto const green = (uint32_t)( (uint64_t)alpha * row / rows );
+    auto const blue  = alpha - (red + green) / 2;
+
+    return red | (green << 8) | (blue << 16) | (alpha << 24);
+}
+
+// * writeGridScene
+//
+bool writeGridScene(FILE* file, uint32_t columns, uint32_t rows)
+{
+    const SceneHeader header = {
+        .magic      = sceneMagic,
+        .version    = sceneVersion,
+        .recordSize = sizeof(SceneRect),
+        .rectCount  = columns * rows,
+        .reserved   = 0
+    };
+
+    auto isWritten = (1 == fwrite(&header, sizeof(header), 1, file));
+
+    auto pRects = (SceneRect*)malloc(columns * sizeof(SceneRect));
+
+    if (nullptr == pRects) {
+        return false;
+    }
+
+    auto const cellWidth  = 2.0f / (float)columns;
+    auto const cellHeight = 2.0f / (float)rows;
+
+    for (uint32_t row = 0; isWritten && row < rows; ++row)
+    {
+        for (uint32_t column = 0; column < columns; ++column)
+        {
+            auto const left = -1.0f + cellWidth * (float)column;
+            auto const top  = -1.0f + cellHeight * (float)row;
+
+            pRects[column] = (SceneRect){
+                .left   = left + 0.25f * cellWidth,
+                .top    = top + 0.25f * cellHeight,
+                .right  = left + 0.75f * cellWidth,
+                .bottom = top + 0.75f * cellHeight,
+                .color  = gridColor(column, row, columns, rows)
+            };
+        }
+
+        isWritten = (columns == fwrite(pRects, sizeof(SceneRect), columns, file));
+    }
+
+    free(pRects);
+
+    return isWritten;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main(const int argc, const char* const argv[])
+{
+    uint32_t columns = 0;
+    uint32_t rows    = 0;
+
+    auto isValid = (4 == argc);
+
+    if (isValid)
+    {
+        char* pEnd = nullptr;
+
+        auto const parsedColumns = strtoul(argv[2], &pEnd, 10);
+        isValid = ('\0' == *pEnd);
+
+        auto const parsedRows = strtoul(argv[3], &pEnd, 10);
+        isValid = isValid && ('\0' == *pEnd);
+
+        isValid = isValid && 0 < parsedColumns && parsedColumns <= 65536
+                          && 0 < parsedRows && parsedRows <= 65536
+                          && parsedColumns * parsedRows <= UINT32_MAX;
+
+        columns = (uint32_t)parsedColumns;
+        rows    = (uint32_t)parsedRows;
+    }
+
+    if (!isValid)
+    {
+        printf("usage: %s file columns rows\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto file = fopen(argv[1], "wb");
+
+    if (nullptr == file)
+    {
+        printf("Failed to open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    auto isWritten = writeGridScene(file, columns, rows);
+
+    isWritten = (0 == fclose(file)) && isWritten;
+
+    if (!isWritten)
+    {
+        printf("Failed to write %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    printf( "Wrote %u rectangles to %s\n", columns * rows, argv[1] );
+
+    return EXIT_SUCCESS;
+}
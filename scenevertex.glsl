@@ -0,0 +1,45 @@
+//
+// scenevertex.glsl
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#version 450
+#pragma shader_stage(vertex)
+
+// * One rectangle per instance : left, top, right, bottom in normalized
+//   device coordinates, and a premultiplied color
+//
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+// * Clockwise triangle strip quad, as in vertex.glsl
+//
+//   1   3
+//   | \ |
+//   0   2
+//
+void main()
+{
+    float x = (0 != (gl_VertexIndex & 2)) ? inRect.z : inRect.x;
+    float y = (0 != (gl_VertexIndex & 1)) ? inRect.y : inRect.w;
+
+    gl_Position = vec4(x, y, 0.0, 1.0);
+    outColor    = inColor;
+}
@@ -0,0 +1,269 @@
+//
+// scheduler.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scheduler.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Scheduler
+//
+//====----------------------------------------------------------------------====
+
+// * createScheduler
+//
+bool createScheduler(const SchedulerInfo* pInfo, Scheduler* pScheduler)
+{
+    Scheduler scheduler = {
+        .queueDepth      = pInfo->queueDepth,
+        .maxBatchSize    = pInfo->maxBatchSize,
+        .latencyBudgetMs = pInfo->latencyBudgetMs
+    };
+
+    if ( 0 == scheduler.queueDepth || 0 == scheduler.maxBatchSize ||
+         schedulerMaxBatchSize < scheduler.maxBatchSize )
+    {
+        return false;
+    }
+
+    scheduler.ppJobs = (RenderJob**)calloc(scheduler.queueDepth, sizeof(RenderJob*));
+
+    if (nullptr == scheduler.ppJobs) {
+        return false;
+    }
+
+    if (thrd_success != mtx_init(&scheduler.mutex, mtx_plain))
+    {
+        free(scheduler.ppJobs);
+        return false;
+    }
+
+    cnd_init(&scheduler.jobQueued);
+    cnd_init(&scheduler.jobDone);
+
+    *pScheduler = scheduler;
+
+    return true;
+}
+
+// * destroyScheduler
+//
+void destroyScheduler(Scheduler* pScheduler)
+{
+    cnd_destroy(&pScheduler->jobDone);
+    cnd_destroy(&pScheduler->jobQueued);
+    mtx_destroy(&pScheduler->mutex);
+
+    free(pScheduler->ppJobs);
+
+    memset( pScheduler, 0, sizeof(*pScheduler) );
+}
+
+// * scheduleJob
+//
+ScheduleStatus scheduleJob(Scheduler* pScheduler, RenderJob* pJob)
+{
+    auto status = SCHEDULE_STATUS_QUEUED;
+
+    mtx_lock(&pScheduler->mutex);
+
+    if (pScheduler->isDraining) {
+        status = SCHEDULE_STATUS_DRAINING;
+    }
+    else if (pScheduler->queueDepth == pScheduler->count) {
+        status = SCHEDULE_STATUS_BUSY;
+    }
+    else
+    {
+        pJob->queuedMs   = getTimeMs();
+        pJob->deadlineMs = pJob->queuedMs + pScheduler->latencyBudgetMs;
+        pJob->isDone     = false;
+
+        pScheduler->ppJobs[pScheduler->count++] = pJob;
+
+        cnd_signal(&pScheduler->jobQueued);
+    }
+
+    mtx_unlock(&pScheduler->mutex);
+
+    return status;
+}
+
+// * waitForJob
+//
+void waitForJob(Scheduler* pScheduler, RenderJob* pJob)
+{
+    mtx_lock(&pScheduler->mutex);
+
+    while (!pJob->isDone) {
+        cnd_wait(&pScheduler->jobDone, &pScheduler->mutex);
+    }
+
+    mtx_unlock(&pScheduler->mutex);
+}
+
+// * countCompatibleJobs : queued jobs the size of the oldest one
+//
+uint32_t countCompatibleJobs(const Scheduler* pScheduler)
+{
+    auto const pOldest = pScheduler->ppJobs[0];
+
+    uint32_t count = 0;
+
+    for (uint32_t ii = 0; ii < pScheduler->count; ++ii)
+    {
+        auto const pJob = pScheduler->ppJobs[ii];
+
+        count += (pOldest->width == pJob->width && pOldest->height == pJob->height);
+    }
+
+    return count;
+}
+
+// * toTimespec : absolute CLOCK_REALTIME time for cnd_timedwait, from a
+//                monotonic deadline
+//
+struct timespec toTimespec(double deadlineMs)
+{
+    auto const waitMs = deadlineMs - getTimeMs();
+
+    struct timespec time = {};
+    timespec_get(&time, TIME_UTC);
+
+    auto const nanoseconds = (int64_t)time.tv_nsec
+                           + (int64_t)( 1e6 * ((0.0 < waitMs) ? waitMs : 0.0) );
+
+    time.tv_sec  += (time_t)(nanoseconds / 1000000000);
+    time.tv_nsec  = (long)(nanoseconds % 1000000000);
+
+    return time;
+}
+
+// * takeBatch
+//
+uint32_t takeBatch(Scheduler* pScheduler, RenderJob** ppBatch)
+{
+    mtx_lock(&pScheduler->mutex);
+
+    //  - wait for a full batch, the oldest job's deadline or a drain
+    while (true)
+    {
+        if (0 == pScheduler->count)
+        {
+            if (pScheduler->isDraining) {
+                break;
+            }
+
+            cnd_wait(&pScheduler->jobQueued, &pScheduler->mutex);
+            continue;
+        }
+
+        auto const deadlineMs = pScheduler->ppJobs[0]->deadlineMs;
+
+        if ( pScheduler->isDraining ||
+             pScheduler->maxBatchSize <= countCompatibleJobs(pScheduler) ||
+             deadlineMs <= getTimeMs() )
+        {
+            break;
+        }
+
+        auto const deadline = toTimespec(deadlineMs);
+
+        cnd_timedwait(&pScheduler->jobQueued, &pScheduler->mutex, &deadline);
+    }
+
+    //  - take the oldest job and those of its size, keeping arrival order
+    //    for the remainder
+    uint32_t batchSize = 0;
+    uint32_t kept      = 0;
+
+    if (0 < pScheduler->count)
+    {
+        auto const width  = pScheduler->ppJobs[0]->width;
+        auto const height = pScheduler->ppJobs[0]->height;
+
+        for (uint32_t ii = 0; ii < pScheduler->count; ++ii)
+        {
+            auto const pJob = pScheduler->ppJobs[ii];
+
+            auto const isCompatible = ( width == pJob->width &&
+                                        height == pJob->height &&
+                                        batchSize < pScheduler->maxBatchSize );
+            if (isCompatible) {
+                ppBatch[batchSize++] = pJob;
+            }
+            else {
+                pScheduler->ppJobs[kept++] = pJob;
+            }
+        }
+
+        pScheduler->count = kept;
+    }
+
+    mtx_unlock(&pScheduler->mutex);
+
+    return batchSize;
+}
+
+// * completeBatch
+//
+void completeBatch(Scheduler* pScheduler, RenderJob* const* ppBatch, uint32_t count)
+{
+    mtx_lock(&pScheduler->mutex);
+
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        ppBatch[ii]->batchSize = count;
+        ppBatch[ii]->isDone    = true;
+    }
+
+    cnd_broadcast(&pScheduler->jobDone);
+
+    mtx_unlock(&pScheduler->mutex);
+}
+
+// * drainScheduler
+//
+void drainScheduler(Scheduler* pScheduler)
+{
+    mtx_lock(&pScheduler->mutex);
+
+    pScheduler->isDraining = true;
+    cnd_broadcast(&pScheduler->jobQueued);
+
+    mtx_unlock(&pScheduler->mutex);
+}
+
+// * isSchedulerDraining
+//
+bool isSchedulerDraining(Scheduler* pScheduler)
+{
+    mtx_lock(&pScheduler->mutex);
+
+    auto const isDraining = pScheduler->isDraining;
+
+    mtx_unlock(&pScheduler->mutex);
+
+    return isDraining;
+}
@@ -0,0 +1,128 @@
+//
+// scheduler.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <stdint.h>
+#include <threads.h>
+
+#include "renderer.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Scheduler : coalesces pending render jobs of the same size into batches
+//               rendered with one queue submission (see renderFrameBatch).
+//               A batch is released when it is full, or when its oldest job
+//               has waited for its latency budget
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t schedulerMaxBatchSize = 16;
+
+typedef enum ScheduleStatus
+{
+    SCHEDULE_STATUS_QUEUED   = 0,
+    SCHEDULE_STATUS_BUSY     = 1,   // the queue is full
+    SCHEDULE_STATUS_DRAINING = 2    // no longer accepting jobs
+}
+ScheduleStatus;
+
+// * RenderJob : owned by the caller that scheduled it, and left untouched
+//               by the scheduler once done
+//
+typedef struct RenderJob
+{
+    uint32_t     width;
+    uint32_t     height;
+    double       queuedMs;
+    double       deadlineMs;        // latest release for batching
+    double       startMs;
+    double       endMs;
+    uint32_t     batchSize;         // jobs rendered in the same submission
+    bool         didRender;
+    bool         isDone;
+    ImageContext imageContext;      // unless there is a destination
+
+    //  - caller memory the frame is rendered into, see renderFrameToMemory.
+    //    nullptr : imageContext
+    void*        pDestination;
+    size_t       destinationBytesPerRow;
+}
+RenderJob;
+
+typedef struct SchedulerInfo
+{
+    uint32_t queueDepth;            // jobs waiting to render
+    uint32_t maxBatchSize;          // at most schedulerMaxBatchSize
+    double   latencyBudgetMs;       // 0 : batch only what is already queued
+}
+SchedulerInfo;
+
+typedef struct Scheduler
+{
+    mtx_t       mutex;
+    cnd_t       jobQueued;
+    cnd_t       jobDone;
+    RenderJob** ppJobs;             // in arrival order
+    uint32_t    count;
+    uint32_t    queueDepth;
+    uint32_t    maxBatchSize;
+    double      latencyBudgetMs;
+    bool        isDraining;
+}
+Scheduler;
+
+// * createScheduler
+//
+bool createScheduler(const SchedulerInfo* pInfo, Scheduler* pScheduler);
+
+// * destroyScheduler : the queue must be empty
+//
+void destroyScheduler(Scheduler* pScheduler);
+
+// * scheduleJob : queues the job without waiting for it
+//
+ScheduleStatus scheduleJob(Scheduler* pScheduler, RenderJob* pJob);
+
+// * waitForJob
+//
+void waitForJob(Scheduler* pScheduler, RenderJob* pJob);
+
+// * takeBatch : waits for the next batch, all of one size, and returns the
+//               number of jobs. Zero once draining and empty
+//
+uint32_t takeBatch(Scheduler* pScheduler, RenderJob** ppBatch);
+
+// * completeBatch : fans the results back out to the waiting callers
+//
+void completeBatch(Scheduler* pScheduler, RenderJob* const* ppBatch, uint32_t count);
+
+// * drainScheduler : refuses new jobs. Queued jobs are released at once
+//
+void drainScheduler(Scheduler* pScheduler);
+
+// * isSchedulerDraining
+//
+bool isSchedulerDraining(Scheduler* pScheduler);
+
+// * toTimespec : absolute CLOCK_REALTIME time for cnd_timedwait, from a
+//                getTimeMs deadline
+//
+struct timespec toTimespec(double deadlineMs);
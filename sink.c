@@ -0,0 +1,200 @@
+//
+// sink.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "rendercache.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * squaresink : takes the frames square hands off with --output-socket,
+//                maps each one and hashes its rows, as a pipeline stage
+//                reading them would
+//
+//====----------------------------------------------------------------------====
+
+// * isFrameConsistent : the memfd is sealed, so the producer can neither
+//                       change nor truncate it while it is mapped, and the
+//                       rows lie within it. The header is not trusted
+//
+bool isFrameConsistent(const FrameHeader* pHeader, int memfd)
+{
+    auto const requiredSeals = F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW;
+    auto const seals         = fcntl(memfd, F_GET_SEALS);
+
+    if (seals < 0 || requiredSeals != (seals & requiredSeals)) {
+        return false;
+    }
+
+    struct stat status = {};
+
+    if (0 != fstat(memfd, &status) || (uint64_t)status.st_size != pHeader->size) {
+        return false;
+    }
+
+    //  - divided, as the product of a hostile header could overflow
+    return 0 < pHeader->bytesPerRow && pHeader->dataOffset <= pHeader->size &&
+           pHeader->height <= (pHeader->size - pHeader->dataOffset) / pHeader->bytesPerRow;
+}
+
+// * hashFrame : the leading bytes of the rows' hash, or false when the
+//               memfd could not be mapped
+//
+bool hashFrame(const FrameHeader* pHeader, int memfd, uint64_t* pHash)
+{
+    auto const pData = (const uint8_t*)mmap( nullptr, pHeader->size, PROT_READ,
+                                             MAP_SHARED, memfd, 0 );
+    if (MAP_FAILED == pData) {
+        return false;
+    }
+
+    CacheKeyHasher hasher = {};
+    beginCacheKey(&hasher);
+
+    addCacheKeyData( &hasher, pData + pHeader->dataOffset,
+                     pHeader->bytesPerRow * pHeader->height );
+
+    auto const key = finishCacheKey(&hasher);
+
+    munmap((void*)pData, pHeader->size);
+
+    memcpy(pHash, key.bytes, sizeof(*pHash));
+
+    return true;
+}
+
+// * receiveFrames : from one producer until it disconnects, or the frame
+//                   limit is reached. Returns the number of bytes taken
+//
+uint64_t receiveFrames( int       producer,
+                        uint32_t  frameLimit,
+                        uint32_t* pFrameCount,
+                        bool*     pDidFail )
+{
+    uint64_t    byteCount = 0;
+    FrameHeader header    = {};
+    int         memfd     = -1;
+
+    while (*pFrameCount < frameLimit && receiveFrame(producer, &header, &memfd))
+    {
+        uint64_t hash = 0;
+
+        auto const didHash = isFrameConsistent(&header, memfd) &&
+                             hashFrame(&header, memfd, &hash);
+        close(memfd);
+
+        if (!didHash)
+        {
+            printf("frame %u : inconsistent\n", header.frame);
+            *pDidFail = true;
+            continue;
+        }
+
+        printf( "frame %u : %ux%u, %llu bytes per row, format %u, layout %u, %016llx\n",
+                header.frame, header.width, header.height,
+                (unsigned long long)header.bytesPerRow,
+                header.colorFormat, header.pixelLayout, (unsigned long long)hash );
+
+        byteCount    += header.bytesPerRow * header.height;
+        *pFrameCount += 1;
+    }
+
+    return byteCount;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main(const int argc, const char* const argv[])
+{
+    //  - squaresink socket [--frames n] : producers are served one at a
+    //    time, until n frames have arrived
+    auto frameLimit = UINT32_MAX;
+    auto isValid    = (2 == argc || 4 == argc);
+
+    if (4 == argc)
+    {
+        isValid    = (0 == strcmp(argv[2], "--frames"));
+        frameLimit = (uint32_t)strtoul(argv[3], nullptr, 10);
+    }
+
+    if (!isValid || 0 == frameLimit)
+    {
+        printf("usage: %s socket [--frames n]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto const socketPath = argv[1];
+    auto const listener   = listenForFrames(socketPath);
+
+    if (listener < 0)
+    {
+        printf("Failed to listen on %s\n", socketPath);
+        return EXIT_FAILURE;
+    }
+
+    printf("Listening on %s\n", socketPath);
+    fflush(stdout);
+
+    uint32_t frameCount = 0;
+    uint64_t byteCount  = 0;
+    auto     didFail    = false;
+    auto     start      = 0.0;
+
+    while (frameCount < frameLimit)
+    {
+        auto const producer = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (producer < 0) {
+            break;
+        }
+
+        if (0 == frameCount) {
+            start = getTimeMs();
+        }
+
+        byteCount += receiveFrames(producer, frameLimit, &frameCount, &didFail);
+
+        close(producer);
+    }
+
+    auto const elapsedMs = getTimeMs() - start;
+
+    printf( "%u frames, %.1f frames/s, %.1f MiB/s\n", frameCount,
+            (0.0 < elapsedMs) ? 1e3 * frameCount / elapsedMs : 0.0,
+            (0.0 < elapsedMs) ? 1e3 * (double)byteCount / elapsedMs / (1 << 20) : 0.0 );
+
+    close(listener);
+    unlink(socketPath);
+
+    return didFail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
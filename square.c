@@ -18,1118 +18,1643 @@
 //
 
 #include <vulkan/vulkan.h>
-#include <tiffio.h>
 
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
+#include <threads.h>
+#include <unistd.h>
+
+#include "allocator.h"
+#include "daemon.h"
+#include "encode.h"
+#include "renderer.h"
+#include "scene.h"
+#include "scheduler.h"
+#include "trace.h"
 #include "utilities.h"
 
 //====----------------------------------------------------------------------====
 //
-// * Shader data
+// * Options
 //
 //====----------------------------------------------------------------------====
 
-const uint8_t alignas(uint32_t) vertexShaderData[] = {
-    #embed "vertex.spv"
-};
+// * Encoder threads are capped, and each has at most two frames queued
+//
+constexpr uint32_t maxEncodeThreads     = 64;
+constexpr uint32_t encodeQueuePerThread = 2;
 
-const uint8_t alignas(uint32_t) fragmentShaderData[] = {
-    #embed "fragment.spv"
-};
+// * Render threads are capped at the daemon's limit, per device
+//
+constexpr uint32_t maxRenderThreads = daemonMaxRenderThreads;
+
+// * Devices opened by --device all, at most
+//
+constexpr uint32_t maxDevices = 8;
+
+// * Damage rectangles per incremental frame, past which they are merged
+//
+constexpr uint32_t maxDamageRects = 16;
+
+typedef struct SquareOptions
+{
+    uint32_t          width;
+    uint32_t          height;
+    uint32_t          frameCount;
+    uint32_t          batchSize;            // frames per queue submission
+    const char*       outputPattern;        // '#' runs become the frame number
+    const char*       timingsFilename;
+    const char*       startupTimingsFilename; // nullptr : not written
+    const char*       traceFilename;
+    bool              encode;
+    TIFFWriteOptions  writeOptions;
+
+    //  - frame handoff : frames are rendered into memfds sent to a
+    //    consumer in place of TIFF files, see renderFramesToMemfds
+    const char*       outputSocketPath;
+    int               outputSocket;         // connected in main, -1 : none
+    VkFormat          colorFormat;
+    PixelLayout       pixelLayout;
+    uint32_t          deviceNumber;
+    bool              useAllDevices;        // frames are shared across devices
+    uint32_t          threadCount;          // encoder threads, 0 : inline
+    uint32_t          renderThreadCount;    // per device
+    uint32_t          queueCount;           // 0 : every queue of the family
+    uint32_t          drawCount;            // 0 : one draw
+    uint32_t          recordThreadCount;    // 0 : record inline
+    const char*       sceneFilename;        // nullptr : the built-in square
+    const char*       damagePattern;        // per-frame scenes, nullptr : none
+    uint32_t          sampleCount;          // 1 : no multisampling
+    uint32_t          previewLevels;        // 0 : no previews
+    bool              fastStartup;          // deferred pipeline compile
+    bool              renderToMemory;       // see renderFrameToMemory
+    bool              disableHostImageCopy;
+    bool              useAllocator;
+    HostAllocatorMode allocatorMode;
+    bool              enableValidation;
+
+    //  - daemon mode : serve requests instead of rendering frames
+    const char*       daemonSocketPath;
+    const char*       daemonOutputDirectory;
+    uint32_t          daemonQueueDepth;
+    double            daemonLatencyBudgetMs;
+    const char*       daemonCacheDirectory; // nullptr : no render cache
+    uint32_t          daemonCacheSizeMiB;
+}
+SquareOptions;
 
 //====----------------------------------------------------------------------====
 //
-// * ImageContext
+// * Option values
 //
 //====----------------------------------------------------------------------====
 
-typedef struct ImageContext
+typedef struct NamedValue
 {
-    uint32_t        width;
-    uint32_t        height;
-    VkDeviceSize    bytesPerRow;
-    VkFormat        colorPixelFormat;
-    uint8_t*        data;
+    const char* name;
+    int         value;
 }
-ImageContext;
+NamedValue;
+
+const NamedValue formatNames[] = {
+    { "auto",    VK_FORMAT_UNDEFINED                },
+    { "rgba8",   VK_FORMAT_R8G8B8A8_UNORM           },
+    { "rgb10a2", VK_FORMAT_A2B10G10R10_UNORM_PACK32 },
+    { "rgba16",  VK_FORMAT_R16G16B16A16_UNORM       },
+    { "rgba16f", VK_FORMAT_R16G16B16A16_SFLOAT      }
+};
+
+// * Readback modes : as named by squarebench
+//
+const NamedValue readbackNames[] = {
+    { "copy",      PIXEL_LAYOUT_RGBA_PREMULTIPLIED },
+    { "pack-rgba", PIXEL_LAYOUT_RGBA               },
+    { "pack-rgb",  PIXEL_LAYOUT_RGB                },
+    { "pack-gray", PIXEL_LAYOUT_GRAY               }
+};
+
+const NamedValue compressionNames[] = {
+    { "none",     TIFF_COMPRESSION_NONE     },
+    { "lzw",      TIFF_COMPRESSION_LZW      },
+    { "deflate",  TIFF_COMPRESSION_DEFLATE  },
+    { "packbits", TIFF_COMPRESSION_PACKBITS }
+};
 
-// * disposeImageContext
+const NamedValue allocatorNames[] = {
+    { "none",     -1                           },
+    { "counting", HOST_ALLOCATOR_MODE_COUNTING },
+    { "pooled",   HOST_ALLOCATOR_MODE_POOLED   }
+};
+
+// * findNamedValue
 //
-void disposeImageContext(ImageContext* ctx)
+bool findNamedValue( const NamedValue* pValues,
+                     uint32_t          count,
+                     const char*       name,
+                     int*              pValue )
 {
-    free(ctx->data);
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        if (0 == strcmp(pValues[ii].name, name))
+        {
+            *pValue = pValues[ii].value;
+            return true;
+        }
+    }
 
-    memset( ctx, 0, sizeof(*ctx) );
+    return false;
+}
+
+// * parseUInt : whole argument, decimal
+//
+bool parseUInt(const char* text, uint32_t* pValue)
+{
+    char* end = nullptr;
+
+    auto const value = strtoul(text, &end, 10);
+
+    if (end == text || '\0' != *end || UINT32_MAX < value) {
+        return false;
+    }
+
+    *pValue = (uint32_t)value;
+
+    return true;
+}
+
+// * parseLevelMask : comma separated mip levels, 1 through the most a render
+//                    image has, as a mask of level bits
+//
+bool parseLevelMask(const char* text, uint32_t* pMask)
+{
+    uint32_t mask = 0;
+
+    while (true)
+    {
+        char* end = nullptr;
+
+        auto const level = strtoul(text, &end, 10);
+
+        if (end == text || level < 1 || rendererMaxMipLevels <= level) {
+            return false;
+        }
+
+        mask |= 1u << level;
+
+        if ('\0' == *end) {
+            break;
+        }
+
+        if (',' != *end) {
+            return false;
+        }
+
+        text = end + 1;
+    }
+
+    *pMask = mask;
+
+    return true;
 }
 
 //====----------------------------------------------------------------------====
-// renderImage
+//
+// * Output filenames
+//
 //====----------------------------------------------------------------------====
 
-ImageContext renderImage(uint32_t width, uint32_t height)
+// * hasFramePlaceholder
+//
+bool hasFramePlaceholder(const char* pattern)
 {
-    ImageContext imageContext = {};
+    return nullptr != strchr(pattern, '#');
+}
 
-    //====------------------------------------------------------------------====
-    // * Common layer names
-    //
-    const char* layerNames[] = { "VK_LAYER_KHRONOS_validation" };
-
-    //====------------------------------------------------------------------====
-    // * Instance
-
-    //  - application info
-    const VkApplicationInfo applicationInfo = {
-        .sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-        .pNext              = nullptr,
-        .pApplicationName   = "base",
-        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
-        .pEngineName        = "no engine",
-        .engineVersion      = VK_MAKE_VERSION(0, 0, 0),
-        .apiVersion         = VK_API_VERSION_1_4
-    };
+// * formatOutputFilename : each run of '#' becomes the zero-padded frame
+//                          number, widened as needed
+//
+bool formatOutputFilename( const char* pattern,
+                           uint32_t    frame,
+                           char*       buffer,
+                           size_t      bufferSize )
+{
+    size_t length = 0;
 
-    //  - instance
-    const VkInstanceCreateInfo instanceInfo = {
-        .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-        .pNext                   = nullptr,
-        .flags                   = 0,
-        .pApplicationInfo        = &applicationInfo,
-        .enabledLayerCount       = ARRAY_LENGTH(layerNames),
-        .ppEnabledLayerNames     = layerNames,
-        .enabledExtensionCount   = 0,
-        .ppEnabledExtensionNames = nullptr
-    };
+    for (auto source = pattern; '\0' != *source; )
+    {
+        if ('#' != *source)
+        {
+            if (length + 1 >= bufferSize) {
+                return false;
+            }
 
-    VkInstance instance = nullptr;
+            buffer[length++] = *source++;
+            continue;
+        }
 
-    auto result = vkCreateInstance(&instanceInfo, nullptr, &instance);
+        auto width = 0;
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_instance;
-    }
+        for (; '#' == *source; ++source) {
+            ++width;
+        }
 
-    //====------------------------------------------------------------------====
-    // * Physical device
-    //
-    VkPhysicalDevice physicalDevice = nullptr;
+        auto const written = snprintf( buffer + length, bufferSize - length,
+                                       "%0*u", width, frame );
 
-    result = findFirstGPU(instance, &physicalDevice);
+        if (written < 0 || bufferSize - length <= (size_t)written) {
+            return false;
+        }
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_physical_device;
+        length += (size_t)written;
     }
 
-    //  - memory properties
-    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    buffer[length] = '\0';
 
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    return true;
+}
 
-    //====------------------------------------------------------------------====
-    // * Queue family
-    //
-    uint32_t queueFamilyIndex = 0;
+//====----------------------------------------------------------------------====
+//
+// * Encode queue : frames are handed to encoder threads while the next one
+//                  renders, and taken in frame order however they arrive.
+//                  Bounded to a window of frames past the next one to
+//                  encode, so rendering waits for slow encodes
+//
+//====----------------------------------------------------------------------====
 
-    result = findGraphicsAndComputeQueueFamily(physicalDevice, &queueFamilyIndex);
+typedef struct EncodeJob
+{
+    ImageContext imageContext;
+    FrameMemfd   memfd;             // in place of the image context for a
+                                    // frame handoff, see handOffFrame
+    uint32_t     frame;
+}
+EncodeJob;
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_queue_family_index;
-    }
+// * EncodeSlot : the slot of frame f is f % capacity
+//
+typedef struct EncodeSlot
+{
+    EncodeJob job;
+    bool      isQueued;
+}
+EncodeSlot;
 
-    //====------------------------------------------------------------------====
-    // * Logical device
+typedef struct EncodeQueue
+{
+    mtx_t                mutex;
+    cnd_t                notEmpty;          // the next frame has arrived
+    cnd_t                notFull;           // the window has moved
+    EncodeSlot*          pSlots;
+    uint32_t             capacity;
+    uint32_t             nextFrame;         // next frame to encode
+    bool                 isClosed;
+    atomic_bool          didFail;
+    const SquareOptions* pOptions;
+}
+EncodeQueue;
 
-    //  - device queue
-    auto const queuePriority = 1.0f;
+// * writeFrame : saves the frame, or hands it off
+//
+bool writeFrame( const SquareOptions* pOptions,
+                 const ImageContext*  pImageContext,
+                 uint32_t             frame )
+{
+    if (0 <= pOptions->outputSocket)
+    {
+        auto const didSend = sendFrameCopy(pOptions->outputSocket, pImageContext, frame);
 
-    const VkDeviceQueueCreateInfo deviceQueueInfo = {
-        .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-        .pNext            = nullptr,
-        .flags            = 0,
-        .queueFamilyIndex = queueFamilyIndex,
-        .queueCount       = 1,
-        .pQueuePriorities = &queuePriority
-    };
+        if (!didSend) {
+            printf("Failed to hand off frame %u\n", frame);
+        }
 
-    //  - physical device features
-    const VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
-
-    //  - device
-    const VkDeviceCreateInfo deviceInfo = {
-        .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext                   = nullptr,
-        .flags                   = 0,
-        .queueCreateInfoCount    = 1,
-        .pQueueCreateInfos       = &deviceQueueInfo,
-        .enabledLayerCount       = ARRAY_LENGTH(layerNames),
-        .ppEnabledLayerNames     = layerNames,
-        .enabledExtensionCount   = 0,
-        .ppEnabledExtensionNames = nullptr,
-        .pEnabledFeatures        = &physicalDeviceFeatures
-    };
+        return didSend;
+    }
 
-    VkDevice device = nullptr;
+    char filename[4096] = {};
 
-    result = vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device);
+    auto didSave = formatOutputFilename( pOptions->outputPattern, frame,
+                                         filename, sizeof(filename) );
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_device;
+    if (didSave)
+    {
+        didSave = saveRGBATIFFFile( filename, pImageContext,
+                                    &pOptions->writeOptions );
     }
 
-    //  - queue
-    //
-    VkQueue queue = nullptr;
+    if (!didSave) {
+        printf("Failed to save frame %u\n", frame);
+    }
 
-    vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+    return didSave;
+}
 
-    //====------------------------------------------------------------------====
-    // * Command pool
-    //
-    const VkCommandPoolCreateInfo commandPoolInfo = {
-        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .pNext            = nullptr,
-        .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        .queueFamilyIndex = queueFamilyIndex
-    };
+// * encodeFrame : writeFrame, taking ownership of the image context
+//
+bool encodeFrame( const SquareOptions* pOptions,
+                  ImageContext*        pImageContext,
+                  uint32_t             frame )
+{
+    auto const didWrite = writeFrame(pOptions, pImageContext, frame);
 
-    VkCommandPool commandPool = nullptr;
+    disposeImageContext(pImageContext);
 
-    result = vkCreateCommandPool(device, &commandPoolInfo, nullptr, &commandPool);
+    return didWrite;
+}
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_command_pool;
+// * handOffFrame : sends the frame's sealed memfd, taking ownership of it.
+//                  Sent by the one encoder thread, or inline by the one
+//                  render thread, so frames reach the consumer in order
+//
+bool handOffFrame(const SquareOptions* pOptions, FrameMemfd* pMemfd)
+{
+    auto const didSend = sendFrame(pOptions->outputSocket, pMemfd);
+
+    if (!didSend) {
+        printf("Failed to hand off frame %u\n", pMemfd->header.frame);
     }
 
-    //====------------------------------------------------------------------====
-    // * Pipeline cache
-    //
-    const VkPipelineCacheCreateInfo pipelineCacheInfo = {
-        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-        .pNext           = nullptr,
-        .flags           = 0,
-        .initialDataSize = 0,
-        .pInitialData    = nullptr
-    };
+    disposeFrameMemfd(pMemfd);
 
-    VkPipelineCache pipelineCache = nullptr;
+    return didSend;
+}
+
+// * pushEncodeJob : waits for the frame to fit the window. False when the
+//                   queue has been closed
+//
+bool pushEncodeJob(EncodeQueue* pQueue, const EncodeJob* pJob)
+{
+    mtx_lock(&pQueue->mutex);
 
-    result = vkCreatePipelineCache( device, &pipelineCacheInfo, nullptr,
-                                    &pipelineCache );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_pipeline_cache;
+    while ( pQueue->nextFrame + pQueue->capacity <= pJob->frame &&
+            !pQueue->isClosed )
+    {
+        cnd_wait(&pQueue->notFull, &pQueue->mutex);
     }
 
-    //====------------------------------------------------------------------====
-    // * Shaders
-    
-    //  - vertex
-    const VkShaderModuleCreateInfo vertexShaderInfo = {
-        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .pNext    = nullptr,
-        .flags    = 0,
-        .codeSize = sizeof(vertexShaderData),
-        .pCode    = (const uint32_t*)vertexShaderData
-    };
+    auto const isClosed = pQueue->isClosed;
 
-    VkShaderModule vertexShader = nullptr;
+    if (!isClosed)
+    {
+        auto const pSlot = &pQueue->pSlots[pJob->frame % pQueue->capacity];
 
-    result = vkCreateShaderModule( device, &vertexShaderInfo, nullptr,
-                                   &vertexShader );
+        pSlot->job      = *pJob;
+        pSlot->isQueued = true;
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_vertex_shader;
+        if (pQueue->nextFrame == pJob->frame) {
+            cnd_signal(&pQueue->notEmpty);
+        }
     }
 
-    //  - fragment
-    const VkShaderModuleCreateInfo fragmentShaderInfo = {
-        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .pNext    = nullptr,
-        .flags    = 0,
-        .codeSize = sizeof(fragmentShaderData),
-        .pCode    = (const uint32_t*)fragmentShaderData
-    };
+    mtx_unlock(&pQueue->mutex);
 
-    VkShaderModule fragmentShader = nullptr;
+    return !isClosed;
+}
+
+// * popEncodeJob : the next frame in order. Once the queue is closed,
+//                  frames that never arrived are skipped, and false is
+//                  returned when none are left
+//
+bool popEncodeJob(EncodeQueue* pQueue, EncodeJob* pJob)
+{
+    mtx_lock(&pQueue->mutex);
 
-    result = vkCreateShaderModule( device, &fragmentShaderInfo, nullptr,
-                                   &fragmentShader );
+    auto pSlot = &pQueue->pSlots[pQueue->nextFrame % pQueue->capacity];
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_fragment_shader;
+    while (!pSlot->isQueued && !pQueue->isClosed)
+    {
+        cnd_wait(&pQueue->notEmpty, &pQueue->mutex);
+        pSlot = &pQueue->pSlots[pQueue->nextFrame % pQueue->capacity];
     }
 
-    //  - stages
-    const VkPipelineShaderStageCreateInfo shaderStages[] = {
-        {
-            .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext               = nullptr,
-            .flags               = 0,
-            .stage               = VK_SHADER_STAGE_VERTEX_BIT,
-            .module              = vertexShader,
-            .pName               = "main",
-            .pSpecializationInfo = nullptr
-        },
-        {
-            .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .pNext               = nullptr,
-            .flags               = 0,
-            .stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module              = fragmentShader,
-            .pName               = "main",
-            .pSpecializationInfo = nullptr
-        }
-    };
+    for (uint32_t ii = 1; !pSlot->isQueued && ii < pQueue->capacity; ++ii) {
+        pSlot = &pQueue->pSlots[(pQueue->nextFrame + ii) % pQueue->capacity];
+    }
 
-    //====------------------------------------------------------------------====
-    // * Fixed function settings
-
-    //  - vertex input
-    const VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
-        .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .pNext                           = nullptr,
-        .flags                           = 0,
-        .vertexBindingDescriptionCount   = 0,
-        .pVertexBindingDescriptions      = nullptr,
-        .vertexAttributeDescriptionCount = 0,
-        .pVertexAttributeDescriptions    = nullptr
-    };
+    auto const hasJob = pSlot->isQueued;
 
-    //  - input assembly
-    const VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {
-        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .pNext                  = nullptr,
-        .flags                  = 0,
-        .topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
-        .primitiveRestartEnable = false
-    };
+    if (hasJob)
+    {
+        *pJob = pSlot->job;
 
-    //  - viewport
-    const VkViewport viewport = {
-        .x        = 0.0f,
-        .y        = 0.0f,
-        .width    = (float)width,
-        .height   = (float)height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f
-    };
+        pSlot->isQueued   = false;
+        pQueue->nextFrame = pJob->frame + 1;
 
-    const VkRect2D scissor = {
-        .offset = { 0, 0 }, 
-        .extent = { width, height } 
-    };
+        //  - producers waiting on the window, and the encoder for the next
+        //    frame when it is already here
+        cnd_broadcast(&pQueue->notFull);
 
-    const VkPipelineViewportStateCreateInfo viewportInfo = {
-        .sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .pNext         = nullptr,
-        .flags         = 0,
-        .viewportCount = 1,
-        .pViewports    = &viewport,
-        .scissorCount  = 1,
-        .pScissors     = &scissor
-    };
+        if (pQueue->pSlots[pQueue->nextFrame % pQueue->capacity].isQueued) {
+            cnd_signal(&pQueue->notEmpty);
+        }
+    }
 
-    //  - rasterization
-    const VkPipelineRasterizationStateCreateInfo rasterizationInfo = {
-        .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .pNext                   = nullptr,
-        .flags                   = 0,
-        .depthClampEnable        = false,
-        .rasterizerDiscardEnable = false,
-        .polygonMode             = VK_POLYGON_MODE_FILL,
-        .cullMode                = VK_CULL_MODE_BACK_BIT,
-        .frontFace               = VK_FRONT_FACE_CLOCKWISE, 
-        .depthBiasEnable         = false,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp          = 0.0f,
-        .depthBiasSlopeFactor    = 0.0f,
-        .lineWidth               = 1.0f
-    };
+    mtx_unlock(&pQueue->mutex);
 
-    //  - multisampling
-    const VkPipelineMultisampleStateCreateInfo multisamplingInfo = {
-        .sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .pNext                 = nullptr,
-        .flags                 = 0,
-        .rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT,
-        .sampleShadingEnable   = false,
-        .minSampleShading      = 1.0f,
-        .pSampleMask           = nullptr,
-        .alphaToCoverageEnable = false,
-        .alphaToOneEnable      = false
-    };
+    return hasJob;
+}
 
-    //  - blend mode
-    const VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-        .blendEnable         = false,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .colorBlendOp        = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp        = VK_BLEND_OP_ADD,
-        .colorWriteMask      = VK_COLOR_COMPONENT_R_BIT
-                             | VK_COLOR_COMPONENT_G_BIT
-                             | VK_COLOR_COMPONENT_B_BIT
-                             | VK_COLOR_COMPONENT_A_BIT
-    };
+// * closeEncodeQueue : workers finish the queued frames, then exit
+//
+void closeEncodeQueue(EncodeQueue* pQueue)
+{
+    mtx_lock(&pQueue->mutex);
 
-    const VkPipelineColorBlendStateCreateInfo colorBlendInfo = {
-        .sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .pNext           = nullptr,
-        .flags           = 0,
-        .logicOpEnable   = false,
-        .logicOp         = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
-        .pAttachments    = &colorBlendAttachment,
-        .blendConstants  = { 0.0f, 0.0f, 0.0f, 0.0f }
-    };
+    pQueue->isClosed = true;
 
-    //  - dynamic states
-    const VkPipelineDynamicStateCreateInfo dynamicStateInfo = {
-        .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .pNext             = nullptr,
-        .flags             = 0,
-        .dynamicStateCount = 0,
-        .pDynamicStates    = nullptr
-    };
+    cnd_broadcast(&pQueue->notEmpty);
+    cnd_broadcast(&pQueue->notFull);
 
-    //====------------------------------------------------------------------====
-    // * Pipeline layout
-    //
-    const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
-        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .pNext                  = nullptr,
-        .flags                  = 0,
-        .setLayoutCount         = 0,
-        .pSetLayouts            = nullptr,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges    = nullptr
-    };
+    mtx_unlock(&pQueue->mutex);
+}
+
+// * encodeThread
+//
+int encodeThread(void* pArgument)
+{
+    auto const pQueue = (EncodeQueue*)pArgument;
+
+    EncodeJob job = {};
 
-    VkPipelineLayout pipelineLayout = nullptr;
+    auto const pOptions    = pQueue->pOptions;
+    auto const isHandedOff = (0 <= pOptions->outputSocket);
 
-    result = vkCreatePipelineLayout( device, &pipelineLayoutInfo, nullptr,
-                                     &pipelineLayout );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_pipeline_layout;
+    while (popEncodeJob(pQueue, &job))
+    {
+        auto const didEncode = isHandedOff
+                             ? handOffFrame(pOptions, &job.memfd)
+                             : encodeFrame(pOptions, &job.imageContext, job.frame);
+        if (!didEncode) {
+            atomic_store(&pQueue->didFail, true);
+        }
     }
 
-    //====------------------------------------------------------------------====
-    // * Render pass
+    return 0;
+}
 
-    //  - color attachment
-    const VkAttachmentDescription colorAttachment = {
-        .flags          = 0,
-        .format         = VK_FORMAT_R8G8B8A8_UNORM,
-        .samples        = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout    = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-    };
+//====----------------------------------------------------------------------====
+//
+// * Render
+//
+//====----------------------------------------------------------------------====
 
-    //  - subpass
-    const VkAttachmentReference colorAttachmentRef = {
-        .attachment = 0,
-        .layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    };
+// * FrameWorker : one render thread, with its own targets and queue on
+//                 one of the devices
+//
+typedef struct FrameWorker
+{
+    const SquareOptions* pOptions;
+    Renderer*            pRenderer;
+    FrameTimings*        pTimings;
+    EncodeQueue*         pEncodeQueue;      // null : encode inline
+    atomic_uint*         pNextFrame;
+    atomic_bool*         pDidFail;
+    uint32_t             queueIndex;
+    double               startMs;
+
+    //  - throughput, read once the worker has been joined
+    uint32_t             frameCount;
+    double               finishMs;          // since startMs
+}
+FrameWorker;
 
-    const VkSubpassDescription subpass = {
-        .flags                   = 0,
-        .pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
-        .inputAttachmentCount    = 0,
-        .pInputAttachments       = nullptr,
-        .colorAttachmentCount    = 1,
-        .pColorAttachments       = &colorAttachmentRef,
-        .pResolveAttachments     = nullptr,
-        .pDepthStencilAttachment = nullptr,
-        .preserveAttachmentCount = 0,
-        .pPreserveAttachments    = nullptr
-    };
+// * renderFramesToMemory : each frame on its own target, into memory the
+//                          image context owns, aligned for the device to
+//                          import it. pTimings holds frameCount timings
+//
+VkResult renderFramesToMemory( Renderer*            pRenderer,
+                               RenderTarget* const* ppTargets,
+                               uint32_t             frameCount,
+                               ImageContext*        pImageContexts,
+                               FrameTimings*        pTimings )
+{
+    auto const colorPixelFormat = readbackColorFormat(pRenderer);
+    auto const alignment        = (0 != pRenderer->hostPointerAlignment)
+                                ? (size_t)pRenderer->hostPointerAlignment
+                                : alignof(max_align_t);
+    auto result = VK_SUCCESS;
 
-    //  - subpass dependency : post-image render only. A second, preceding
-    //                         dependency would be added for copying, for
-    //                         example, vertex buffer data to the device
-    const VkSubpassDependency subpassDependency = {
-        .srcSubpass      = 0,
-        .dstSubpass      = VK_SUBPASS_EXTERNAL,
-        .srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstStageMask    = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        .srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
-                         | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-        .dstAccessMask   = VK_ACCESS_MEMORY_READ_BIT,
-        .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
-    };
+    for (uint32_t ff = 0; ff < frameCount && VK_SUCCESS == result; ++ff)
+    {
+        auto const pTarget     = ppTargets[ff];
+        auto const bytesPerRow = (size_t)pTarget->width * formatBytesPerPixel(colorPixelFormat);
+        auto const size        = (bytesPerRow * pTarget->height + alignment - 1)
+                               / alignment * alignment;
+
+        pImageContexts[ff] = (ImageContext){
+            .width            = pTarget->width,
+            .height           = pTarget->height,
+            .bytesPerRow      = bytesPerRow,
+            .colorPixelFormat = colorPixelFormat,
+            .pixelLayout      = pRenderer->pixelLayout,
+            .data             = (uint8_t*)aligned_alloc(alignment, size)
+        };
+
+        result = (nullptr != pImageContexts[ff].data)
+               ? renderFrameToMemory( pRenderer, pTarget, pImageContexts[ff].data,
+                                      bytesPerRow, &pTimings[ff] )
+               : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
 
-    //  - render pass
-    const VkRenderPassCreateInfo renderPassInfo = {
-        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .pNext           = nullptr,
-        .flags           = 0,
-        .attachmentCount = 1,
-        .pAttachments    = &colorAttachment,
-        .subpassCount    = 1,
-        .pSubpasses      = &subpass,
-        .dependencyCount = 1,
-        .pDependencies   = &subpassDependency
-    };
+    return result;
+}
 
-    VkRenderPass renderPass = nullptr;
+// * renderFramesToMemfds : each frame on its own target, straight into a
+//                          memfd of its own, then sealed. Every memfd is
+//                          left for the caller to dispose, -1 where none
+//                          was created. pTimings holds frameCount timings
+//
+VkResult renderFramesToMemfds( Renderer*            pRenderer,
+                               RenderTarget* const* ppTargets,
+                               uint32_t             first,
+                               uint32_t             frameCount,
+                               FrameMemfd*          pMemfds,
+                               FrameTimings*        pTimings )
+{
+    auto const colorFormat = readbackColorFormat(pRenderer);
+    auto result            = VK_SUCCESS;
 
-    result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+    for (uint32_t ff = 0; ff < frameCount; ++ff) {
+        pMemfds[ff] = (FrameMemfd){ .fd = -1 };
+    }
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_render_pass;
+    for (uint32_t ff = 0; ff < frameCount && VK_SUCCESS == result; ++ff)
+    {
+        auto const pTarget     = ppTargets[ff];
+        auto const pMemfd      = &pMemfds[ff];
+        auto const bytesPerRow = (uint64_t)pTarget->width * formatBytesPerPixel(colorFormat);
+
+        result = createFrameMemfd( pTarget->width, pTarget->height, bytesPerRow,
+                                   colorFormat, pRenderer->pixelLayout, first + ff, pMemfd )
+               ? renderFrameToMemory( pRenderer, pTarget,
+                                      pMemfd->pMapping + pMemfd->header.dataOffset,
+                                      bytesPerRow, &pTimings[ff] )
+               : VK_ERROR_OUT_OF_HOST_MEMORY;
+
+        if (VK_SUCCESS == result && !sealFrameMemfd(pMemfd)) {
+            result = VK_ERROR_UNKNOWN;
+        }
     }
 
-    //====--------------------------------------------------------------====
-    // * Pipeline
-    //
-    const VkGraphicsPipelineCreateInfo pipelineInfo = {
-        .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext               = nullptr,
-        .flags               = 0,
-        .stageCount          = ARRAY_LENGTH(shaderStages),
-        .pStages             = shaderStages,
-        .pVertexInputState   = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssemblyInfo,
-        .pTessellationState  = nullptr,
-        .pViewportState      = &viewportInfo,
-        .pRasterizationState = &rasterizationInfo,
-        .pMultisampleState   = &multisamplingInfo,
-        .pDepthStencilState  = nullptr,
-        .pColorBlendState    = &colorBlendInfo,
-        .pDynamicState       = &dynamicStateInfo,
-        .layout              = pipelineLayout,
-        .renderPass          = renderPass,
-        .subpass             = 0,
-        .basePipelineHandle  = nullptr,
-        .basePipelineIndex   = -1
-    };
+    return result;
+}
 
-    VkPipeline graphicsPipeline = nullptr;
-
-    result = vkCreateGraphicsPipelines( device, pipelineCache, 1, &pipelineInfo, 
-                                        nullptr, &graphicsPipeline );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_graphics_pipeline;
-    }
-
-    //  - shader modules no longer in use
-    vkDestroyShaderModule(device, fragmentShader, nullptr);
-    fragmentShader = nullptr;
-
-    vkDestroyShaderModule(device, vertexShader, nullptr);
-    vertexShader = nullptr;
-
-    //====--------------------------------------------------------------====
-    // * Image
-
-    //  - image
-    const VkImageCreateInfo imageInfo = {
-        .sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .pNext                 = nullptr,
-        .flags                 = 0,
-        .imageType             = VK_IMAGE_TYPE_2D,
-        .format                = colorAttachment.format,
-        .extent                = { width, height, 1 },
-        .mipLevels             = 1,
-        .arrayLayers           = 1,
-        .samples               = VK_SAMPLE_COUNT_1_BIT,
-        .tiling                = VK_IMAGE_TILING_OPTIMAL,
-        .usage                 = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
-                               | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 0,
-        .pQueueFamilyIndices   = nullptr,
-        .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
-    };
+// * frameThread : renders batches of frames until none are left or any
+//                 worker has failed. Batches are claimed in frame order
+//                 from a counter every device shares, so a faster device
+//                 takes more of them, and frames reach the encode queue
+//                 close to the order they are written in
+//
+int frameThread(void* pArgument)
+{
+    auto const pWorker  = (FrameWorker*)pArgument;
+    auto const pOptions = pWorker->pOptions;
 
-    VkImage        image       = nullptr;
-    VkDeviceMemory imageMemory = nullptr;
-
-    result = createImageAndMemory( device, &imageInfo, &memoryProperties,
-                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                   &image, &imageMemory );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_image;
-    }
-
-    //  - image view
-    const VkImageViewCreateInfo imageViewInfo = {
-        .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .pNext      = nullptr,
-        .flags      = 0,
-        .image      = image,
-        .viewType   = VK_IMAGE_VIEW_TYPE_2D,
-        .format     = imageInfo.format,
-        .components = {
-            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .a = VK_COMPONENT_SWIZZLE_IDENTITY
-        },
-        .subresourceRange = {
-            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel   = 0,
-            .levelCount     = 1,
-            .baseArrayLayer = 0,
-            .layerCount     = 1
-        }
-    };
+    //  - one target per frame of a batch, all submitted to this worker's
+    //    queue. Batches shrink to the targets that fit the device memory,
+    //    and a worker without any leaves the frames to the others
+    RenderTarget  targets[schedulerMaxBatchSize]   = {};
+    RenderTarget* ppTargets[schedulerMaxBatchSize] = {};
+    uint32_t      targetCount                      = 0;
 
-    VkImageView imageView = nullptr;
+    for (; targetCount < pOptions->batchSize; ++targetCount)
+    {
+        auto const result = createRenderTargetInBudget( pWorker->pRenderer,
+                                                        pOptions->width, pOptions->height,
+                                                        &targets[targetCount] );
+        if (VK_SUCCESS != result) {
+            break;
+        }
 
-    result = vkCreateImageView(device, &imageViewInfo, nullptr, &imageView);
+        targets[targetCount].queueIndex = pWorker->queueIndex;
+        ppTargets[targetCount]          = &targets[targetCount];
+    }
 
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_image_view;
+    if (targetCount < pOptions->batchSize)
+    {
+        printf( "Render thread : %u of %u targets fit the device memory\n",
+                targetCount, pOptions->batchSize );
     }
 
-    //  - framebuffer
-    const VkFramebufferCreateInfo framebufferInfo = {
-        .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-        .pNext           = nullptr,
-        .flags           = 0,
-        .renderPass      = renderPass,
-        .attachmentCount = 1,
-        .pAttachments    = &imageView,
-        .width           = width,
-        .height          = height,
-        .layers          = 1
-    };
+    //  - frames
+    while (0 < targetCount && !atomic_load(pWorker->pDidFail))
+    {
+        auto const first = atomic_fetch_add(pWorker->pNextFrame, targetCount);
 
-    VkFramebuffer framebuffer = nullptr;
+        if (pOptions->frameCount <= first) {
+            break;
+        }
 
-    result = vkCreateFramebuffer( device, &framebufferInfo, nullptr,
-                                  &framebuffer );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_framebuffer;
-    }
+        auto const remaining = pOptions->frameCount - first;
+        auto const batchSize = (remaining < targetCount) ? remaining : targetCount;
 
-    //====-----------------------------------------------------------------====
-    // * Command buffer
+        ImageContext imageContexts[schedulerMaxBatchSize] = {};
+        FrameMemfd   memfds[schedulerMaxBatchSize]        = {};
 
-    //  - allocate
-    const VkCommandBufferAllocateInfo renderCommandBufferInfo = {
-        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext              = nullptr,
-        .commandPool        = commandPool,
-        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1
-    };
+        TRACE_BEGIN(frameSpan, "render batch");
 
-    VkCommandBuffer renderCommandBuffer = nullptr;
+        auto const isHandedOff = pOptions->encode && 0 <= pOptions->outputSocket;
 
-    result = vkAllocateCommandBuffers( device, &renderCommandBufferInfo,
-                                       &renderCommandBuffer );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_render_command_buffer;
-    }
+        auto const result = isHandedOff
+                          ? renderFramesToMemfds( pWorker->pRenderer, ppTargets, first,
+                                                  batchSize, memfds, &pWorker->pTimings[first] )
+                          : pOptions->renderToMemory
+                          ? renderFramesToMemory( pWorker->pRenderer, ppTargets, batchSize,
+                                                  imageContexts, &pWorker->pTimings[first] )
+                          : renderFrameBatch( pWorker->pRenderer, ppTargets, batchSize,
+                                              imageContexts, &pWorker->pTimings[first] );
+        TRACE_END(frameSpan);
 
-    //  - begin
-    const VkCommandBufferBeginInfo renderCommandBufferBeginInfo = {
-        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext            = nullptr,
-        .flags            = 0,
-        .pInheritanceInfo = nullptr
-    };
+        auto didSucceed = true;
 
-    result = vkBeginCommandBuffer(renderCommandBuffer, &renderCommandBufferBeginInfo);
+        for (uint32_t bb = 0; bb < batchSize; ++bb)
+        {
+            auto const frame         = first + bb;
+            auto const pImageContext = &imageContexts[bb];
+            auto const pMemfd        = &memfds[bb];
 
-    if (VK_SUCCESS != result) {
-        goto post_render_command;
-    }
+            auto const isRendered = isHandedOff ? (0 <= pMemfd->fd)
+                                                : (nullptr != pImageContext->data);
 
-    //  - render pass
-    const VkClearValue clearValues[] = {
-        { .color = { .float32 = { 0.1f, 0.0f, 0.1f, 1.0f } } }
-    };
+            if (VK_SUCCESS != result || !isRendered || !didSucceed)
+            {
+                if (didSucceed) {
+                    printf("Failed to render frame %u\n", frame);
+                }
 
-    const VkRenderPassBeginInfo renderPassBeginInfo = {
-        .sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .pNext       = nullptr,
-        .renderPass  = renderPass,
-        .framebuffer = framebuffer,
-        .renderArea  = { 
-            .offset = { 0, 0 }, 
-            .extent = { width, height } 
-        },
-        .clearValueCount = ARRAY_LENGTH(clearValues),
-        .pClearValues    = clearValues
-    };
+                disposeImageContext(pImageContext);
 
-    vkCmdBeginRenderPass( renderCommandBuffer, &renderPassBeginInfo,
-                          VK_SUBPASS_CONTENTS_INLINE );
+                if (isHandedOff) {
+                    disposeFrameMemfd(pMemfd);
+                }
 
-    //  - pipeline
-    vkCmdBindPipeline( renderCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                       graphicsPipeline );
+                didSucceed = false;
+            }
+            else if (!pOptions->encode) {
+                disposeImageContext(pImageContext);
+            }
+            else if (nullptr != pWorker->pEncodeQueue)
+            {
+                const EncodeJob job = {
+                    .imageContext = *pImageContext,
+                    .memfd        = *pMemfd,
+                    .frame        = frame
+                };
+
+                if (!pushEncodeJob(pWorker->pEncodeQueue, &job))
+                {
+                    disposeImageContext(pImageContext);
+
+                    if (isHandedOff) {
+                        disposeFrameMemfd(pMemfd);
+                    }
+                }
+            }
+            else if (isHandedOff) {
+                didSucceed = handOffFrame(pOptions, pMemfd);
+            }
+            else {
+                didSucceed = encodeFrame(pOptions, pImageContext, frame);
+            }
+        }
 
-    //  - draw
-    vkCmdDraw(renderCommandBuffer, 4, 1, 0, 0);
+        if (!didSucceed)
+        {
+            atomic_store(pWorker->pDidFail, true);
 
-    //  - end
-    vkCmdEndRenderPass(renderCommandBuffer);
+            //  - frames of this batch will never arrive, so workers
+            //    waiting on the encode window are released
+            if (nullptr != pWorker->pEncodeQueue) {
+                closeEncodeQueue(pWorker->pEncodeQueue);
+            }
+        }
 
-    result = vkEndCommandBuffer(renderCommandBuffer);
+        pWorker->frameCount += batchSize;
+        pWorker->finishMs    = getTimeMs() - pWorker->startMs;
+    }
 
-    if (VK_SUCCESS != result) {
-        goto post_render_command;
+    for (uint32_t tt = 0; tt < targetCount; ++tt) {
+        destroyRenderTarget(pWorker->pRenderer, &targets[tt]);
     }
 
-    //  - submit command buffer
-    result = submitCommandBuffer(device, queue, renderCommandBuffer);
+    return 0;
+}
+
+// * readFrameScene : the records of a frame's scene file, which the caller
+//                    frees
+//
+bool readFrameScene( const SquareOptions* pOptions,
+                     uint32_t             frame,
+                     SceneRect**          ppRects,
+                     uint32_t*            pRectCount )
+{
+    char filename[4096] = {};
 
-    if (VK_SUCCESS != result) {
-        goto post_render_command;
+    auto const didRead = formatOutputFilename( pOptions->damagePattern, frame,
+                                               filename, sizeof(filename) )
+                      && VK_SUCCESS == readSceneRects(filename, ppRects, pRectCount);
+    if (!didRead) {
+        printf("Failed to read the scene of frame %u\n", frame);
     }
 
-    //  - wait for events to complete
-    vkQueueWaitIdle(queue);
+    return didRead;
+}
 
-    //  - command buffer no longer in use
-    vkFreeCommandBuffers(device, commandPool, 1, &renderCommandBuffer);
-    renderCommandBuffer = nullptr;
+// * renderDamageFrames : the first frame in full, then each frame's scene is
+//                        compared with the one before. Only the records
+//                        that changed are updated, and only the pixels they
+//                        cover are redrawn and read back, into the frame
+//                        kept on the host between frames
+//
+bool renderDamageFrames( const SquareOptions* pOptions,
+                         Renderer*            pRenderer,
+                         FrameTimings*        pTimings )
+{
+    RenderTarget target    = {};
+    ImageContext frame     = {};
+    SceneRect*   pPrevious = nullptr;
+    uint32_t     rectCount = 0;
 
-    //====------------------------------------------------------------------====
-    // * Destination image
+    auto didSucceed = readFrameScene(pOptions, 0, &pPrevious, &rectCount);
 
-    //  - image
-    const VkImageCreateInfo destImageInfo = {
-        .sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .pNext                 = nullptr,
-        .flags                 = 0,
-        .imageType             = VK_IMAGE_TYPE_2D,
-        .format                = VK_FORMAT_R8G8B8A8_UNORM,
-        .extent                = { width, height, 1 },
-        .mipLevels             = 1,
-        .arrayLayers           = 1,
-        .samples               = VK_SAMPLE_COUNT_1_BIT,
-        .tiling                = VK_IMAGE_TILING_LINEAR,
-        .usage                 = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 0,
-        .pQueueFamilyIndices   = nullptr,
-        .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
-    };
+    if (didSucceed)
+    {
+        didSucceed = VK_SUCCESS == createRenderTarget( pRenderer, pOptions->width,
+                                                       pOptions->height, &target );
+    }
 
-    VkImage        destImage       = nullptr;
-    VkDeviceMemory destImageMemory = nullptr;
+    //  - first frame
+    if (didSucceed)
+    {
+        didSucceed = VK_SUCCESS == renderFrame(pRenderer, &target, &frame, &pTimings[0])
+                  && nullptr != frame.data;
+        if (!didSucceed) {
+            puts("Failed to render frame 0");
+        }
+    }
 
-    result = createImageAndMemory( device, &destImageInfo, &memoryProperties,
-                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-                                   | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                   &destImage,
-                                   &destImageMemory );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_dest_image;
+    if (didSucceed && pOptions->encode) {
+        didSucceed = writeFrame(pOptions, &frame, 0);
     }
 
-    //====------------------------------------------------------------------====
-    // * Copy command
+    //  - each later frame, over the one before
+    for (uint32_t ff = 1; didSucceed && ff < pOptions->frameCount; ++ff)
+    {
+        SceneRect* pNext     = nullptr;
+        uint32_t   nextCount = 0;
 
-    //  - command buffer
-    const VkCommandBufferAllocateInfo copyCommandBufferInfo = {
-        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext              = nullptr,
-        .commandPool        = commandPool,
-        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1
-    };
+        didSucceed = readFrameScene(pOptions, ff, &pNext, &nextCount);
 
-    VkCommandBuffer copyCommandBuffer = nullptr;
+        if (didSucceed && nextCount != rectCount)
+        {
+            printf("The scene of frame %u has %u rectangles, not %u\n", ff, nextCount, rectCount);
+            didSucceed = false;
+        }
 
-    result = vkAllocateCommandBuffers( device, &copyCommandBufferInfo,
-                                       &copyCommandBuffer );
-    if (VK_SUCCESS != result) {
-        goto post_cleanup_copy_command_buffer;
-    }
+        if (!didSucceed)
+        {
+            free(pNext);
+            break;
+        }
 
-    //  - begin
-    const VkCommandBufferBeginInfo copyCommandBufferBeginInfo = {
-        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext            = nullptr,
-        .flags            = 0,
-        .pInheritanceInfo = nullptr
-    };
+        //  - the changed records, as one range
+        uint32_t first = 0;
+        uint32_t end   = rectCount;
 
-    result = vkBeginCommandBuffer(copyCommandBuffer, &copyCommandBufferBeginInfo);
-
-    if (VK_SUCCESS != result) {
-        goto post_copy_command;
-    }
-
-    //  - transition destination image to transfer destination layout
-    const VkImageMemoryBarrier destLayoutBarrier = {
-        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .pNext               = nullptr,
-        .srcAccessMask       = 0,
-        .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
-        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        .srcQueueFamilyIndex = 0,
-        .dstQueueFamilyIndex = 0,
-        .image               = destImage,
-        .subresourceRange = {
-            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel   = 0,
-            .levelCount     = 1,
-            .baseArrayLayer = 0,
-            .layerCount     = 1
+        while (first < end && 0 == memcmp(&pPrevious[first], &pNext[first], sizeof(SceneRect))) {
+            ++first;
         }
-    };
 
-    vkCmdPipelineBarrier( copyCommandBuffer,
-                          VK_PIPELINE_STAGE_TRANSFER_BIT,
-                          VK_PIPELINE_STAGE_TRANSFER_BIT,
-                          0, 0, nullptr, 0, nullptr,
-                          1, &destLayoutBarrier );
-
-    //  - copy image
-    const VkImageCopy imageCopy = {
-        .srcSubresource = {
-            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel       = 0,
-            .baseArrayLayer = 0,
-            .layerCount     = 1
-        },
-        .srcOffset      = { .x = 0, .y = 0, .z = 0 },
-        .dstSubresource = {
-            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel       = 0,
-            .baseArrayLayer = 0,
-            .layerCount     = 1
-        },
-        .dstOffset = { .x = 0, .y = 0, .z = 0 },
-        .extent    = { width, height, 1 }
-    };
+        while (first < end && 0 == memcmp(&pPrevious[end - 1], &pNext[end - 1], sizeof(SceneRect))) {
+            --end;
+        }
+
+        VkRect2D damage[maxDamageRects] = {};
+
+        auto const damageCount = computeSceneDamage( pPrevious, pNext, rectCount,
+                                                     pOptions->width, pOptions->height,
+                                                     damage, maxDamageRects );
+
+        auto result = (first < end)
+                    ? updateRendererScene(pRenderer, first, end - first, &pNext[first])
+                    : VK_SUCCESS;
+
+        if (VK_SUCCESS == result)
+        {
+            TRACE_BEGIN(frameSpan, "render damage");
 
-    vkCmdCopyImage( copyCommandBuffer,
-                    image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    destImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    1, &imageCopy );
-
-    //  - transition destination image to general layout
-    const VkImageMemoryBarrier generalLayoutBarrier = {
-        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .pNext               = nullptr,
-        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT,
-        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
-        .srcQueueFamilyIndex = 0,
-        .dstQueueFamilyIndex = 0,
-        .image               = destImage,
-        .subresourceRange = {
-            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel   = 0,
-            .levelCount     = 1,
-            .baseArrayLayer = 0,
-            .layerCount     = 1
+            result = renderFrameDamage( pRenderer, &target, damage, damageCount,
+                                        &frame, &pTimings[ff] );
+            TRACE_END(frameSpan);
         }
-    };
 
-    vkCmdPipelineBarrier( copyCommandBuffer,
-                          VK_PIPELINE_STAGE_TRANSFER_BIT,
-                          VK_PIPELINE_STAGE_TRANSFER_BIT,
-                          0, 0, nullptr, 0, nullptr,
-                          1, &generalLayoutBarrier );
+        free(pPrevious);
+        pPrevious = pNext;
 
-    //  - end
-    result = vkEndCommandBuffer(copyCommandBuffer);
+        didSucceed = (VK_SUCCESS == result);
 
-    if (VK_SUCCESS != result) {
-        goto post_copy_command;
+        if (!didSucceed) {
+            printf("Failed to render frame %u\n", ff);
+        }
+        else if (pOptions->encode) {
+            didSucceed = writeFrame(pOptions, &frame, ff);
+        }
     }
 
-    //  - submit copy command buffer
-    result = submitCommandBuffer(device, queue, copyCommandBuffer);
+    disposeImageContext(&frame);
 
-    if (VK_SUCCESS != result) {
-        goto post_copy_command;
+    if (0 != target.width) {
+        destroyRenderTarget(pRenderer, &target);
     }
 
-    //  - wait for events to complete
-    vkQueueWaitIdle(queue);
+    free(pPrevious);
 
-    //  - command buffer no longer in use
-    vkFreeCommandBuffers(device, commandPool, 1, &copyCommandBuffer);
-    copyCommandBuffer = nullptr;
+    return didSucceed;
+}
 
-    //====--------------------------------------------------------------====
-    // * Copy destination image to host allocated buffer
+// * reportDeviceThroughput : frames each device rendered, and their rate
+//                            up to its last frame
+//
+void reportDeviceThroughput( const Renderer*    pRenderers,
+                             uint32_t           rendererCount,
+                             const FrameWorker* pWorkers,
+                             uint32_t           workersPerDevice )
+{
+    for (uint32_t dd = 0; dd < rendererCount; ++dd)
+    {
+        uint32_t frameCount = 0;
+        double   finishMs   = 0.0;
 
-    //  - image memory layout
-    const VkImageSubresource destImageSubresource = {
-        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-        .mipLevel   = 0,
-        .arrayLayer = 0
+        for (uint32_t ww = 0; ww < workersPerDevice; ++ww)
+        {
+            auto const pWorker = &pWorkers[dd * workersPerDevice + ww];
+
+            frameCount += pWorker->frameCount;
+            finishMs    = (finishMs < pWorker->finishMs) ? pWorker->finishMs : finishMs;
+        }
+
+        VkPhysicalDeviceProperties properties = {};
+        vkGetPhysicalDeviceProperties(pRenderers[dd].physicalDevice, &properties);
+
+        printf( "Device %u (%s) : %u frames, %.1f frames/s\n",
+                dd, properties.deviceName, frameCount,
+                (0.0 < finishMs) ? 1e3 * frameCount / finishMs : 0.0 );
+    }
+}
+
+// * renderFrames : false if any frame failed to render or encode
+//
+bool renderFrames( const SquareOptions* pOptions,
+                   Renderer*            pRenderers,
+                   uint32_t             rendererCount,
+                   FrameTimings*        pTimings )
+{
+    auto const workerCount = rendererCount * pOptions->renderThreadCount;
+
+    //  - frame handoff : memfds are sent by a single encoder thread, in
+    //    frame order, whenever frames render on more than one thread
+    auto const isHandedOff       = pOptions->encode && 0 <= pOptions->outputSocket;
+    auto const encodeThreadCount = !isHandedOff ? pOptions->threadCount
+                                 : (1 < workerCount || 0 < pOptions->threadCount) ? 1u
+                                                                                  : 0u;
+
+    //  - encoder threads : the window also covers every batch in flight, so
+    //    render threads only wait on it when encoding falls behind
+    EncodeQueue queue = {
+        .capacity = encodeQueuePerThread * encodeThreadCount
+                  + pOptions->batchSize * workerCount,
+        .pOptions = pOptions
     };
 
-    VkSubresourceLayout destImageSubresourceLayout = {};
+    thrd_t   threads[maxEncodeThreads] = {};
+    uint32_t threadCount               = 0;
 
-    vkGetImageSubresourceLayout( device, destImage,
-                                 &destImageSubresource,
-                                 &destImageSubresourceLayout );
-    //  - map memory
-    uint8_t* pDestImageData = nullptr;
+    if (pOptions->encode && 0 < encodeThreadCount)
+    {
+        queue.pSlots = (EncodeSlot*)calloc(queue.capacity, sizeof(EncodeSlot));
 
-    result = vkMapMemory( device, destImageMemory, 0, VK_WHOLE_SIZE, 0,
-                          (void**)&pDestImageData );
+        if ( nullptr != queue.pSlots &&
+             thrd_success == mtx_init(&queue.mutex, mtx_plain) &&
+             thrd_success == cnd_init(&queue.notEmpty) &&
+             thrd_success == cnd_init(&queue.notFull) )
+        {
+            for (; threadCount < encodeThreadCount; ++threadCount)
+            {
+                if (thrd_success != thrd_create( &threads[threadCount],
+                                                 encodeThread, &queue ))
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    //  - render threads : renderThreadCount per device, each taking its
+    //    own queue while there are enough. Frames are encoded inline when
+    //    no encoder thread could start
+    atomic_uint nextFrame = 0;
+    atomic_bool didFail   = false;
 
-    if (VK_SUCCESS != result) {
-        goto post_copy_command;
+    if (isHandedOff && 1 < workerCount && 0 == threadCount)
+    {
+        puts("Failed to start the frame handoff thread");
+        atomic_store(&didFail, true);
     }
 
-    pDestImageData += destImageSubresourceLayout.offset;
+    FrameWorker workers[maxDevices * maxRenderThreads]       = {};
+    thrd_t      renderThreads[maxDevices * maxRenderThreads] = {};
+    uint32_t    renderThreadCount                            = 0;
 
-    //  - copy to local buffer
-    size_t destImageDataSize = (size_t)height * destImageSubresourceLayout.rowPitch;
+    auto const startMs = getTimeMs();
 
-    imageContext.data = malloc(destImageDataSize);
+    for (uint32_t ww = 0; ww < workerCount; ++ww)
+    {
+        auto const pRenderer = &pRenderers[ww / pOptions->renderThreadCount];
+
+        workers[ww] = (FrameWorker){
+            .pOptions     = pOptions,
+            .pRenderer    = pRenderer,
+            .pTimings     = pTimings,
+            .pEncodeQueue = (0 < threadCount) ? &queue : nullptr,
+            .pNextFrame   = &nextFrame,
+            .pDidFail     = &didFail,
+            .queueIndex   = (ww % pOptions->renderThreadCount) % pRenderer->queueCount,
+            .startMs      = startMs
+        };
+    }
 
-    if (nullptr != imageContext.data)
+    for (; 1 < workerCount && renderThreadCount < workerCount; ++renderThreadCount)
     {
-        memcpy(imageContext.data, pDestImageData, destImageDataSize);
+        if (thrd_success != thrd_create( &renderThreads[renderThreadCount],
+                                         frameThread, &workers[renderThreadCount] ))
+        {
+            break;
+        }
+    }
 
-        imageContext.width            = width;
-        imageContext.height           = height;
-        imageContext.colorPixelFormat = destImageInfo.format;
-        imageContext.bytesPerRow      = destImageSubresourceLayout.rowPitch;
+    //  - with a single render thread, or none started, render here
+    if (0 == renderThreadCount) {
+        frameThread(&workers[0]);
     }
 
-    vkUnmapMemory(device, destImageMemory);
-    pDestImageData = nullptr;
+    for (uint32_t ww = 0; ww < renderThreadCount; ++ww) {
+        thrd_join(renderThreads[ww], nullptr);
+    }
 
-    //====------------------------------------------------------------------====
-    // * Cleanup
-    //
+    if (pOptions->useAllDevices)
+    {
+        reportDeviceThroughput( pRenderers, rendererCount, workers,
+                                pOptions->renderThreadCount );
+    }
 
-post_copy_command:
+    auto didSucceed = !atomic_load(&didFail);
 
-    if (nullptr != copyCommandBuffer) {
-        vkFreeCommandBuffers(device, commandPool, 1, &copyCommandBuffer);
-        copyCommandBuffer = nullptr;
+    //  - frames are left unclaimed when no worker had a target that fit
+    if (didSucceed && atomic_load(&nextFrame) < pOptions->frameCount)
+    {
+        puts("No render target fits the device memory");
+        didSucceed = false;
     }
 
-post_cleanup_copy_command_buffer:
-
-    vkDestroyImage(device, destImage, nullptr);
-    destImage = nullptr;
+    //  - drain
+    if (0 < threadCount)
+    {
+        closeEncodeQueue(&queue);
 
-    vkFreeMemory(device, destImageMemory, nullptr);
-    destImageMemory = nullptr;
+        for (uint32_t tt = 0; tt < threadCount; ++tt) {
+            thrd_join(threads[tt], nullptr);
+        }
 
-post_cleanup_dest_image:
-post_render_command:
+        didSucceed = didSucceed && !atomic_load(&queue.didFail);
+    }
 
-    if (nullptr != renderCommandBuffer) {
-        vkFreeCommandBuffers(device, commandPool, 1, &renderCommandBuffer);
-        renderCommandBuffer = nullptr;
+    if (nullptr != queue.pSlots)
+    {
+        cnd_destroy(&queue.notFull);
+        cnd_destroy(&queue.notEmpty);
+        mtx_destroy(&queue.mutex);
+        free(queue.pSlots);
     }
 
-post_cleanup_render_command_buffer:
+    return didSucceed;
+}
 
-    vkDestroyFramebuffer(device, framebuffer, nullptr);
-    framebuffer = nullptr;
+// * createDeviceRenderers : a renderer on every device in enumeration
+//                           order, skipping those without a suitable queue
+//                           family or format
+//
+uint32_t createDeviceRenderers(const RendererInfo* pInfo, Renderer* pRenderers)
+{
+    auto     deviceInfo    = *pInfo;
+    uint32_t rendererCount = 0;
 
-post_cleanup_framebuffer:
+    for ( deviceInfo.deviceNumber = 1; rendererCount < maxDevices;
+          ++deviceInfo.deviceNumber )
+    {
+        auto const result = createRenderer(&deviceInfo, &pRenderers[rendererCount]);
 
-    vkDestroyImageView(device, imageView, nullptr);
-    imageView = nullptr;
+        if (VK_SUCCESS == result) {
+            ++rendererCount;
+        }
+        else if (VK_ERROR_INITIALIZATION_FAILED == result) {
+            break;
+        }
+        else {
+            printf("Skipping device %u\n", deviceInfo.deviceNumber - 1);
+        }
+    }
 
-post_cleanup_image_view:
+    return rendererCount;
+}
 
-    vkDestroyImage(device, image, nullptr);
-    image = nullptr;
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
 
-    vkFreeMemory(device, imageMemory, nullptr);
-    imageMemory = nullptr;
+// * printUsage
+//
+void printUsage(const char* program)
+{
+    auto const indent = (int)strlen(program);
+
+    printf( "usage: %s [--size n | --width n --height n] [--frames n] [--batch n]\n"
+            "       %*s [--output pattern] [--output-socket path] [--no-encode]\n"
+            "       %*s [--timings file]\n"
+            "       %*s [--format auto|rgba8|rgb10a2|rgba16|rgba16f]\n"
+            "       %*s [--readback copy|pack-rgba|pack-rgb|pack-gray]\n"
+            "       %*s [--compression none|lzw|deflate|packbits]\n"
+            "       %*s [--8bit] [--straight-alpha] [--device auto|all|n]\n"
+            "       %*s [--threads n] [--render-threads n] [--queues n]\n"
+            "       %*s [--draws n] [--record-threads n] [--scene file]\n"
+            "       %*s [--damage pattern] [--to-memory] [--no-host-copy]\n"
+            "       %*s [--samples 1|2|4|8] [--previews level,...]\n"
+            "       %*s [--allocator none|counting|pooled]\n"
+            "       %*s [--fast-startup] [--startup-timings file] [--validation]\n"
+            "       %*s [--daemon socket [--queue n] [--output-dir dir]\n"
+            "       %*s                  [--latency-budget ms]\n"
+            "       %*s                  [--cache dir [--cache-size MiB]]]\n"
+            "\n"
+            "  '#' runs in the output pattern are replaced by the frame number,\n"
+            "  and are required for more than one frame: output-####.tiff\n"
+            "\n"
+            "  --output-socket hands each frame to the consumer listening on a\n"
+            "  Unix socket, such as squaresink, as a sealed memfd in place of a\n"
+            "  file. Frames are rendered straight into their memfds, without\n"
+            "  previews, and sent in frame order by a single thread\n"
+            "\n"
+            "  --device all shares frames across every device that can render\n"
+            "  them, with --render-threads threads each. Encoder threads take\n"
+            "  frames in order\n"
+            "\n"
+            "  --scene draws the rectangles of a scene file, such as one written\n"
+            "  by scenegen, in place of the square\n"
+            "\n"
+            "  --damage renders frame n from the scene file the pattern names\n"
+            "  for it, as --output does. After the first frame, only the pixels\n"
+            "  that rectangles changed since the previous frame are redrawn and\n"
+            "  read back\n"
+            "\n"
+            "  --to-memory renders each frame into memory allocated for it,\n"
+            "  which the device copies into directly where it can import it\n"
+            "\n"
+            "  --no-host-copy reads frames back through copy commands even where\n"
+            "  the host could copy the render image itself\n"
+            "\n"
+            "  --samples antialiases with that many samples per pixel, or as many\n"
+            "  as the device supports, resolved before readback\n"
+            "\n"
+            "  --previews downsamples each frame by 2^level for each level given,\n"
+            "  on the GPU, and writes them after the frame as reduced resolution\n"
+            "  pages. Copy readback only\n"
+            "\n"
+            "  --fast-startup draws the first frames with shader objects while\n"
+            "  the graphics pipeline compiles in the background, where the\n"
+            "  device supports VK_EXT_shader_object\n"
+            "\n"
+            "  --startup-timings writes when each phase of the first renderer's\n"
+            "  initialization started and ended\n"
+            "\n"
+            "  --cache keeps the daemon's encoded file replies in a directory,\n"
+            "  which other daemons may share, evicting the least recently used\n"
+            "  past --cache-size\n",
+            program, indent, "", indent, "", indent, "", indent, "",
+            indent, "", indent, "", indent, "", indent, "", indent, "",
+            indent, "", indent, "", indent, "", indent, "", indent, "",
+            indent, "" );
+}
 
-post_cleanup_image:
+// * parseOptions
+//
+bool parseOptions(const int argc, const char* const argv[], SquareOptions* pOptions)
+{
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        auto const arg     = argv[ii];
+        auto const next    = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+        auto       isValid = true;
+        auto       value   = 0;
+
+        if (0 == strcmp(arg, "--no-encode")) {
+            pOptions->encode = false;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--8bit")) {
+            pOptions->writeOptions.narrowTo8Bits = true;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--straight-alpha")) {
+            pOptions->writeOptions.unassociateAlpha = true;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--fast-startup")) {
+            pOptions->fastStartup = true;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--to-memory")) {
+            pOptions->renderToMemory = true;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--no-host-copy")) {
+            pOptions->disableHostImageCopy = true;
+            continue;
+        }
+        else if (0 == strcmp(arg, "--validation")) {
+            pOptions->enableValidation = true;
+            continue;
+        }
+        else if (nullptr == next) {
+            isValid = false;
+        }
+        else if (0 == strcmp(arg, "--size"))
+        {
+            isValid = parseUInt(next, &pOptions->width);
+            pOptions->height = pOptions->width;
+        }
+        else if (0 == strcmp(arg, "--width")) {
+            isValid = parseUInt(next, &pOptions->width);
+        }
+        else if (0 == strcmp(arg, "--height")) {
+            isValid = parseUInt(next, &pOptions->height);
+        }
+        else if (0 == strcmp(arg, "--frames")) {
+            isValid = parseUInt(next, &pOptions->frameCount);
+        }
+        else if (0 == strcmp(arg, "--batch"))
+        {
+            isValid = parseUInt(next, &pOptions->batchSize) &&
+                      0 < pOptions->batchSize &&
+                      pOptions->batchSize <= schedulerMaxBatchSize;
+        }
+        else if (0 == strcmp(arg, "--latency-budget"))
+        {
+            char* end = nullptr;
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    graphicsPipeline = nullptr;
+            pOptions->daemonLatencyBudgetMs = strtod(next, &end);
 
-post_cleanup_graphics_pipeline:
+            isValid = (end != next) && '\0' == *end &&
+                      0.0 <= pOptions->daemonLatencyBudgetMs;
+        }
+        else if (0 == strcmp(arg, "--output")) {
+            pOptions->outputPattern = next;
+        }
+        else if (0 == strcmp(arg, "--output-socket")) {
+            pOptions->outputSocketPath = next;
+        }
+        else if (0 == strcmp(arg, "--timings")) {
+            pOptions->timingsFilename = next;
+        }
+        else if (0 == strcmp(arg, "--startup-timings")) {
+            pOptions->startupTimingsFilename = next;
+        }
+        else if (0 == strcmp(arg, "--daemon")) {
+            pOptions->daemonSocketPath = next;
+        }
+        else if (0 == strcmp(arg, "--output-dir")) {
+            pOptions->daemonOutputDirectory = next;
+        }
+        else if (0 == strcmp(arg, "--cache")) {
+            pOptions->daemonCacheDirectory = next;
+        }
+        else if (0 == strcmp(arg, "--cache-size"))
+        {
+            isValid = parseUInt(next, &pOptions->daemonCacheSizeMiB) &&
+                      0 < pOptions->daemonCacheSizeMiB;
+        }
+        else if (0 == strcmp(arg, "--queue"))
+        {
+            isValid = parseUInt(next, &pOptions->daemonQueueDepth) &&
+                      0 < pOptions->daemonQueueDepth;
+        }
+        else if (0 == strcmp(arg, "--format"))
+        {
+            isValid = findNamedValue( formatNames, ARRAY_LENGTH(formatNames),
+                                      next, &value );
+            pOptions->colorFormat = (VkFormat)value;
+        }
+        else if (0 == strcmp(arg, "--readback"))
+        {
+            isValid = findNamedValue( readbackNames, ARRAY_LENGTH(readbackNames),
+                                      next, &value );
+            pOptions->pixelLayout = (PixelLayout)value;
+        }
+        else if (0 == strcmp(arg, "--compression"))
+        {
+            isValid = findNamedValue( compressionNames, ARRAY_LENGTH(compressionNames),
+                                      next, &value );
+            pOptions->writeOptions.compression = (TIFFCompression)value;
+        }
+        else if (0 == strcmp(arg, "--device"))
+        {
+            //  - device numbers are one past the enumeration index
+            uint32_t index = 0;
 
-    vkDestroyRenderPass(device, renderPass, nullptr);
-    renderPass = nullptr;
+            pOptions->useAllDevices = (0 == strcmp(next, "all"));
 
-post_cleanup_render_pass:
+            isValid = (0 == strcmp(next, "auto")) || pOptions->useAllDevices ||
+                      parseUInt(next, &index);
+            pOptions->deviceNumber = (0 == strcmp(next, "auto")) ? 0 : index + 1;
+        }
+        else if (0 == strcmp(arg, "--threads"))
+        {
+            isValid = parseUInt(next, &pOptions->threadCount) &&
+                      pOptions->threadCount <= maxEncodeThreads;
+        }
+        else if (0 == strcmp(arg, "--render-threads"))
+        {
+            isValid = parseUInt(next, &pOptions->renderThreadCount) &&
+                      0 < pOptions->renderThreadCount &&
+                      pOptions->renderThreadCount <= maxRenderThreads;
+        }
+        else if (0 == strcmp(arg, "--queues")) {
+            isValid = parseUInt(next, &pOptions->queueCount);
+        }
+        else if (0 == strcmp(arg, "--draws")) {
+            isValid = parseUInt(next, &pOptions->drawCount);
+        }
+        else if (0 == strcmp(arg, "--record-threads"))
+        {
+            isValid = parseUInt(next, &pOptions->recordThreadCount) &&
+                      pOptions->recordThreadCount <= rendererMaxRecordThreads;
+        }
+        else if (0 == strcmp(arg, "--scene")) {
+            pOptions->sceneFilename = next;
+        }
+        else if (0 == strcmp(arg, "--damage")) {
+            pOptions->damagePattern = next;
+        }
+        else if (0 == strcmp(arg, "--samples"))
+        {
+            isValid = parseUInt(next, &pOptions->sampleCount) &&
+                      0 < pOptions->sampleCount && pOptions->sampleCount <= 8 &&
+                      0 == (pOptions->sampleCount & (pOptions->sampleCount - 1));
+        }
+        else if (0 == strcmp(arg, "--previews")) {
+            isValid = parseLevelMask(next, &pOptions->previewLevels);
+        }
+        else if (0 == strcmp(arg, "--allocator"))
+        {
+            isValid = findNamedValue( allocatorNames, ARRAY_LENGTH(allocatorNames),
+                                      next, &value );
+            pOptions->useAllocator  = (0 <= value);
+            pOptions->allocatorMode = (0 <= value) ? (HostAllocatorMode)value
+                                                   : HOST_ALLOCATOR_MODE_COUNTING;
+        }
+        else {
+            isValid = false;
+        }
 
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    pipelineLayout = nullptr;
+        if (!isValid)
+        {
+            printf("Invalid argument: %s%s%s\n", arg, next ? " " : "", next ? next : "");
+            return false;
+        }
 
-post_cleanup_pipeline_layout:
+        ++ii;
+    }
 
-    if (nullptr != fragmentShader) {
-        vkDestroyShaderModule(device, fragmentShader, nullptr);
-        fragmentShader = nullptr;
+    //  - consistency
+    if (0 == pOptions->width || 0 == pOptions->height || 0 == pOptions->frameCount)
+    {
+        puts("Width, height and frame count must be positive");
+        return false;
     }
 
-post_cleanup_fragment_shader:
+    if ( pOptions->encode && 1 < pOptions->frameCount &&
+         nullptr == pOptions->outputSocketPath &&
+         !hasFramePlaceholder(pOptions->outputPattern) )
+    {
+        puts("The output pattern needs a '#' run for more than one frame");
+        return false;
+    }
 
-    if (nullptr != vertexShader) {
-        vkDestroyShaderModule(device, vertexShader, nullptr);
-        vertexShader = nullptr;
+    if (pOptions->useAllDevices && nullptr != pOptions->daemonSocketPath)
+    {
+        puts("The daemon renders on a single device");
+        return false;
     }
 
-post_cleanup_vertex_shader:
+    if (nullptr != pOptions->daemonCacheDirectory && nullptr == pOptions->daemonSocketPath)
+    {
+        puts("The render cache serves daemon requests");
+        return false;
+    }
 
-    vkDestroyPipelineCache(device, pipelineCache, nullptr);
-    pipelineCache = nullptr;
+    //  - TIFF samples : copy readback keeps the color format, packed
+    //    readback is 8-bit. Only unsigned samples narrow to 8 bits, and
+    //    alpha is only unassociated from 8-bit samples. auto selects a
+    //    16-bit format
+    if (PIXEL_LAYOUT_RGBA_PREMULTIPLIED == pOptions->pixelLayout)
+    {
+        auto const writeOptions = &pOptions->writeOptions;
+        auto const is16Bit      = VK_FORMAT_R8G8B8A8_UNORM != pOptions->colorFormat;
 
-post_cleanup_pipeline_cache:
+        if ( writeOptions->narrowTo8Bits &&
+             VK_FORMAT_R16G16B16A16_SFLOAT == pOptions->colorFormat )
+        {
+            puts("--8bit narrows unsigned samples, not rgba16f");
+            return false;
+        }
 
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    commandPool = nullptr;
+        if (writeOptions->unassociateAlpha && is16Bit && !writeOptions->narrowTo8Bits)
+        {
+            puts("--straight-alpha needs 8-bit samples, use --8bit with 16-bit formats");
+            return false;
+        }
+    }
 
-post_cleanup_command_pool:
+    //  - damage : one target keeps the frame the next is drawn over
+    if (nullptr != pOptions->damagePattern)
+    {
+        if (1 < pOptions->frameCount && !hasFramePlaceholder(pOptions->damagePattern))
+        {
+            puts("The damage pattern needs a '#' run for more than one frame");
+            return false;
+        }
 
-    vkDestroyDevice(device, nullptr);
-    device = nullptr;
-    queue  = nullptr;
+        if ( nullptr != pOptions->sceneFilename || nullptr != pOptions->daemonSocketPath ||
+             pOptions->useAllDevices || 1 < pOptions->batchSize ||
+             1 < pOptions->renderThreadCount || 0 != pOptions->previewLevels ||
+             pOptions->renderToMemory )
+        {
+            puts( "Damage rendering draws its own scenes, on one target, without "
+                  "previews, batches, caller memory, daemon or other devices" );
+            return false;
+        }
+    }
 
-post_cleanup_device:
+    if ( (pOptions->renderToMemory || nullptr != pOptions->outputSocketPath) &&
+         0 != pOptions->previewLevels )
+    {
+        puts("Frames rendered into memory or memfds have no previews");
+        return false;
+    }
 
-    queueFamilyIndex = 0;
+    return true;
+}
 
-post_cleanup_queue_family_index:
+int main(const int argc, const char* const argv[])
+{
+    SquareOptions options = {
+        .width                 = 1080,
+        .height                = 1080,
+        .frameCount            = 1,
+        .batchSize             = 1,
+        .outputPattern         = "output.tiff",
+        .timingsFilename       = "output.timings.json",
+        .traceFilename         = "output.trace.json",
+        .encode                = true,
+        .writeOptions          = {
+            .narrowTo8Bits    = false,
+            .unassociateAlpha = false,
+            .compression      = TIFF_COMPRESSION_NONE
+        },
+        .outputSocketPath      = nullptr,
+        .outputSocket          = -1,
+        .colorFormat           = VK_FORMAT_R8G8B8A8_UNORM,
+        .pixelLayout           = PIXEL_LAYOUT_RGBA_PREMULTIPLIED,
+        .deviceNumber          = 0,
+        .useAllDevices         = false,
+        .threadCount           = 0,
+        .renderThreadCount     = 1,
+        .queueCount            = 0,
+        .drawCount             = 0,
+        .recordThreadCount     = 0,
+        .sceneFilename         = nullptr,
+        .damagePattern         = nullptr,
+        .sampleCount           = 1,
+        .previewLevels         = 0,
+        .fastStartup           = false,
+        .renderToMemory        = false,
+        .disableHostImageCopy  = false,
+        .useAllocator          = false,
+        .allocatorMode         = HOST_ALLOCATOR_MODE_COUNTING,
+        .enableValidation      = false,
+
+        .daemonSocketPath      = nullptr,
+        .daemonOutputDirectory = ".",
+        .daemonQueueDepth      = 16,
+        .daemonLatencyBudgetMs = 2.0,
+        .daemonCacheDirectory  = nullptr,
+        .daemonCacheSizeMiB    = 1024
+    };
 
-    physicalDevice = nullptr;
+    // * Arguments
+    //
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
 
-post_cleanup_physical_device:
+    // * Renderer : a damage sequence starts from the scene of its first frame
+    //
+    char firstSceneFilename[4096] = {};
 
-    vkDestroyInstance(instance, nullptr);
-    instance = nullptr;
+    if ( nullptr != options.damagePattern &&
+         !formatOutputFilename( options.damagePattern, 0, firstSceneFilename,
+                                sizeof(firstSceneFilename) ) )
+    {
+        puts("The damage pattern is too long");
+        return EXIT_FAILURE;
+    }
 
-post_cleanup_instance:
+    HostAllocator hostAllocator = {};
 
-    return imageContext;
-}
+    if (options.useAllocator) {
+        createHostAllocator(options.allocatorMode, &hostAllocator);
+    }
 
-//====----------------------------------------------------------------------====
-// * saveRGBATIFFFile
-//====----------------------------------------------------------------------====
+    const RendererInfo rendererInfo = {
+        .colorFormat          = options.colorFormat,
+        .pixelLayout          = options.pixelLayout,
+        .enableValidation     = options.enableValidation,
+        .deviceNumber         = options.deviceNumber,
+        .queueCount           = options.queueCount,
+        .drawCount            = options.drawCount,
+        .recordThreadCount    = options.recordThreadCount,
+        .sceneFilename        = (nullptr != options.damagePattern)
+                                ? firstSceneFilename : options.sceneFilename,
+        .sampleCount          = (VkSampleCountFlagBits)options.sampleCount,
+        .previewLevels        = options.previewLevels,
+        .deferPipelineCompile = options.fastStartup,
+        .disableHostImageCopy = options.disableHostImageCopy,
+        .pAllocator           = options.useAllocator
+                                ? getHostAllocationCallbacks(&hostAllocator)
+                                : nullptr
+    };
 
-bool saveRGBATIFFFile( const char*    filename,
-                       const uint8_t* imageData,
-                       uint32_t       width,
-                       uint32_t       height,
-                       size_t         bytesPerRow )
-{
-    auto file = TIFFOpen(filename, "w");
+    Renderer renderers[maxDevices] = {};
+    uint32_t rendererCount         = 0;
 
-    if (nullptr == file) {
-        return false;
+    TRACE_BEGIN(rendererSpan, "create renderer");
+
+    if (options.useAllDevices) {
+        rendererCount = createDeviceRenderers(&rendererInfo, renderers);
+    }
+    else if (VK_SUCCESS == createRenderer(&rendererInfo, &renderers[0])) {
+        rendererCount = 1;
     }
 
-    //  - image properties
-    TIFFSetField(file, TIFFTAG_IMAGEWIDTH, width);
-    TIFFSetField(file, TIFFTAG_IMAGELENGTH, height);
-    TIFFSetField(file, TIFFTAG_SAMPLESPERPIXEL, 4);
-    TIFFSetField(file, TIFFTAG_BITSPERSAMPLE, 8);
-    TIFFSetField(file, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-    TIFFSetField(file, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-    TIFFSetField(file, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    TRACE_END(rendererSpan);
 
-    const uint16_t extraSample = EXTRASAMPLE_ASSOCALPHA;
-    TIFFSetField(file, TIFFTAG_EXTRASAMPLES, 1, &extraSample);
+    if (0 == rendererCount)
+    {
+        puts("Failed to create renderer");
+        destroyHostAllocator(&hostAllocator);
+        return EXIT_FAILURE;
+    }
 
-    TIFFSetField( file, TIFFTAG_ROWSPERSTRIP,
-                  TIFFDefaultStripSize(file, 4*width) );
+    //  - devices may support fewer samples than requested, or no previews
+    for (uint32_t rr = 0; rr < rendererCount; ++rr)
+    {
+        if ((uint32_t)renderers[rr].sampleCount < options.sampleCount)
+        {
+            printf( "Renderer %u : %u samples per pixel, the most supported\n",
+                    rr, (uint32_t)renderers[rr].sampleCount );
+        }
 
-    //  - scan line buffer
-    auto const preferredScanlineSize = (size_t)TIFFScanlineSize(file);
-    
-    auto const scanlineSize = (0 < preferredScanlineSize)
-                               ? preferredScanlineSize
-                               : bytesPerRow;
+        if (renderers[rr].previewLevels != options.previewLevels) {
+            printf("Renderer %u : previews are not supported\n", rr);
+        }
+    }
 
-    auto scanlineBuffer = (uint8_t*)_TIFFmalloc(scanlineSize);
-    auto result         = false;
+    //  - startup timings
+    auto startupFile = (nullptr != options.startupTimingsFilename)
+                     ? fopen(options.startupTimingsFilename, "w") : nullptr;
 
-    if (nullptr != scanlineBuffer)
+    if (nullptr != startupFile)
     {
-        //  - write each scanline
-        auto const rowCopySize = (scanlineSize < bytesPerRow)
-                                  ? scanlineSize
-                                  : bytesPerRow;
+        writeStartupReport(startupFile, &renderers[0].startupTimings);
+        fclose(startupFile);
+    }
 
-        const uint8_t* row         = imageData;
-        int            writeResult = -1;
+    // * Daemon : the renderer stays warm across requests
+    //
+    if (nullptr != options.daemonSocketPath)
+    {
+        RenderCache cache    = {};
+        auto        hasCache = (nullptr != options.daemonCacheDirectory);
 
-        for (uint32_t yy = 0; yy < height; ++yy)
+        if ( hasCache && !openRenderCache( options.daemonCacheDirectory,
+                                           (uint64_t)options.daemonCacheSizeMiB << 20,
+                                           &cache ) )
         {
-            memcpy(scanlineBuffer, row, rowCopySize);            
+            printf("Failed to open render cache %s\n", options.daemonCacheDirectory);
+            closeRenderCache(&cache);
+            hasCache = false;
+        }
 
-            writeResult = TIFFWriteScanline(file, scanlineBuffer, yy, 0);
+        const DaemonOptions daemonOptions = {
+            .socketPath        = options.daemonSocketPath,
+            .outputDirectory   = options.daemonOutputDirectory,
+            .queueDepth        = options.daemonQueueDepth,
+            .maxBatchSize      = options.batchSize,
+            .renderThreadCount = options.renderThreadCount,
+            .latencyBudgetMs   = options.daemonLatencyBudgetMs,
+            .maxDimension      = 16384,
+            .pWriteOptions     = &options.writeOptions,
+            .pCache            = hasCache ? &cache : nullptr
+        };
+
+        auto const didServe = runDaemon(&renderers[0], &daemonOptions);
+
+        if (hasCache)
+        {
+            writeRenderCacheReport(stdout, &cache);
+            closeRenderCache(&cache);
+        }
 
-            if (writeResult < 0) {
-                break;
-            }
+        destroyRenderer(&renderers[0]);
 
-            row += bytesPerRow;
+        if (options.useAllocator)
+        {
+            writeHostAllocatorReport(stdout, &hostAllocator);
+            destroyHostAllocator(&hostAllocator);
         }
 
-        //  - cleanup buffer
-        _TIFFfree(scanlineBuffer);
-        scanlineBuffer = nullptr;
+        TRACE_WRITE_FILE(options.traceFilename);
 
-        //  - result
-        result = (0 <= writeResult);
+        return didServe ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    //  - cleanup file
-    TIFFClose(file);
-    file = nullptr;
+    // * Render and save frames, or hand them off
+    //
+    if (nullptr != options.outputSocketPath) {
+        options.outputSocket = connectFrameConsumer(options.outputSocketPath);
+    }
 
-    return result;
-}
+    auto timings    = (FrameTimings*)calloc(options.frameCount, sizeof(FrameTimings));
+    auto didSucceed = (nullptr != timings);
 
-//====----------------------------------------------------------------------====
-// * main
-//====----------------------------------------------------------------------====
+    if (!didSucceed) {
+        puts("Failed to allocate frame timings");
+    }
+    else if (nullptr != options.outputSocketPath && options.outputSocket < 0)
+    {
+        printf("Failed to connect to %s\n", options.outputSocketPath);
+        didSucceed = false;
+    }
+    else if (nullptr != options.damagePattern) {
+        didSucceed = renderDamageFrames(&options, &renderers[0], timings);
+    }
+    else {
+        didSucceed = renderFrames(&options, renderers, rendererCount, timings);
+    }
 
-int main( [[maybe_unused]] const int         argc, 
-          [[maybe_unused]] const char* const argv[] )
-{
-    // * Render image
+    if (0 <= options.outputSocket) {
+        close(options.outputSocket);
+    }
+
+    for (uint32_t dd = 0; dd < rendererCount; ++dd) {
+        destroyRenderer(&renderers[dd]);
+    }
+
+    // * Timing report
     //
-    auto imageContext = renderImage(1080, 1080);
+    auto timingFile = didSucceed ? fopen(options.timingsFilename, "w") : nullptr;
 
-    if (nullptr == imageContext.data)
+    if (nullptr != timingFile)
     {
-        puts("Failed to render image");
-        return EXIT_FAILURE;
+        writeTimingReport(timingFile, timings, options.frameCount);
+        fclose(timingFile);
     }
 
-    // * Save image file
-    //
-    auto didSave = saveRGBATIFFFile( "output.tiff",
-                                     imageContext.data,
-                                     imageContext.width,
-                                     imageContext.height,
-                                     imageContext.bytesPerRow );
-    // * Cleanup
-    //
-    disposeImageContext(&imageContext);
+    free(timings);
 
-    // * Error reporting
+    // * Host allocations, once every object has been destroyed
     //
-    if (!didSave) 
+    if (options.useAllocator)
     {
-        puts("Failed to save image file");
-        return EXIT_FAILURE;
+        writeHostAllocatorReport(stdout, &hostAllocator);
+        destroyHostAllocator(&hostAllocator);
     }
 
-    return EXIT_SUCCESS;
-}
+    // * Trace : only written when built with tracing
+    //
+    TRACE_WRITE_FILE(options.traceFilename);
 
+    return didSucceed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
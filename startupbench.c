@@ -0,0 +1,217 @@
+//
+// startupbench.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <vulkan/vulkan.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "renderer.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Benchmark parameters
+//
+//====----------------------------------------------------------------------====
+
+// * Each run creates its own renderer, as a process starting up would.
+//   Frames after the pipeline is ready are the steady state
+//
+constexpr uint32_t benchSize         = 1024;
+constexpr uint32_t benchRuns         = 8;
+constexpr uint32_t benchSteadyFrames = 16;
+
+//====----------------------------------------------------------------------====
+//
+// * Running
+//
+//====----------------------------------------------------------------------====
+
+// * StartupRun : milliseconds since createRendererAndTarget was called
+//
+typedef struct StartupRun
+{
+    double         createMs;        // createRendererAndTarget returned
+    double         firstPixelMs;    // first frame read back
+    double         pipelineReadyMs; // waitForGraphicsPipeline returned
+    double         frameMs;         // median steady frame
+    StartupTimings startupTimings;  // the renderer's and target's phases
+}
+StartupRun;
+
+// * runStartup : returns false on failure. *pIsDeferred is set when the
+//                pipeline compile was deferred, which the device may not
+//                support
+//
+bool runStartup( const char* sceneFilename,
+                 bool        deferPipelineCompile,
+                 bool*       pIsDeferred,
+                 StartupRun* pRun )
+{
+    const RendererInfo rendererInfo = {
+        .colorFormat          = VK_FORMAT_R8G8B8A8_UNORM,
+        .pixelLayout          = PIXEL_LAYOUT_RGBA_PREMULTIPLIED,
+        .enableValidation     = false,
+        .sceneFilename        = sceneFilename,
+        .deferPipelineCompile = deferPipelineCompile
+    };
+
+    Renderer     renderer     = {};
+    RenderTarget target       = {};
+    ImageContext imageContext = {};
+
+    double frameMs[benchSteadyFrames] = {};
+
+    auto const start = getTimeMs();
+
+    auto result = createRendererAndTarget( &rendererInfo, benchSize, benchSize,
+                                           &renderer, &target );
+
+    pRun->createMs       = getTimeMs() - start;
+    pRun->startupTimings = renderer.startupTimings;
+    *pIsDeferred         = (nullptr != renderer.pStartup);
+
+    //  - first pixel
+    if (VK_SUCCESS == result)
+    {
+        result = renderFrame(&renderer, &target, &imageContext, nullptr);
+        disposeImageContext(&imageContext);
+
+        pRun->firstPixelMs = getTimeMs() - start;
+    }
+
+    //  - pipeline ready
+    if (VK_SUCCESS == result)
+    {
+        result = waitForGraphicsPipeline(&renderer);
+
+        pRun->pipelineReadyMs = getTimeMs() - start;
+    }
+
+    //  - steady frames
+    for (uint32_t ff = 0; ff < benchSteadyFrames && VK_SUCCESS == result; ++ff)
+    {
+        auto const frameStart = getTimeMs();
+
+        result = renderFrame(&renderer, &target, &imageContext, nullptr);
+
+        frameMs[ff] = getTimeMs() - frameStart;
+
+        disposeImageContext(&imageContext);
+    }
+
+    if (VK_SUCCESS == result) {
+        pRun->frameMs = summarizeTimings(frameMs, benchSteadyFrames, sizeof(double)).median;
+    }
+
+    if (nullptr != renderer.device) {
+        destroyRenderTarget(&renderer, &target);
+    }
+
+    destroyRenderer(&renderer);
+
+    return VK_SUCCESS == result;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+// * printPhases : median start and end of each phase, which every run has
+//                 in the same order
+//
+void printPhases(const StartupRun* pRuns, uint32_t runCount)
+{
+    auto const pTimings = &pRuns[0].startupTimings;
+
+    for (uint32_t pp = 0; pp < pTimings->phaseCount; ++pp)
+    {
+        auto const startMs = summarizeTimings( &pTimings->phases[pp].startMs,
+                                               runCount, sizeof(StartupRun) ).median;
+        auto const endMs   = summarizeTimings( &pTimings->phases[pp].endMs,
+                                               runCount, sizeof(StartupRun) ).median;
+
+        printf( "  %-32s %10.3f .. %10.3f\n",
+                pTimings->phases[pp].name, startMs, endMs );
+    }
+}
+
+int main(const int argc, const char* const argv[])
+{
+    //  - startupbench [scene file]
+    if (2 < argc)
+    {
+        printf("usage: %s [scene file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto const sceneFilename = (2 == argc) ? argv[1] : nullptr;
+
+    printf( "%s, %u^2, median of %u runs\n\n",
+            (nullptr != sceneFilename) ? sceneFilename : "square", benchSize, benchRuns );
+
+    printf( "%-16s %10s %15s %18s %10s\n",
+            "path", "create_ms", "first_pixel_ms", "pipeline_ready_ms", "frame_ms" );
+
+    auto failed = false;
+
+    for (uint32_t pp = 0; pp < 2; ++pp)
+    {
+        auto const deferPipelineCompile = (1 == pp);
+        auto const path = deferPipelineCompile ? "shader-objects" : "pipeline";
+
+        StartupRun runs[benchRuns] = {};
+
+        auto isSupported = true;
+        auto isFailed    = false;
+
+        for (uint32_t rr = 0; rr < benchRuns && isSupported && !isFailed; ++rr)
+        {
+            auto isDeferred = false;
+
+            isFailed    = !runStartup(sceneFilename, deferPipelineCompile, &isDeferred, &runs[rr]);
+            isSupported = isFailed || deferPipelineCompile == isDeferred;
+        }
+
+        if (isFailed)
+        {
+            printf("%-16s %10s\n", path, "failed");
+            failed = true;
+            continue;
+        }
+
+        if (!isSupported)
+        {
+            printf("%-16s %10s\n", path, "unsupported");
+            continue;
+        }
+
+        printf( "%-16s %10.3f %15.3f %18.3f %10.3f\n", path,
+                summarizeTimings(&runs[0].createMs, benchRuns, sizeof(StartupRun)).median,
+                summarizeTimings(&runs[0].firstPixelMs, benchRuns, sizeof(StartupRun)).median,
+                summarizeTimings(&runs[0].pipelineReadyMs, benchRuns, sizeof(StartupRun)).median,
+                summarizeTimings(&runs[0].frameMs, benchRuns, sizeof(StartupRun)).median );
+
+        printPhases(runs, benchRuns);
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,301 @@
+//
+// taskpool.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <string.h>
+
+#include "taskpool.h"
+#include "timing.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Tasks
+//
+//====----------------------------------------------------------------------====
+
+// * runAvailableTasks : with the mutex held, runs tasks of the current call
+//                       until none are left to start
+//
+void runAvailableTasks(TaskPool* pPool)
+{
+    while (pPool->nextTask < pPool->taskCount)
+    {
+        auto const taskIndex = pPool->nextTask++;
+
+        mtx_unlock(&pPool->mutex);
+
+        pPool->function(pPool->pContext, taskIndex);
+
+        mtx_lock(&pPool->mutex);
+
+        if (0 == --pPool->pendingCount) {
+            cnd_signal(&pPool->tasksDone);
+        }
+    }
+}
+
+// * taskThread
+//
+int taskThread(void* pArgument)
+{
+    auto const pPool = (TaskPool*)pArgument;
+
+    mtx_lock(&pPool->mutex);
+
+    while (!pPool->isStopping)
+    {
+        runAvailableTasks(pPool);
+
+        if (!pPool->isStopping) {
+            cnd_wait(&pPool->taskReady, &pPool->mutex);
+        }
+    }
+
+    mtx_unlock(&pPool->mutex);
+
+    return 0;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * TaskPool
+//
+//====----------------------------------------------------------------------====
+
+// * createTaskPool
+//
+bool createTaskPool(uint32_t threadCount, TaskPool* pPool)
+{
+    memset( pPool, 0, sizeof(*pPool) );
+
+    if (taskPoolMaxThreads < threadCount) {
+        return false;
+    }
+
+    if (thrd_success != mtx_init(&pPool->runMutex, mtx_plain)) {
+        return false;
+    }
+
+    if (thrd_success != mtx_init(&pPool->mutex, mtx_plain))
+    {
+        mtx_destroy(&pPool->runMutex);
+        return false;
+    }
+
+    cnd_init(&pPool->taskReady);
+    cnd_init(&pPool->tasksDone);
+
+    for (; pPool->threadCount < threadCount; ++pPool->threadCount)
+    {
+        if (thrd_success != thrd_create( &pPool->threads[pPool->threadCount],
+                                         taskThread, pPool ))
+        {
+            destroyTaskPool(pPool);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// * destroyTaskPool
+//
+void destroyTaskPool(TaskPool* pPool)
+{
+    mtx_lock(&pPool->mutex);
+
+    pPool->isStopping = true;
+    cnd_broadcast(&pPool->taskReady);
+
+    mtx_unlock(&pPool->mutex);
+
+    for (uint32_t tt = 0; tt < pPool->threadCount; ++tt) {
+        thrd_join(pPool->threads[tt], nullptr);
+    }
+
+    cnd_destroy(&pPool->tasksDone);
+    cnd_destroy(&pPool->taskReady);
+    mtx_destroy(&pPool->mutex);
+    mtx_destroy(&pPool->runMutex);
+
+    memset( pPool, 0, sizeof(*pPool) );
+}
+
+// * runTasks
+//
+void runTasks( TaskPool*    pPool,
+               uint32_t     taskCount,
+               TaskFunction function,
+               void*        pContext )
+{
+    if (0 == taskCount) {
+        return;
+    }
+
+    mtx_lock(&pPool->runMutex);
+    mtx_lock(&pPool->mutex);
+
+    pPool->function     = function;
+    pPool->pContext     = pContext;
+    pPool->taskCount    = taskCount;
+    pPool->nextTask     = 0;
+    pPool->pendingCount = taskCount;
+
+    cnd_broadcast(&pPool->taskReady);
+
+    //  - the caller takes tasks too, then waits for those still running
+    runAvailableTasks(pPool);
+
+    while (0 < pPool->pendingCount) {
+        cnd_wait(&pPool->tasksDone, &pPool->mutex);
+    }
+
+    pPool->taskCount = 0;
+    pPool->nextTask  = 0;
+
+    mtx_unlock(&pPool->mutex);
+    mtx_unlock(&pPool->runMutex);
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Task graphs
+//
+//====----------------------------------------------------------------------====
+
+// * TaskGraphRun : one call to runTaskGraph, its masks guarded by mutex
+//
+typedef struct TaskGraphRun
+{
+    TaskGraphNode* pNodes;
+    uint32_t       nodeCount;
+    mtx_t          mutex;
+    cnd_t          nodeDone;
+    uint32_t       startedNodes;
+    uint32_t       finishedNodes;
+    uint32_t       succeededNodes;
+}
+TaskGraphRun;
+
+// * runGraphNodes : task function. Runs ready nodes until every node has
+//                   finished, waiting while those left depend on nodes
+//                   still running
+//
+void runGraphNodes(void* pContext, [[maybe_unused]] uint32_t taskIndex)
+{
+    auto const pRun     = (TaskGraphRun*)pContext;
+    auto const allNodes = (uint32_t)( (1ull << pRun->nodeCount) - 1 );
+
+    mtx_lock(&pRun->mutex);
+
+    while (allNodes != pRun->finishedNodes)
+    {
+        //  - first node not yet started whose dependencies have finished
+        auto nodeIndex = pRun->nodeCount;
+
+        for (uint32_t nn = 0; nn < pRun->nodeCount && pRun->nodeCount == nodeIndex; ++nn)
+        {
+            auto const dependencies = pRun->pNodes[nn].dependencies & allNodes;
+
+            if ( 0 == (pRun->startedNodes & (1u << nn)) &&
+                 dependencies == (pRun->finishedNodes & dependencies) )
+            {
+                nodeIndex = nn;
+            }
+        }
+
+        if (pRun->nodeCount == nodeIndex)
+        {
+            //  - nothing running either : the nodes left wait on themselves
+            if (pRun->startedNodes == pRun->finishedNodes)
+            {
+                pRun->startedNodes  = allNodes;
+                pRun->finishedNodes = allNodes;
+                break;
+            }
+
+            cnd_wait(&pRun->nodeDone, &pRun->mutex);
+            continue;
+        }
+
+        auto const pNode   = &pRun->pNodes[nodeIndex];
+        auto const nodeBit = 1u << nodeIndex;
+
+        pRun->startedNodes |= nodeBit;
+
+        //  - skipped, unless every dependency succeeded
+        auto const dependencies = pNode->dependencies & allNodes;
+        auto       isSucceeded  = false;
+
+        if (dependencies == (pRun->succeededNodes & dependencies))
+        {
+            mtx_unlock(&pRun->mutex);
+
+            pNode->startMs = getTimeMs();
+            isSucceeded    = pNode->function(pNode->pContext);
+            pNode->endMs   = getTimeMs();
+
+            mtx_lock(&pRun->mutex);
+        }
+
+        pRun->finishedNodes  |= nodeBit;
+        pRun->succeededNodes |= isSucceeded ? nodeBit : 0;
+
+        cnd_broadcast(&pRun->nodeDone);
+    }
+
+    //  - wake those still waiting, to see every node has finished
+    cnd_broadcast(&pRun->nodeDone);
+
+    mtx_unlock(&pRun->mutex);
+}
+
+// * runTaskGraph
+//
+uint32_t runTaskGraph( TaskPool*      pPool,
+                       TaskGraphNode* pNodes,
+                       uint32_t       nodeCount )
+{
+    if (taskGraphMaxNodes < nodeCount) {
+        return 0;
+    }
+
+    TaskGraphRun run = {
+        .pNodes    = pNodes,
+        .nodeCount = nodeCount
+    };
+
+    if (thrd_success != mtx_init(&run.mutex, mtx_plain)) {
+        return 0;
+    }
+
+    if (thrd_success != cnd_init(&run.nodeDone))
+    {
+        mtx_destroy(&run.mutex);
+        return 0;
+    }
+
+    //  - a task per thread, each running nodes as they become ready
+    runTasks(pPool, pPool->threadCount + 1, runGraphNodes, &run);
+
+    cnd_destroy(&run.nodeDone);
+    mtx_destroy(&run.mutex);
+
+    return run.succeededNodes;
+}
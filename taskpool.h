@@ -0,0 +1,109 @@
+//
+// taskpool.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <stdint.h>
+#include <threads.h>
+
+//====----------------------------------------------------------------------====
+//
+// * TaskPool : persistent threads that run the tasks of one call to
+//              runTasks in parallel, with the calling thread taking part.
+//              Calls from several threads take turns
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t taskPoolMaxThreads = 32;
+
+// * TaskFunction : runs task taskIndex of the current call
+//
+typedef void (*TaskFunction)(void* pContext, uint32_t taskIndex);
+
+typedef struct TaskPool
+{
+    mtx_t        runMutex;          // held for the whole of runTasks
+    mtx_t        mutex;
+    cnd_t        taskReady;
+    cnd_t        tasksDone;
+    thrd_t       threads[taskPoolMaxThreads];
+    uint32_t     threadCount;
+
+    //  - the current call, guarded by mutex
+    TaskFunction function;
+    void*        pContext;
+    uint32_t     taskCount;
+    uint32_t     nextTask;
+    uint32_t     pendingCount;      // tasks not yet finished
+    bool         isStopping;
+}
+TaskPool;
+
+// * createTaskPool : threadCount threads besides the caller of runTasks.
+//                    The pool must not move once created
+//
+bool createTaskPool(uint32_t threadCount, TaskPool* pPool);
+
+// * destroyTaskPool : joins the threads
+//
+void destroyTaskPool(TaskPool* pPool);
+
+// * runTasks : returns once every task has run
+//
+void runTasks( TaskPool*    pPool,
+               uint32_t     taskCount,
+               TaskFunction function,
+               void*        pContext );
+
+//====----------------------------------------------------------------------====
+//
+// * Task graphs : nodes run on a pool once the nodes they depend on have
+//                 succeeded, as many at a time as there are threads
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t taskGraphMaxNodes = 32;
+
+// * TaskGraphFunction : returns false when the node failed
+//
+typedef bool (*TaskGraphFunction)(void* pContext);
+
+// * TaskGraphNode : startMs and endMs are set by runTaskGraph, on the
+//                   getTimeMs clock, for nodes that ran
+//
+typedef struct TaskGraphNode
+{
+    const char*       name;
+    TaskGraphFunction function;
+    void*             pContext;
+    uint32_t          dependencies;     // bit n : waits for node n
+    double            startMs;
+    double            endMs;
+}
+TaskGraphNode;
+
+// * runTaskGraph : runs every node whose dependencies all succeed, on the
+//                  pool's threads and the caller's. Nodes depending on a
+//                  node that failed, or never ran, are skipped. Returns a
+//                  mask of the nodes that succeeded
+//
+uint32_t runTaskGraph( TaskPool*      pPool,
+                       TaskGraphNode* pNodes,
+                       uint32_t       nodeCount );
@@ -0,0 +1,233 @@
+//
+// timing.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "timing.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Frame timings
+//
+//====----------------------------------------------------------------------====
+
+// * getTimeMs
+//
+double getTimeMs(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return 1e3 * (double)time.tv_sec + 1e-6 * (double)time.tv_nsec;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Startup timings
+//
+//====----------------------------------------------------------------------====
+
+// * addStartupPhase
+//
+void addStartupPhase( StartupTimings* pTimings,
+                      const char*     name,
+                      double          startMs,
+                      double          endMs )
+{
+    if (startupMaxPhases <= pTimings->phaseCount) {
+        return;
+    }
+
+    pTimings->phases[pTimings->phaseCount++] = (StartupPhase){
+        .name    = name,
+        .startMs = startMs - pTimings->beginMs,
+        .endMs   = endMs - pTimings->beginMs
+    };
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Reporting
+//
+//====----------------------------------------------------------------------====
+
+// * compareDoubles
+//
+int compareDoubles(const void* pLeft, const void* pRight)
+{
+    auto const left  = *(const double*)pLeft;
+    auto const right = *(const double*)pRight;
+
+    return (left > right) - (left < right);
+}
+
+// * nearestRank : index of the smallest value with at least percent of the
+//                 values at or below it
+//
+uint32_t nearestRank(uint32_t count, uint32_t percent) [[unsequenced]]
+{
+    auto const rank = (percent * (uint64_t)count + 99) / 100;
+
+    return (0 < rank) ? (uint32_t)rank - 1 : 0;
+}
+
+// * summarizeTimings
+//
+TimingSummary summarizeTimings( const double* pValues,
+                                uint32_t      count,
+                                size_t        stride )
+{
+    TimingSummary summary = {};
+
+    auto sorted = (double*)malloc(count * sizeof(double));
+
+    if (0 == count || nullptr == sorted)
+    {
+        free(sorted);
+        return summary;
+    }
+
+    for (uint32_t ii = 0; ii < count; ++ii) {
+        memcpy(&sorted[ii], (const uint8_t*)pValues + ii*stride, sizeof(double));
+    }
+
+    qsort(sorted, count, sizeof(double), compareDoubles);
+
+    summary.min    = sorted[0];
+    summary.median = sorted[nearestRank(count, 50)];
+    summary.p99    = sorted[nearestRank(count, 99)];
+
+    free(sorted);
+
+    return summary;
+}
+
+// * TimingStage
+//
+typedef struct TimingStage
+{
+    const char* name;
+    size_t      offset;
+    bool        isGPU;
+}
+TimingStage;
+
+const TimingStage timingStages[] = {
+    { "render_ms",     offsetof(FrameTimings, renderMs),     true  },
+    { "pack_ms",       offsetof(FrameTimings, packMs),       true  },
+    { "transition_ms", offsetof(FrameTimings, transitionMs), true  },
+    { "copy_ms",       offsetof(FrameTimings, copyMs),       true  },
+    { "preview_ms",    offsetof(FrameTimings, previewMs),    true  },
+    { "gpu_ms",        offsetof(FrameTimings, gpuMs),        true  },
+    { "readback_ms",   offsetof(FrameTimings, readbackMs),   false },
+    { "record_ms",     offsetof(FrameTimings, recordMs),     false }
+};
+
+// * writeTimingReport
+//
+bool writeTimingReport( FILE*               file,
+                        const FrameTimings* pTimings,
+                        uint32_t            frameCount )
+{
+    auto const stageCount = (uint32_t)( sizeof(timingStages)/sizeof(timingStages[0]) );
+
+    //  - GPU stages are reported only when every frame has them
+    auto hasGPUTimings = (0 < frameCount);
+
+    for (uint32_t ff = 0; ff < frameCount; ++ff) {
+        hasGPUTimings = hasGPUTimings && pTimings[ff].hasGPUTimings;
+    }
+
+    //  - frames
+    fprintf(file, "{\n  \"frames\": [");
+
+    for (uint32_t ff = 0; ff < frameCount; ++ff)
+    {
+        fprintf(file, "%s\n    { \"frame\": %u", (0 < ff) ? "," : "", ff);
+
+        for (uint32_t ss = 0; ss < stageCount; ++ss)
+        {
+            auto const stage = &timingStages[ss];
+
+            if (stage->isGPU && !hasGPUTimings) {
+                continue;
+            }
+
+            double value = 0.0;
+            memcpy( &value, (const uint8_t*)&pTimings[ff] + stage->offset,
+                    sizeof(value) );
+
+            fprintf(file, ", \"%s\": %.6f", stage->name, value);
+        }
+
+        fprintf(file, " }");
+    }
+
+    //  - aggregates
+    fprintf(file, "\n  ],\n  \"summary\": {");
+
+    auto isFirst = true;
+
+    for (uint32_t ss = 0; ss < stageCount; ++ss)
+    {
+        auto const stage = &timingStages[ss];
+
+        if (stage->isGPU && !hasGPUTimings) {
+            continue;
+        }
+
+        auto const summary = summarizeTimings(
+            (const double*)( (const uint8_t*)pTimings + stage->offset ),
+            frameCount, sizeof(FrameTimings) );
+
+        fprintf( file,
+                 "%s\n    \"%s\": { \"min\": %.6f, \"median\": %.6f, \"p99\": %.6f }",
+                 isFirst ? "" : ",", stage->name,
+                 summary.min, summary.median, summary.p99 );
+
+        isFirst = false;
+    }
+
+    fprintf(file, "\n  }\n}\n");
+
+    return 0 == ferror(file);
+}
+
+// * writeStartupReport
+//
+bool writeStartupReport(FILE* file, const StartupTimings* pTimings)
+{
+    fprintf(file, "{\n  \"phases\": [");
+
+    for (uint32_t pp = 0; pp < pTimings->phaseCount; ++pp)
+    {
+        auto const phase = &pTimings->phases[pp];
+
+        fprintf( file,
+                 "%s\n    { \"phase\": \"%s\", \"start_ms\": %.6f, \"end_ms\": %.6f }",
+                 (0 < pp) ? "," : "", phase->name, phase->startMs, phase->endMs );
+    }
+
+    fprintf(file, "\n  ],\n  \"total_ms\": %.6f\n}\n", pTimings->totalMs);
+
+    return 0 == ferror(file);
+}
@@ -0,0 +1,121 @@
+//
+// timing.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Frame timings
+//
+//====----------------------------------------------------------------------====
+
+// * FrameTimings : GPU stage durations come from timestamp queries and are
+//                  only valid when hasGPUTimings is set. Stages a frame does
+//                  not use are zero
+//
+typedef struct FrameTimings
+{
+    bool   hasGPUTimings;
+    double renderMs;            // render pass
+    double packMs;              // pack compute pass
+    double transitionMs;        // readback image layout transitions
+    double copyMs;              // vkCmdCopyImage
+    double previewMs;           // preview mip chain blits and copies
+    double gpuMs;               // sum of the GPU stages
+    double readbackMs;          // host map and copy out of readback memory
+    double recordMs;            // host command recording
+}
+FrameTimings;
+
+// * getTimeMs : monotonic host clock
+//
+double getTimeMs(void);
+
+//====----------------------------------------------------------------------====
+//
+// * Startup timings
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t startupMaxPhases = 24;
+
+// * StartupPhase : milliseconds since startup began. Phases run in
+//                  parallel may overlap
+//
+typedef struct StartupPhase
+{
+    const char* name;
+    double      startMs;
+    double      endMs;
+}
+StartupPhase;
+
+typedef struct StartupTimings
+{
+    double       beginMs;           // getTimeMs when startup began
+    double       totalMs;
+    StartupPhase phases[startupMaxPhases];
+    uint32_t     phaseCount;
+}
+StartupTimings;
+
+// * addStartupPhase : startMs and endMs on the getTimeMs clock. Phases past
+//                     startupMaxPhases are dropped
+//
+void addStartupPhase( StartupTimings* pTimings,
+                      const char*     name,
+                      double          startMs,
+                      double          endMs );
+
+//====----------------------------------------------------------------------====
+//
+// * Reporting
+//
+//====----------------------------------------------------------------------====
+
+// * TimingSummary
+//
+typedef struct TimingSummary
+{
+    double min;
+    double median;
+    double p99;
+}
+TimingSummary;
+
+// * summarizeTimings : nearest-rank statistics of count values read with
+//                      the given byte stride
+//
+TimingSummary summarizeTimings( const double* pValues,
+                                uint32_t      count,
+                                size_t        stride );
+
+// * writeTimingReport : JSON with every frame followed by per-stage
+//                       min / median / p99 aggregates
+//
+bool writeTimingReport( FILE*               file,
+                        const FrameTimings* pTimings,
+                        uint32_t            frameCount );
+
+// * writeStartupReport : JSON with every phase and the total
+//
+bool writeStartupReport(FILE* file, const StartupTimings* pTimings);
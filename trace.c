@@ -0,0 +1,145 @@
+//
+// trace.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "trace.h"
+
+#if defined(SQUARE_TRACE)
+
+#include "timing.h"
+
+#include <stdatomic.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Trace storage : a fixed array claimed with an atomic counter, so spans
+//                   may be recorded from any thread without locking
+//
+//====----------------------------------------------------------------------====
+
+constexpr uint32_t traceCapacity = 1u << 16;
+
+typedef struct TraceEvent
+{
+    const char* name;
+    double      startMs;
+    double      durationMs;
+    uint32_t    threadId;
+}
+TraceEvent;
+
+TraceEvent            traceEvents[traceCapacity];
+atomic_uint           traceEventCount;
+atomic_uint           traceThreadCount;
+thread_local uint32_t traceThreadId;
+
+// * getTraceThreadId : small sequential ids read better than system ids
+//
+uint32_t getTraceThreadId(void)
+{
+    if (0 == traceThreadId) {
+        traceThreadId = 1 + atomic_fetch_add(&traceThreadCount, 1);
+    }
+
+    return traceThreadId;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Spans
+//
+//====----------------------------------------------------------------------====
+
+// * traceBegin
+//
+TraceSpan traceBegin(const char* name)
+{
+    return (TraceSpan){ .name = name, .startMs = getTimeMs() };
+}
+
+// * traceEnd
+//
+void traceEnd(const TraceSpan* pSpan)
+{
+    auto const endMs = getTimeMs();
+    auto const index = atomic_fetch_add(&traceEventCount, 1);
+
+    if (traceCapacity <= index) {
+        return;
+    }
+
+    traceEvents[index] = (TraceEvent){
+        .name       = pSpan->name,
+        .startMs    = pSpan->startMs,
+        .durationMs = endMs - pSpan->startMs,
+        .threadId   = getTraceThreadId()
+    };
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Output
+//
+//====----------------------------------------------------------------------====
+
+// * writeTrace : complete ("X") events with microsecond timestamps
+//
+bool writeTrace(FILE* file)
+{
+    auto count = atomic_load(&traceEventCount);
+
+    if (traceCapacity < count) {
+        count = traceCapacity;
+    }
+
+    fprintf(file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [");
+
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        auto const event = &traceEvents[ii];
+
+        fprintf( file,
+                 "%s\n    { \"name\": \"%s\", \"cat\": \"square\", \"ph\": \"X\", "
+                 "\"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u }",
+                 (0 < ii) ? "," : "", event->name,
+                 1e3 * event->startMs, 1e3 * event->durationMs,
+                 event->threadId );
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+
+    return 0 == ferror(file);
+}
+
+// * writeTraceFile
+//
+bool writeTraceFile(const char* filename)
+{
+    auto file = fopen(filename, "w");
+
+    if (nullptr == file) {
+        return false;
+    }
+
+    auto const result = writeTrace(file);
+
+    return (0 == fclose(file)) && result;
+}
+
+#endif // SQUARE_TRACE
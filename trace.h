@@ -0,0 +1,73 @@
+//
+// trace.h
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+//====----------------------------------------------------------------------====
+//
+// * Tracing : CPU phase spans written as Chrome / Perfetto trace-event JSON.
+//             Compiled out entirely unless SQUARE_TRACE is defined
+//             (make trace=1)
+//
+//====----------------------------------------------------------------------====
+
+// * TraceSpan : an open span. name must be a string literal, or otherwise
+//               outlive the trace
+//
+typedef struct TraceSpan
+{
+    const char* name;
+    double      startMs;
+}
+TraceSpan;
+
+#if defined(SQUARE_TRACE)
+
+// * traceBegin
+//
+TraceSpan traceBegin(const char* name);
+
+// * traceEnd : records the span as a complete event. Spans beyond the
+//              trace capacity are dropped
+//
+void traceEnd(const TraceSpan* pSpan);
+
+// * writeTrace : trace-event JSON of every recorded span
+//
+bool writeTrace(FILE* file);
+
+// * writeTraceFile
+//
+bool writeTraceFile(const char* filename);
+
+#define TRACE_BEGIN(Span_, Name_)    const TraceSpan Span_ = traceBegin(Name_)
+#define TRACE_END(Span_)             traceEnd(&Span_)
+#define TRACE_WRITE_FILE(Filename_)  ((void)writeTraceFile(Filename_))
+
+#else
+
+#define TRACE_BEGIN(Span_, Name_)
+#define TRACE_END(Span_)
+#define TRACE_WRITE_FILE(Filename_)  ((void)(Filename_))
+
+#endif
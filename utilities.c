@@ -18,8 +18,10 @@
 //
 
 #include "utilities.h"
+#include "trace.h"
 
 #include <stdbit.h>
+#include <string.h>
 
 //====----------------------------------------------------------------------====
 //
@@ -37,6 +39,8 @@ VkResult findFirstGPU(VkInstance instance, VkPhysicalDevice* pPhysicalDevice)
     VkPhysicalDevice physicalDevices[physicalDeviceCount] = {};
     vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices);
 
+    VkPhysicalDevice cpuDevice = nullptr;
+
     for (uint32_t ii = 0; ii < physicalDeviceCount; ++ii)
     {
         VkPhysicalDeviceProperties properties = {};
@@ -48,10 +52,64 @@ VkResult findFirstGPU(VkInstance instance, VkPhysicalDevice* pPhysicalDevice)
             *pPhysicalDevice = physicalDevices[ii];
             return VK_SUCCESS;
         }
+
+        if ( VK_PHYSICAL_DEVICE_TYPE_CPU == properties.deviceType &&
+             nullptr == cpuDevice )
+        {
+            cpuDevice = physicalDevices[ii];
+        }
     };
 
-    *pPhysicalDevice = nullptr;
-    return VK_ERROR_FEATURE_NOT_PRESENT;
+    *pPhysicalDevice = cpuDevice;
+
+    return (nullptr != cpuDevice) ? VK_SUCCESS : VK_ERROR_FEATURE_NOT_PRESENT;
+}
+
+// * findPhysicalDevice
+//
+VkResult findPhysicalDevice( VkInstance        instance,
+                             uint32_t          deviceNumber,
+                             VkPhysicalDevice* pPhysicalDevice )
+{
+    if (0 == deviceNumber) {
+        return findFirstGPU(instance, pPhysicalDevice);
+    }
+
+    uint32_t physicalDeviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+
+    if (physicalDeviceCount < deviceNumber) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkPhysicalDevice physicalDevices[physicalDeviceCount] = {};
+    vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices);
+
+    *pPhysicalDevice = physicalDevices[deviceNumber - 1];
+
+    return VK_SUCCESS;
+}
+
+// * hasDeviceExtension
+//
+bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char* extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+    VkExtensionProperties extensions[extensionCount] = {};
+
+    vkEnumerateDeviceExtensionProperties( physicalDevice, nullptr,
+                                          &extensionCount, extensions );
+
+    for (uint32_t ii = 0; ii < extensionCount; ++ii)
+    {
+        if (0 == strcmp(extensions[ii].extensionName, extensionName)) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 //====----------------------------------------------------------------------====
@@ -143,6 +201,63 @@ VkResult findMemoryTypeIndex
     return VK_ERROR_FEATURE_NOT_PRESENT;
 }
 
+//====----------------------------------------------------------------------====
+//
+// * Formats
+//
+//====----------------------------------------------------------------------====
+
+// * formatBytesPerPixel
+//
+uint32_t formatBytesPerPixel(VkFormat format) [[unsequenced]]
+{
+    switch (format)
+    {
+        case VK_FORMAT_R8_UNORM:                 return 1;
+        case VK_FORMAT_R8G8B8_UNORM:             return 3;
+        case VK_FORMAT_R8G8B8A8_UNORM:           return 4;
+        case VK_FORMAT_B8G8R8A8_UNORM:           return 4;
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32: return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:      return 8;
+        case VK_FORMAT_R16G16B16A16_UNORM:       return 8;
+        default:                                 return 0;
+    }
+}
+
+// * findSupportedFormat
+//
+VkResult findSupportedFormat
+(
+    VkPhysicalDevice     physicalDevice,
+    const VkFormat*      pCandidates,
+    uint32_t             candidateCount,
+    VkFormatFeatureFlags optimalTilingFeatures,
+    VkFormatFeatureFlags linearTilingFeatures,
+    VkFormat*            pFormat
+)
+{
+    for (uint32_t ii = 0; ii < candidateCount; ++ii)
+    {
+        VkFormatProperties properties = {};
+
+        vkGetPhysicalDeviceFormatProperties( physicalDevice, pCandidates[ii],
+                                             &properties );
+
+        auto const optimal = properties.optimalTilingFeatures;
+        auto const linear  = properties.linearTilingFeatures;
+
+        if ( optimalTilingFeatures == (optimal & optimalTilingFeatures) &&
+             linearTilingFeatures  == (linear  & linearTilingFeatures) )
+        {
+            *pFormat = pCandidates[ii];
+            return VK_SUCCESS;
+        }
+    }
+
+    *pFormat = VK_FORMAT_UNDEFINED;
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+}
+
 //====----------------------------------------------------------------------====
 //
 // * Images
@@ -157,6 +272,7 @@ VkResult createImageAndMemory
     const VkImageCreateInfo*                pImageInfo,
     const VkPhysicalDeviceMemoryProperties* pMemoryProperties,
     VkMemoryPropertyFlags                   requestedMemoryProperties,
+    const VkAllocationCallbacks*            pAllocator,
     VkImage*                                pImage,
     VkDeviceMemory*                         pImageMemory
 )
@@ -167,7 +283,7 @@ VkResult createImageAndMemory
 
     do
     {
-        result = vkCreateImage(device, pImageInfo, nullptr, &image);
+        result = vkCreateImage(device, pImageInfo, pAllocator, &image);
 
         if (VK_SUCCESS != result) {
             break;
@@ -195,7 +311,7 @@ VkResult createImageAndMemory
             .memoryTypeIndex = memoryTypeIndex
         };
 
-        result = vkAllocateMemory( device, &memoryAllocInfo, nullptr,
+        result = vkAllocateMemory( device, &memoryAllocInfo, pAllocator,
                                    &imageMemory );
 
         if (VK_SUCCESS != result) {
@@ -208,10 +324,10 @@ VkResult createImageAndMemory
 
     if (VK_SUCCESS != result)
     {
-        vkDestroyImage(device, image, nullptr);
+        vkDestroyImage(device, image, pAllocator);
         image = nullptr;
 
-        vkFreeMemory(device, imageMemory, nullptr);
+        vkFreeMemory(device, imageMemory, pAllocator);
         imageMemory = nullptr;
     }
 
@@ -221,15 +337,99 @@ VkResult createImageAndMemory
     return result;
 }
 
+//====----------------------------------------------------------------------====
+//
+// * Buffers
+//
+//====----------------------------------------------------------------------====
+
+// * createBufferAndMemory
+//
+VkResult createBufferAndMemory
+(
+    VkDevice                                device,
+    const VkBufferCreateInfo*               pBufferInfo,
+    const VkPhysicalDeviceMemoryProperties* pMemoryProperties,
+    VkMemoryPropertyFlags                   requestedMemoryProperties,
+    const VkAllocationCallbacks*            pAllocator,
+    VkBuffer*                               pBuffer,
+    VkDeviceMemory*                         pBufferMemory
+)
+{
+    VkResult       result       = VK_SUCCESS;
+    VkBuffer       buffer       = nullptr;
+    VkDeviceMemory bufferMemory = nullptr;
+
+    do
+    {
+        result = vkCreateBuffer(device, pBufferInfo, pAllocator, &buffer);
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - memory requirements
+        VkMemoryRequirements memoryRequirements = {};
+        vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+        uint32_t memoryTypeIndex = 0;
+
+        result = findMemoryTypeIndex( pMemoryProperties,
+                                      memoryRequirements.memoryTypeBits,
+                                      requestedMemoryProperties,
+                                      &memoryTypeIndex );
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        //  - memory
+        const VkMemoryAllocateInfo memoryAllocInfo = {
+            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext           = nullptr,
+            .allocationSize  = memoryRequirements.size,
+            .memoryTypeIndex = memoryTypeIndex
+        };
+
+        result = vkAllocateMemory( device, &memoryAllocInfo, pAllocator,
+                                   &bufferMemory );
+
+        if (VK_SUCCESS != result) {
+            break;
+        }
+
+        result = vkBindBufferMemory(device, buffer, bufferMemory, 0);
+    }
+    while (0);
+
+    if (VK_SUCCESS != result)
+    {
+        vkDestroyBuffer(device, buffer, pAllocator);
+        buffer = nullptr;
+
+        vkFreeMemory(device, bufferMemory, pAllocator);
+        bufferMemory = nullptr;
+    }
+
+    *pBufferMemory = bufferMemory;
+    *pBuffer       = buffer;
+
+    return result;
+}
+
 //====----------------------------------------------------------------------====
 //
 // * Command buffers
 //
 //====----------------------------------------------------------------------====
 
-VkResult submitCommandBuffer( VkDevice        device,
-                              VkQueue         queue,
-                              VkCommandBuffer commandBuffer )
+// * submitAndWait
+//
+VkResult submitAndWait( VkDevice                     device,
+                        VkQueue                      queue,
+                        mtx_t*                       pQueueMutex,
+                        uint32_t                     submitCount,
+                        const VkSubmitInfo*          pSubmits,
+                        const VkAllocationCallbacks* pAllocator )
 {
     //   - fence
     const VkFenceCreateInfo fenceInfo = {
@@ -240,33 +440,82 @@ VkResult submitCommandBuffer( VkDevice        device,
 
     VkFence fence = nullptr;
 
-    auto result = vkCreateFence(device, &fenceInfo, nullptr, &fence);
+    auto result = vkCreateFence(device, &fenceInfo, pAllocator, &fence);
 
     if (VK_SUCCESS == result)
     {
-        const VkSubmitInfo submitInfo = {
-            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext                = nullptr,
-            .waitSemaphoreCount   = 0,
-            .pWaitSemaphores      = nullptr,
-            .pWaitDstStageMask    = nullptr,
-            .commandBufferCount   = 1,
-            .pCommandBuffers      = &commandBuffer,
-            .signalSemaphoreCount = 0,
-            .pSignalSemaphores    = nullptr
-        };
+        TRACE_BEGIN(submitSpan, "queue submit");
+
+        if (nullptr != pQueueMutex) {
+            mtx_lock(pQueueMutex);
+        }
+
+        result = vkQueueSubmit(queue, submitCount, pSubmits, fence);
+
+        if (nullptr != pQueueMutex) {
+            mtx_unlock(pQueueMutex);
+        }
 
-        result = vkQueueSubmit(queue, 1, &submitInfo, fence);
+        TRACE_END(submitSpan);
+
+        //  - a fence the wait failed on may still be pending : it is only
+        //    destroyed once the queue has gone idle, and leaked otherwise.
+        //    The wait's error is returned either way
+        auto isFencePending = false;
 
         if (VK_SUCCESS == result)
         {
-            vkWaitForFences(device, 1, &fence, true, UINT64_MAX);
+            TRACE_BEGIN(waitSpan, "fence wait");
+
+            result = vkWaitForFences(device, 1, &fence, true, UINT64_MAX);
+
+            TRACE_END(waitSpan);
+
+            isFencePending = (VK_SUCCESS != result);
+        }
+
+        if (isFencePending)
+        {
+            if (nullptr != pQueueMutex) {
+                mtx_lock(pQueueMutex);
+            }
+
+            isFencePending = (VK_SUCCESS != vkQueueWaitIdle(queue));
+
+            if (nullptr != pQueueMutex) {
+                mtx_unlock(pQueueMutex);
+            }
+        }
+
+        if (!isFencePending) {
+            vkDestroyFence(device, fence, pAllocator);
         }
 
-        vkDestroyFence(device, fence, nullptr);
         fence = nullptr;
     }
 
     return result;
 }
 
+// * submitCommandBuffer
+//
+VkResult submitCommandBuffer( VkDevice                     device,
+                              VkQueue                      queue,
+                              VkCommandBuffer              commandBuffer,
+                              const VkAllocationCallbacks* pAllocator )
+{
+    const VkSubmitInfo submitInfo = {
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = nullptr,
+        .waitSemaphoreCount   = 0,
+        .pWaitSemaphores      = nullptr,
+        .pWaitDstStageMask    = nullptr,
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores    = nullptr
+    };
+
+    return submitAndWait(device, queue, nullptr, 1, &submitInfo, pAllocator);
+}
+
@@ -21,6 +21,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include <threads.h>
+
 //====----------------------------------------------------------------------====
 //
 // * Utilities
@@ -36,10 +38,23 @@
 //
 //====----------------------------------------------------------------------====
 
-// * findFirstGPU
+// * findFirstGPU : falls back to the first CPU implementation, such as
+//                 lavapipe, on machines without a GPU
 //
 VkResult findFirstGPU(VkInstance instance, VkPhysicalDevice* pPhysicalDevice);
 
+// * findPhysicalDevice : deviceNumber 0 is the first GPU, otherwise the
+//                        device at deviceNumber - 1 in enumeration order.
+//                        VK_ERROR_INITIALIZATION_FAILED past the last one
+//
+VkResult findPhysicalDevice( VkInstance        instance,
+                             uint32_t          deviceNumber,
+                             VkPhysicalDevice* pPhysicalDevice );
+
+// * hasDeviceExtension
+//
+bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char* extensionName);
+
 //====----------------------------------------------------------------------====
 //
 // * Queue family
@@ -82,6 +97,29 @@ VkResult findMemoryTypeIndex
     uint32_t*                               pMemoryTypeIndex
 );
 
+//====----------------------------------------------------------------------====
+//
+// * Formats
+//
+//====----------------------------------------------------------------------====
+
+// * formatBytesPerPixel : zero for formats the renderer does not produce
+//
+uint32_t formatBytesPerPixel(VkFormat format) [[unsequenced]];
+
+// * findSupportedFormat : first candidate with all of the requested optimal
+//                         and linear tiling features
+//
+VkResult findSupportedFormat
+(
+    VkPhysicalDevice     physicalDevice,
+    const VkFormat*      pCandidates,
+    uint32_t             candidateCount,
+    VkFormatFeatureFlags optimalTilingFeatures,
+    VkFormatFeatureFlags linearTilingFeatures,
+    VkFormat*            pFormat
+);
+
 //====----------------------------------------------------------------------====
 //
 // * Images
@@ -96,17 +134,52 @@ VkResult createImageAndMemory
     const VkImageCreateInfo*                pImageInfo,
     const VkPhysicalDeviceMemoryProperties* pMemoryProperties,
     VkMemoryPropertyFlags                   requestedMemoryProperties,
+    const VkAllocationCallbacks*            pAllocator,
     VkImage*                                pImage,
     VkDeviceMemory*                         pImageMemory
 );
 
+//====----------------------------------------------------------------------====
+//
+// * Buffers
+//
+//====----------------------------------------------------------------------====
+
+// * createBufferAndMemory
+//
+VkResult createBufferAndMemory
+(
+    VkDevice                                device,
+    const VkBufferCreateInfo*               pBufferInfo,
+    const VkPhysicalDeviceMemoryProperties* pMemoryProperties,
+    VkMemoryPropertyFlags                   requestedMemoryProperties,
+    const VkAllocationCallbacks*            pAllocator,
+    VkBuffer*                               pBuffer,
+    VkDeviceMemory*                         pBufferMemory
+);
+
 //====----------------------------------------------------------------------====
 //
 // * Command buffers
 //
 //====----------------------------------------------------------------------====
 
-VkResult submitCommandBuffer( VkDevice        device,
-                              VkQueue         queue,
-                              VkCommandBuffer commandBuffer );
+// * submitAndWait : every submit info in a single vkQueueSubmit, waited on
+//                   with one fence. The queue mutex, if any, is held for
+//                   the submission only, and to wait for the queue to go
+//                   idle when the fence wait fails
+//
+VkResult submitAndWait( VkDevice                     device,
+                        VkQueue                      queue,
+                        mtx_t*                       pQueueMutex,
+                        uint32_t                     submitCount,
+                        const VkSubmitInfo*          pSubmits,
+                        const VkAllocationCallbacks* pAllocator );
+
+// * submitCommandBuffer
+//
+VkResult submitCommandBuffer( VkDevice                     device,
+                              VkQueue                      queue,
+                              VkCommandBuffer              commandBuffer,
+                              const VkAllocationCallbacks* pAllocator );
 
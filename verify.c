@@ -0,0 +1,807 @@
+//
+// verify.c
+//
+//  Copyright © 2025 Robert Guequierre
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <vulkan/vulkan.h>
+#include <tiffio.h>
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "encode.h"
+#include "renderer.h"
+#include "utilities.h"
+
+//====----------------------------------------------------------------------====
+//
+// * Known scene : vertex.glsl and fragment.glsl draw an opaque blue square
+//                 over the middle half of a (0.1, 0, 0.1) background. Sizes
+//                 are multiples of four so no pixel centre lies on an edge
+//
+//====----------------------------------------------------------------------====
+
+typedef struct SceneSize
+{
+    uint32_t width;
+    uint32_t height;
+}
+SceneSize;
+
+const SceneSize sceneSizes[] = {
+    {  100,   60 },
+    { 1080, 1080 }
+};
+
+// * Per-sample tolerance of the analytic comparison, covering unorm
+//   rounding and the 8-bit repacking of higher precision formats
+//
+constexpr float sampleTolerance = 2.0f / 255.0f;
+
+// * expectedColor : straight RGBA, gray in the first sample. Samples the
+//                   layout does not store are zero
+//
+void expectedColor( PixelLayout pixelLayout,
+                    uint32_t    x,
+                    uint32_t    y,
+                    uint32_t    width,
+                    uint32_t    height,
+                    float       color[4] )
+{
+    auto const isInside = ( 4*x + 2 >= width  && 4*x + 2 <= 3*width ) &&
+                          ( 4*y + 2 >= height && 4*y + 2 <= 3*height );
+
+    color[0] = isInside ? 0.0f : 0.1f;
+    color[1] = 0.0f;
+    color[2] = isInside ? 1.0f : 0.1f;
+    color[3] = 1.0f;
+
+    //  - Rec. 709 luminance, as pack.glsl computes it
+    if (PIXEL_LAYOUT_GRAY == pixelLayout)
+    {
+        color[0] = 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+        color[1] = color[2] = 0.0f;
+    }
+
+    if (4 != samplesPerPixel(pixelLayout)) {
+        color[3] = 0.0f;
+    }
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Modes
+//
+//====----------------------------------------------------------------------====
+
+typedef struct FormatMode
+{
+    const char* name;
+    VkFormat    format;
+    bool        isRequired;     // optional formats may be unsupported
+}
+FormatMode;
+
+const FormatMode formatModes[] = {
+    { "rgba8",       VK_FORMAT_R8G8B8A8_UNORM,           true  },
+    { "a2b10g10r10", VK_FORMAT_A2B10G10R10_UNORM_PACK32, false },
+    { "rgba16f",     VK_FORMAT_R16G16B16A16_SFLOAT,      false },
+    { "rgba16",      VK_FORMAT_R16G16B16A16_UNORM,       false }
+};
+
+typedef struct LayoutMode
+{
+    const char* name;
+    PixelLayout pixelLayout;
+}
+LayoutMode;
+
+const LayoutMode layoutModes[] = {
+    { "premultiplied", PIXEL_LAYOUT_RGBA_PREMULTIPLIED },
+    { "rgba",          PIXEL_LAYOUT_RGBA               },
+    { "rgb",           PIXEL_LAYOUT_RGB                },
+    { "gray",          PIXEL_LAYOUT_GRAY               }
+};
+
+// * Encodings : raw host pixels, or TIFF files decoded with libtiff
+//
+typedef enum EncodeMode
+{
+    ENCODE_MODE_RAW,
+    ENCODE_MODE_TIFF,
+    ENCODE_MODE_TIFF_8BIT_STRAIGHT,     // narrowTo8Bits and unassociateAlpha
+    ENCODE_MODE_COUNT
+}
+EncodeMode;
+
+const char* const encodeModeNames[] = { "raw", "tiff", "tiff-8bit-straight" };
+
+// * Readback paths : renderImage()'s, then each path the renderer may take
+//                    instead, checked raw. Names of the default path are
+//                    left out of mode names
+//
+typedef enum ReadbackPath
+{
+    READBACK_PATH_DEFAULT,          // renderImage()
+    READBACK_PATH_COPY,             // disableHostImageCopy
+    READBACK_PATH_MEMORY,           // renderFrameToMemory, imported if possible
+    READBACK_PATH_DAMAGE,           // renderFrameDamage over spoiled regions
+    READBACK_PATH_MSAA,             // four samples resolved in the pass
+    READBACK_PATH_COUNT
+}
+ReadbackPath;
+
+const char* const readbackPathNames[] = { "", "copy", "memory", "damage", "msaa" };
+
+//====----------------------------------------------------------------------====
+//
+// * Rendering by path
+//
+//====----------------------------------------------------------------------====
+
+// * spoilDamage : overwrites the damaged pixels, which a damage readback
+//                 must restore
+//
+void spoilDamage( ImageContext*   pImageContext,
+                  const VkRect2D* pDamage,
+                  uint32_t        damageCount )
+{
+    auto const bytesPerPixel = (size_t)formatBytesPerPixel(pImageContext->colorPixelFormat);
+
+    for (uint32_t dd = 0; dd < damageCount; ++dd)
+    {
+        auto const pRect = &pDamage[dd];
+
+        for (uint32_t yy = 0; yy < pRect->extent.height; ++yy)
+        {
+            auto const row = pImageContext->data
+                           + (pRect->offset.y + yy) * pImageContext->bytesPerRow;
+
+            memset( row + pRect->offset.x * bytesPerPixel, 0xa5,
+                    pRect->extent.width * bytesPerPixel );
+        }
+    }
+}
+
+// * renderPathImage : a frame of the size, format and layout, read back
+//                     by the path. False when the renderer can't be
+//                     created
+//
+bool renderPathImage( ReadbackPath  path,
+                      uint32_t      width,
+                      uint32_t      height,
+                      VkFormat      format,
+                      PixelLayout   pixelLayout,
+                      ImageContext* pImageContext )
+{
+    *pImageContext = (ImageContext){};
+
+    if (READBACK_PATH_DEFAULT == path)
+    {
+        *pImageContext = renderImage(width, height, format, pixelLayout, nullptr, nullptr);
+
+        return nullptr != pImageContext->data;
+    }
+
+    const RendererInfo rendererInfo = {
+        .colorFormat          = format,
+        .pixelLayout          = pixelLayout,
+        .enableValidation     = true,
+        .sampleCount          = (READBACK_PATH_MSAA == path) ? VK_SAMPLE_COUNT_4_BIT
+                                                             : VK_SAMPLE_COUNT_1_BIT,
+        .disableHostImageCopy = (READBACK_PATH_COPY == path)
+    };
+
+    Renderer     renderer = {};
+    RenderTarget target   = {};
+
+    auto result = createRendererAndTarget(&rendererInfo, width, height, &renderer, &target);
+
+    if (VK_SUCCESS != result) {
+        return false;
+    }
+
+    if (READBACK_PATH_MEMORY == path)
+    {
+        //  - rows as square --to-memory lays them out, aligned for import
+        auto const colorPixelFormat = readbackColorFormat(&renderer);
+        auto const bytesPerRow      = (size_t)width * formatBytesPerPixel(colorPixelFormat);
+        auto const alignment        = (0 != renderer.hostPointerAlignment)
+                                    ? (size_t)renderer.hostPointerAlignment
+                                    : alignof(max_align_t);
+        auto const size             = (bytesPerRow * height + alignment - 1)
+                                    / alignment * alignment;
+
+        *pImageContext = (ImageContext){
+            .width            = width,
+            .height           = height,
+            .bytesPerRow      = bytesPerRow,
+            .colorPixelFormat = colorPixelFormat,
+            .pixelLayout      = pixelLayout,
+            .data             = (uint8_t*)aligned_alloc(alignment, size)
+        };
+
+        result = (nullptr != pImageContext->data)
+               ? renderFrameToMemory( &renderer, &target, pImageContext->data,
+                                      bytesPerRow, nullptr )
+               : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    else
+    {
+        result = renderFrame(&renderer, &target, pImageContext, nullptr);
+    }
+
+    //  - damage : two overlapping regions across the square's edges, read
+    //    back over pixels spoiled since the full frame
+    if (VK_SUCCESS == result && READBACK_PATH_DAMAGE == path)
+    {
+        const VkRect2D damage[] = {
+            { .offset = { (int32_t)(width / 8), (int32_t)(height / 8) },
+              .extent = { width / 2, height / 4 } },
+            { .offset = { (int32_t)(width / 2), (int32_t)(height / 4) },
+              .extent = { width / 3, height / 2 } }
+        };
+
+        spoilDamage(pImageContext, damage, ARRAY_LENGTH(damage));
+
+        result = renderFrameDamage( &renderer, &target, damage, ARRAY_LENGTH(damage),
+                                    pImageContext, nullptr );
+    }
+
+    destroyRenderTarget(&renderer, &target);
+    destroyRenderer(&renderer);
+
+    if (VK_SUCCESS != result) {
+        disposeImageContext(pImageContext);
+    }
+
+    return VK_SUCCESS == result;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Decoded images
+//
+//====----------------------------------------------------------------------====
+
+typedef enum SampleKind
+{
+    SAMPLE_KIND_UNORM,
+    SAMPLE_KIND_FLOAT,
+    SAMPLE_KIND_A2B10G10R10
+}
+SampleKind;
+
+// * DecodedImage : rows of bytesPerRow, of which only width pixels are
+//                  hashed or compared
+//
+typedef struct DecodedImage
+{
+    uint32_t       width;
+    uint32_t       height;
+    size_t         bytesPerRow;
+    uint32_t       sampleCount;
+    uint32_t       bitsPerSample;
+    SampleKind     sampleKind;
+    const uint8_t* data;
+    void*          ownedData;
+}
+DecodedImage;
+
+// * decodeImageContext : a view of the host pixels returned by renderImage()
+//
+bool decodeImageContext(const ImageContext* pImageContext, DecodedImage* pImage)
+{
+    *pImage = (DecodedImage){
+        .width       = pImageContext->width,
+        .height      = pImageContext->height,
+        .bytesPerRow = pImageContext->bytesPerRow,
+        .sampleCount = samplesPerPixel(pImageContext->pixelLayout),
+        .data        = pImageContext->data
+    };
+
+    switch (pImageContext->colorPixelFormat)
+    {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8G8B8_UNORM:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            pImage->bitsPerSample = 8;
+            pImage->sampleKind    = SAMPLE_KIND_UNORM;
+            return true;
+
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            pImage->bitsPerSample = 32;
+            pImage->sampleKind    = SAMPLE_KIND_A2B10G10R10;
+            pImage->sampleCount   = 1;
+            return true;
+
+        case VK_FORMAT_R16G16B16A16_UNORM:
+            pImage->bitsPerSample = 16;
+            pImage->sampleKind    = SAMPLE_KIND_UNORM;
+            return true;
+
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            pImage->bitsPerSample = 16;
+            pImage->sampleKind    = SAMPLE_KIND_FLOAT;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// * readTIFFFile : scanlines exactly as stored
+//
+bool readTIFFFile(const char* filename, DecodedImage* pImage)
+{
+    *pImage = (DecodedImage){};
+
+    auto file = TIFFOpen(filename, "r");
+
+    if (nullptr == file) {
+        return false;
+    }
+
+    uint32_t width         = 0;
+    uint32_t height        = 0;
+    uint16_t sampleCount   = 0;
+    uint16_t bitsPerSample = 0;
+    uint16_t sampleFormat  = SAMPLEFORMAT_UINT;
+
+    TIFFGetField(file, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(file, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetField(file, TIFFTAG_SAMPLESPERPIXEL, &sampleCount);
+    TIFFGetField(file, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+    TIFFGetFieldDefaulted(file, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+
+    auto const bytesPerRow = (size_t)TIFFScanlineSize(file);
+    auto       data        = (uint8_t*)malloc(bytesPerRow * height);
+    auto       result      = (nullptr != data);
+
+    for (uint32_t yy = 0; yy < height && result; ++yy) {
+        result = (0 <= TIFFReadScanline(file, data + yy*bytesPerRow, yy, 0));
+    }
+
+    TIFFClose(file);
+
+    if (!result)
+    {
+        free(data);
+        return false;
+    }
+
+    *pImage = (DecodedImage){
+        .width         = width,
+        .height        = height,
+        .bytesPerRow   = bytesPerRow,
+        .sampleCount   = sampleCount,
+        .bitsPerSample = bitsPerSample,
+        .sampleKind    = (SAMPLEFORMAT_IEEEFP == sampleFormat) ? SAMPLE_KIND_FLOAT
+                                                               : SAMPLE_KIND_UNORM,
+        .data          = data,
+        .ownedData     = data
+    };
+
+    return true;
+}
+
+// * disposeDecodedImage
+//
+void disposeDecodedImage(DecodedImage* pImage)
+{
+    free(pImage->ownedData);
+
+    memset( pImage, 0, sizeof(*pImage) );
+}
+
+// * hashDecodedImage : 64-bit FNV-1a of each row's pixels, without padding
+//
+uint64_t hashDecodedImage(const DecodedImage* pImage)
+{
+    auto const pixelBytes = (size_t)pImage->width * pImage->sampleCount
+                          * pImage->bitsPerSample / 8;
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (uint32_t yy = 0; yy < pImage->height; ++yy)
+    {
+        auto const row = pImage->data + yy*pImage->bytesPerRow;
+
+        for (size_t ii = 0; ii < pixelBytes; ++ii)
+        {
+            hash ^= row[ii];
+            hash *= 0x100000001b3ull;
+        }
+    }
+
+    return hash;
+}
+
+// * halfToFloat
+//
+float halfToFloat(uint16_t half) [[unsequenced]]
+{
+    auto const sign     = (half & 0x8000) ? -1.0f : 1.0f;
+    auto const exponent = (half >> 10) & 0x1f;
+    auto const mantissa = half & 0x3ff;
+
+    if (0 == exponent) {
+        return sign * ldexpf((float)mantissa, -24);
+    }
+
+    if (0x1f == exponent) {
+        return (0 == mantissa) ? sign * INFINITY : NAN;
+    }
+
+    return sign * ldexpf((float)(mantissa | 0x400), exponent - 25);
+}
+
+// * getPixel : samples as floats, missing samples are zero
+//
+void getPixel(const DecodedImage* pImage, uint32_t x, uint32_t y, float color[4])
+{
+    auto const row = pImage->data + y*pImage->bytesPerRow;
+
+    color[0] = color[1] = color[2] = color[3] = 0.0f;
+
+    if (SAMPLE_KIND_A2B10G10R10 == pImage->sampleKind)
+    {
+        uint32_t packed = 0;
+        memcpy(&packed, row + 4*x, sizeof(packed));
+
+        color[0] = (float)( packed        & 0x3ff) / 1023.0f;
+        color[1] = (float)((packed >> 10) & 0x3ff) / 1023.0f;
+        color[2] = (float)((packed >> 20) & 0x3ff) / 1023.0f;
+        color[3] = (float)( packed >> 30         ) / 3.0f;
+        return;
+    }
+
+    for (uint32_t ss = 0; ss < pImage->sampleCount && ss < 4; ++ss)
+    {
+        auto const index = (size_t)x * pImage->sampleCount + ss;
+
+        if (8 == pImage->bitsPerSample) {
+            color[ss] = (float)row[index] / 255.0f;
+            continue;
+        }
+
+        uint16_t sample = 0;
+        memcpy(&sample, row + 2*index, sizeof(sample));
+
+        color[ss] = (SAMPLE_KIND_FLOAT == pImage->sampleKind)
+                  ? halfToFloat(sample)
+                  : (float)sample / 65535.0f;
+    }
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Comparison
+//
+//====----------------------------------------------------------------------====
+
+// * diffWithScene : per-pixel report against the analytic scene. Returns
+//                   the number of pixels beyond sampleTolerance
+//
+uint64_t diffWithScene( const char*         modeName,
+                        const DecodedImage* pImage,
+                        PixelLayout         pixelLayout )
+{
+    constexpr uint32_t maxReportedPixels = 8;
+
+    auto const sampleCount = samplesPerPixel(pixelLayout);
+
+    uint64_t differingPixels = 0;
+    float    maxError[4]     = {};
+
+    for (uint32_t yy = 0; yy < pImage->height; ++yy)
+    {
+        for (uint32_t xx = 0; xx < pImage->width; ++xx)
+        {
+            float actual[4]   = {};
+            float expected[4] = {};
+
+            getPixel(pImage, xx, yy, actual);
+            expectedColor(pixelLayout, xx, yy, pImage->width, pImage->height, expected);
+
+            auto isDifferent = false;
+
+            for (uint32_t ss = 0; ss < sampleCount; ++ss)
+            {
+                auto const error = fabsf(actual[ss] - expected[ss]);
+
+                maxError[ss] = fmaxf(maxError[ss], error);
+                isDifferent  = isDifferent || !(error <= sampleTolerance);
+            }
+
+            if (!isDifferent) {
+                continue;
+            }
+
+            if (differingPixels < maxReportedPixels)
+            {
+                printf( "    %s (%u, %u): actual %.4f %.4f %.4f %.4f"
+                        " expected %.4f %.4f %.4f %.4f\n",
+                        modeName, xx, yy,
+                        actual[0], actual[1], actual[2], actual[3],
+                        expected[0], expected[1], expected[2], expected[3] );
+            }
+
+            ++differingPixels;
+        }
+    }
+
+    if (0 < differingPixels)
+    {
+        printf( "    %s: %llu of %llu pixels differ, max error %.4f %.4f %.4f %.4f\n",
+                modeName, (unsigned long long)differingPixels,
+                (unsigned long long)pImage->width * pImage->height,
+                maxError[0], maxError[1], maxError[2], maxError[3] );
+    }
+
+    return differingPixels;
+}
+
+//====----------------------------------------------------------------------====
+//
+// * Golden hashes : "<mode> <hash>" per line
+//
+//====----------------------------------------------------------------------====
+
+typedef struct GoldenHash
+{
+    char     mode[96];
+    uint64_t hash;
+}
+GoldenHash;
+
+constexpr uint32_t maxGoldenHashes = 256;
+
+GoldenHash goldenHashes[maxGoldenHashes];
+GoldenHash currentHashes[maxGoldenHashes];
+
+// * loadGoldenHashes : a missing file is an empty set, in which every
+//                      mode's hash is missing
+//
+uint32_t loadGoldenHashes(const char* filename, GoldenHash* pHashes)
+{
+    auto file = fopen(filename, "r");
+
+    if (nullptr == file) {
+        return 0;
+    }
+
+    uint32_t           count = 0;
+    unsigned long long hash  = 0;
+
+    while ( count < maxGoldenHashes &&
+            2 == fscanf(file, "%95s %llx", pHashes[count].mode, &hash) )
+    {
+        pHashes[count++].hash = hash;
+    }
+
+    fclose(file);
+
+    return count;
+}
+
+// * findGoldenHash
+//
+const GoldenHash* findGoldenHash( const GoldenHash* pHashes,
+                                  uint32_t          count,
+                                  const char*       mode )
+{
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        if (0 == strcmp(pHashes[ii].mode, mode)) {
+            return &pHashes[ii];
+        }
+    }
+
+    return nullptr;
+}
+
+//====----------------------------------------------------------------------====
+// * main
+//====----------------------------------------------------------------------====
+
+int main(const int argc, const char* const argv[])
+{
+    // * Arguments : [--update] [golden file]. Without a golden file
+    //               output is only checked against the scene
+    //
+    auto        isUpdating     = false;
+    const char* goldenFilename = nullptr;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        if (0 == strcmp(argv[ii], "--update")) {
+            isUpdating = true;
+        }
+        else {
+            goldenFilename = argv[ii];
+        }
+    }
+
+    if (isUpdating && nullptr == goldenFilename) {
+        goldenFilename = "golden.txt";
+    }
+
+    auto const isComparing  = (nullptr != goldenFilename);
+    auto const goldenCount  = isComparing ? loadGoldenHashes(goldenFilename, goldenHashes)
+                                          : 0;
+    uint32_t   currentCount = 0;
+
+    uint32_t failures = 0;
+    uint32_t missing  = 0;
+
+    auto const sizeCount   = (uint32_t)( sizeof(sceneSizes)/sizeof(sceneSizes[0]) );
+    auto const formatCount = (uint32_t)( sizeof(formatModes)/sizeof(formatModes[0]) );
+    auto const layoutCount = (uint32_t)( sizeof(layoutModes)/sizeof(layoutModes[0]) );
+
+    for (uint32_t zz = 0; zz < sizeCount; ++zz)
+    for (uint32_t ff = 0; ff < formatCount; ++ff)
+    for (uint32_t ll = 0; ll < layoutCount; ++ll)
+    for (uint32_t pp = 0; pp < READBACK_PATH_COUNT; ++pp)
+    {
+        auto const size        = sceneSizes[zz];
+        auto const formatMode  = &formatModes[ff];
+        auto const pixelLayout = layoutModes[ll].pixelLayout;
+        auto const path        = (ReadbackPath)pp;
+
+        char pathName[80] = {};
+
+        snprintf( pathName, sizeof(pathName), "%ux%u/%s/%s%s%s",
+                  size.width, size.height, formatMode->name, layoutModes[ll].name,
+                  (READBACK_PATH_DEFAULT == path) ? "" : "/", readbackPathNames[pp] );
+
+        // * Render
+        //
+        ImageContext imageContext = {};
+
+        if ( !renderPathImage( path, size.width, size.height, formatMode->format,
+                               pixelLayout, &imageContext ) )
+        {
+            printf( "%s: %s\n", pathName,
+                    formatMode->isRequired ? "FAILED to render" : "unsupported" );
+
+            failures += formatMode->isRequired ? 1 : 0;
+            continue;
+        }
+
+        // * Each encoding of the rendered pixels. Paths other than the
+        //   default only change how pixels reach the host
+        //
+        auto const encodeCount = (uint32_t)( (READBACK_PATH_DEFAULT == path)
+                                             ? ENCODE_MODE_COUNT : ENCODE_MODE_TIFF );
+
+        for (uint32_t ee = 0; ee < encodeCount; ++ee)
+        {
+            char modeName[96] = {};
+
+            snprintf( modeName, sizeof(modeName), "%s/%s",
+                      pathName, encodeModeNames[ee] );
+
+            DecodedImage image = {};
+            auto         isDecoded = false;
+
+            if (ENCODE_MODE_RAW == ee) {
+                isDecoded = decodeImageContext(&imageContext, &image);
+            }
+            else
+            {
+                const TIFFWriteOptions writeOptions = {
+                    .narrowTo8Bits    = (ENCODE_MODE_TIFF_8BIT_STRAIGHT == ee),
+                    .unassociateAlpha = (ENCODE_MODE_TIFF_8BIT_STRAIGHT == ee)
+                };
+
+                //  - float samples cannot be narrowed
+                if ( writeOptions.narrowTo8Bits &&
+                     VK_FORMAT_R16G16B16A16_SFLOAT == imageContext.colorPixelFormat )
+                {
+                    continue;
+                }
+
+                isDecoded = saveRGBATIFFFile( "output.verify.tiff", &imageContext,
+                                              &writeOptions )
+                         && readTIFFFile("output.verify.tiff", &image);
+
+                remove("output.verify.tiff");
+            }
+
+            if (!isDecoded)
+            {
+                printf("%s: FAILED to encode or decode\n", modeName);
+                ++failures;
+                continue;
+            }
+
+            // * Hash and compare
+            //
+            auto const hash   = hashDecodedImage(&image);
+            auto const golden = findGoldenHash(goldenHashes, goldenCount, modeName);
+
+            auto const differingPixels = diffWithScene(modeName, &image, pixelLayout);
+
+            const char* status = "ok";
+
+            if (0 < differingPixels) {
+                status = "DIFFERS from scene";
+            }
+            else if (isComparing && nullptr == golden) {
+                status = "MISSING golden hash";
+            }
+            else if (isComparing && golden->hash != hash) {
+                status = "MISMATCH with golden hash";
+            }
+
+            printf("%s: %016llx %s\n", modeName, (unsigned long long)hash, status);
+
+            //  - an update records missing hashes and replaces mismatched
+            //    ones, so long as the pixels still match the scene
+            auto const isMismatch = isComparing &&
+                                    (nullptr == golden || golden->hash != hash);
+
+            failures += (0 < differingPixels || (isMismatch && !isUpdating)) ? 1 : 0;
+            missing  += (isComparing && nullptr == golden) ? 1 : 0;
+
+            if (currentCount < maxGoldenHashes)
+            {
+                memcpy(currentHashes[currentCount].mode, modeName, sizeof(modeName));
+                currentHashes[currentCount++].hash = hash;
+            }
+
+            disposeDecodedImage(&image);
+        }
+
+        disposeImageContext(&imageContext);
+    }
+
+    // * Update : only output that matches the scene may become golden
+    //
+    if (isUpdating && 0 == failures)
+    {
+        auto file = fopen(goldenFilename, "w");
+
+        for (uint32_t ii = 0; ii < currentCount && nullptr != file; ++ii)
+        {
+            fprintf( file, "%s %016llx\n", currentHashes[ii].mode,
+                     (unsigned long long)currentHashes[ii].hash );
+        }
+
+        if (nullptr == file || 0 != fclose(file))
+        {
+            printf("Failed to write %s\n", goldenFilename);
+            return EXIT_FAILURE;
+        }
+
+        printf("Wrote %u golden hashes to %s\n", currentCount, goldenFilename);
+    }
+    else if (0 < missing)
+    {
+        printf( "%u modes have no golden hash, run `make golden` on the reference "
+                "device to record them\n", missing );
+    }
+
+    printf("%u failure(s)\n", failures);
+
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}